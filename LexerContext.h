@@ -8,11 +8,33 @@
 
 #include <string>
 #include <stack>
+#include <deque>
+#include <cstring>
+#include <utility>
 
+#include "TipPod.h"
 #include "TipPodNode.h"
+#include "TipPodValue.h"
+#include "TipPodBlockPodValue.h"
+#include "TipPodSource.h"
+#include "TipPodSourcePodValue.h"
+#include "TipPodUtils.h"
 
 namespace TipPod {
 
+//
+// Span of the source text matched by the lexer for an identifier or string
+// token (sans quotes).  'escaped' is set if the text of a string contains
+// escape sequences which still need to be decoded.
+//
+struct LexerSpan
+{
+    const char* text;
+    size_t      length;
+    bool        escaped;
+};
+
+
 // 
 // This will be available as global 'state' during parsing.  It is created
 // and passed to yyparse() in TipPod::parseFile().
@@ -20,7 +42,9 @@ namespace TipPod {
 class LexerContext
 {
 public:
-    LexerContext() : current(), stack(), parent(NULL), sourcefile() {}
+    LexerContext() : current(), stack(), parent(NULL), sourcefile(),
+                     source(NULL), flags(PARSE_DEFAULT), nodeBegin(NULL), blockOpen(NULL),
+                     blockTail(NULL), formats(), names() {}
 
     // <user-specified block "scope type", nodes in block>
     typedef std::pair<std::string, TipPod::PodNodeDeque> BlockScope;
@@ -30,7 +54,155 @@ public:
 
     TipPod::PodNode* parent;
 
-    std::string sourcefile;
+    std::string sourcefile; // File name to record on each node
+
+    TipPod::PodSource* source; // Text being scanned
+    int                flags;  // TipPod::ParseFlags
+
+    // For PARSE_KEEP_FORMAT: where the text of the next node in the current
+    // block starts (after the node before it, or the '{'), and where the
+    // '{' and the text after the last node were in the block just parsed
+    const char* nodeBegin;
+    const char* blockOpen;
+    const char* blockTail;
+
+    // Start a new, nested block context.
+    void pushScope(const LexerSpan& scopeType)
+    {
+        stack.push(BlockScope());
+        stack.top().first.swap(current.first);
+        stack.top().second.swap(current.second);
+        current.first.assign(scopeType.text, scopeType.length);
+    }
+
+    // Move the nodes of the current block context into 'block', and return
+    // to the enclosing context.
+    void popScope(TipPod::BlockPodValue* block)
+    {
+        block->setScopeType(current.first);
+        block->value().swap(current.second);
+        if (!stack.empty())
+        {
+            current.first.swap(stack.top().first);
+            current.second.swap(stack.top().second);
+            stack.pop();
+        }
+    }
+
+    // Note where a block's text starts, before parsing the nodes in it
+    void openBlockFormat(const char* open)
+    {
+        if (!(flags & PARSE_KEEP_FORMAT)) return;
+        formats.push(std::make_pair(nodeBegin, open));
+        nodeBegin = open;
+    }
+
+    // And where it ends, going back to the enclosing block
+    void closeBlockFormat()
+    {
+        if (!(flags & PARSE_KEEP_FORMAT)) return;
+        blockOpen = formats.top().second;
+        blockTail = nodeBegin;
+        nodeBegin = formats.top().first;
+        formats.pop();
+    }
+
+    // Give 'node' a PodNodeFormat for its text, from 'start' to 'end'.
+    // 'valueBegin' and 'valueEnd' are NULL if it has no value.
+    void keepFormat(TipPod::PodNode* node, const char* start, const char* valueBegin,
+                    const char* valueEnd, const char* end)
+    {
+        if (!(flags & PARSE_KEEP_FORMAT)) return;
+        TipPod::PodNodeFormat* format = new TipPod::PodNodeFormat(source);
+        format->begin = nodeBegin;
+        format->start = start;
+        format->valueBegin = valueBegin;
+        format->valueEnd = valueEnd;
+        format->end = end;
+        if (node->isBlock())
+        {
+            format->open = blockOpen;
+            format->tailBegin = blockTail;
+        }
+        node->setFormat(format);
+        nodeBegin = end;
+    }
+
+    std::string str(const LexerSpan& span) const
+    {
+        return std::string(span.text, span.length);
+    }
+
+    // Span for "<a><separator><b>".  If the tokens were adjacent in the source,
+    // this is just a larger span of it.  Otherwise the joined text is kept
+    // here until parsing is finished.
+    LexerSpan join(const LexerSpan& a, const char* separator, const LexerSpan& b)
+    {
+        const size_t separatorLength = strlen(separator);
+        LexerSpan result = a;
+        if (b.text == a.text + a.length + separatorLength)
+        {
+            result.length += separatorLength + b.length;
+        }
+        else
+        {
+            names.push_back(str(a) + separator + str(b));
+            result.text = names.back().data();
+            result.length = names.back().size();
+        }
+        return result;
+    }
+
+    TipPod::PodValue* newStringValue(const LexerSpan& span) const
+    {
+        if (flags & PARSE_ZERO_COPY)
+        {
+            return new TipPod::SourceStringPodValue(source, span.text, span.length, span.escaped);
+        }
+        else if (span.escaped)
+        {
+            std::string text;
+            unescapeString(span.text, span.length, text);
+            return new TipPod::StringPodValue(text);
+        }
+        return new TipPod::StringPodValue(str(span));
+    }
+
+    TipPod::PodValue* newIdentifierValue(const LexerSpan& span) const
+    {
+        if ((flags & PARSE_ZERO_COPY) && source->contains(span.text))
+        {
+            return new TipPod::SourceIdentifierPodValue(source, span.text, span.length);
+        }
+        return new TipPod::IdentifierPodValue(str(span));
+    }
+
+    // In lazy scalar mode, numbers keep their text and are converted later.
+    // Otherwise the lexer has already converted them to 'value'.
+    TipPod::PodValue* newIntValue(const LexerSpan& span, int value) const
+    {
+        if (flags & PARSE_LAZY_SCALARS)
+        {
+            return new TipPod::SourceIntPodValue(source, span.text, span.length);
+        }
+        return new TipPod::IntPodValue(value);
+    }
+
+    TipPod::PodValue* newFloatValue(const LexerSpan& span, float value) const
+    {
+        if (flags & PARSE_LAZY_SCALARS)
+        {
+            return new TipPod::SourceFloatPodValue(source, span.text, span.length);
+        }
+        return new TipPod::FloatPodValue(value);
+    }
+
+private:
+    // Where the enclosing blocks' next nodes start, and their '{'s
+    std::stack<std::pair<const char*, const char*> > formats;
+
+    std::deque<std::string> names;  // Storage for join()ed names not found verbatim
+                                    // in the source.  (deque, so pointers are stable)
 };
 
 
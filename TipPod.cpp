@@ -20,6 +20,7 @@
 #include "TipPodNode.h"
 #include "TipPodBlockPodValue.h"
 #include "TipPodUtils.h"
+#include "TipPodSource.h"
 #include "LexerContext.h"
 
 extern const char* TipPod_VERSIONTAG;
@@ -30,45 +31,104 @@ namespace TipPod {
 #warning TODO: Move these to static factory methods on the TipPod::PodNode class
 
 // *****************************************************************************
-PodNode* parseFile(const std::string& filename)
-{ 
-    if (filename.empty())
+//
+// 'end', moved past a comment after it on the same line, if there is one.
+// A // or # comment takes its newline with it, so that whatever is written
+// after the node when it's moved doesn't end up in the comment.
+//
+static const char* restOfLine(const char* end)
+{
+    const char* next = end;
+    while (*next == ' ' || *next == '\t') ++next;
+    if (next[0] == '#' || (next[0] == '/' && next[1] == '/'))
     {
-        return NULL;
+        while (*next && *next != '\n' && *next != '\r') ++next;
+        if (next[0] == '\r' && next[1] == '\n') ++next;
+        if (*next == '\n') ++next;
+        return next;
     }
+    if (next[0] == '/' && next[1] == '*')
+    {
+        for (next += 2; *next && *next != '\n' && *next != '\r'; ++next)
+        {
+            if (next[0] == '*' && next[1] == '/') return next + 2;
+        }
+    }
+    return end;
+}
 
+
+// *****************************************************************************
+//
+// Give comments after a '{' or a node on the same line to the block or the
+// node, rather than to the node after them.  Done once the whole source
+// has been scanned, and flex has put back the character it replaced with
+// a NUL just past the last token.
+//
+static void keepLineComments(PodNode& node)
+{
+    PodNodeFormat* format = node.format();
+    if (!format || !format->open) return;
+
+    const char* previousEnd = format->open;
+    if (!format->whole) format->open = restOfLine(format->open);
+    const char* movedEnd = format->open;
+    const PodNodeDeque& block = node.asBlock();
+    for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+    {
+        PodNodeFormat* child = (*iter)->format();
+        if (!child) continue;
+        if (child->begin == previousEnd) child->begin = movedEnd;
+        previousEnd = child->end;
+        movedEnd = child->end = restOfLine(child->end);
+        keepLineComments(**iter);
+    }
+    if (format->tailBegin == previousEnd) format->tailBegin = movedEnd;
+}
+
+// *****************************************************************************
+PodNode* parseSource(PodSource* source, int flags)
+{
 #if YYDEBUG
     extern int yydebug;
     const int yydebug_prev = ::yydebug;
+    ::yydebug = bool(getenv("TIP_POD_VERBOSE_DEBUG"));
 #endif
 
-    FILE *pod_in = fopen(filename.c_str(), "r");
-    if (!pod_in)
+    // Initialize the context struct.  In zero-copy mode, nodes don't get
+    // their own copy of the file name; they share the root node's.
+    LexerContext ctx;
+    if (!(flags & PARSE_ZERO_COPY))
     {
-        throw std::runtime_error(strerror(errno));
+        ctx.sourcefile = source->name();
     }
-    try
-    {
-#if YYDEBUG
-        ::yydebug = bool(getenv("TIP_POD_VERBOSE_DEBUG"));
-#endif
-
-        // Build and init scanner (i.e. lexer, i.e. tokenizer)
-        yyscan_t scanner;
-        yylex_init(&scanner);
-
-        // Initialize the context struct
-        LexerContext ctx;
-        ctx.sourcefile = filename;
-        yylex_init_extra(&ctx, &scanner);
+    ctx.source = source;
+    ctx.flags = flags;
+    ctx.nodeBegin = source->data();
 
-        // Tell the lexer to get its input from a FILE* other than stdin
-        yyset_in(pod_in, scanner);
+    // Build and init scanner (i.e. lexer, i.e. tokenizer)
+    yyscan_t scanner;
+    yylex_init_extra(&ctx, &scanner);
 
+    // Tell the lexer to scan the source buffer directly, rather than 
+    // copying it in chunks from a FILE*
+    YY_BUFFER_STATE buffer = yy_scan_buffer(source->scanBuffer(), source->scanBufferSize(),
+                                            scanner);
+    yyset_lineno(1, scanner);
 
+    try
+    {
         // Start the parser
         const int result = yyparse(scanner, &ctx);
 
+        // flex puts a NUL after each token while it scans, and if it
+        // stopped short of the end (at an unknown token) the last one is
+        // still there.  Switching to another buffer puts the character
+        // back, so the source is as it was for the spans and values that
+        // point into it.
+        yy_scan_string("", scanner);
+        yy_delete_buffer(buffer, scanner);
+
         // These should always be true--if we encountered a parse error,
         // we would have thrown past this.
         assert(result == 0);
@@ -79,9 +139,20 @@ PodNode* parseFile(const std::string& filename)
         // So we contruct a thin wrapper around what we found in the file to 
         // return it in.
         //
-        BlockPodValue* rootBlock = new BlockPodValue(ctx.current.second, ctx.current.first);
+        BlockPodValue* rootBlock = new BlockPodValue;
+        ctx.popScope(rootBlock);
         PodNode* rootNode = new PodNode("", "", rootBlock);
-        rootNode->setSource(filename, 0);
+        rootNode->setSource(source->name(), 0);
+        if (flags & PARSE_KEEP_FORMAT)
+        {
+            PodNodeFormat* format = new PodNodeFormat(source);
+            format->begin = format->start = format->valueBegin = format->open = source->data();
+            format->tailBegin = ctx.nodeBegin;
+            format->valueEnd = format->end = source->data() + source->size();
+            format->whole = true;
+            rootNode->setFormat(format);
+            keepLineComments(*rootNode);
+        }
 
         // Clean up
         yylex_destroy(scanner);
@@ -92,92 +163,56 @@ PodNode* parseFile(const std::string& filename)
     }
     catch (...)
     {
+        yylex_destroy(scanner);
 #if YYDEBUG
         ::yydebug = yydebug_prev;
 #endif
-        fclose(pod_in);
         throw;
     }
 }
 
 
 // *****************************************************************************
-PodNode* parseText(const std::string& text, const std::string& source)
+PodNode* parseFile(const std::string& filename, int flags)
 { 
-    // NOTE: This is currently a hack--it writes the given text to
-    // a tempfile and parses that.  Getting flex to read directly 
-    // from a string is a bit more work...
-
-    if (text.empty())
+    if (filename.empty())
     {
         return NULL;
     }
 
-#if YYDEBUG
-    extern int yydebug;
-    const int yydebug_prev = ::yydebug;
-#endif
-
-    FILE *pod_in = tmpfile();
-    if (!pod_in)
+    PodSource* source = PodSource::fromFile(filename);
+    try
     {
-        throw std::runtime_error(strerror(errno));
+        PodNode* rootNode = parseSource(source, flags);
+        source->unref();
+        return rootNode;
     }
-    try
+    catch (...)
     {
-#if YYDEBUG
-        ::yydebug = bool(getenv("TIP_POD_VERBOSE_DEBUG"));
-#endif
-        
-        if (fwrite(text.c_str(), text.size(), 1, pod_in) != 1)
-        {
-            throw std::runtime_error("Failed to write temp file");
-        }
-        fflush(pod_in);
-        fseek(pod_in, 0L, SEEK_SET);
-
-        // Build and init scanner (i.e. lexer, i.e. tokenizer)
-        yyscan_t scanner;
-        yylex_init(&scanner);
-
-        // Initialize the context struct
-        LexerContext ctx;
-        ctx.sourcefile = source;
-        yylex_init_extra(&ctx, &scanner);
-
-        // Tell the lexer to get its input from a FILE* other than stdin
-        yyset_in(pod_in, scanner);
-
-        // Start the parser
-        const int result = yyparse(scanner, &ctx);
+        source->unref();
+        throw;
+    }
+}
 
-        // These should always be true--if we encountered a parse error,
-        // we would have thrown past this.
-        assert(result == 0);
-        assert(ctx.stack.size() == 0);
 
-        //
-        // Parsing has already occurred, and the results are stored in ctx.
-        // So we contruct a thin wrapper around what we found in the file to 
-        // return it in.
-        //
-        BlockPodValue* rootBlock = new BlockPodValue(ctx.current.second, ctx.current.first);
-        PodNode* rootNode = new PodNode("", "", rootBlock);
-        rootNode->setSource(source, 0);
+// *****************************************************************************
+PodNode* parseText(const std::string& text, const std::string& sourcename, int flags)
+{ 
+    if (text.empty())
+    {
+        return NULL;
+    }
 
-        // Clean up
-        yylex_destroy(scanner);
-#if YYDEBUG
-        ::yydebug = yydebug_prev;
-#endif
+    PodSource* source = PodSource::fromText(text, sourcename);
+    try
+    {
+        PodNode* rootNode = parseSource(source, flags);
+        source->unref();
         return rootNode;
     }
     catch (...)
     {
-#if YYDEBUG
-        ::yydebug = yydebug_prev;
-#endif
-        fclose(pod_in);
+        source->unref();
         throw;
     }
 }
@@ -33,18 +33,35 @@ extern char** environ;
 
 namespace TipPod {
 
+// Flags for parseFile() and parseText(), which may be or'd together.
+enum ParseFlags {
+                  PARSE_DEFAULT   = 0,
+                  PARSE_ZERO_COPY = 1<<0, // STRING and IDENTIFIER values refer to the 
+                                          // text of the file, which stays in memory 
+                                          // until the last such value is deleted. 
+                                          // Escapes are decoded on first access.
+                  PARSE_LAZY_SCALARS = 1<<1, // INT and FLOAT values keep their text, and are
+                                             // only converted (and range checked) on first 
+                                             // access.  write() reproduces the original text.
+                  PARSE_KEEP_FORMAT = 1<<2,  // Nodes note where their text is, and the file 
+                                             // stays in memory.  write() of the root node
+                                             // copies the text of everything that hasn't
+                                             // changed, comments and all.  See PodNodeFormat.
+                };
+
 // Parse the given file.  Returns a PodNode whose name and semantic type are
 // both "", and whose value is a BlockPodValue containing all the 
 // nodes in the file.
 // Throws on error.
-PodNode* parseFile(const std::string& filename);
+PodNode* parseFile(const std::string& filename, int flags=PARSE_DEFAULT);
 
 
 // Parse the given text.  Returns a PodNode whose name and semantic type are
 // both "", and whose value is a BlockPodValue containing all the 
 // nodes in the file.
 // Throws on error.
-PodNode* parseText(const std::string& text, const std::string& source="");
+PodNode* parseText(const std::string& text, const std::string& source="", 
+                   int flags=PARSE_DEFAULT);
 
 
 // Parse the given environment.  Returns a PodNode whose name and semantic 
@@ -23,17 +23,21 @@ BlockPodValue::~BlockPodValue()
 
 
 // *****************************************************************************
-void BlockPodValue::write(std::ostream& output, int indent) const
+void BlockPodValue::write(PodWriteBuffer& output, int indent) const
 {
-    if (!m_scopeType.empty()) output << m_scopeType << " ";
-    output << "{" << std::endl;
+    if (!m_scopeType.empty())
+    {
+        output.append(m_scopeType);
+        output.append(' ');
+    }
+    output.append("{\n", 2);
     for (PodNodeDeque::const_iterator iter = m_value.begin();
             iter != m_value.end(); ++iter)
     {
         (*iter)->write(output, indent+1);
     }
-    for (int i = 0; i < indent; ++i) output << "    ";
-    output << "}";
+    output.indent(indent);
+    output.append('}');
 }
 
 
@@ -7,7 +7,6 @@
 #define __TIPPODBLOCKPODVALUE_H__
 
 #include <fstream>
-#include <deque>
 #include <string>
 
 #include "TipPodValue.h"
@@ -23,7 +22,7 @@ namespace TipPod {
 class BlockPodValue : public PodValue 
 {
 public:
-    typedef std::deque<PodNode*> PodNodeDeque;
+    typedef TipPod::PodNodeDeque PodNodeDeque;
 
     // Default constructor
     BlockPodValue() : PodValue(PodNode::BLOCK), m_value(), m_scopeType() {}
@@ -39,7 +38,8 @@ public:
     // Destructor
     virtual ~BlockPodValue();
 
-    virtual void write(std::ostream& output, int indent=0) const;
+    using PodValue::write;
+    virtual void write(PodWriteBuffer& output, int indent=0) const;
 
     virtual const PodNodeDeque& value() const { return m_value; }
     virtual PodNodeDeque& value() { return m_value; }
@@ -0,0 +1,263 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <algorithm>
+#include <sstream>
+
+#include "TipPodDiff.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+static const size_t NO_MATCH = size_t(-1);
+
+
+// *****************************************************************************
+//
+// A child of one of the two blocks being compared, for sorting children
+// into groups with the same name
+//
+struct DiffChild
+{
+    uint64_t       nameHash;
+    const PodNode* node;
+    size_t         index;  // In its block
+    bool           after;  // Which block
+
+    bool operator<(const DiffChild& other) const
+        {
+            if (nameHash != other.nameHash) return nameHash < other.nameHash;
+            const int names = node->podName().compare(other.node->podName());
+            if (names != 0) return names < 0;
+            if (after != other.after) return !after;
+            return index < other.index;
+        }
+};
+
+
+static void diffNodes(const PodNode& before, const PodNode& after, const std::string& path,
+                      std::vector<PodDiffEntry>& changes);
+
+
+// *****************************************************************************
+static void addEntry(PodDiffEntry::Kind kind, const std::string& path, const PodNode* before,
+                     const PodNode* after, std::vector<PodDiffEntry>& changes)
+{
+    PodDiffEntry entry;
+    entry.kind = kind;
+    entry.path = path;
+    entry.before = before;
+    entry.after = after;
+    changes.push_back(entry);
+}
+
+
+// *****************************************************************************
+//
+// Path of a child, by name if it's the first with its name in the block,
+// by index otherwise
+//
+static std::string childPath(const std::string& path, const PodNode& child, size_t index,
+                             bool firstWithName)
+{
+    if (firstWithName && !child.podName().empty())
+    {
+        return path.empty() ? child.podName() : path + "." + child.podName();
+    }
+    std::ostringstream step;
+    step << path << "[" << index << "]";
+    return step.str();
+}
+
+
+// *****************************************************************************
+//
+// Match the children of one name (or none) in two blocks: identical ones
+// first, then the rest in order
+//
+static void matchGroup(const DiffChild* befores, size_t beforeCount,
+                       const DiffChild* afters, size_t afterCount,
+                       std::vector<size_t>& beforeMatch, std::vector<size_t>& afterMatch)
+{
+    if (beforeCount > 1 || afterCount > 1)
+    {
+        // Befores by hash, and how many of each run of equal hashes have
+        // been matched so far, in order
+        std::vector<std::pair<uint64_t, size_t> > hashes(beforeCount);
+        for (size_t b = 0; b < beforeCount; ++b)
+        {
+            hashes[b] = std::make_pair(befores[b].node->contentHash(), b);
+        }
+        std::sort(hashes.begin(), hashes.end());
+        std::vector<size_t> taken(beforeCount, 0);
+
+        for (size_t a = 0; a < afterCount; ++a)
+        {
+            const uint64_t hash = afters[a].node->contentHash();
+            const size_t run = std::lower_bound(hashes.begin(), hashes.end(),
+                                                std::make_pair(hash, size_t(0))) - hashes.begin();
+            if (run == beforeCount) continue;
+            const size_t next = run + taken[run];
+            if (next < beforeCount && hashes[next].first == hash)
+            {
+                ++taken[run];
+                beforeMatch[befores[hashes[next].second].index] = afters[a].index;
+                afterMatch[afters[a].index] = befores[hashes[next].second].index;
+            }
+        }
+    }
+
+    size_t b = 0;
+    for (size_t a = 0; a < afterCount; ++a)
+    {
+        if (afterMatch[afters[a].index] != NO_MATCH) continue;
+        while (b < beforeCount && beforeMatch[befores[b].index] != NO_MATCH) ++b;
+        if (b == beforeCount) break;
+        beforeMatch[befores[b].index] = afters[a].index;
+        afterMatch[afters[a].index] = befores[b].index;
+    }
+}
+
+
+// *****************************************************************************
+//
+// Sort the children of both blocks into groups with the same name, and
+// note which is the first of its name in each block
+//
+static void groupByName(const PodNodeDeque& befores, const PodNodeDeque& afters,
+                        std::vector<DiffChild>& children,
+                        std::vector<bool>& beforeFirst, std::vector<bool>& afterFirst)
+{
+    children.reserve(befores.size() + afters.size());
+    for (int side = 0; side < 2; ++side)
+    {
+        const PodNodeDeque& block = side ? afters : befores;
+        for (size_t i = 0; i < block.size(); ++i)
+        {
+            const std::string& name = block[i]->podName();
+            DiffChild child = { hashBytesFast(name.data(), name.size()), block[i], i, side != 0 };
+            children.push_back(child);
+        }
+    }
+    std::sort(children.begin(), children.end());
+
+    beforeFirst.assign(befores.size(), false);
+    afterFirst.assign(afters.size(), false);
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        if (i == 0 || children[i].after != children[i - 1].after
+            || children[i].nameHash != children[i - 1].nameHash
+            || children[i].node->podName() != children[i - 1].node->podName())
+        {
+            (children[i].after ? afterFirst : beforeFirst)[children[i].index] = true;
+        }
+    }
+}
+
+
+// *****************************************************************************
+static void diffBlocks(const PodNode& before, const PodNode& after, const std::string& path,
+                       std::vector<PodDiffEntry>& changes)
+{
+    const PodNodeDeque& befores = before.asBlock();
+    const PodNodeDeque& afters = after.asBlock();
+    std::vector<DiffChild> children;
+    std::vector<bool> beforeFirst, afterFirst;
+
+    // Usually the names are all the same, in the same order, and the
+    // children are compared in place.  Their paths are only worked out
+    // if one of them differs.
+    bool inOrder = befores.size() == afters.size();
+    for (size_t i = 0; inOrder && i < befores.size(); ++i)
+    {
+        inOrder = befores[i]->podName() == afters[i]->podName();
+    }
+    if (inOrder)
+    {
+        for (size_t i = 0; i < afters.size(); ++i)
+        {
+            if (befores[i]->contentHash() == afters[i]->contentHash()) continue;
+            if (children.empty()) groupByName(befores, afters, children, beforeFirst, afterFirst);
+            diffNodes(*befores[i], *afters[i], childPath(path, *afters[i], i, afterFirst[i]),
+                      changes);
+        }
+        return;
+    }
+
+    groupByName(befores, afters, children, beforeFirst, afterFirst);
+    std::vector<size_t> beforeMatch(befores.size(), NO_MATCH);
+    std::vector<size_t> afterMatch(afters.size(), NO_MATCH);
+    for (size_t start = 0; start < children.size(); )
+    {
+        size_t middle = start, end = start;
+        while (end < children.size()
+               && children[end].nameHash == children[start].nameHash
+               && children[end].node->podName() == children[start].node->podName())
+        {
+            if (!children[end].after) ++middle;
+            ++end;
+        }
+        matchGroup(&children[start], middle - start, &children[middle], end - middle,
+                   beforeMatch, afterMatch);
+        start = end;
+    }
+
+    for (size_t i = 0; i < befores.size(); ++i)
+    {
+        if (beforeMatch[i] == NO_MATCH)
+        {
+            addEntry(PodDiffEntry::REMOVED, childPath(path, *befores[i], i, beforeFirst[i]),
+                     befores[i], NULL, changes);
+        }
+    }
+    for (size_t i = 0; i < afters.size(); ++i)
+    {
+        if (afterMatch[i] == NO_MATCH)
+        {
+            addEntry(PodDiffEntry::ADDED, childPath(path, *afters[i], i, afterFirst[i]),
+                     NULL, afters[i], changes);
+        }
+        else if (befores[afterMatch[i]]->contentHash() != afters[i]->contentHash())
+        {
+            diffNodes(*befores[afterMatch[i]], *afters[i],
+                      childPath(path, *afters[i], i, afterFirst[i]), changes);
+        }
+    }
+}
+
+
+// *****************************************************************************
+static void diffNodes(const PodNode& before, const PodNode& after, const std::string& path,
+                      std::vector<PodDiffEntry>& changes)
+{
+    if (before.contentHash() == after.contentHash())
+    {
+        return;
+    }
+    if (before.isBlock() && after.isBlock()
+        && before.podName() == after.podName()
+        && before.podType() == after.podType()
+        && before.blockScopeType() == after.blockScopeType())
+    {
+        diffBlocks(before, after, path, changes);
+    }
+    else
+    {
+        addEntry(PodDiffEntry::CHANGED, path, &before, &after, changes);
+    }
+}
+
+
+// *****************************************************************************
+std::vector<PodDiffEntry> diff(const PodNode& before, const PodNode& after)
+{
+    std::vector<PodDiffEntry> changes;
+    diffNodes(before, after, "", changes);
+    return changes;
+}
+
+
+}  //  End namespace TipPod
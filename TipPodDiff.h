@@ -0,0 +1,64 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODDIFF_H__
+#define __TIPPODDIFF_H__
+
+#include <string>
+#include <vector>
+
+#include "TipPodNode.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// One difference between two pods, found by diff()
+//
+struct PodDiffEntry
+{
+    enum Kind { ADDED, REMOVED, CHANGED };
+
+    Kind           kind;
+    std::string    path;    // See PodPath; in 'after', except for REMOVED
+    const PodNode* before;  // NULL if ADDED
+    const PodNode* after;   // NULL if REMOVED
+};
+
+
+// *****************************************************************************
+//
+// What was added, removed and changed going from one pod to another:
+//
+//     std::vector<PodDiffEntry> changes = diff(*r1, *r2);
+//
+// RULES:
+//
+// * Children of a block are matched by podName.  Where several have the
+//   same name, or none, identical nodes are matched first, and the rest in
+//   order, so inserting an unnamed node in a list adds one entry rather
+//   than changing everything after it.
+// * Matched blocks with the same podType and scope type are compared child
+//   by child.  Any other matched nodes that differ are CHANGED as a whole.
+// * Paths name each node by its podName where that finds it, and by its
+//   index in its block ("shots[3].frames") where it doesn't.
+// * Entries for a block list what was removed from it, then what was
+//   added to or changed in it, in order.
+//
+// NOTES:
+//
+// * Subtrees are compared by PodNode::contentHash(), so identical ones are
+//   skipped without looking inside them.  Hashes are kept by the nodes, so
+//   diffing against the same pod again only looks at what has changed.
+// * Entries point into both pods, which must outlive them.
+//
+std::vector<PodDiffEntry> diff(const PodNode& before, const PodNode& after);
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODDIFF_H__
@@ -0,0 +1,408 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#include "TipPod.h"
+#include "TipPodDiskCache.h"
+#include "TipPodSource.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// A cache entry is a .podb file with the path of the .pod file and this
+// trailer appended to it.  PodSnapshot::load() ignores anything after the
+// snapshot itself.
+//
+struct PodDiskCacheTrailer
+{
+    char     magic[4];          // "PODC"
+    uint32_t pathLength;        // Of the path, which comes just before this
+    uint64_t sourceSize;
+    int64_t  sourceMtimeSec;
+    int64_t  sourceMtimeNsec;
+    uint64_t contentHash;       // hashBytes() of the whole .pod file
+};
+
+static const char ENTRY_MAGIC[4] = { 'P', 'O', 'D', 'C' };
+static const char ENTRY_SUFFIX[] = ".podb";
+
+// Temporary files from writeFileAtomically() older than this were left
+// behind by a writer that died.
+static const time_t ABANDONED_SECONDS = 3600;
+
+
+// *****************************************************************************
+static bool sameFile(const struct stat& a, const struct stat& b)
+{
+    return a.st_size == b.st_size
+           && a.st_mtim.tv_sec == b.st_mtim.tv_sec
+           && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+
+// *****************************************************************************
+static bool hashFile(const std::string& filename, uint64_t& hash)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    hash = HASH_SEED;
+    char buffer[65536];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0)
+        {
+            close(fd);
+            return false;
+        }
+        hash = hashBytes(buffer, n, hash);
+    }
+    close(fd);
+    return true;
+}
+
+
+// *****************************************************************************
+static bool readAt(int fd, void* buffer, size_t size, off_t offset)
+{
+    char* data = static_cast<char*>(buffer);
+    while (size > 0)
+    {
+        const ssize_t n = pread(fd, data, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+
+// *****************************************************************************
+PodDiskCache::PodDiskCache(const std::string& directory,
+                           size_t maxBytes,
+                           bool verifyContent)
+        : m_directory(directory),
+          m_maxBytes(maxBytes),
+          m_verifyContent(verifyContent),
+          m_stats()
+{
+    if (mkdir(m_directory.c_str(), 0777) != 0 && errno != EEXIST)
+    {
+        throw std::runtime_error(m_directory + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (stat(m_directory.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        throw std::runtime_error(m_directory + ": Not a directory");
+    }
+}
+
+
+// *****************************************************************************
+PodSnapshot* PodDiskCache::load(const std::string& filename)
+{
+    // Entries are keyed by the real path, so the same file reached by
+    // different names has one entry.
+    std::string path = filename;
+    if (char* real = realpath(filename.c_str(), NULL))
+    {
+        path = real;
+        free(real);
+    }
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+
+    if (PodSnapshot* snapshot = lookup(path, st))
+    {
+        return snapshot;
+    }
+    __sync_fetch_and_add(&m_stats.misses, 1);
+
+    //
+    // Parse the file from a buffer we can hash before scanning it, so the
+    // file is only read once.
+    //
+    PodSource* source = PodSource::fromFile(filename);
+    const uint64_t contentHash = hashBytes(source->data(), source->size());
+    const size_t sourceSize = source->size();
+    PodNode* rootNode = NULL;
+    try
+    {
+        rootNode = parseSource(source, PARSE_DEFAULT);
+        source->unref();
+    }
+    catch (...)
+    {
+        source->unref();
+        throw;
+    }
+
+    PodSnapshot* snapshot = NULL;
+    try
+    {
+        snapshot = freeze(*rootNode);
+    }
+    catch (...)
+    {
+        delete rootNode;
+        throw;
+    }
+    delete rootNode;
+
+    // If the file changed while we were reading it, we don't know which
+    // version we got, so don't cache it.
+    struct stat after;
+    if (stat(path.c_str(), &after) == 0 && sameFile(st, after)
+        && sourceSize == size_t(st.st_size))
+    {
+        try
+        {
+            store(path, st, *snapshot, contentHash);
+        }
+        catch (const std::exception&)
+        {
+            // The cache is only an optimization; the caller still gets the pod.
+            __sync_fetch_and_add(&m_stats.storeErrors, 1);
+        }
+    }
+    return snapshot;
+}
+
+
+// *****************************************************************************
+PodNode* PodDiskCache::parseFile(const std::string& filename)
+{
+    PodSnapshot* snapshot = load(filename);
+    try
+    {
+        PodNode* rootNode = snapshot->root().thaw();
+        rootNode->setSource(filename, 0);
+        delete snapshot;
+        return rootNode;
+    }
+    catch (...)
+    {
+        delete snapshot;
+        throw;
+    }
+}
+
+
+// *****************************************************************************
+//
+// Returns NULL if there's no usable entry for the file.
+//
+PodSnapshot* PodDiskCache::lookup(const std::string& path, const struct stat& st)
+{
+    const std::string entry = entryName(path);
+    const int fd = open(entry.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    PodSnapshot* snapshot = NULL;
+    try
+    {
+        struct stat entrySt;
+        PodDiskCacheTrailer trailer;
+        std::string entryPath;
+        bool usable = fstat(fd, &entrySt) == 0
+                      && size_t(entrySt.st_size) > sizeof(trailer)
+                      && readAt(fd, &trailer, sizeof(trailer), entrySt.st_size - sizeof(trailer))
+                      && memcmp(trailer.magic, ENTRY_MAGIC, sizeof(trailer.magic)) == 0
+                      && trailer.pathLength == path.size()
+                      && size_t(entrySt.st_size) > sizeof(trailer) + trailer.pathLength
+                      && trailer.sourceSize == uint64_t(st.st_size)
+                      && trailer.sourceMtimeSec == int64_t(st.st_mtim.tv_sec)
+                      && trailer.sourceMtimeNsec == int64_t(st.st_mtim.tv_nsec);
+        if (usable)
+        {
+            entryPath.resize(trailer.pathLength);
+            const off_t pathOffset = entrySt.st_size - sizeof(trailer) - trailer.pathLength;
+            usable = readAt(fd, &entryPath[0], trailer.pathLength, pathOffset)
+                     && entryPath == path;
+        }
+        if (usable && m_verifyContent)
+        {
+            uint64_t contentHash;
+            usable = hashFile(path, contentHash) && contentHash == trailer.contentHash;
+        }
+        if (usable)
+        {
+            snapshot = PodSnapshot::load(fd, entry);
+            if (snapshot->size() + trailer.pathLength + sizeof(trailer) > size_t(entrySt.st_size))
+            {
+                delete snapshot;
+                snapshot = NULL;
+            }
+        }
+    }
+    catch (const std::exception&)
+    {
+        // Damaged entry
+        snapshot = NULL;
+    }
+
+    if (snapshot)
+    {
+        // Entries are evicted least recently used first
+        futimens(fd, NULL);
+        __sync_fetch_and_add(&m_stats.hits, 1);
+    }
+    else
+    {
+        __sync_fetch_and_add(&m_stats.stale, 1);
+    }
+    close(fd);
+    return snapshot;
+}
+
+
+// *****************************************************************************
+void PodDiskCache::store(const std::string& path, const struct stat& st,
+                         const PodSnapshot& snapshot, uint64_t contentHash)
+{
+    PodDiskCacheTrailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    memcpy(trailer.magic, ENTRY_MAGIC, sizeof(trailer.magic));
+    trailer.pathLength = path.size();
+    trailer.sourceSize = st.st_size;
+    trailer.sourceMtimeSec = st.st_mtim.tv_sec;
+    trailer.sourceMtimeNsec = st.st_mtim.tv_nsec;
+    trailer.contentHash = contentHash;
+
+    struct iovec pieces[3];
+    pieces[0].iov_base = const_cast<char*>(snapshot.data());
+    pieces[0].iov_len = snapshot.size();
+    pieces[1].iov_base = const_cast<char*>(path.data());
+    pieces[1].iov_len = path.size();
+    pieces[2].iov_base = &trailer;
+    pieces[2].iov_len = sizeof(trailer);
+    writeFileAtomically(entryName(path), pieces, 3);
+
+    __sync_fetch_and_add(&m_stats.stores, 1);
+    trim();
+}
+
+
+// *****************************************************************************
+std::string PodDiskCache::entryName(const std::string& path) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx",
+             static_cast<unsigned long long>(hashBytes(path.data(), path.size())));
+    return m_directory + "/" + name + ENTRY_SUFFIX;
+}
+
+
+// *****************************************************************************
+struct PodDiskCacheEntry
+{
+    time_t      mtime;
+    off_t       size;
+    std::string name;
+
+    bool operator<(const PodDiskCacheEntry& other) const { return mtime < other.mtime; }
+};
+
+
+// *****************************************************************************
+void PodDiskCache::trim()
+{
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) return;
+
+    const time_t now = time(NULL);
+    std::vector<PodDiskCacheEntry> entries;
+    uint64_t total = 0;
+    while (struct dirent* d = readdir(dir))
+    {
+        const char* suffix = strstr(d->d_name, ENTRY_SUFFIX);
+        if (!suffix) continue;
+
+        PodDiskCacheEntry entry;
+        entry.name = m_directory + "/" + d->d_name;
+        struct stat st;
+        if (stat(entry.name.c_str(), &st) != 0) continue;  // Removed by someone else
+
+        if (suffix[sizeof(ENTRY_SUFFIX) - 1] != '\0')
+        {
+            // A temporary file
+            if (now - st.st_mtime > ABANDONED_SECONDS)
+            {
+                unlink(entry.name.c_str());
+            }
+            continue;
+        }
+        entry.mtime = st.st_mtime;
+        entry.size = st.st_size;
+        entries.push_back(entry);
+        total += st.st_size;
+    }
+    closedir(dir);
+
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size() && total > m_maxBytes; ++i)
+    {
+        // Another process may be trimming too, so only count our own removals
+        if (unlink(entries[i].name.c_str()) == 0)
+        {
+            __sync_fetch_and_add(&m_stats.evictions, 1);
+        }
+        total -= entries[i].size;
+    }
+}
+
+
+// *****************************************************************************
+void PodDiskCache::clear()
+{
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) return;
+
+    while (struct dirent* d = readdir(dir))
+    {
+        if (strstr(d->d_name, ENTRY_SUFFIX))
+        {
+            unlink((m_directory + "/" + d->d_name).c_str());
+        }
+    }
+    closedir(dir);
+}
+
+
+// *****************************************************************************
+PodDiskCacheStats PodDiskCache::stats() const
+{
+    return m_stats;
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,110 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODDISKCACHE_H__
+#define __TIPPODDISKCACHE_H__
+
+#include <string>
+#include <sys/stat.h>
+#include <stdint.h>
+
+#include "TipPodNode.h"
+#include "TipPodSnapshot.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Counts of what a PodDiskCache has done, as returned by stats()
+//
+struct PodDiskCacheStats
+{
+    PodDiskCacheStats()
+        : hits(0), misses(0), stale(0), stores(0), storeErrors(0), evictions(0) {}
+
+    unsigned long hits;        // Loaded from the cache
+    unsigned long misses;      // Parsed, because there was no usable entry
+    unsigned long stale;       // Misses where the entry was out of date or damaged
+    unsigned long stores;      // Entries written
+    unsigned long storeErrors; // Entries that couldn't be written
+    unsigned long evictions;   // Entries removed to keep the cache within its size
+};
+
+
+// *****************************************************************************
+//
+// A directory of .podb files made from parsed .pod files, so that processes
+// which read the same pods over and over only have to parse each one once.
+//
+// NOTES:
+//
+// * Entries are found by the (real) path of the .pod file, and are used if
+//   the file's size and modification time are the same as when the entry
+//   was made.  If verifyContent is true, a hash of the file's contents must
+//   match as well, which means reading the file but not parsing it.
+// * A hit maps the entry into memory (see PodSnapshot::load()).
+// * Entries are written atomically, so any number of processes and threads
+//   may share a cache directory.  When two of them store the same file,
+//   the last one wins.
+// * After each store, the least recently used entries are removed until
+//   the cache is no bigger than maxBytes.
+// * Nothing in the cache is trusted: a damaged entry is just a miss.
+//
+class PodDiskCache
+{
+public:
+    static const size_t DEFAULT_MAX_BYTES = 1024 * 1024 * 1024;
+
+    // Creates the directory if necessary.  Throws if it can't.
+    PodDiskCache(const std::string& directory,
+                 size_t maxBytes=DEFAULT_MAX_BYTES,
+                 bool verifyContent=false);
+
+    // Snapshot of the given .pod file, owned by the caller.  Parses the file
+    // and adds it to the cache if necessary.  Throws on parse errors.
+    PodSnapshot* load(const std::string& filename);
+
+    // The same nodes as TipPod::parseFile(), but through the cache.  They're
+    // thawed from the snapshot, which doesn't keep line numbers, so
+    // sourceline() is -1 below the root (sourcefile() is right), and errors
+    // found in them later can't say which line.  Parse errors are reported
+    // as usual.
+    PodNode* parseFile(const std::string& filename);
+
+    // Remove least recently used entries until the cache is within maxBytes,
+    // and any temporary files left behind by writers which died.
+    void trim();
+
+    // Remove every entry
+    void clear();
+
+    PodDiskCacheStats stats() const;
+    const std::string& directory() const { return m_directory; }
+    size_t maxBytes() const { return m_maxBytes; }
+
+private:
+    PodSnapshot* lookup(const std::string& path, const struct stat& st);
+    void store(const std::string& path, const struct stat& st,
+               const PodSnapshot& snapshot, uint64_t contentHash);
+    std::string entryName(const std::string& path) const;
+
+    // Not copyable
+    PodDiskCache(const PodDiskCache&);
+    PodDiskCache& operator=(const PodDiskCache&);
+
+private:
+    std::string m_directory;
+    size_t      m_maxBytes;
+    bool        m_verifyContent;
+
+    mutable PodDiskCacheStats m_stats;  // Updated atomically
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODDISKCACHE_H__
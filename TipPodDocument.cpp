@@ -0,0 +1,91 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include "TipPodDocument.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+PodDocument::PodDocument(PodSnapshot* snapshot, const std::string& filename)
+        : m_snapshot(snapshot),
+          m_filename(filename),
+          m_refCount(1),
+          m_index(NULL)
+{
+}
+
+
+// *****************************************************************************
+PodDocument::~PodDocument()
+{
+    delete m_index;
+    m_index = NULL;
+    delete m_snapshot;
+    m_snapshot = NULL;
+}
+
+
+// *****************************************************************************
+PodDocument* PodDocument::create(PodSnapshot* snapshot, const std::string& filename)
+{
+    try
+    {
+        return new PodDocument(snapshot, filename);
+    }
+    catch (...)
+    {
+        delete snapshot;
+        throw;
+    }
+}
+
+
+// *****************************************************************************
+PodNode* PodDocument::thaw() const
+{
+    PodNode* rootNode = m_snapshot->root().thaw();
+    rootNode->setSource(m_filename, 0);
+    return rootNode;
+}
+
+
+// *****************************************************************************
+//
+// Threads that ask at the same time may each build one, but only the first
+// to finish is kept.
+//
+const PodSnapshotIndex& PodDocument::index() const
+{
+    if (m_index == NULL)
+    {
+        PodSnapshotIndex* index = new PodSnapshotIndex(*m_snapshot);
+        if (!__sync_bool_compare_and_swap(&m_index, static_cast<PodSnapshotIndex*>(NULL), index))
+        {
+            delete index;
+        }
+    }
+    return *m_index;
+}
+
+
+// *****************************************************************************
+void PodDocument::ref() const
+{
+    __sync_add_and_fetch(&m_refCount, 1);
+}
+
+
+// *****************************************************************************
+void PodDocument::unref() const
+{
+    if (__sync_sub_and_fetch(&m_refCount, 1) == 0)
+    {
+        delete this;
+    }
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,108 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODDOCUMENT_H__
+#define __TIPPODDOCUMENT_H__
+
+#include <string>
+
+#include "TipPodNode.h"
+#include "TipPodSnapshot.h"
+#include "TipPodSnapshotIndex.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// An immutable, parsed pod which may be shared by any number of owners and
+// threads, such as those handed out by PodDocumentCache.
+//
+// NOTES:
+//
+// * Reference counted, like PodSource: created with create(), and
+//   released with unref() rather than deleted.  PodDocumentHandle does
+//   the counting automatically.
+// * The pod is read through PodNodeViews.  Code that needs PodNodes calls
+//   thaw() to get its own copy, which it owns and deletes as usual.
+//
+class PodDocument
+{
+public:
+    // Takes ownership of the snapshot.  The new document has one reference.
+    static PodDocument* create(PodSnapshot* snapshot, const std::string& filename="");
+
+    const std::string& filename() const { return m_filename; }
+    const PodSnapshot& snapshot() const { return *m_snapshot; }
+    PodNodeView root() const { return m_snapshot->root(); }
+
+    // The snapshot's nodes by type and name, built the first time it's asked for
+    const PodSnapshotIndex& index() const;
+
+    // New, mutable copy of the pod, owned by the caller
+    PodNode* thaw() const;
+
+    void ref() const;
+    void unref() const;  // Deletes this once the last reference is released
+
+private:
+    PodDocument(PodSnapshot* snapshot, const std::string& filename);
+    ~PodDocument();
+
+    // Not copyable
+    PodDocument(const PodDocument&);
+    PodDocument& operator=(const PodDocument&);
+
+private:
+    PodSnapshot*                      m_snapshot;
+    std::string                       m_filename;
+    mutable int                       m_refCount;
+    mutable PodSnapshotIndex* volatile m_index;
+};
+
+
+// *****************************************************************************
+//
+// Holds one reference to a PodDocument, for as long as the handle exists.
+// Copying a handle adds a reference.
+//
+class PodDocumentHandle
+{
+public:
+    PodDocumentHandle() : m_document(NULL) {}
+    explicit PodDocumentHandle(PodDocument* document)  // Takes over a reference
+        : m_document(document) {}
+    PodDocumentHandle(const PodDocumentHandle& other)
+        : m_document(other.m_document)
+        {
+            if (m_document) m_document->ref();
+        }
+    ~PodDocumentHandle()
+        {
+            if (m_document) m_document->unref();
+        }
+
+    PodDocumentHandle& operator=(const PodDocumentHandle& other)
+        {
+            if (other.m_document) other.m_document->ref();
+            if (m_document) m_document->unref();
+            m_document = other.m_document;
+            return *this;
+        }
+
+    bool isNull() const { return m_document == NULL; }
+    PodDocument* get() const { return m_document; }
+    PodDocument* operator->() const { return m_document; }
+    PodDocument& operator*() const { return *m_document; }
+
+private:
+    PodDocument* m_document;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODDOCUMENT_H__
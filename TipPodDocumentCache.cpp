@@ -0,0 +1,366 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#include "TipPod.h"
+#include "TipPodDocumentCache.h"
+
+namespace TipPod {
+
+
+// Events on a directory which mean a file in it may have changed
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE
+                                   | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                   | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+
+// *****************************************************************************
+//
+// Locks a mutex for as long as it exists
+//
+class PodMutexLock
+{
+public:
+    explicit PodMutexLock(pthread_mutex_t& mutex) : m_mutex(mutex) { pthread_mutex_lock(&m_mutex); }
+    ~PodMutexLock() { pthread_mutex_unlock(&m_mutex); }
+private:
+    pthread_mutex_t& m_mutex;
+};
+
+
+// *****************************************************************************
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// *****************************************************************************
+static bool sameFile(const struct stat& a, const struct stat& b)
+{
+    return a.st_ino == b.st_ino
+           && a.st_dev == b.st_dev
+           && a.st_size == b.st_size
+           && a.st_mtim.tv_sec == b.st_mtim.tv_sec
+           && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+
+// *****************************************************************************
+static std::string directoryOf(const std::string& path)
+{
+    const size_t slash = path.rfind('/');
+    if (slash == std::string::npos) return ".";
+    if (slash == 0) return "/";
+    return path.substr(0, slash);
+}
+
+
+// *****************************************************************************
+PodDocumentCache::PodDocumentCache(size_t maxBytes, bool useInotify, double pollSeconds)
+        : m_maxBytes(maxBytes),
+          m_pollSeconds(pollSeconds),
+          m_entries(),
+          m_lru(),
+          m_inotify(-1),
+          m_watches(),
+          m_directories(),
+          m_stats()
+{
+    pthread_mutex_init(&m_mutex, NULL);
+    if (useInotify)
+    {
+        // If this fails, everything is polled
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+}
+
+
+// *****************************************************************************
+PodDocumentCache::~PodDocumentCache()
+{
+    clear();
+    if (m_inotify >= 0)
+    {
+        close(m_inotify);
+    }
+    pthread_mutex_destroy(&m_mutex);
+}
+
+
+// *****************************************************************************
+PodDocumentHandle PodDocumentCache::get(const std::string& filename)
+{
+    std::string path = filename;
+    if (char* real = realpath(filename.c_str(), NULL))
+    {
+        path = real;
+        free(real);
+    }
+
+    bool watched = false;
+    {
+        PodMutexLock lock(m_mutex);
+        processEvents();
+
+        EntryMap::iterator iter = m_entries.find(path);
+        if (iter != m_entries.end())
+        {
+            Entry* entry = iter->second;
+            if (!entry->watched && now() - entry->checked >= m_pollSeconds)
+            {
+                struct stat st;
+                if (stat(path.c_str(), &st) == 0 && sameFile(st, entry->st))
+                {
+                    entry->checked = now();
+                }
+                else
+                {
+                    remove(iter);
+                    ++m_stats.invalidations;
+                    entry = NULL;
+                }
+            }
+            if (entry)
+            {
+                m_lru.splice(m_lru.begin(), m_lru, entry->lru);
+                ++m_stats.hits;
+                entry->document->ref();
+                return PodDocumentHandle(entry->document);
+            }
+        }
+        ++m_stats.misses;
+
+        // Watch before reading the file, so no change can be missed
+        watched = m_inotify >= 0 && watchDirectory(directoryOf(path));
+    }
+
+    //
+    // Parse without holding the lock
+    //
+    struct stat before;
+    if (stat(path.c_str(), &before) != 0)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+    PodNode* rootNode = parseFile(filename);
+    PodSnapshot* snapshot = NULL;
+    try
+    {
+        snapshot = freeze(*rootNode);
+    }
+    catch (...)
+    {
+        delete rootNode;
+        throw;
+    }
+    delete rootNode;
+    PodDocumentHandle handle(PodDocument::create(snapshot, filename));
+
+    // If the file changed while we were reading it, we don't know which
+    // version we got, so don't cache it.
+    struct stat after;
+    if (stat(path.c_str(), &after) != 0 || !sameFile(before, after))
+    {
+        return handle;
+    }
+
+    // Add the entry before taking the events that came in while we were
+    // reading, so that a change made since the second stat() drops it.
+    // Taking them first would lose that change, since watched entries are
+    // never polled.
+    PodMutexLock lock(m_mutex);
+    if (m_entries.find(path) == m_entries.end())  // Another thread may have beaten us
+    {
+        Entry* entry = new Entry;
+        entry->path = path;
+        entry->document = handle.get();
+        entry->document->ref();
+        entry->st = before;
+        entry->checked = now();
+        entry->watched = watched;
+        entry->bytes = snapshot->size() + sizeof(Entry) + path.size();
+        m_lru.push_front(entry);
+        entry->lru = m_lru.begin();
+        m_entries[path] = entry;
+        m_stats.bytes += entry->bytes;
+        trim();
+    }
+    processEvents();
+    return handle;
+}
+
+
+// *****************************************************************************
+void PodDocumentCache::invalidate(const std::string& filename)
+{
+    std::string path = filename;
+    if (char* real = realpath(filename.c_str(), NULL))
+    {
+        path = real;
+        free(real);
+    }
+
+    PodMutexLock lock(m_mutex);
+    EntryMap::iterator iter = m_entries.find(path);
+    if (iter != m_entries.end())
+    {
+        remove(iter);
+        ++m_stats.invalidations;
+    }
+}
+
+
+// *****************************************************************************
+void PodDocumentCache::clear()
+{
+    PodMutexLock lock(m_mutex);
+    while (!m_entries.empty())
+    {
+        remove(m_entries.begin());
+    }
+}
+
+
+// *****************************************************************************
+PodDocumentCacheStats PodDocumentCache::stats() const
+{
+    PodMutexLock lock(m_mutex);
+    PodDocumentCacheStats result = m_stats;
+    result.documents = m_entries.size();
+    return result;
+}
+
+
+// *****************************************************************************
+//
+// Drop the entries for any files inotify has told us about.
+//
+void PodDocumentCache::processEvents()
+{
+    if (m_inotify < 0) return;
+
+    char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;)
+    {
+        const ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) continue;
+        if (length <= 0) break;  // EAGAIN: no more events
+
+        for (const char* p = buffer; p < buffer + length; )
+        {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // Events were lost, so anything could have changed
+                m_stats.invalidations += m_entries.size();
+                while (!m_entries.empty())
+                {
+                    remove(m_entries.begin());
+                }
+                continue;
+            }
+
+            std::map<int, std::string>::iterator watch = m_watches.find(event->wd);
+            if (watch == m_watches.end()) continue;
+            const std::string directory = watch->second;
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+            {
+                // The directory itself is gone
+                invalidateDirectory(directory);
+                if (event->mask & IN_IGNORED)
+                {
+                    m_directories.erase(directory);
+                    m_watches.erase(watch);
+                }
+            }
+            else if (event->len > 0)
+            {
+                EntryMap::iterator iter = m_entries.find(directory + "/" + event->name);
+                if (iter != m_entries.end())
+                {
+                    remove(iter);
+                    ++m_stats.invalidations;
+                }
+            }
+        }
+    }
+}
+
+
+// *****************************************************************************
+void PodDocumentCache::invalidateDirectory(const std::string& directory)
+{
+    EntryMap::iterator iter = m_entries.lower_bound(directory + "/");
+    while (iter != m_entries.end()
+           && iter->first.compare(0, directory.size() + 1, directory + "/") == 0)
+    {
+        EntryMap::iterator next = iter;
+        ++next;
+        if (directoryOf(iter->first) == directory)
+        {
+            remove(iter);
+            ++m_stats.invalidations;
+        }
+        iter = next;
+    }
+}
+
+
+// *****************************************************************************
+void PodDocumentCache::remove(EntryMap::iterator iter)
+{
+    Entry* entry = iter->second;
+    m_stats.bytes -= entry->bytes;
+    m_lru.erase(entry->lru);
+    m_entries.erase(iter);
+    entry->document->unref();
+    delete entry;
+}
+
+
+// *****************************************************************************
+bool PodDocumentCache::watchDirectory(const std::string& directory)
+{
+    if (m_directories.find(directory) != m_directories.end())
+    {
+        return true;
+    }
+    const int wd = inotify_add_watch(m_inotify, directory.c_str(), WATCH_MASK);
+    if (wd < 0)
+    {
+        return false;  // Out of watches, say; the file will be polled
+    }
+    m_directories[directory] = wd;
+    m_watches[wd] = directory;
+    return true;
+}
+
+
+// *****************************************************************************
+void PodDocumentCache::trim()
+{
+    while (m_stats.bytes > m_maxBytes && !m_lru.empty())
+    {
+        remove(m_entries.find(m_lru.back()->path));
+        ++m_stats.evictions;
+    }
+}
+
+
+}  //  End namespace TipPod
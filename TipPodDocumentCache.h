@@ -0,0 +1,125 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODDOCUMENTCACHE_H__
+#define __TIPPODDOCUMENTCACHE_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "TipPodDocument.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Counts of what a PodDocumentCache has done, as returned by stats()
+//
+struct PodDocumentCacheStats
+{
+    PodDocumentCacheStats()
+        : hits(0), misses(0), invalidations(0), evictions(0), documents(0), bytes(0) {}
+
+    unsigned long hits;          // Returned a cached document
+    unsigned long misses;        // Parsed the file
+    unsigned long invalidations; // Documents dropped because their file changed
+    unsigned long evictions;     // Documents dropped to stay within maxBytes
+    size_t        documents;     // Currently cached
+    size_t        bytes;         // Memory used by the cached documents
+};
+
+
+// *****************************************************************************
+//
+// Parsed pods kept in memory, for long-running processes that read the same
+// files over and over.  get() returns the same immutable PodDocument for as
+// long as its file doesn't change.
+//
+// NOTES:
+//
+// * Safe to use from any number of threads.  Files are parsed without
+//   holding the cache's lock, so a slow parse doesn't hold up lookups.
+// * Changes are noticed with inotify, by watching the directory of each
+//   file, so replacing a file by renaming another over it is seen too.
+//   Files which can't be watched (or all files, if useInotify is false)
+//   are stat()ed instead, at most once per pollSeconds.  inotify doesn't
+//   see changes made by other hosts to files on network file systems, so
+//   turn it off for those.
+// * When the cached documents use more than maxBytes, the least recently
+//   used are dropped.  Documents are reference counted, so dropping one
+//   doesn't affect anyone still holding a handle to it.
+//
+class PodDocumentCache
+{
+public:
+    static const size_t DEFAULT_MAX_BYTES = 256 * 1024 * 1024;
+
+    PodDocumentCache(size_t maxBytes=DEFAULT_MAX_BYTES,
+                     bool useInotify=true,
+                     double pollSeconds=1.0);
+    ~PodDocumentCache();
+
+    // The document for the given file, parsing it if it isn't cached or
+    // has changed.  Throws on error.
+    PodDocumentHandle get(const std::string& filename);
+
+    void invalidate(const std::string& filename);
+    void clear();
+
+    PodDocumentCacheStats stats() const;
+    bool usingInotify() const { return m_inotify >= 0; }
+
+private:
+    struct Entry;
+    typedef std::list<Entry*>             LruList;  // Most recently used first
+    typedef std::map<std::string, Entry*> EntryMap; // By real path
+
+    struct Entry
+    {
+        std::string       path;
+        PodDocument*      document;  // Holds a reference
+        struct stat       st;        // Of the file, when it was parsed
+        double            checked;   // When st was last compared to the file
+        bool              watched;   // By inotify, so it needn't be polled
+        size_t            bytes;
+        LruList::iterator lru;
+    };
+
+    // These are only called with m_mutex locked
+    void processEvents();
+    void invalidateDirectory(const std::string& directory);
+    void remove(EntryMap::iterator iter);
+    bool watchDirectory(const std::string& directory);
+    void trim();
+
+    // Not copyable
+    PodDocumentCache(const PodDocumentCache&);
+    PodDocumentCache& operator=(const PodDocumentCache&);
+
+private:
+    size_t m_maxBytes;
+    double m_pollSeconds;
+
+    mutable pthread_mutex_t m_mutex;  // Guards everything below
+
+    EntryMap m_entries;
+    LruList  m_lru;
+
+    int                        m_inotify;      // -1 if not in use
+    std::map<int, std::string> m_watches;      // Watched directories, by watch descriptor
+    std::map<std::string, int> m_directories;  // Watch descriptors, by directory
+
+    PodDocumentCacheStats m_stats;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODDOCUMENTCACHE_H__
@@ -22,18 +22,28 @@ class ValueTypeError : public std::exception
 {
 public:
     ValueTypeError(std::string func, const PodNode* node)
-        : std::exception(), m_func(func), m_valueType(node ? node->valueTypeName() : "NULL") {}
+        : std::exception(), m_func(func), m_valueType(node ? node->valueTypeName() : "NULL"),
+          m_what(message(m_func, m_valueType)) {}
+    ValueTypeError(std::string func, PodNode::ValueType valueType)
+        : std::exception(), m_func(func), m_valueType(PodNode::valueTypeName(valueType)),
+          m_what(message(m_func, m_valueType)) {}
     virtual ~ValueTypeError() throw() {}
 
     virtual const char* what() const throw()
+    {
+        return m_what.c_str();
+    }
+private:
+    static std::string message(const std::string& func, const std::string& valueType)
     {
         std::ostringstream err;
-        err << m_func << "() called on PodNode of incompatible type " << m_valueType;
-        return err.str().c_str();
+        err << func << "() called on PodNode of incompatible type " << valueType;
+        return err.str();
     }
 private:
     const std::string m_func;
     const std::string m_valueType;
+    const std::string m_what;
 };
 
 
@@ -42,19 +52,104 @@ class PodIntegrityError : public std::exception
 {
 public:
     PodIntegrityError(const PodNode* node, std::string msg)
-        : std::exception(), m_node(node ? node->repr() : "NULL"), m_msg(msg) {}
+        : std::exception(), m_node(node ? node->repr() : "NULL"), m_msg(msg),
+          m_what(message(m_node, m_msg)) {}
     virtual ~PodIntegrityError() throw() {}
 
     virtual const char* what() const throw()
+    {
+        return m_what.c_str();
+    }
+private:
+    static std::string message(const std::string& node, const std::string& msg)
     {
         std::ostringstream err;
-        err << "TipPod integrity violation(s) detected in " << m_node << ":" << std::endl;
-        err << m_msg;
-        return err.str().c_str();
+        err << "TipPod integrity violation(s) detected in " << node << ":" << std::endl;
+        err << msg;
+        return err.str();
     }
 private:
     const std::string m_node;
     const std::string m_msg;
+    const std::string m_what;
+};
+
+
+// *****************************************************************************
+class PodReferenceError : public std::exception 
+{
+public:
+    PodReferenceError(const PodNode* node, std::string msg)
+        : std::exception(), m_node(node ? node->repr() : "NULL"), m_msg(msg),
+          m_what(message(m_node, m_msg)) {}
+    virtual ~PodReferenceError() throw() {}
+
+    virtual const char* what() const throw()
+    {
+        return m_what.c_str();
+    }
+private:
+    static std::string message(const std::string& node, const std::string& msg)
+    {
+        std::ostringstream err;
+        err << "Can't resolve " << node << ": " << msg;
+        return err.str();
+    }
+private:
+    const std::string m_node;
+    const std::string m_msg;
+    const std::string m_what;
+};
+
+
+// *****************************************************************************
+class PodPathError : public std::exception 
+{
+public:
+    PodPathError(std::string path, size_t column, std::string msg)
+        : std::exception(), m_path(path), m_msg(msg), m_what(message(m_path, column, m_msg)) {}
+    virtual ~PodPathError() throw() {}
+
+    virtual const char* what() const throw()
+    {
+        return m_what.c_str();
+    }
+private:
+    static std::string message(const std::string& path, size_t column, const std::string& msg)
+    {
+        std::ostringstream err;
+        err << "Bad pod path '" << path << "', column " << column + 1 << ": " << msg;
+        return err.str();
+    }
+private:
+    const std::string m_path;
+    const std::string m_msg;
+    const std::string m_what;
+};
+
+
+class PodSelectorError : public std::exception 
+{
+public:
+    PodSelectorError(std::string selector, size_t column, std::string msg)
+        : std::exception(), m_selector(selector), m_msg(msg), m_what(message(m_selector, column, m_msg)) {}
+    virtual ~PodSelectorError() throw() {}
+
+    virtual const char* what() const throw()
+    {
+        return m_what.c_str();
+    }
+private:
+    static std::string message(const std::string& selector, size_t column, const std::string& msg)
+    {
+        std::ostringstream err;
+        err << "Bad pod selector '" << selector << "', column " << column + 1 << ": " << msg;
+        return err.str();
+    }
+private:
+    const std::string m_selector;
+    const std::string m_msg;
+    const std::string m_what;
 };
 
 }  //  End namespace TipPod
@@ -0,0 +1,861 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "TipPodJson.h"
+#include "TipPodValue.h"
+#include "TipPodBlockPodValue.h"
+#include "TipPodWriteBuffer.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+static void writeNode(const PodNode& node, bool inArray, PodWriteBuffer& output);
+
+
+// *****************************************************************************
+static void writeString(const char* text, size_t length, PodWriteBuffer& output)
+{
+    static const char HEX[] = "0123456789abcdef";
+
+    output.append('"');
+    for (;;)
+    {
+        const size_t plain = plainLength(text, length);
+        output.append(text, plain);
+        if (plain == length) break;
+
+        // JSON has the same short escapes as pods, and \u for the rest
+        const unsigned char c = text[plain];
+        const char code = escapeCode(c);
+        if (code)
+        {
+            const char escape[2] = { '\\', code };
+            output.append(escape, 2);
+        }
+        else
+        {
+            const char escape[6] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xf] };
+            output.append(escape, 6);
+        }
+        text += plain + 1;
+        length -= plain + 1;
+    }
+    output.append('"');
+}
+
+
+// *****************************************************************************
+static void writeString(const std::string& text, PodWriteBuffer& output)
+{
+    writeString(text.data(), text.size(), output);
+}
+
+
+// *****************************************************************************
+static void writeKey(const char* key, size_t length, bool& first, PodWriteBuffer& output)
+{
+    if (!first) output.append(',');
+    first = false;
+    writeString(key, length, output);
+    output.append(':');
+}
+
+
+// *****************************************************************************
+//
+// One of the "$" keys, given with its quotes and colon, which are written
+// as they are
+//
+static void writeSpecialKey(const char* key, size_t length, bool& first, PodWriteBuffer& output)
+{
+    if (!first) output.append(',');
+    first = false;
+    output.append(key, length);
+}
+
+
+// *****************************************************************************
+//
+// Whether a block can be written as an object: its children that are
+// written all have names, and no two the same
+//
+typedef std::pair<uint64_t, const std::string*> HashedName;
+
+static bool namesAreUnique(const PodNodeDeque& block)
+{
+    for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+    {
+        if ((*iter)->podName().empty() && (*iter)->isValid()) return false;
+    }
+
+    // Most blocks are small enough to just compare every pair
+    if (block.size() <= 8)
+    {
+        for (size_t i = 1; i < block.size(); ++i)
+        {
+            for (size_t j = 0; j < i; ++j)
+            {
+                const std::string& name = block[i]->podName();
+                if (!name.empty() && name == block[j]->podName()) return false;
+            }
+        }
+        return true;
+    }
+
+    // Otherwise into a hash table, at most half full, looking for the next
+    // free slot where one is taken
+    size_t slots = 16;
+    while (slots < 2 * block.size()) slots *= 2;
+    std::vector<HashedName> table(slots, HashedName(0, static_cast<const std::string*>(NULL)));
+    for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+    {
+        const std::string& name = (*iter)->podName();
+        if (name.empty()) continue;
+        const uint64_t hash = hashBytesFast(name.data(), name.size());
+        size_t slot = hash & (slots - 1);
+        for (; table[slot].second; slot = (slot + 1) & (slots - 1))
+        {
+            if (table[slot].first == hash && *table[slot].second == name) return false;
+        }
+        table[slot] = HashedName(hash, &name);
+    }
+    return true;
+}
+
+
+// *****************************************************************************
+//
+// The value of a node that isn't written as an object
+//
+static void writeValue(const PodNode& node, PodWriteBuffer& output)
+{
+    const PodValue* value = node.value();
+    switch (node.valueType())
+    {
+        case PodNode::STRING:
+            writeString(static_cast<const StringPodValue*>(value)->value(), output);
+            break;
+        case PodNode::INT:
+            output.appendInt(static_cast<const IntPodValue*>(value)->value());
+            break;
+        case PodNode::FLOAT:
+        {
+            const float number = static_cast<const FloatPodValue*>(value)->value();
+            if (number != number || number - number != 0.0f)  // NaN or infinite
+            {
+                output.append("null", 4);
+                break;
+            }
+            char text[FLOAT_TEXT_SIZE];
+            output.append(text, formatFloat(number, text));
+            break;
+        }
+        case PodNode::BOOL:
+            if (static_cast<const BoolPodValue*>(value)->value())
+            {
+                output.append("true", 4);
+            }
+            else
+            {
+                output.append("false", 5);
+            }
+            break;
+        case PodNode::BLOCK:
+        {
+            output.append('[');
+            bool first = true;
+            const PodNodeDeque& block = node.asBlock();
+            for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+            {
+                if (!(*iter)->isValid()) continue;
+                if (!first) output.append(',');
+                first = false;
+                writeNode(**iter, true, output);
+            }
+            output.append(']');
+            break;
+        }
+        default:
+            output.append("null", 4);
+            break;
+    }
+}
+
+
+// *****************************************************************************
+//
+// The members of the object for a value written as one
+//
+static void writeMembers(const PodNode& node, bool& first, PodWriteBuffer& output)
+{
+    const PodValue* value = node.value();
+    switch (node.valueType())
+    {
+        case PodNode::IDENTIFIER:
+            writeSpecialKey("\"$identifier\":", 14, first, output);
+            writeString(static_cast<const IdentifierPodValue*>(value)->value(), output);
+            break;
+        case PodNode::EMBED:
+        {
+            const EmbedPodValue* embed = static_cast<const EmbedPodValue*>(value);
+            writeSpecialKey("\"$embed\":", 9, first, output);
+            writeString(embed->value(), output);
+            writeSpecialKey("\"$language\":", 12, first, output);
+            writeString(embed->language(), output);
+            break;
+        }
+        default:
+        {
+            const PodNodeDeque& block = node.asBlock();
+            for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+            {
+                const PodNode& child = **iter;
+                if (!child.isValid()) continue;
+                writeKey(child.podName().data(), child.podName().size(), first, output);
+                writeNode(child, false, output);
+            }
+            break;
+        }
+    }
+}
+
+
+// *****************************************************************************
+static void writeNode(const PodNode& node, bool inArray, PodWriteBuffer& output)
+{
+    const PodNode::ValueType type = node.valueType();
+    const bool named = inArray && !node.podName().empty();
+    const bool scoped = type == PodNode::BLOCK && !node.blockScopeType().empty();
+    const bool asObject = type == PodNode::IDENTIFIER || type == PodNode::EMBED
+                          || (type == PodNode::BLOCK && namesAreUnique(node.asBlock()));
+    if (!asObject && !named && !scoped && node.podType().empty())
+    {
+        writeValue(node, output);
+        return;
+    }
+
+    output.append('{');
+    bool first = true;
+    if (named)
+    {
+        writeSpecialKey("\"$name\":", 8, first, output);
+        writeString(node.podName(), output);
+    }
+    if (!node.podType().empty())
+    {
+        writeSpecialKey("\"$type\":", 8, first, output);
+        writeString(node.podType(), output);
+    }
+    if (scoped)
+    {
+        writeSpecialKey("\"$scope\":", 9, first, output);
+        writeString(node.blockScopeType(), output);
+    }
+    if (asObject)
+    {
+        writeMembers(node, first, output);
+    }
+    else
+    {
+        writeSpecialKey("\"$value\":", 9, first, output);
+        writeValue(node, output);
+    }
+    output.append('}');
+}
+
+
+// *****************************************************************************
+void toJson(const PodNode& node, PodWriteBuffer& output)
+{
+    writeNode(node, true, output);
+}
+
+
+// *****************************************************************************
+void toJson(const PodNode& node, std::ostream& output)
+{
+    PodWriteBuffer buffer(output);
+    toJson(node, buffer);
+    buffer.flush();
+}
+
+
+// *****************************************************************************
+std::string toJson(const PodNode& node)
+{
+    PodWriteBuffer buffer;
+    toJson(node, buffer);
+    return std::string(buffer.data(), buffer.size());
+}
+
+
+// *****************************************************************************
+//
+// PodValues can only be deleted by the node that owns them
+//
+static void deleteValue(PodValue* value)
+{
+    if (value) PodNode owner("", "", value);
+}
+
+
+// *****************************************************************************
+//
+// Reads JSON text into PodNodes, with the mapping in TipPodJson.h
+//
+class JsonReader
+{
+public:
+    JsonReader(const char* text, size_t length, const std::string& source);
+
+    PodNode* read();
+
+private:
+    // What the "$" keys of a value's object said about its node
+    struct NodeKeys
+    {
+        NodeKeys() : named(false), typed(false), scoped(false) {}
+
+        std::string name;
+        std::string podType;
+        std::string scopeType;
+        bool        named;
+        bool        typed;
+        bool        scoped;
+    };
+
+    PodNode* readNode(const std::string* key, int depth);  // NULL if skipped
+    PodValue* readValue(NodeKeys& keys, int depth);
+    PodValue* readObject(NodeKeys& keys, int depth);
+    PodValue* readArray(int depth);
+    PodValue* readNumber();
+    void readString(std::string& result);
+    void readKeyString(const std::string& key, bool& seen, std::string& result);
+    void readUnicodeEscape(std::string& result);
+    unsigned int readHex();
+    void readWord(const char* word, size_t length);
+    void skipSpace();
+    void fail(const std::string& message) const;
+
+    const char*        m_next;
+    const char*        m_end;
+    const char*        m_lineBegin;
+    int                m_line;
+    const std::string& m_source;
+    std::string        m_text;  // Scratch, for string values
+};
+
+
+// *****************************************************************************
+JsonReader::JsonReader(const char* text, size_t length, const std::string& source)
+        : m_next(text),
+          m_end(text + length),
+          m_lineBegin(text),
+          m_line(1),
+          m_source(source),
+          m_text()
+{
+}
+
+
+// *****************************************************************************
+PodNode* JsonReader::read()
+{
+    skipSpace();
+    const int line = m_line;
+    PodNode* root = readNode(NULL, 0);
+    if (!root) root = new PodNode;
+    try
+    {
+        skipSpace();
+        if (m_next != m_end) fail("Text after the JSON value");
+    }
+    catch (...)
+    {
+        delete root;
+        throw;
+    }
+    root->setSource(m_source, line);
+    return root;
+}
+
+
+// *****************************************************************************
+PodNode* JsonReader::readNode(const std::string* key, int depth)
+{
+    skipSpace();
+    const int line = m_line;
+    NodeKeys keys;
+    PodValue* value = readValue(keys, depth);
+    try
+    {
+        if (key && keys.named) fail("\"$name\" in an object, whose keys are the names");
+        if (keys.scoped)
+        {
+            if (!value || value->type() != PodNode::BLOCK)
+            {
+                fail("\"$scope\" for a value that isn't a block");
+            }
+            static_cast<BlockPodValue*>(value)->setScopeType(keys.scopeType);
+        }
+    }
+    catch (...)
+    {
+        deleteValue(value);
+        throw;
+    }
+
+    const std::string& name = key ? *key : keys.name;
+    if (!value && name.empty()) return NULL;  // write() would skip it
+    PodNode* node = new PodNode(name, keys.podType, value);
+    node->setSource("", line);
+    return node;
+}
+
+
+// *****************************************************************************
+PodValue* JsonReader::readValue(NodeKeys& keys, int depth)
+{
+    if (depth > JSON_MAX_DEPTH)
+    {
+        std::ostringstream err;
+        err << "JSON nested more than " << JSON_MAX_DEPTH << " deep";
+        fail(err.str());
+    }
+    skipSpace();
+    if (m_next == m_end) fail("Expected a value");
+    switch (*m_next)
+    {
+        case '"':
+            readString(m_text);
+            return new StringPodValue(m_text);
+        case '{':
+            return readObject(keys, depth + 1);
+        case '[':
+            return readArray(depth + 1);
+        case 't':
+            readWord("true", 4);
+            return new BoolPodValue(true);
+        case 'f':
+            readWord("false", 5);
+            return new BoolPodValue(false);
+        case 'n':
+            readWord("null", 4);
+            return NULL;
+    }
+    if (*m_next == '-' || (*m_next >= '0' && *m_next <= '9'))
+    {
+        return readNumber();
+    }
+    fail("Expected a value");
+    return NULL;
+}
+
+
+// *****************************************************************************
+PodValue* JsonReader::readObject(NodeKeys& keys, int depth)
+{
+    enum Form { BLOCK_FORM, VALUE_FORM, IDENTIFIER_FORM, EMBED_FORM };
+
+    ++m_next;  // '{'
+    BlockPodValue* block = new BlockPodValue;
+    PodValue* value = NULL;
+    Form form = BLOCK_FORM;
+    bool hasLanguage = false;
+    std::string key, language;
+    try
+    {
+        skipSpace();
+        if (m_next != m_end && *m_next == '}')
+        {
+            ++m_next;
+            return block;
+        }
+        for (;;)
+        {
+            skipSpace();
+            if (m_next == m_end || *m_next != '"') fail("Expected a key in quotes");
+            readString(key);
+            skipSpace();
+            if (m_next == m_end || *m_next != ':') fail("Expected ':'");
+            ++m_next;
+
+            const bool special = key.size() > 1 && key[0] == '$';
+            if (special && (key == "$value" || key == "$identifier" || key == "$embed"))
+            {
+                if (form != BLOCK_FORM)
+                {
+                    fail("More than one of \"$value\", \"$identifier\" and \"$embed\"");
+                }
+                bool seen = false;
+                if (key == "$value")
+                {
+                    form = VALUE_FORM;
+                    value = readValue(keys, depth);
+                }
+                else if (key == "$identifier")
+                {
+                    form = IDENTIFIER_FORM;
+                    readKeyString(key, seen, m_text);
+                    value = new IdentifierPodValue(m_text);
+                }
+                else
+                {
+                    form = EMBED_FORM;
+                    readKeyString(key, seen, m_text);
+                    value = new EmbedPodValue(m_text, "");
+                }
+            }
+            else if (special && key == "$name")
+            {
+                readKeyString(key, keys.named, keys.name);
+            }
+            else if (special && key == "$type")
+            {
+                readKeyString(key, keys.typed, keys.podType);
+            }
+            else if (special && key == "$scope")
+            {
+                readKeyString(key, keys.scoped, keys.scopeType);
+            }
+            else if (special && key == "$language")
+            {
+                readKeyString(key, hasLanguage, language);
+            }
+            else if (PodNode* child = readNode(&key, depth))
+            {
+                block->value().push_back(child);
+            }
+
+            skipSpace();
+            if (m_next != m_end && *m_next == ',')
+            {
+                ++m_next;
+                continue;
+            }
+            if (m_next != m_end && *m_next == '}')
+            {
+                ++m_next;
+                break;
+            }
+            fail("Expected ',' or '}'");
+        }
+
+        if (hasLanguage != (form == EMBED_FORM))
+        {
+            fail(hasLanguage ? "\"$language\" without \"$embed\""
+                             : "\"$embed\" without \"$language\"");
+        }
+        if (form == BLOCK_FORM)
+        {
+            return block;
+        }
+        if (!block->value().empty())
+        {
+            fail("Children in an object with \"$value\", \"$identifier\" or \"$embed\"");
+        }
+        if (form == EMBED_FORM)
+        {
+            static_cast<EmbedPodValue*>(value)->setLanguage(language);
+        }
+    }
+    catch (...)
+    {
+        delete block;
+        deleteValue(value);
+        throw;
+    }
+    delete block;
+    return value;
+}
+
+
+// *****************************************************************************
+PodValue* JsonReader::readArray(int depth)
+{
+    ++m_next;  // '['
+    BlockPodValue* block = new BlockPodValue;
+    try
+    {
+        skipSpace();
+        if (m_next != m_end && *m_next == ']')
+        {
+            ++m_next;
+            return block;
+        }
+        for (;;)
+        {
+            if (PodNode* child = readNode(NULL, depth))
+            {
+                block->value().push_back(child);
+            }
+
+            skipSpace();
+            if (m_next != m_end && *m_next == ',')
+            {
+                ++m_next;
+                continue;
+            }
+            if (m_next != m_end && *m_next == ']')
+            {
+                ++m_next;
+                break;
+            }
+            fail("Expected ',' or ']'");
+        }
+    }
+    catch (...)
+    {
+        delete block;
+        throw;
+    }
+    return block;
+}
+
+
+// *****************************************************************************
+//
+// An INT if it has no fraction or exponent and fits, otherwise a FLOAT
+//
+PodValue* JsonReader::readNumber()
+{
+    const char* start = m_next;
+    const bool negative = *m_next == '-';
+    if (negative) ++m_next;
+
+    if (m_next == m_end || *m_next < '0' || *m_next > '9') fail("Expected a digit");
+    int64_t magnitude = 0;
+    int digits = 0;
+    if (*m_next == '0')
+    {
+        ++m_next;
+    }
+    else
+    {
+        for (; m_next != m_end && *m_next >= '0' && *m_next <= '9'; ++m_next, ++digits)
+        {
+            if (digits < 18) magnitude = magnitude * 10 + (*m_next - '0');
+        }
+    }
+
+    bool integer = true;
+    if (m_next != m_end && *m_next == '.')
+    {
+        integer = false;
+        ++m_next;
+        if (m_next == m_end || *m_next < '0' || *m_next > '9') fail("Expected a digit");
+        while (m_next != m_end && *m_next >= '0' && *m_next <= '9') ++m_next;
+    }
+    if (m_next != m_end && (*m_next == 'e' || *m_next == 'E'))
+    {
+        integer = false;
+        ++m_next;
+        if (m_next != m_end && (*m_next == '+' || *m_next == '-')) ++m_next;
+        if (m_next == m_end || *m_next < '0' || *m_next > '9') fail("Expected a digit");
+        while (m_next != m_end && *m_next >= '0' && *m_next <= '9') ++m_next;
+    }
+
+    if (integer && digits <= 18)
+    {
+        const int64_t number = negative ? -magnitude : magnitude;
+        if (number >= std::numeric_limits<int>::min() && number <= std::numeric_limits<int>::max())
+        {
+            return new IntPodValue(int(number));
+        }
+    }
+    float number;
+    if (!stringToFloat(start, m_next - start, number))
+    {
+        m_next = start;
+        fail("Out of range number");
+    }
+    return new FloatPodValue(number);
+}
+
+
+// *****************************************************************************
+void JsonReader::readString(std::string& result)
+{
+    ++m_next;  // '"'
+    result.clear();
+    for (;;)
+    {
+        const size_t plain = plainLength(m_next, m_end - m_next);
+        result.append(m_next, plain);
+        m_next += plain;
+        if (m_next == m_end) fail("Unterminated string");
+        if (*m_next == '"')
+        {
+            ++m_next;
+            return;
+        }
+        if (*m_next != '\\') fail("Control character in string");
+
+        if (++m_next == m_end) fail("Unterminated string");
+        switch (*m_next++)
+        {
+            case '"':  result += '"'; break;
+            case '\\': result += '\\'; break;
+            case '/':  result += '/'; break;
+            case 'b':  result += '\b'; break;
+            case 'f':  result += '\f'; break;
+            case 'n':  result += '\n'; break;
+            case 'r':  result += '\r'; break;
+            case 't':  result += '\t'; break;
+            case 'u':  readUnicodeEscape(result); break;
+            default:
+                --m_next;
+                fail("Unknown escape sequence");
+        }
+    }
+}
+
+
+// *****************************************************************************
+//
+// The value of a "$" key, which must be a string, and not given twice
+//
+void JsonReader::readKeyString(const std::string& key, bool& seen, std::string& result)
+{
+    if (seen) fail("\"" + key + "\" given twice");
+    seen = true;
+    skipSpace();
+    if (m_next == m_end || *m_next != '"') fail("\"" + key + "\" must be a string");
+    readString(result);
+}
+
+
+// *****************************************************************************
+//
+// The rest of a \u escape, written to 'result' as UTF-8.  Characters past
+// U+FFFF are written in JSON as two escapes, a UTF-16 surrogate pair.
+//
+void JsonReader::readUnicodeEscape(std::string& result)
+{
+    unsigned int code = readHex();
+    if (code >= 0xdc00 && code <= 0xdfff)
+    {
+        fail("Unpaired surrogate in \\u escape");
+    }
+    if (code >= 0xd800 && code <= 0xdbff)
+    {
+        if (m_end - m_next < 2 || m_next[0] != '\\' || m_next[1] != 'u')
+        {
+            fail("Unpaired surrogate in \\u escape");
+        }
+        m_next += 2;
+        const unsigned int low = readHex();
+        if (low < 0xdc00 || low > 0xdfff) fail("Unpaired surrogate in \\u escape");
+        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+    }
+
+    if (code < 0x80)
+    {
+        result += char(code);
+    }
+    else if (code < 0x800)
+    {
+        result += char(0xc0 | (code >> 6));
+        result += char(0x80 | (code & 0x3f));
+    }
+    else if (code < 0x10000)
+    {
+        result += char(0xe0 | (code >> 12));
+        result += char(0x80 | ((code >> 6) & 0x3f));
+        result += char(0x80 | (code & 0x3f));
+    }
+    else
+    {
+        result += char(0xf0 | (code >> 18));
+        result += char(0x80 | ((code >> 12) & 0x3f));
+        result += char(0x80 | ((code >> 6) & 0x3f));
+        result += char(0x80 | (code & 0x3f));
+    }
+}
+
+
+// *****************************************************************************
+unsigned int JsonReader::readHex()
+{
+    unsigned int code = 0;
+    for (int i = 0; i < 4; ++i, ++m_next)
+    {
+        if (m_next == m_end) fail("Unterminated string");
+        const char c = *m_next;
+        if (c >= '0' && c <= '9')      code = code * 16 + (c - '0');
+        else if (c >= 'a' && c <= 'f') code = code * 16 + (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') code = code * 16 + (c - 'A' + 10);
+        else fail("Expected four hex digits after \\u");
+    }
+    return code;
+}
+
+
+// *****************************************************************************
+void JsonReader::readWord(const char* word, size_t length)
+{
+    if (size_t(m_end - m_next) < length || memcmp(m_next, word, length) != 0)
+    {
+        fail("Expected a value");
+    }
+    m_next += length;
+}
+
+
+// *****************************************************************************
+void JsonReader::skipSpace()
+{
+    for (; m_next != m_end; ++m_next)
+    {
+        const char c = *m_next;
+        if (c == '\n')
+        {
+            ++m_line;
+            m_lineBegin = m_next + 1;
+        }
+        else if (c != ' ' && c != '\t' && c != '\r')
+        {
+            return;
+        }
+    }
+}
+
+
+// *****************************************************************************
+void JsonReader::fail(const std::string& message) const
+{
+    std::ostringstream err;
+    err << message;
+    if (m_next == m_end) err << ", at the end of the text,";
+    err << " in file '" << m_source << "', line " << m_line
+        << ", column " << m_next - m_lineBegin + 1;
+    throw std::runtime_error(err.str());
+}
+
+
+// *****************************************************************************
+PodNode* fromJson(const char* text, size_t length, const std::string& source)
+{
+    JsonReader reader(text, length, source);
+    return reader.read();
+}
+
+
+// *****************************************************************************
+PodNode* fromJson(const std::string& text, const std::string& source)
+{
+    return fromJson(text.data(), text.size(), source);
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,100 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODJSON_H__
+#define __TIPPODJSON_H__
+
+#include <iostream>
+#include <string>
+
+#include "TipPodNode.h"
+
+namespace TipPod {
+
+class PodWriteBuffer;
+
+
+// *****************************************************************************
+//
+// Conversions between pods and JSON, for services that want pod data in
+// that form:
+//
+//     PodWriteBuffer output(fd);
+//     toJson(*rootNode, output);
+//     output.flush();
+//
+//     PodNode* rootNode = fromJson(text, "shot.json");
+//
+// Pods are written as the JSON a service would expect, with "$" keys for
+// what JSON has no form for:
+//
+//     Pod                              JSON
+//
+//     "text"                           "text"
+//     240                              240
+//     1.5                              1.5
+//     true                             true
+//     name;                            "name": null
+//     cam_main                         {"$identifier": "cam_main"}
+//     <python>x = 1</python>           {"$embed": "x = 1", "$language": "python"}
+//     { frames = 240; fps = 24; }      {"frames": 240, "fps": 24}
+//     { 1; 2; 3; }                     [1, 2, 3]
+//     Shot shot = { ... };             "shot": {"$type": "Shot", ...}
+//     shot = parallel { ... };         "shot": {"$scope": "parallel", ...}
+//     Frame start = 1001;              "start": {"$type": "Frame", "$value": 1001}
+//     { 1; two = 2; }                  [1, {"$name": "two", "$value": 2}]
+//
+// RULES:
+//
+// * A block is written as an object if all its children have names and
+//   no two share one, and as an array otherwise.  An empty block is {}.
+// * A node's type, a block's scope type, and the name of a node in an
+//   array, go in its object as "$type", "$scope" and "$name".  Values that
+//   aren't written as objects are put in one for them, as its "$value".
+// * toJson() of a node writes its name as "$name" as well, so a root node
+//   from parseFile(), which has none, is written as just its block.
+// * fromJson() reads any JSON.  Objects become blocks of named nodes, in
+//   the order of their keys; arrays become blocks of nameless ones.
+//   Numbers with a fraction or exponent become FLOATs, and others INTs,
+//   or FLOATs if they're too big for an int.  The root node it returns
+//   holds what the JSON does, named and typed if the JSON says so.
+// * Only the "$" keys above are read specially, and an object with
+//   "$value", "$identifier" or "$embed" can't have other children.  Pod
+//   names can't start with '$', so other keys that do are names like any
+//   other.
+//
+// So fromJson(toJson(node)) gives back the same nodes, contentHash() and
+// all, except that nameless nodes with no value, which write() skips, are
+// skipped in both directions.
+//
+// NOTES:
+//
+// * toJson() writes straight to a PodWriteBuffer, which goes out in chunks
+//   writing to a file descriptor or stream.  It writes no whitespace.
+// * Strings are written byte for byte, but for quotes, backslashes and
+//   control characters, which are escaped; pod text is taken to be UTF-8,
+//   as JSON is.  fromJson() decodes \u escapes to UTF-8, but doesn't check
+//   the rest.
+// * NaN and infinities, which JSON has no numbers for, are written as null.
+// * Names from JSON aren't checked.  Keys that aren't pod identifiers make
+//   nodes that write() writes, but parseFile() can't read back.
+// * fromJson() throws std::runtime_error for text that isn't JSON, saying
+//   where, and for JSON nested more than JSON_MAX_DEPTH deep.  Its nodes
+//   have the line they started on, and 'source' as their file name.
+//
+const int JSON_MAX_DEPTH = 1000;
+
+void toJson(const PodNode& node, PodWriteBuffer& output);
+void toJson(const PodNode& node, std::ostream& output);
+std::string toJson(const PodNode& node);
+
+PodNode* fromJson(const char* text, size_t length, const std::string& source="");
+PodNode* fromJson(const std::string& text, const std::string& source="");
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODJSON_H__
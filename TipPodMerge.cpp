@@ -0,0 +1,407 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <algorithm>
+#include <sstream>
+
+#include "TipPodMerge.h"
+#include "TipPodValue.h"
+#include "TipPodBlockPodValue.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+static const size_t NO_CHILD = size_t(-1);
+
+
+// *****************************************************************************
+//
+// The children of a block by name, without copying the names
+//
+class MergeNames
+{
+public:
+    explicit MergeNames(const PodNodeDeque& block);
+
+    // First child with the name, or NO_CHILD.  'guess' is tried before
+    // looking it up, since children usually stay where they were.
+    size_t find(const std::string& name, size_t guess = NO_CHILD) const;
+    bool hasDuplicates() const;
+
+private:
+    struct Entry
+    {
+        uint64_t           nameHash;
+        const std::string* name;
+        size_t             index;
+
+        bool operator<(const Entry& other) const
+            {
+                if (nameHash != other.nameHash) return nameHash < other.nameHash;
+                const int names = name->compare(*other.name);
+                return names != 0 ? names < 0 : index < other.index;
+            }
+    };
+
+    const PodNodeDeque& m_block;
+    std::vector<Entry>  m_sorted;    // By hash, then name, then index
+    std::vector<bool>   m_first;     // Whether each child is the first of its name
+};
+
+
+// *****************************************************************************
+MergeNames::MergeNames(const PodNodeDeque& block)
+        : m_block(block),
+          m_sorted(block.size()),
+          m_first(block.size(), false)
+{
+    for (size_t i = 0; i < block.size(); ++i)
+    {
+        const std::string& name = block[i]->podName();
+        Entry entry = { hashBytesFast(name.data(), name.size()), &name, i };
+        m_sorted[i] = entry;
+    }
+    std::sort(m_sorted.begin(), m_sorted.end());
+    for (size_t i = 0; i < m_sorted.size(); ++i)
+    {
+        m_first[m_sorted[i].index] = i == 0 || m_sorted[i].nameHash != m_sorted[i - 1].nameHash
+                                     || *m_sorted[i].name != *m_sorted[i - 1].name;
+    }
+}
+
+
+// *****************************************************************************
+size_t MergeNames::find(const std::string& name, size_t guess) const
+{
+    if (guess < m_block.size() && m_first[guess] && m_block[guess]->podName() == name)
+    {
+        return guess;
+    }
+    const Entry key = { hashBytesFast(name.data(), name.size()), &name, 0 };
+    std::vector<Entry>::const_iterator iter =
+        std::lower_bound(m_sorted.begin(), m_sorted.end(), key);
+    return iter != m_sorted.end() && iter->nameHash == key.nameHash && *iter->name == name
+           ? iter->index : NO_CHILD;
+}
+
+
+// *****************************************************************************
+bool MergeNames::hasDuplicates() const
+{
+    for (size_t i = 0; i < m_first.size(); ++i)
+    {
+        if (!m_first[i]) return true;
+    }
+    return false;
+}
+
+
+static void mergeNodes(const PodNode& base, PodNode& ours, const PodNode& theirs,
+                       const std::string& path, std::vector<PodMergeConflict>& conflicts);
+
+
+// *****************************************************************************
+static void addConflict(const std::string& path, const PodNode* base, const PodNode* ours,
+                        const PodNode* theirs, std::vector<PodMergeConflict>& conflicts)
+{
+    PodMergeConflict conflict;
+    conflict.path = path;
+    conflict.base = base;
+    conflict.ours = ours;
+    conflict.theirs = theirs;
+    conflicts.push_back(conflict);
+}
+
+
+// *****************************************************************************
+static std::string childPath(const std::string& path, const PodNode& child, size_t index,
+                             bool firstWithName)
+{
+    if (firstWithName && !child.podName().empty())
+    {
+        return path.empty() ? child.podName() : path + "." + child.podName();
+    }
+    std::ostringstream step;
+    step << path << "[" << index << "]";
+    return step.str();
+}
+
+
+// *****************************************************************************
+static bool sameHash(const PodNode* a, const PodNode* b)
+{
+    return a && b ? a->contentHash() == b->contentHash() : a == b;
+}
+
+
+// *****************************************************************************
+static PodNode* copyNode(const PodNode& node);
+
+
+// *****************************************************************************
+static PodValue* copyValue(const PodNode& node)
+{
+    if (!node.isBlock())
+    {
+        return node.value() ? node.value()->copy() : NULL;
+    }
+
+    BlockPodValue* blockValue = new BlockPodValue;
+    try
+    {
+        blockValue->setScopeType(node.blockScopeType());
+        const PodNodeDeque& block = node.asBlock();
+        PodNodeDeque& nodes = blockValue->value();
+        nodes.reserve(block.size());
+        for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+        {
+            nodes.push_back(copyNode(**iter));
+        }
+    }
+    catch (...)
+    {
+        delete blockValue;
+        throw;
+    }
+    return blockValue;
+}
+
+
+// *****************************************************************************
+static PodNode* copyNode(const PodNode& node)
+{
+    PodNode* copy = new PodNode(node.podName(), node.podType(), copyValue(node));
+    copy->setSource(node.sourcefile(), node.sourceline());
+    return copy;
+}
+
+
+// *****************************************************************************
+//
+// Merge blocks whose children all have the same names in the same order
+// in all three pods, in place
+//
+static void mergeInOrder(const PodNodeDeque& bases, PodNodeDeque& ours, const PodNodeDeque& theirs,
+                         const std::string& path, std::vector<PodMergeConflict>& conflicts)
+{
+    MergeNames* names = NULL;
+    try
+    {
+        for (size_t i = 0; i < ours.size(); ++i)
+        {
+            if (theirs[i]->contentHash() == bases[i]->contentHash()
+                || theirs[i]->contentHash() == ours[i]->contentHash())
+            {
+                continue;
+            }
+            if (!names) names = new MergeNames(ours);
+            mergeNodes(*bases[i], *ours[i], *theirs[i],
+                       childPath(path, *ours[i], i, names->find(ours[i]->podName(), i) == i),
+                       conflicts);
+        }
+    }
+    catch (...)
+    {
+        delete names;
+        throw;
+    }
+    delete names;
+}
+
+
+// *****************************************************************************
+//
+// Merge the children of blocks that both sides changed, matching them by
+// name.  Returns false if they can't be.
+//
+static bool mergeByName(const PodNode& base, PodNode& ours, const PodNode& theirs,
+                        const std::string& path, std::vector<PodMergeConflict>& conflicts)
+{
+    const PodNodeDeque& bases = base.asBlock();
+    const PodNodeDeque& theirNodes = theirs.asBlock();
+    PodNodeDeque& ourNodes = ours.asBlock();
+
+    const MergeNames baseNames(bases), ourNames(ourNodes), theirNames(theirNodes);
+    if (baseNames.hasDuplicates() || ourNames.hasDuplicates() || theirNames.hasDuplicates())
+    {
+        return false;
+    }
+
+    // Changes to our children happen in place; removing and adding them
+    // waits until all have been looked at, so that indexes stay valid
+    std::vector<bool> removed(ourNodes.size(), false);
+    std::vector<std::vector<PodNode*> > added(ourNodes.size() + 1);  // After ourNodes[i - 1]
+    try
+    {
+        // Where each side's children are, relative to the base's, so far
+        ptrdiff_t ourShift = 0, theirShift = 0;
+        for (size_t b = 0; b < bases.size(); ++b)
+        {
+            const size_t o = ourNames.find(bases[b]->podName(), b + ourShift);
+            const size_t t = theirNames.find(bases[b]->podName(), b + theirShift);
+            if (o != NO_CHILD) ourShift = ptrdiff_t(o) - ptrdiff_t(b);
+            if (t != NO_CHILD) theirShift = ptrdiff_t(t) - ptrdiff_t(b);
+            PodNode* ourNode = o == NO_CHILD ? NULL : ourNodes[o];
+            const PodNode* theirNode = t == NO_CHILD ? NULL : theirNodes[t];
+            if (sameHash(bases[b], theirNode) || sameHash(ourNode, theirNode))
+            {
+                continue;
+            }
+
+            const std::string child = ourNode ? childPath(path, *ourNode, o, true)
+                                              : childPath(path, *bases[b], b, true);
+            if (!theirNode && sameHash(bases[b], ourNode))
+            {
+                removed[o] = true;
+            }
+            else if (ourNode && theirNode)
+            {
+                mergeNodes(*bases[b], *ourNode, *theirNode, child, conflicts);
+            }
+            else
+            {
+                addConflict(child, bases[b], ourNode, theirNode, conflicts);
+            }
+        }
+
+        ptrdiff_t baseShift = 0;
+        size_t lastAdded = NO_CHILD, after = 0;
+        for (size_t t = 0; t < theirNodes.size(); ++t)
+        {
+            const std::string& name = theirNodes[t]->podName();
+            const size_t b = baseNames.find(name, t + baseShift);
+            if (b != NO_CHILD)
+            {
+                baseShift = ptrdiff_t(b) - ptrdiff_t(t);
+                continue;
+            }
+            const size_t o = ourNames.find(name);
+            if (o != NO_CHILD)
+            {
+                if (!sameHash(ourNodes[o], theirNodes[t]))
+                {
+                    addConflict(childPath(path, *ourNodes[o], o, true), NULL, ourNodes[o],
+                                theirNodes[t], conflicts);
+                }
+                continue;
+            }
+
+            // After the nearest node before it in theirs that we have too
+            if (t != lastAdded + 1)
+            {
+                after = 0;
+                for (size_t previous = t; previous > 0 && !after; --previous)
+                {
+                    const size_t found = ourNames.find(theirNodes[previous - 1]->podName());
+                    if (found != NO_CHILD) after = found + 1;
+                }
+            }
+            added[after].push_back(copyNode(*theirNodes[t]));
+            lastAdded = t;
+        }
+    }
+    catch (...)
+    {
+        for (size_t i = 0; i < added.size(); ++i)
+        {
+            for (size_t j = 0; j < added[i].size(); ++j) delete added[i][j];
+        }
+        throw;
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < added.size() && !changed; ++i)
+    {
+        changed = !added[i].empty() || (i < removed.size() && removed[i]);
+    }
+    if (changed)
+    {
+        PodNodeDeque merged;
+        merged.reserve(ourNodes.size() + theirNodes.size());
+        for (size_t i = 0; i <= ourNodes.size(); ++i)
+        {
+            if (i > 0 && removed[i - 1])
+            {
+                delete ourNodes[i - 1];
+            }
+            else if (i > 0)
+            {
+                merged.push_back(ourNodes[i - 1]);
+            }
+            for (size_t j = 0; j < added[i].size(); ++j) merged.push_back(added[i][j]);
+        }
+        ourNodes.swap(merged);
+        ours.syncBlock();
+    }
+    return true;
+}
+
+
+// *****************************************************************************
+static void mergeNodes(const PodNode& base, PodNode& ours, const PodNode& theirs,
+                       const std::string& path, std::vector<PodMergeConflict>& conflicts)
+{
+    const uint64_t baseHash = base.contentHash();
+    const uint64_t theirHash = theirs.contentHash();
+    if (theirHash == baseHash)
+    {
+        return;
+    }
+
+    // Blocks are merged child by child even where only theirs changed, so
+    // that only what they changed is copied, and ours is only hashed where
+    // theirs changed something
+    if (base.isBlock() && ours.isBlock() && theirs.isBlock()
+        && base.podType() == ours.podType() && base.podType() == theirs.podType()
+        && base.blockScopeType() == ours.blockScopeType()
+        && base.blockScopeType() == theirs.blockScopeType())
+    {
+        const PodNodeDeque& bases = base.asBlock();
+        const PodNodeDeque& theirNodes = theirs.asBlock();
+        PodNodeDeque& ourNodes = ours.asBlock();
+
+        bool inOrder = bases.size() == ourNodes.size() && bases.size() == theirNodes.size();
+        for (size_t i = 0; inOrder && i < bases.size(); ++i)
+        {
+            inOrder = bases[i]->podName() == ourNodes[i]->podName()
+                      && bases[i]->podName() == theirNodes[i]->podName();
+        }
+        if (inOrder)
+        {
+            mergeInOrder(bases, ourNodes, theirNodes, path, conflicts);
+            return;
+        }
+        if (mergeByName(base, ours, theirs, path, conflicts))
+        {
+            return;
+        }
+    }
+
+    const uint64_t ourHash = ours.contentHash();
+    if (ourHash == theirHash)
+    {
+        return;
+    }
+    if (ourHash == baseHash)
+    {
+        ours.setPodType(theirs.podType());
+        ours.setValue(copyValue(theirs));
+        return;
+    }
+    addConflict(path, &base, &ours, &theirs, conflicts);
+}
+
+
+// *****************************************************************************
+std::vector<PodMergeConflict> merge(const PodNode& base, PodNode& ours, const PodNode& theirs)
+{
+    std::vector<PodMergeConflict> conflicts;
+    mergeNodes(base, ours, theirs, "", conflicts);
+    return conflicts;
+}
+
+
+}  //  End namespace TipPod
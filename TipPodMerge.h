@@ -0,0 +1,66 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODMERGE_H__
+#define __TIPPODMERGE_H__
+
+#include <string>
+#include <vector>
+
+#include "TipPodNode.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// A node that both sides of a merge changed in different ways
+//
+struct PodMergeConflict
+{
+    std::string    path;    // See PodPath, in ours
+    const PodNode* base;    // NULL where a pod doesn't have the node
+    const PodNode* ours;    // Left as it was
+    const PodNode* theirs;
+};
+
+
+// *****************************************************************************
+//
+// Three-way merge: apply the changes from base to theirs to ours, which is
+// edited in place and can then be written out as usual:
+//
+//     std::vector<PodMergeConflict> conflicts = merge(*base, *ours, *theirs);
+//     ours->write(file);
+//
+// RULES:
+//
+// * Nodes are matched by path, like diff().  Where only one side changed
+//   a node, added it or removed it, that side wins.  Where both sides made
+//   the same change, it's kept once.
+// * Where both changed a block with the same podType and scope type in
+//   each pod, its children are merged one by one.  Nodes added by theirs
+//   go after the node they follow in theirs, if ours has it.
+// * Anything else both sides changed is a conflict, and ours is kept.
+//   That includes blocks where both sides changed a list of unnamed
+//   children, or children that share a name, since those can't be
+//   matched reliably by path.
+//
+// NOTES:
+//
+// * Subtrees are compared by PodNode::contentHash(), so anything a side
+//   didn't change is skipped without looking inside it, and ours is only
+//   touched where theirs changed something.
+// * What's taken from theirs is copied; base and theirs aren't changed.
+//   Observers of ours are told about each change as usual.
+// * Conflicts point into all three pods, which must outlive them.
+//
+std::vector<PodMergeConflict> merge(const PodNode& base, PodNode& ours, const PodNode& theirs);
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODMERGE_H__
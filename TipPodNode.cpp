@@ -3,19 +3,24 @@
 // $Id: TipPodNode.cpp 41077 2014-08-25 19:05:53Z miker $ 
 //******************************************************************************
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <limits>
 #include <iostream>
 #include <sstream>
 
 #include "TipPod.h"
 #include "TipPodValue.h"
+#include "TipPodSource.h"
 #include "TipPodBlockPodValue.h"
 #include "TipPodExc.h"
+#include "TipPodPath.h"
 #include "TipPodUtils.h"
+#include "TipPodWriteBuffer.h"
 
 namespace TipPod {
 
@@ -29,7 +34,11 @@ PodNode::PodNode(const std::string& podName,
           m_value(value),
           m_parent(NULL),
           m_sourcefile(),
-          m_sourceline(-1)
+          m_sourceline(-1),
+          m_observers(NULL),
+          m_contentHash(0),
+          m_writtenText(NULL),
+          m_format(NULL)
 {
     if (m_value)
     {
@@ -43,6 +52,28 @@ PodNode::~PodNode()
 {
     delete m_value;
     m_value = NULL;
+    delete m_observers;
+    m_observers = NULL;
+    delete m_writtenText;
+    m_writtenText = NULL;
+    delete m_format;
+    m_format = NULL;
+}
+
+
+// *****************************************************************************
+void PodNode::setPodName(const std::string& n)
+{
+    m_podName = n;
+    notifyRenamed();
+}
+
+
+// *****************************************************************************
+void PodNode::setPodType(const std::string& t)
+{
+    m_podType = t;
+    notifyRenamed();
 }
 
 
@@ -71,7 +102,14 @@ bool PodNode::isValueType(int type) const
 // *****************************************************************************
 std::string PodNode::valueTypeName() const
 {
-    switch (m_value ? m_value->type() : UNDEFINED)
+    return valueTypeName(m_value ? m_value->type() : UNDEFINED);
+}
+
+
+// *****************************************************************************
+std::string PodNode::valueTypeName(ValueType type)
+{
+    switch (type)
     {
         case STRING:     return "STRING";
         case INT:        return "INT";
@@ -88,16 +126,16 @@ std::string PodNode::valueTypeName() const
 // *****************************************************************************
 void PodNode::setValue(const PodNode& other)
 {
-    delete m_value; 
+    // Copy before deleting our value, which other's may be in, and so that
+    // it's kept if copying throws (blocks can't be copied)
+    PodValue* value = NULL;
     if (other.valueType() != UNDEFINED)
     {
-        m_value = other.m_value->copy();
-    }
-    else
-    {
-        m_value = NULL;
+        value = other.m_value->copy();
     }
-    syncBlock();
+    delete m_value;
+    m_value = value;
+    syncValue(false);
 }
 
 
@@ -106,7 +144,7 @@ void PodNode::setValue(PodValue* value)
 {
     delete m_value;
     m_value = value;
-    syncBlock();
+    syncValue(false);
 }
 
 
@@ -131,7 +169,8 @@ std::string PodNode::asString() const
     }
     else if (const FloatPodValue* v = dynamic_cast<const FloatPodValue*>(m_value))
     {
-        result << v->value();
+        char text[FLOAT_TEXT_SIZE];
+        result.write(text, formatFloat(v->value(), text));
     }
     else if (const IdentifierPodValue* v = dynamic_cast<const IdentifierPodValue*>(m_value))
     {
@@ -141,9 +180,9 @@ std::string PodNode::asString() const
     {
         result << v->value();
     }
-    else if (const BlockPodValue* v = dynamic_cast<const BlockPodValue*>(m_value))
+    else if (m_value && m_value->type() == BLOCK)
     {
-        write(result);
+        return writtenText();
     }
     else
     {
@@ -158,6 +197,7 @@ void PodNode::setValue(const std::string& value)
 {
     delete m_value;
     m_value = new StringPodValue(value);
+    notifyValueChanged();
 }
 
 
@@ -199,6 +239,7 @@ void PodNode::setValue(bool value)
 {
     delete m_value;
     m_value = new BoolPodValue(value);
+    notifyValueChanged();
 }
 
 
@@ -241,6 +282,7 @@ void PodNode::setValue(int value)
 {
     delete m_value;
     m_value = new IntPodValue(value);
+    notifyValueChanged();
 }
 
 
@@ -279,6 +321,7 @@ void PodNode::setValue(float value)
 {
     delete m_value;
     m_value = new FloatPodValue(value);
+    notifyValueChanged();
 }
 
 
@@ -312,6 +355,7 @@ PodNodeDeque& PodNode::asBlock()
         // Special case: User asked for value as a block, but this node has no
         // current value, so set the value to be an empty block and return it.
         m_value = new BlockPodValue;
+        notifyValueChanged();
         return asBlock();
     }
     throw ValueTypeError(__FUNCTION__, this);
@@ -335,6 +379,8 @@ void PodNode::setBlockScopeType(const std::string& blockScopeType)
     if (BlockPodValue* v = dynamic_cast<BlockPodValue*>(m_value))
     {
         v->setScopeType(blockScopeType);
+        notifyValueChanged();
+        return;
     }
     throw ValueTypeError(__FUNCTION__, this);
 }
@@ -355,7 +401,7 @@ void PodNode::setValue(PodNodeDeque& value, const std::string& blockScopeType)
 
     delete m_value;
     m_value = new BlockPodValue(value, blockScopeType);
-    syncBlock();
+    syncValue(false);
 }
 
 
@@ -427,10 +473,64 @@ const PodNode* PodNode::firstChildOfType(const std::string& podType) const
 }
 
 
+// *****************************************************************************
+PodNode* PodNode::find(const std::string& path)
+{
+    return PodPath(path).find(*this);
+}
+
+
+// *****************************************************************************
+const PodNode* PodNode::find(const std::string& path) const
+{
+    return PodPath(path).find(*this);
+}
+
+
 // *****************************************************************************
 void PodNode::syncBlock()
 {
-    if (!isBlock()) return;
+    syncValue(true);
+}
+
+
+// *****************************************************************************
+//
+// syncBlock(), after either the block's nodes were edited, or the value
+// was replaced
+//
+void PodNode::syncValue(bool blockEdited)
+{
+    try
+    {
+        syncChildren();
+    }
+    catch (...)
+    {
+        notifyValueChanged(blockEdited);  // Some children may have been dropped
+        throw;
+    }
+    notifyValueChanged(blockEdited);
+}
+
+
+// *****************************************************************************
+//
+// Returns whether the nodes of this block, or of any block under it, have
+// changed since they were parsed keeping their format.  Nodes that are
+// where they were parsed follow on from each other in the source, from
+// the '{' to the text after the last node; one that was added, moved or
+// has lost its neighbour doesn't.  Blocks found changed are marked edited,
+// so write() doesn't copy their old text.  Content hashes and written
+// text are cleared on every node visited, since without a format there's
+// no telling what changed, and a node's text depends on its parent.
+//
+bool PodNode::syncChildren()
+{
+    m_contentHash = 0;
+    delete m_writtenText;
+    m_writtenText = NULL;
+    if (!isBlock()) return false;
 
     //
     // We need to remove any PodNode*s from this block if they are
@@ -442,6 +542,8 @@ void PodNode::syncBlock()
     // them at once after cleaning things up.
     //
     std::ostringstream err;
+    bool changed = false;
+    const char* expected = m_format ? m_format->open : NULL;
     PodNodeDeque& block = asBlock();
     PodNodeDeque::iterator iter = block.begin();
     while (iter != block.end())
@@ -452,6 +554,7 @@ void PodNode::syncBlock()
             err << "Invalid NULL pointer in block." << std::endl;
             block.erase(iter);
             iter = block.begin();  // erase() invalidates iter, so start over
+            changed = true;
         }
         else if (child->m_parent && child->m_parent != this)
         {
@@ -459,18 +562,30 @@ void PodNode::syncBlock()
                 << child->m_parent->repr() << std::endl;
             block.erase(iter);
             iter = block.begin();  // erase() invalidates iter, so start over
+            changed = true;
         }
         else
         {
+            const PodNodeFormat* childFormat = child->m_format;
+            if (child->m_parent != this || !childFormat || childFormat->whole
+                || childFormat->edited || childFormat->begin != expected)
+            {
+                changed = true;
+            }
+            expected = childFormat ? childFormat->end : NULL;
             child->m_parent = this;
-            child->syncBlock();
+            if (child->syncChildren()) changed = true;
             ++iter;
         }
     }
+    if (m_format && expected != m_format->tailBegin) changed = true;
+    if (changed && m_format) m_format->edited = true;
+
     if (!err.str().empty())
     {
         throw PodIntegrityError(this, err.str());
     }
+    return changed;
 }
 
 
@@ -497,6 +612,8 @@ PodNode& PodNode::setIdentifierValue(const std::string& value)
 {
     delete m_value;
     m_value = new IdentifierPodValue(value);
+    notifyValueChanged();
+    return *this;
 }
 
 
@@ -535,6 +652,8 @@ void PodNode::setEmbedScriptLanguage(const std::string& language)
     if (EmbedPodValue* v = dynamic_cast<EmbedPodValue*>(m_value))
     {
         v->setLanguage(language);
+        notifyValueChanged();
+        return;
     }
     throw ValueTypeError(__FUNCTION__, this);
 }
@@ -545,15 +664,31 @@ PodNode& PodNode::setEmbedScriptValue(const std::string& value, const std::strin
 {
     delete m_value;
     m_value = new EmbedPodValue(value, language);
+    notifyValueChanged();
+    return *this;
 }
 
 
 // *****************************************************************************
 void PodNode::write(std::ostream& output, int indent) const
+{
+    PodWriteBuffer buffer(output);
+    write(buffer, indent);
+    buffer.flush();
+}
+
+
+// *****************************************************************************
+void PodNode::write(PodWriteBuffer& output, int indent) const
 {
     if (!isValid()) return;
 
-    if (valueType() == BLOCK 
+    if (m_format && m_format->whole && !m_parent
+        && !m_format->renamed && !m_format->valueChanged)
+    {
+        writeKeepingFormat(output, indent);
+    }
+    else if (valueType() == BLOCK 
         && (!parent() && m_podName.empty() && m_podType.empty()))
     {
         
@@ -568,26 +703,141 @@ void PodNode::write(std::ostream& output, int indent) const
     }
     else
     {
-        for (int i = 0; i < indent; ++i) output << "    ";
+        output.indent(indent);
+        writeLine(output, indent);
+        output.append('\n');
+    }
+}
 
-        if (!m_podType.empty())
-        {
-            output << m_podType << " ";
-        }
-        if (!m_podName.empty())
-        {
-            output << m_podName;
-        }
-        if (m_value)
+
+// *****************************************************************************
+//
+// The node as write() writes it, without the indent before it or the
+// newline after
+//
+void PodNode::writeLine(PodWriteBuffer& output, int indent) const
+{
+    writeNodeHead(output, m_podType, m_podName, m_value != NULL);
+    if (m_value)
+    {
+        m_value->write(output, indent);
+    }
+    output.append(';');
+}
+
+
+// *****************************************************************************
+//
+// write() for a node with a PodNodeFormat: its text is copied from the
+// source, but for what has changed since, which is written as usual.
+// Comments and spaces before a node go with it.  Nodes in a block that
+// weren't parsed with it go on a line of their own.
+//
+void PodNode::writeKeepingFormat(PodWriteBuffer& output, int indent) const
+{
+    const PodNodeFormat& format = *m_format;
+    if (!format.edited)
+    {
+        output.append(format.begin, format.end - format.begin);
+        return;
+    }
+    if (!format.valueBegin || !m_value || (format.renamed && format.valueChanged))
+    {
+        output.append(format.begin, format.start - format.begin);
+        writeLine(output, indent);
+        return;
+    }
+
+    if (format.renamed)
+    {
+        output.append(format.begin, format.start - format.begin);
+        writeNodeHead(output, m_podType, m_podName, m_value != NULL);
+    }
+    else
+    {
+        output.append(format.begin, format.valueBegin - format.begin);
+    }
+
+    if (format.valueChanged)
+    {
+        m_value->write(output, indent);
+    }
+    else if (format.open)
+    {
+        output.append(format.valueBegin, format.open - format.valueBegin);
+        // Nodes that haven't changed, and were next to each other, are
+        // copied in one piece.  What was copied last may end with a line
+        // comment and its newline, so a new node doesn't need another.
+        const int childIndent = format.whole ? indent : indent + 1;
+        const char* keptBegin = format.tailBegin;
+        const char* keptEnd = format.tailBegin;
+        bool lineEnded = format.open > format.valueBegin && format.open[-1] == '\n';
+        const PodNodeDeque& block = asBlock();
+        for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
         {
-            if (!m_podName.empty()) output << " = ";
-            m_value->write(output, indent);
+            const PodNode* child = *iter;
+            const PodNodeFormat* childFormat = child->m_format;
+            if (childFormat && !childFormat->whole && !childFormat->edited)
+            {
+                if (childFormat->begin != keptEnd)
+                {
+                    output.append(keptBegin, keptEnd - keptBegin);
+                    keptBegin = childFormat->begin;
+                }
+                keptEnd = childFormat->end;
+                continue;
+            }
+            if (keptEnd != keptBegin)
+            {
+                output.append(keptBegin, keptEnd - keptBegin);
+                lineEnded = keptEnd[-1] == '\n';
+            }
+            keptBegin = keptEnd;
+
+            if (!child->isValid()) continue;
+            if (childFormat && !childFormat->whole)
+            {
+                child->writeKeepingFormat(output, childIndent);
+            }
+            else
+            {
+                if (!lineEnded) output.append('\n');
+                output.indent(childIndent);
+                child->writeLine(output, childIndent);
+            }
+            lineEnded = false;
         }
-        output << ";" << std::endl;
+        output.append(keptBegin, keptEnd - keptBegin);
+        output.append(format.tailBegin, format.valueEnd - format.tailBegin);
     }
+    else
+    {
+        output.append(format.valueBegin, format.valueEnd - format.valueBegin);
+    }
+    output.append(format.valueEnd, format.end - format.valueEnd);
 }
 
 
+// *****************************************************************************
+const std::string& PodNode::writtenText() const
+{
+    if (!m_writtenText)
+    {
+        PodWriteBuffer buffer;
+        write(buffer);
+        m_writtenText = new std::string(buffer.data(), buffer.size());
+    }
+    return *m_writtenText;
+}
+
+
+// *****************************************************************************
+void PodNode::setFormat(PodNodeFormat* format)
+{
+    delete m_format;
+    m_format = format;
+}
+
 
 // *****************************************************************************
 std::string PodNode::repr() const
@@ -602,6 +852,248 @@ std::string PodNode::repr() const
 std::ostream& operator<<(std::ostream& output, const PodNode& pv)
 {
     output << pv.repr(); 
+    return output;
+}
+
+
+// *****************************************************************************
+const std::string& PodNode::sourcefile() const
+{
+    // Nodes parsed in zero-copy mode don't have their own copy of the file
+    // name, and share that of the root node instead.
+    const PodNode* node = this;
+    while (node->m_sourcefile.empty() && node->m_parent)
+    {
+        node = node->m_parent;
+    }
+    return node->m_sourcefile;
+}
+
+
+// *****************************************************************************
+//
+// Each piece is hashed with the hash so far as its seed, and strings
+// include their length, so different nodes don't run together into the
+// same bytes.  0 is kept to mean "not computed".
+//
+uint64_t PodNode::contentHash() const
+{
+    if (m_contentHash)
+    {
+        return m_contentHash;
+    }
+
+    uint64_t hash = hashBytesFast(m_podName.data(), m_podName.size());
+    hash = hashBytesFast(m_podType.data(), m_podType.size(), hash);
+    const uint32_t type = valueType();
+    hash = hashBytesFast(&type, sizeof(type), hash);
+
+    switch (type)
+    {
+        case STRING:
+            {
+                const std::string& v = static_cast<const StringPodValue*>(m_value)->value();
+                hash = hashBytesFast(v.data(), v.size(), hash);
+            }
+            break;
+        case IDENTIFIER:
+            {
+                const std::string& v = static_cast<const IdentifierPodValue*>(m_value)->value();
+                hash = hashBytesFast(v.data(), v.size(), hash);
+            }
+            break;
+        case EMBED:
+            {
+                const EmbedPodValue* v = static_cast<const EmbedPodValue*>(m_value);
+                hash = hashBytesFast(v->value().data(), v->value().size(), hash);
+                hash = hashBytesFast(v->language().data(), v->language().size(), hash);
+            }
+            break;
+        case INT:
+            {
+                const int v = static_cast<const IntPodValue*>(m_value)->value();
+                hash = hashBytesFast(&v, sizeof(v), hash);
+            }
+            break;
+        case FLOAT:
+            {
+                const float v = static_cast<const FloatPodValue*>(m_value)->value();
+                hash = hashBytesFast(&v, sizeof(v), hash);
+            }
+            break;
+        case BOOL:
+            {
+                const uint32_t v = static_cast<const BoolPodValue*>(m_value)->value();
+                hash = hashBytesFast(&v, sizeof(v), hash);
+            }
+            break;
+        case BLOCK:
+            {
+                const BlockPodValue* v = static_cast<const BlockPodValue*>(m_value);
+                hash = hashBytesFast(v->scopeType().data(), v->scopeType().size(), hash);
+                const PodNodeDeque& block = v->value();
+                for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+                {
+                    const uint64_t child = (*iter)->contentHash();
+                    hash = hashBytesFast(&child, sizeof(child), hash);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    m_contentHash = hash ? hash : 1;
+    return m_contentHash;
+}
+
+
+// *****************************************************************************
+//
+// Floats and bools are compared as contentHash() hashes them, by their
+// bytes, so a node with a NaN value still equals itself.
+//
+bool PodNode::contentEquals(const PodNode& other) const
+{
+    if (this == &other)
+    {
+        return true;
+    }
+    if (contentHash() != other.contentHash())
+    {
+        return false;
+    }
+    if (m_podName != other.m_podName || m_podType != other.m_podType)
+    {
+        return false;
+    }
+    const ValueType type = valueType();
+    if (type != other.valueType())
+    {
+        return false;
+    }
+
+    switch (type)
+    {
+        case STRING:
+            return static_cast<const StringPodValue*>(m_value)->value() ==
+                static_cast<const StringPodValue*>(other.m_value)->value();
+        case IDENTIFIER:
+            return static_cast<const IdentifierPodValue*>(m_value)->value() ==
+                static_cast<const IdentifierPodValue*>(other.m_value)->value();
+        case EMBED:
+            {
+                const EmbedPodValue* v = static_cast<const EmbedPodValue*>(m_value);
+                const EmbedPodValue* o = static_cast<const EmbedPodValue*>(other.m_value);
+                return v->value() == o->value() && v->language() == o->language();
+            }
+        case INT:
+            return static_cast<const IntPodValue*>(m_value)->value() ==
+                static_cast<const IntPodValue*>(other.m_value)->value();
+        case FLOAT:
+            {
+                const float v = static_cast<const FloatPodValue*>(m_value)->value();
+                const float o = static_cast<const FloatPodValue*>(other.m_value)->value();
+                return memcmp(&v, &o, sizeof(v)) == 0;
+            }
+        case BOOL:
+            return static_cast<const BoolPodValue*>(m_value)->value() ==
+                static_cast<const BoolPodValue*>(other.m_value)->value();
+        case BLOCK:
+            {
+                const BlockPodValue* v = static_cast<const BlockPodValue*>(m_value);
+                const BlockPodValue* o = static_cast<const BlockPodValue*>(other.m_value);
+                if (v->scopeType() != o->scopeType())
+                {
+                    return false;
+                }
+                const PodNodeDeque& block = v->value();
+                const PodNodeDeque& otherBlock = o->value();
+                if (block.size() != otherBlock.size())
+                {
+                    return false;
+                }
+                for (PodNodeDeque::const_iterator iter = block.begin(), otherIter = otherBlock.begin();
+                     iter != block.end(); ++iter, ++otherIter)
+                {
+                    if (!(*iter)->contentEquals(**otherIter))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        default:
+            return true;
+    }
+}
+
+
+// *****************************************************************************
+void PodNode::addObserver(PodNodeObserver* observer)
+{
+    if (!m_observers)
+    {
+        m_observers = new std::vector<PodNodeObserver*>;
+    }
+    m_observers->push_back(observer);
+}
+
+
+// *****************************************************************************
+void PodNode::removeObserver(PodNodeObserver* observer)
+{
+    if (!m_observers) return;
+
+    std::vector<PodNodeObserver*>::iterator iter =
+        std::find(m_observers->begin(), m_observers->end(), observer);
+    if (iter != m_observers->end())
+    {
+        m_observers->erase(iter);
+    }
+    if (m_observers->empty())
+    {
+        delete m_observers;
+        m_observers = NULL;
+    }
+}
+
+
+// *****************************************************************************
+void PodNode::notifyRenamed()
+{
+    if (m_format) m_format->renamed = true;
+    for (PodNode* node = this; node; node = node->m_parent)
+    {
+        node->m_contentHash = 0;
+        if (node->m_format) node->m_format->edited = true;
+        delete node->m_writtenText;
+        node->m_writtenText = NULL;
+        if (!node->m_observers) continue;
+        for (size_t i = 0; i < node->m_observers->size(); ++i)
+        {
+            (*node->m_observers)[i]->nodeRenamed(*this);
+        }
+    }
+}
+
+
+// *****************************************************************************
+void PodNode::notifyValueChanged(bool blockEdited)
+{
+    if (m_format && !blockEdited) m_format->valueChanged = true;
+    for (PodNode* node = this; node; node = node->m_parent)
+    {
+        node->m_contentHash = 0;
+        if (node->m_format) node->m_format->edited = true;
+        delete node->m_writtenText;
+        node->m_writtenText = NULL;
+        if (!node->m_observers) continue;
+        for (size_t i = 0; i < node->m_observers->size(); ++i)
+        {
+            (*node->m_observers)[i]->valueChanged(*this);
+        }
+    }
 }
 
 
@@ -645,7 +1137,7 @@ void PodNode::dump(std::ostream& output, int indent)
         }
         for (int i = 0; i < indent; ++i) output << "\t";
     }
-    output << " [defined in '" << m_sourcefile << "', line " << m_sourceline << "]";
+    output << " [defined in '" << sourcefile() << "', line " << m_sourceline << "]";
     output << ")" << std::endl;
 }
 
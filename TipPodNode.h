@@ -7,13 +7,22 @@
 #define __TIPPODNODE_H__
 
 #include <string>
-#include <deque>
+#include <vector>
+#include <stdint.h>
+
+#include "TipPodNodeVector.h"
 
 namespace TipPod {
 
 class PodValue;
 class PodNode;
-typedef std::deque<PodNode*> PodNodeDeque;
+class PodNodeObserver;
+class PodWriteBuffer;
+struct PodNodeFormat;
+
+// The nodes of a block.  This used to be a std::deque<PodNode*>; the name is
+// kept so existing code still compiles, but new code should use PodNodeVector.
+typedef PodNodeVector PodNodeDeque;
 typedef PodNodeDeque::iterator PodNodeIter;
 
 
@@ -67,11 +76,11 @@ public:
 
     // Node's user-specified name.  May be empty.
     const std::string& podName() const { return m_podName; }
-    void setPodName(const std::string& n) { m_podName = n; }
+    void setPodName(const std::string& n);
 
     // Node's user-specified semantic type.  May be empty.
     const std::string& podType() const { return m_podType; }
-    void setPodType(const std::string& t) { m_podType = t; }
+    void setPodType(const std::string& t);
 
     // Node representing the block this node was defined in.
     // Returns NULL if node is at the top level.
@@ -83,12 +92,15 @@ public:
     ValueType valueType() const;
     bool isValueType(int type) const;
     std::string valueTypeName() const;
-    void setValue(const PodNode& other);  // Makes a copy of other PodNode's value
+    static std::string valueTypeName(ValueType type);
+    void setValue(const PodNode& other);  // Makes a copy of other PodNode's value, throws if a block
     void setValue(PodValue* value);       // Takes ownership of this pointer
 
     // Node's value as a string.
     bool isString() const;
     std::string asString() const;   // All types are cast to string as one would expect.
+                                    // Floats as formatFloat() writes them, blocks as
+                                    // writtenText().
     void setValue(const std::string& value);
 
     // Node's value as a bool.
@@ -119,6 +131,8 @@ public:
     const PodNode* childByName(const std::string& name) const; // Returns first match, NULL if not found
     PodNode* firstChildOfType(const std::string& podType);              // Returns first match, NULL if not found
     const PodNode* firstChildOfType(const std::string& podType) const;   // Returns first match, NULL if not found
+    PodNode* find(const std::string& path);              // See PodPath, NULL if not found
+    const PodNode* find(const std::string& path) const;  // See PodPath, NULL if not found
     PodNodeDeque& asBlock();  // Throws if not a block, creates empty block if undefined
     //
     // IMPORTANT: If you modify the contents of the block, you MUST call
@@ -140,20 +154,68 @@ public:
     PodNode& setEmbedScriptValue(const std::string& value, const std::string& language);
 
     //
-    // Serialization
+    // Serialization.  Writing to a stream goes through a PodWriteBuffer,
+    // which is flushed at the end; pass one to write several nodes, or to
+    // write straight to a file descriptor.  A root node parsed with
+    // PARSE_KEEP_FORMAT copies the text of what hasn't changed instead.
     //
     void write(std::ostream& output, int indent=0) const;
+    void write(PodWriteBuffer& output, int indent=0) const;
     std::string repr() const;
 
+    //
+    // The text write() writes for this node, at no indent.  Written the
+    // first time it's asked for and kept, like contentHash(), until this
+    // node or one under it is changed; the reference is good until then.
+    //
+    const std::string& writtenText() const;
+
+    //
+    // Hash of this node's name, type and value, and of everything under it,
+    // for telling whether a subtree has changed or two are the same.  Where
+    // the node came from and how its file was formatted don't count.
+    // Computed the first time it's asked for and kept until this node or
+    // one under it is changed, by the same calls observers are told about
+    // (see PodNodeObserver), or syncBlock() is called on a node above it.
+    // Stable across runs, like hashBytesFast().
+    //
+    uint64_t contentHash() const;
+
+    //
+    // Whether this node and other have the same name, type and value, and
+    // the same everything under them, going by what contentHash() hashes.
+    // Different hashes answer no straight away; equal ones are confirmed
+    // by comparing the nodes, since different content can share a hash.
+    //
+    bool contentEquals(const PodNode& other) const;
+
     //
     // Internal and/or junk to be moved and/or removed
     //
     void dump(std::ostream& output, int indent=0);
     friend std::ostream& operator<<(std::ostream&, const PodNode&);
     void setSource(const std::string& filename, int line) { m_sourcefile = filename; m_sourceline = line; }
+    void setFormat(PodNodeFormat* format);  // Takes ownership, see PARSE_KEEP_FORMAT
+    PodNodeFormat* format() const { return m_format; }  // NULL if none
+    const std::string& sourcefile() const;  // Nearest non-empty file name of this node or its parents
+    int sourceline() const { return m_sourceline; }
     const PodValue* value() const { return m_value; }
 
+    //
+    // Observers are told about changes to this node and every node under it
+    // (see PodNodeObserver).  The observer isn't owned, and must be removed
+    // before it's destroyed; an observer of a node must not outlive it.
+    //
+    void addObserver(PodNodeObserver* observer);
+    void removeObserver(PodNodeObserver* observer);
+
 protected:
+    void syncValue(bool blockEdited);
+    bool syncChildren();
+    void notifyRenamed();
+    void notifyValueChanged(bool blockEdited=false);
+    void writeLine(PodWriteBuffer& output, int indent) const;
+    void writeKeepingFormat(PodWriteBuffer& output, int indent) const;
 
 protected:
     std::string     m_podName; // Name of this node, may be unspecified ("")
@@ -164,6 +226,43 @@ protected:
 
     std::string m_sourcefile;  // Where this node came from
     int         m_sourceline;
+
+    std::vector<PodNodeObserver*>* m_observers;  // NULL unless there are some
+    mutable uint64_t m_contentHash;              // 0 until computed
+    mutable std::string* m_writtenText;          // NULL until asked for
+    PodNodeFormat* m_format;                     // NULL unless parsed with PARSE_KEEP_FORMAT
+};
+
+
+// *****************************************************************************
+//
+// Interface for code that keeps information about a tree of PodNodes up to
+// date as the tree is changed, such as PodNodeIndex.
+//
+// NOTES:
+//
+// * Added to a node with PodNode::addObserver(), and told about changes to
+//   that node and any node below it, after they are made.  Calls are made
+//   on the thread making the change.
+// * valueChanged() is called when a node's value is replaced with one of
+//   the setValue() methods, or syncBlock() is called on it after its block
+//   has been edited through asBlock().  Anything that was under the node
+//   may have been deleted by then, so observers that keep pointers to
+//   nodes must not follow them until they have checked they are still in
+//   the tree.
+// * Edits made through asBlock() aren't seen until syncBlock() is called.
+// * Observers must not change the tree from these calls.
+//
+class PodNodeObserver
+{
+public:
+    virtual ~PodNodeObserver() {}
+
+    // After node's podName or podType is set
+    virtual void nodeRenamed(PodNode& node) = 0;
+
+    // After node's value, or anything under it, is changed
+    virtual void valueChanged(PodNode& node) = 0;
 };
 
 
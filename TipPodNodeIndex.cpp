@@ -0,0 +1,497 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <algorithm>
+
+#include "TipPodNodeIndex.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+static size_t hashPointer(const PodNode* node)
+{
+    uint64_t h = reinterpret_cast<uintptr_t>(node);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return size_t(h);
+}
+
+
+// *****************************************************************************
+static size_t countNodes(const PodNode& node)
+{
+    size_t count = 1;
+    if (node.isBlock())
+    {
+        const PodNodeDeque& block = node.asBlock();
+        for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+        {
+            count += countNodes(**iter);
+        }
+    }
+    return count;
+}
+
+
+// *****************************************************************************
+PodNodeIndex::PodNodeIndex(PodNode& root)
+        : m_root(root),
+          m_types(),
+          m_names(),
+          m_entries(),
+          m_freeEntries(),
+          m_slots(),
+          m_slotCount(0),
+          m_nodeCount(0),
+          m_rootEntry(NONE)
+{
+    // Size everything once, rather than growing it node by node
+    const size_t count = countNodes(root);
+    m_entries.reserve(count);
+    size_t slots = 1024;
+    while (slots < count * 2) slots *= 2;
+    m_slots.resize(slots);
+
+    m_rootEntry = add(&root);
+    root.addObserver(this);
+}
+
+
+// *****************************************************************************
+PodNodeIndex::~PodNodeIndex()
+{
+    m_root.removeObserver(this);
+}
+
+
+// *****************************************************************************
+const std::vector<PodNode*>& PodNodeIndex::byType(const std::string& podType) const
+{
+    static const std::vector<PodNode*> none;
+    const List* list = findList(m_types, podType);
+    return list ? list->nodes : none;
+}
+
+
+// *****************************************************************************
+const std::vector<PodNode*>& PodNodeIndex::byName(const std::string& podName) const
+{
+    static const std::vector<PodNode*> none;
+    const List* list = findList(m_names, podName);
+    return list ? list->nodes : none;
+}
+
+
+// *****************************************************************************
+size_t PodNodeIndex::memoryUsage() const
+{
+    size_t total = sizeof(*this)
+                   + m_entries.capacity() * sizeof(Entry)
+                   + m_freeEntries.capacity() * sizeof(uint32_t)
+                   + m_slots.capacity() * sizeof(Slot);
+    const ListTable* tables[] = { &m_types, &m_names };
+    for (size_t t = 0; t < 2; ++t)
+    {
+        total += tables[t]->slots.capacity() * sizeof(List*);
+        for (std::deque<List>::const_iterator iter = tables[t]->lists.begin();
+                iter != tables[t]->lists.end(); ++iter)
+        {
+            total += sizeof(List) + iter->nodes.capacity() * sizeof(PodNode*)
+                     + iter->entries.capacity() * sizeof(uint32_t);
+            if (iter->key.capacity() > 15) total += iter->key.capacity();
+        }
+    }
+    return total;
+}
+
+
+// *****************************************************************************
+void PodNodeIndex::nodeRenamed(PodNode& node)
+{
+    const uint32_t entry = find(&node);
+    if (entry == NONE || entry == m_rootEntry) return;
+
+    // The node may have been renamed to what it was already
+    if (m_entries[entry].podType->key != node.podType()
+        || m_entries[entry].podName->key != node.podName())
+    {
+        unlist(entry);
+        list(entry);
+    }
+}
+
+
+// *****************************************************************************
+void PodNodeIndex::valueChanged(PodNode& node)
+{
+    const uint32_t entry = find(&node);
+    if (entry != NONE)
+    {
+        update(entry);
+    }
+}
+
+
+// *****************************************************************************
+//
+// Index a node and everything under it, in document order
+//
+uint32_t PodNodeIndex::add(PodNode* node)
+{
+    uint32_t entry;
+    if (m_freeEntries.empty())
+    {
+        entry = m_entries.size();
+        m_entries.push_back(Entry());
+    }
+    else
+    {
+        entry = m_freeEntries.back();
+        m_freeEntries.pop_back();
+    }
+    Entry& e = m_entries[entry];
+    e.node = node;
+    e.podType = NULL;
+    e.podName = NULL;
+    e.typePosition = 0;
+    e.namePosition = 0;
+    e.firstChild = NONE;
+    e.nextSibling = NONE;
+    insertSlot(node, entry);
+    if (node != &m_root)
+    {
+        list(entry);
+    }
+
+    if (node->isBlock())
+    {
+        const PodNodeDeque& block = static_cast<const PodNode*>(node)->asBlock();
+        uint32_t previous = NONE;
+        for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+        {
+            const uint32_t child = add(*iter);
+            link(entry, previous) = child;
+            previous = child;
+        }
+    }
+    return entry;
+}
+
+
+// *****************************************************************************
+//
+// Forget a node and everything under it, without looking at any of them
+//
+void PodNodeIndex::remove(uint32_t entry)
+{
+    for (uint32_t child = m_entries[entry].firstChild; child != NONE; )
+    {
+        const uint32_t next = m_entries[child].nextSibling;
+        remove(child);
+        child = next;
+    }
+    if (m_entries[entry].podType)
+    {
+        unlist(entry);
+    }
+    eraseSlot(m_entries[entry].node, entry);
+    m_entries[entry].node = NULL;
+    m_freeEntries.push_back(entry);
+}
+
+
+// *****************************************************************************
+//
+// Bring the index up to date with a node that is still in the tree, and
+// everything under it.  Children are matched with those the index has by
+// address, so a deleted node whose memory has been reused for another is
+// taken for the same one, and fixed up like any other that was changed.
+//
+void PodNodeIndex::update(uint32_t entry)
+{
+    PodNode* node = m_entries[entry].node;
+    if (entry != m_rootEntry
+        && (m_entries[entry].podType->key != node->podType()
+            || m_entries[entry].podName->key != node->podName()))
+    {
+        unlist(entry);
+        list(entry);
+    }
+
+    PodNodeDeque none;
+    const PodNodeDeque& block = node->isBlock() ? static_cast<const PodNode*>(node)->asBlock() : none;
+
+    // Usually most children are the same, in the same order
+    PodNodeDeque::const_iterator iter = block.begin();
+    uint32_t previous = NONE;
+    while (iter != block.end() && link(entry, previous) != NONE
+           && m_entries[link(entry, previous)].node == *iter)
+    {
+        previous = link(entry, previous);
+        update(previous);
+        ++iter;
+    }
+    if (iter == block.end() && link(entry, previous) == NONE)
+    {
+        return;
+    }
+
+    // Otherwise match up the rest, and add and remove the difference
+    std::vector<std::pair<PodNode*, uint32_t> > old;
+    for (uint32_t child = link(entry, previous); child != NONE; child = m_entries[child].nextSibling)
+    {
+        old.push_back(std::make_pair(m_entries[child].node, child));
+    }
+    std::sort(old.begin(), old.end());
+
+    std::vector<uint32_t> children;
+    for (PodNodeDeque::const_iterator rest = iter; rest != block.end(); ++rest)
+    {
+        std::vector<std::pair<PodNode*, uint32_t> >::iterator match =
+            std::lower_bound(old.begin(), old.end(), std::make_pair(*rest, uint32_t(0)));
+        if (match != old.end() && match->first == *rest && match->second != NONE)
+        {
+            children.push_back(match->second);
+            update(match->second);
+            match->second = NONE;
+        }
+        else
+        {
+            children.push_back(NONE);  // Added once the old ones are gone
+        }
+    }
+    for (size_t i = 0; i < old.size(); ++i)
+    {
+        if (old[i].second != NONE) remove(old[i].second);
+    }
+
+    // Relink the children that are left, and add the new ones
+    for (size_t i = 0; i < children.size(); ++i, ++iter)
+    {
+        const uint32_t child = children[i] != NONE ? children[i] : add(*iter);
+        link(entry, previous) = child;
+        previous = child;
+    }
+    link(entry, previous) = NONE;
+}
+
+
+// *****************************************************************************
+//
+// Where the entry after previous, a child of parent, is linked from.  Not
+// kept across calls that add entries, which may move them.
+//
+uint32_t& PodNodeIndex::link(uint32_t parent, uint32_t previous)
+{
+    return previous == NONE ? m_entries[parent].firstChild : m_entries[previous].nextSibling;
+}
+
+
+// *****************************************************************************
+void PodNodeIndex::list(uint32_t entry)
+{
+    PodNode* node = m_entries[entry].node;
+    List* podType = listFor(m_types, node->podType());
+    List* podName = listFor(m_names, node->podName());
+    Entry& e = m_entries[entry];
+    e.podType = podType;
+    e.podName = podName;
+    e.typePosition = podType->nodes.size();
+    e.namePosition = podName->nodes.size();
+    podType->nodes.push_back(node);
+    podType->entries.push_back(entry);
+    podName->nodes.push_back(node);
+    podName->entries.push_back(entry);
+    ++m_nodeCount;
+}
+
+
+// *****************************************************************************
+void PodNodeIndex::unlist(uint32_t entry)
+{
+    const Entry& e = m_entries[entry];
+    listRemove(e.podType, e.typePosition, true);
+    listRemove(e.podName, e.namePosition, false);
+    --m_nodeCount;
+}
+
+
+// *****************************************************************************
+//
+// Move the last node of the list into the place of the one removed
+//
+void PodNodeIndex::listRemove(List* list, uint32_t position, bool isType)
+{
+    const uint32_t last = list->nodes.size() - 1;
+    if (position != last)
+    {
+        const uint32_t moved = list->entries[last];
+        list->nodes[position] = list->nodes[last];
+        list->entries[position] = moved;
+        if (isType)
+        {
+            m_entries[moved].typePosition = position;
+        }
+        else
+        {
+            m_entries[moved].namePosition = position;
+        }
+    }
+    list->nodes.pop_back();
+    list->entries.pop_back();
+}
+
+
+// *****************************************************************************
+//
+// The list for a key, which is added if there isn't one.  Lists are never
+// removed, even once they're empty.
+//
+PodNodeIndex::List* PodNodeIndex::listFor(ListTable& table, const std::string& key)
+{
+    if ((table.lists.size() + 1) * 2 > table.slots.size())
+    {
+        std::vector<List*> slots(std::max(size_t(64), table.slots.size() * 2), NULL);
+        const size_t mask = slots.size() - 1;
+        for (std::deque<List>::iterator iter = table.lists.begin(); iter != table.lists.end(); ++iter)
+        {
+            size_t i = hashBytes(iter->key.data(), iter->key.size()) & mask;
+            while (slots[i]) i = (i + 1) & mask;
+            slots[i] = &*iter;
+        }
+        table.slots.swap(slots);
+    }
+
+    const size_t mask = table.slots.size() - 1;
+    size_t i = hashBytes(key.data(), key.size()) & mask;
+    for (; table.slots[i]; i = (i + 1) & mask)
+    {
+        if (table.slots[i]->key == key)
+        {
+            return table.slots[i];
+        }
+    }
+    table.lists.push_back(List());
+    table.lists.back().key = key;
+    table.slots[i] = &table.lists.back();
+    return table.slots[i];
+}
+
+
+// *****************************************************************************
+const PodNodeIndex::List* PodNodeIndex::findList(const ListTable& table, const std::string& key)
+{
+    if (table.slots.empty())
+    {
+        return NULL;
+    }
+    const size_t mask = table.slots.size() - 1;
+    for (size_t i = hashBytes(key.data(), key.size()) & mask; table.slots[i]; i = (i + 1) & mask)
+    {
+        if (table.slots[i]->key == key)
+        {
+            return table.slots[i];
+        }
+    }
+    return NULL;
+}
+
+
+// *****************************************************************************
+uint32_t PodNodeIndex::find(const PodNode* node) const
+{
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = hashPointer(node) & mask; m_slots[i].node; i = (i + 1) & mask)
+    {
+        if (m_slots[i].node == node)
+        {
+            return m_slots[i].entry;
+        }
+    }
+    return NONE;
+}
+
+
+// *****************************************************************************
+//
+// A node whose memory is reused may be added before its old entry is
+// removed, in which case the slot is taken over by the new entry.
+//
+void PodNodeIndex::insertSlot(PodNode* node, uint32_t entry)
+{
+    if ((m_slotCount + 1) * 2 > m_slots.size())
+    {
+        growSlots();
+    }
+    const size_t mask = m_slots.size() - 1;
+    size_t i = hashPointer(node) & mask;
+    while (m_slots[i].node && m_slots[i].node != node)
+    {
+        i = (i + 1) & mask;
+    }
+    if (!m_slots[i].node)
+    {
+        ++m_slotCount;
+    }
+    m_slots[i].node = node;
+    m_slots[i].entry = entry;
+}
+
+
+// *****************************************************************************
+//
+// Linear probing, so the slots after the one erased are moved back to
+// where a lookup will find them
+//
+void PodNodeIndex::eraseSlot(const PodNode* node, uint32_t entry)
+{
+    const size_t mask = m_slots.size() - 1;
+    size_t i = hashPointer(node) & mask;
+    while (m_slots[i].node != node)
+    {
+        if (!m_slots[i].node) return;
+        i = (i + 1) & mask;
+    }
+    if (m_slots[i].entry != entry)
+    {
+        return;  // Taken over by a new node at the same address
+    }
+
+    m_slots[i].node = NULL;
+    --m_slotCount;
+    for (size_t j = (i + 1) & mask; m_slots[j].node; j = (j + 1) & mask)
+    {
+        const size_t home = hashPointer(m_slots[j].node) & mask;
+        // Move it back if its home isn't cyclically in (i, j]
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+        {
+            m_slots[i] = m_slots[j];
+            m_slots[j].node = NULL;
+            i = j;
+        }
+    }
+}
+
+
+// *****************************************************************************
+void PodNodeIndex::growSlots()
+{
+    std::vector<Slot> old(m_slots.size() * 2);
+    old.swap(m_slots);
+    m_slotCount = 0;
+    for (size_t i = 0; i < old.size(); ++i)
+    {
+        if (old[i].node)
+        {
+            insertSlot(old[i].node, old[i].entry);
+        }
+    }
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,132 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODNODEINDEX_H__
+#define __TIPPODNODEINDEX_H__
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "TipPodNode.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Every node under a PodNode, listed by podType and by podName, and kept up
+// to date as the tree is changed.  The mutable counterpart of
+// PodSnapshotIndex:
+//
+//     PodNodeIndex index(*root);
+//     const std::vector<PodNode*>& lights = index.byType("Light");
+//
+// NOTES:
+//
+// * Built in one pass over the tree, then updated as a PodNodeObserver of
+//   the root: setPodName() and setPodType() move a node between lists,
+//   and the setValue() methods and syncBlock() update the nodes below the
+//   one changed.  Like the tree's parent pointers, edits made through
+//   asBlock() are seen once syncBlock() is called.
+// * Nodes are listed in document order until the tree is changed, after
+//   which the order of each list is unspecified.  The root isn't listed.
+// * Pointers to nodes that are removed from the tree are never followed,
+//   so nodes may be deleted before syncBlock() tells the index they're gone.
+// * The root must outlive the index.  Not thread safe, like the tree.
+//
+class PodNodeIndex : public PodNodeObserver
+{
+public:
+    explicit PodNodeIndex(PodNode& root);
+    virtual ~PodNodeIndex();
+
+    PodNode& root() const { return m_root; }
+
+    // Empty if there are none
+    const std::vector<PodNode*>& byType(const std::string& podType) const;
+    const std::vector<PodNode*>& byName(const std::string& podName) const;
+
+    size_t size() const { return m_nodeCount; }  // Nodes listed
+    size_t memoryUsage() const;
+
+    // PodNodeObserver
+    virtual void nodeRenamed(PodNode& node);
+    virtual void valueChanged(PodNode& node);
+
+private:
+    enum { NONE = 0xffffffff };
+
+    // The nodes with one type, or one name
+    struct List
+    {
+        std::string           key;
+        std::vector<PodNode*> nodes;
+        std::vector<uint32_t> entries;  // Of each node
+    };
+
+    // Open addressed hash table of key to list, for types or names
+    struct ListTable
+    {
+        std::deque<List>   lists;  // Which don't move as more are added
+        std::vector<List*> slots;  // Size is a power of two
+    };
+
+    // What the index knows about a node, which is all it needs to remove
+    // the node and everything under it after they've been deleted
+    struct Entry
+    {
+        PodNode* node;
+        List*    podType;      // NULL for the root
+        List*    podName;
+        uint32_t typePosition;  // In podType->nodes
+        uint32_t namePosition;
+        uint32_t firstChild;   // Entries, or NONE
+        uint32_t nextSibling;
+    };
+
+    // Open addressed hash table of PodNode* to entry
+    struct Slot
+    {
+        PodNode* node;
+        uint32_t entry;
+    };
+
+    uint32_t add(PodNode* node);
+    void remove(uint32_t entry);
+    void update(uint32_t entry);
+    uint32_t& link(uint32_t parent, uint32_t previous);
+    void list(uint32_t entry);
+    void unlist(uint32_t entry);
+    void listRemove(List* list, uint32_t position, bool isType);
+    static List* listFor(ListTable& table, const std::string& key);
+    static const List* findList(const ListTable& table, const std::string& key);
+
+    uint32_t find(const PodNode* node) const;
+    void insertSlot(PodNode* node, uint32_t entry);
+    void eraseSlot(const PodNode* node, uint32_t entry);
+    void growSlots();
+
+    PodNodeIndex(const PodNodeIndex&);             // Not implemented
+    PodNodeIndex& operator=(const PodNodeIndex&);  // Not implemented
+
+private:
+    PodNode&              m_root;
+    ListTable             m_types;
+    ListTable             m_names;
+    std::vector<Entry>    m_entries;
+    std::vector<uint32_t> m_freeEntries;
+    std::vector<Slot>     m_slots;      // Size is a power of two
+    size_t                m_slotCount;  // In use
+    size_t                m_nodeCount;
+    uint32_t              m_rootEntry;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODNODEINDEX_H__
@@ -0,0 +1,134 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "TipPodNodeVector.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+PodNodeVector::PodNodeVector(const PodNodeVector& other)
+        : m_data(m_inline),
+          m_size(0),
+          m_capacity(INLINE_CAPACITY)
+{
+    *this = other;
+}
+
+
+// *****************************************************************************
+PodNodeVector::~PodNodeVector()
+{
+    if (!isInline())
+    {
+        std::free(m_data);
+    }
+}
+
+
+// *****************************************************************************
+PodNodeVector& PodNodeVector::operator=(const PodNodeVector& other)
+{
+    if (this != &other)
+    {
+        m_size = 0;
+        reserve(other.m_size);
+        memcpy(m_data, other.m_data, other.m_size * sizeof(PodNode*));
+        m_size = other.m_size;
+    }
+    return *this;
+}
+
+
+// *****************************************************************************
+void PodNodeVector::swap(PodNodeVector& other)
+{
+    if (this == &other) return;
+
+    if (!isInline() && !other.isInline())
+    {
+        std::swap(m_data, other.m_data);
+    }
+    else if (isInline() && other.isInline())
+    {
+        PodNode* tmp[INLINE_CAPACITY];
+        memcpy(tmp, m_inline, m_size * sizeof(PodNode*));
+        memcpy(m_inline, other.m_inline, other.m_size * sizeof(PodNode*));
+        memcpy(other.m_inline, tmp, m_size * sizeof(PodNode*));
+    }
+    else
+    {
+        // One side is inline: copy its (at most INLINE_CAPACITY) nodes across,
+        // and hand over the heap allocation of the other.
+        PodNodeVector& inlined = isInline() ? *this : other;
+        PodNodeVector& heaped = isInline() ? other : *this;
+        memcpy(heaped.m_inline, inlined.m_inline, inlined.m_size * sizeof(PodNode*));
+        inlined.m_data = heaped.m_data;
+        heaped.m_data = heaped.m_inline;
+    }
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+}
+
+
+// *****************************************************************************
+PodNodeVector::iterator PodNodeVector::insert(iterator position, PodNode* node)
+{
+    const size_type index = position - m_data;
+    if (m_size == m_capacity) grow(m_size + 1);
+    memmove(m_data + index + 1, m_data + index, (m_size - index) * sizeof(PodNode*));
+    m_data[index] = node;
+    ++m_size;
+    return m_data + index;
+}
+
+
+// *****************************************************************************
+PodNodeVector::iterator PodNodeVector::erase(iterator position)
+{
+    return erase(position, position + 1);
+}
+
+
+// *****************************************************************************
+PodNodeVector::iterator PodNodeVector::erase(iterator first, iterator last)
+{
+    memmove(first, last, (end() - last) * sizeof(PodNode*));
+    m_size -= (last - first);
+    return first;
+}
+
+
+// *****************************************************************************
+void PodNodeVector::grow(size_type minCapacity)
+{
+    size_type capacity = m_capacity * 2;
+    if (capacity < minCapacity) capacity = minCapacity;
+
+    PodNode** data = NULL;
+    if (isInline())
+    {
+        data = static_cast<PodNode**>(std::malloc(capacity * sizeof(PodNode*)));
+        if (data) memcpy(data, m_data, m_size * sizeof(PodNode*));
+    }
+    else
+    {
+        data = static_cast<PodNode**>(std::realloc(m_data, capacity * sizeof(PodNode*)));
+    }
+    if (!data)
+    {
+        throw std::bad_alloc();
+    }
+    m_data = data;
+    m_capacity = capacity;
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,136 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODNODEVECTOR_H__
+#define __TIPPODNODEVECTOR_H__
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+
+namespace TipPod {
+
+class PodNode;
+
+
+// *****************************************************************************
+//
+// Contiguous sequence of PodNode*s, used to hold the nodes of a block.
+//
+// NOTES:
+//
+// * Up to INLINE_CAPACITY nodes are stored inside the object itself, so the
+//   typical small block needs no allocation beyond its BlockPodValue.  (A
+//   std::deque allocates a map plus a 512 byte chunk, even for one node.)
+// * Supports the subset of the std::deque interface used with PodNodeDeque,
+//   including push_front()/pop_front(), which are O(n) here.
+// * Iterators are plain pointers, and like those of std::vector are
+//   invalidated by anything that inserts or removes nodes.
+// * Does NOT own the nodes it points to.
+//
+class PodNodeVector
+{
+public:
+    typedef PodNode*                              value_type;
+    typedef size_t                                size_type;
+    typedef ptrdiff_t                             difference_type;
+    typedef PodNode*&                             reference;
+    typedef PodNode* const&                       const_reference;
+    typedef PodNode**                             pointer;
+    typedef PodNode* const*                       const_pointer;
+    typedef PodNode**                             iterator;
+    typedef PodNode* const*                       const_iterator;
+    typedef std::reverse_iterator<iterator>       reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    enum { INLINE_CAPACITY = 8 };
+
+    PodNodeVector() : m_data(m_inline), m_size(0), m_capacity(INLINE_CAPACITY) {}
+    PodNodeVector(const PodNodeVector& other);
+    template <typename InputIterator>
+    PodNodeVector(InputIterator first, InputIterator last)
+        : m_data(m_inline), m_size(0), m_capacity(INLINE_CAPACITY)
+        {
+            for (; first != last; ++first) push_back(*first);
+        }
+    ~PodNodeVector();
+
+    PodNodeVector& operator=(const PodNodeVector& other);
+    void swap(PodNodeVector& other);
+
+    iterator begin() { return m_data; }
+    iterator end() { return m_data + m_size; }
+    const_iterator begin() const { return m_data; }
+    const_iterator end() const { return m_data + m_size; }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    size_type size() const { return m_size; }
+    size_type capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+    void reserve(size_type n) { if (n > m_capacity) grow(n); }
+
+    reference operator[](size_type i) { return m_data[i]; }
+    const_reference operator[](size_type i) const { return m_data[i]; }
+    reference at(size_type i) { checkIndex(i); return m_data[i]; }
+    const_reference at(size_type i) const { checkIndex(i); return m_data[i]; }
+    reference front() { return m_data[0]; }
+    const_reference front() const { return m_data[0]; }
+    reference back() { return m_data[m_size - 1]; }
+    const_reference back() const { return m_data[m_size - 1]; }
+
+    void push_back(PodNode* node)
+        {
+            if (m_size == m_capacity) grow(m_size + 1);
+            m_data[m_size++] = node;
+        }
+    void pop_back() { --m_size; }
+    void push_front(PodNode* node) { insert(begin(), node); }
+    void pop_front() { erase(begin()); }
+
+    iterator insert(iterator position, PodNode* node);
+    iterator erase(iterator position);
+    iterator erase(iterator first, iterator last);
+    void clear() { m_size = 0; }
+
+private:
+    bool isInline() const { return m_data == m_inline; }
+    void grow(size_type minCapacity);
+    void checkIndex(size_type i) const
+        {
+            if (i >= m_size) throw std::out_of_range("PodNodeVector index out of range");
+        }
+
+private:
+    PodNode**    m_data;     // Either m_inline, or a heap allocation
+    unsigned int m_size;
+    unsigned int m_capacity;
+    PodNode*     m_inline[INLINE_CAPACITY];
+};
+
+
+inline bool operator==(const PodNodeVector& a, const PodNodeVector& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+
+inline bool operator!=(const PodNodeVector& a, const PodNodeVector& b)
+{
+    return !(a == b);
+}
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODNODEVECTOR_H__
@@ -0,0 +1,399 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <cstring>
+#include <stdexcept>
+
+#include "TipPodOverlay.h"
+#include "TipPodBlockPodValue.h"
+#include "TipPodExc.h"
+#include "TipPodPath.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Slot to start probing at for a (block, name) pair.  The table is at least
+// twice the number of nodes, so the low bits of a cheap mix are enough.
+//
+static inline size_t childHash(uint32_t block, uint32_t name)
+{
+    uint64_t h = (static_cast<uint64_t>(block) << 32 | name) * 0x9e3779b97f4a7c15ULL;
+    return static_cast<size_t>(h >> 29);
+}
+
+
+const uint64_t PodOverlay::BELOW_UNKNOWN;
+const uint64_t PodOverlay::BELOW_NONE;
+
+
+// *****************************************************************************
+PodOverlay::PodOverlay(const std::vector<PodDocumentHandle>& layers)
+        : m_layers(layers.size())
+{
+    for (size_t i = 0; i < layers.size(); ++i)
+    {
+        if (layers[i].isNull())
+        {
+            throw std::invalid_argument("PodOverlay layer is a null document");
+        }
+        Layer& layer = m_layers[i];
+        layer.document = layers[i];
+        layer.snapshot = &layer.document->snapshot();
+        layer.below.assign(layer.snapshot->nodeCount(), BELOW_UNKNOWN);
+        buildChildren(layer);
+    }
+}
+
+
+// *****************************************************************************
+//
+// The first child with each name in each block.  Blocks store their nodes
+// in order, so visiting nodes in the order they're stored and keeping the
+// first of each pair finds the first child.
+//
+void PodOverlay::buildChildren(Layer& layer)
+{
+    const PodSnapshot& snapshot = *layer.snapshot;
+    const uint32_t root = snapshot.root().index();
+
+    size_t size = 16;
+    while (size < 2 * snapshot.nodeCount()) size *= 2;
+    const Slot empty = { NO_NODE, 0, NO_NODE };
+    layer.children.assign(size, empty);
+
+    const size_t mask = size - 1;
+    for (uint32_t i = 0; i < snapshot.nodeCount(); ++i)
+    {
+        if (i == root) continue;
+        const PodSnapshotNode& record = snapshot.node(i);
+        size_t s = childHash(record.parent, record.podName) & mask;
+        while (layer.children[s].block != NO_NODE
+               && (layer.children[s].block != record.parent
+                   || layer.children[s].name != record.podName))
+        {
+            s = (s + 1) & mask;
+        }
+        if (layer.children[s].block == NO_NODE)
+        {
+            const Slot slot = { record.parent, record.podName, i };
+            layer.children[s] = slot;
+        }
+    }
+}
+
+
+// *****************************************************************************
+PodOverlayNode PodOverlay::root() const
+{
+    if (m_layers.empty())
+    {
+        return PodOverlayNode();
+    }
+    const uint32_t top = static_cast<uint32_t>(m_layers.size() - 1);
+    return PodOverlayNode(this, top, m_layers[top].snapshot->root().index());
+}
+
+
+// *****************************************************************************
+PodDocument* PodOverlay::flatten(const std::string& filename) const
+{
+    if (m_layers.empty())
+    {
+        throw std::logic_error("Can't flatten a PodOverlay with no layers");
+    }
+    PodNode* rootNode = root().thaw();
+    PodSnapshot* snapshot = NULL;
+    try
+    {
+        snapshot = freeze(*rootNode);
+    }
+    catch (...)
+    {
+        delete rootNode;
+        throw;
+    }
+    delete rootNode;
+    return PodDocument::create(snapshot, filename);
+}
+
+
+// *****************************************************************************
+size_t PodOverlay::memoryUsage() const
+{
+    size_t usage = sizeof(*this) + m_layers.capacity() * sizeof(Layer);
+    for (size_t i = 0; i < m_layers.size(); ++i)
+    {
+        usage += m_layers[i].children.capacity() * sizeof(Slot)
+                 + m_layers[i].below.capacity() * sizeof(uint64_t);
+    }
+    return usage;
+}
+
+
+// *****************************************************************************
+uint32_t PodOverlay::child(uint32_t layer, uint32_t block, const char* name, size_t length) const
+{
+    const uint32_t string = m_layers[layer].snapshot->findString(name, length);
+    return string == PodSnapshot::NO_STRING ? NO_NODE : child(layer, block, string);
+}
+
+
+// *****************************************************************************
+uint32_t PodOverlay::child(uint32_t layer, uint32_t block, uint32_t name) const
+{
+    const std::vector<Slot>& children = m_layers[layer].children;
+    const size_t mask = children.size() - 1;
+    for (size_t s = childHash(block, name) & mask; children[s].block != NO_NODE; s = (s + 1) & mask)
+    {
+        if (children[s].block == block && children[s].name == name)
+        {
+            return children[s].child;
+        }
+    }
+    return NO_NODE;
+}
+
+
+// *****************************************************************************
+//
+// First child with the name in a merged block, searching its layers from
+// the top down
+//
+PodOverlayNode PodOverlay::childByName(PodOverlayNode block, const char* name, size_t length) const
+{
+    for (; !block.isNull() && block.isBlock(); block = block.below())
+    {
+        const uint32_t found = child(block.layer(), block.m_index, name, length);
+        if (found != NO_NODE)
+        {
+            return PodOverlayNode(this, block.layer(), found);
+        }
+    }
+    return PodOverlayNode();
+}
+
+
+// *****************************************************************************
+//
+// Whether a child of one of a merged block's layers has the name of a
+// child in a layer above it, going from the top down to that layer
+//
+bool PodOverlay::hidden(PodOverlayNode top, const PodOverlayNode& block, uint32_t position) const
+{
+    const PodSnapshot& snapshot = *m_layers[block.m_layer].snapshot;
+    const PodSnapshotNode& record = snapshot.node(snapshot.node(block.m_index).value + position);
+    const char* name = snapshot.string(record.podName);
+    const size_t length = snapshot.stringLength(record.podName);
+    for (; top != block; top = top.below())
+    {
+        if (child(top.m_layer, top.m_index, name, length) != NO_NODE)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// *****************************************************************************
+//
+// The node at the same path as the given one, in the highest layer below
+// it that has one.  The root's is the root of the next layer down;
+// anything else's is its name looked up in its parent's merged block,
+// starting below its own layer.  Remembered once found, which any number
+// of threads may race to do, since they all find the same answer.
+//
+PodOverlayNode PodOverlay::below(uint32_t layer, uint32_t index) const
+{
+    uint64_t& known = const_cast<uint64_t&>(m_layers[layer].below[index]);
+    const uint64_t value = known;
+    if (value == BELOW_NONE)
+    {
+        return PodOverlayNode();
+    }
+    if (value != BELOW_UNKNOWN)
+    {
+        return PodOverlayNode(this, static_cast<uint32_t>(value >> 32),
+                              static_cast<uint32_t>(value));
+    }
+
+    PodOverlayNode found;
+    const PodSnapshot& snapshot = *m_layers[layer].snapshot;
+    const PodSnapshotNode& record = snapshot.node(index);
+    if (record.parent == PodSnapshot::NO_NODE)
+    {
+        if (layer > 0)
+        {
+            found = PodOverlayNode(this, layer - 1, m_layers[layer - 1].snapshot->root().index());
+        }
+    }
+    else
+    {
+        found = childByName(below(layer, record.parent), snapshot.string(record.podName),
+                            snapshot.stringLength(record.podName));
+    }
+
+    __sync_bool_compare_and_swap(&known, BELOW_UNKNOWN,
+                                 found.isNull() ? BELOW_NONE
+                                 : static_cast<uint64_t>(found.layer()) << 32 | found.m_index);
+    return found;
+}
+
+
+// *****************************************************************************
+PodNodeView PodOverlayNode::view() const
+{
+    return PodNodeView(m_overlay->m_layers[m_layer].snapshot, m_index);
+}
+
+
+// *****************************************************************************
+PodOverlayNode PodOverlayNode::below() const
+{
+    return m_overlay->below(m_layer, m_index);
+}
+
+
+// *****************************************************************************
+PodOverlayBlock PodOverlayNode::asBlock() const
+{
+    if (!isBlock())
+    {
+        throw ValueTypeError(__FUNCTION__, valueType());
+    }
+    return PodOverlayBlock(*this);
+}
+
+
+// *****************************************************************************
+PodOverlayNode PodOverlayNode::childByName(const std::string& name) const
+{
+    return m_overlay->childByName(*this, name.data(), name.size());
+}
+
+
+// *****************************************************************************
+//
+// Paths of names alone, the usual kind, are split in place, without
+// allocating: each step is a name up to the next period, or else a name
+// with periods in it, since the grammar allows those ("a.b.c" is a/b/c, or
+// "a.b"/c, and so on, trying the shortest names first).  Paths with
+// indexes or scoped names that aren't found that way go through PodPath.
+//
+PodOverlayNode PodOverlayNode::find(const std::string& path) const
+{
+    PodOverlayNode node = *this;
+    const char* start = path.data();
+    const char* const end = start + path.size();
+    while (start != end && !node.isNull())
+    {
+        PodOverlayNode next;
+        const char* stop = start;
+        while (next.isNull() && stop != end)
+        {
+            stop = static_cast<const char*>(memchr(stop + 1, '.', end - stop - 1));
+            if (!stop) stop = end;
+            next = m_overlay->childByName(node, start, stop - start);
+        }
+        node = next;
+        start = stop == end ? end : stop + 1;
+    }
+    if (node.isNull() && path.find_first_of("[:") != std::string::npos)
+    {
+        return PodPath(path).find(*this);
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+PodNode* PodOverlayNode::thaw() const
+{
+    if (!isBlock())
+    {
+        return view().thaw();
+    }
+
+    BlockPodValue* blockValue = new BlockPodValue;
+    try
+    {
+        blockValue->setScopeType(view().blockScopeType());
+        PodNodeDeque& nodes = blockValue->value();
+        const PodOverlayBlock block = asBlock();
+        for (PodOverlayBlock::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+        {
+            nodes.push_back((*iter).thaw());
+        }
+    }
+    catch (...)
+    {
+        delete blockValue;
+        throw;
+    }
+    return new PodNode(podName(), podType(), blockValue);
+}
+
+
+// *****************************************************************************
+PodOverlayBlock::const_iterator::const_iterator(const PodOverlayNode& block)
+        : m_overlay(block.overlay()),
+          m_top(block),
+          m_block(block),
+          m_position(0)
+{
+    skipHidden();
+}
+
+
+// *****************************************************************************
+PodOverlayNode PodOverlayBlock::const_iterator::operator*() const
+{
+    return PodOverlayNode(m_overlay, m_block.layer(),
+                          m_block.view().asBlock()[m_position].index());
+}
+
+
+// *****************************************************************************
+PodOverlayBlock::const_iterator& PodOverlayBlock::const_iterator::operator++()
+{
+    ++m_position;
+    skipHidden();
+    return *this;
+}
+
+
+// *****************************************************************************
+//
+// Move on to the next child that isn't hidden by a block above, through
+// the blocks of lower layers, and to the end after the last
+//
+void PodOverlayBlock::const_iterator::skipHidden()
+{
+    while (!m_block.isNull())
+    {
+        const PodBlockView block = m_block.view().asBlock();
+        if (m_position >= block.size())
+        {
+            m_block = m_block.below();
+            m_position = 0;
+            if (!m_block.isNull() && !m_block.isBlock())
+            {
+                m_block = PodOverlayNode();
+            }
+            continue;
+        }
+        if (m_block == m_top || !m_overlay->hidden(m_top, m_block, m_position))
+        {
+            return;
+        }
+        ++m_position;
+    }
+    m_position = 0;
+}
+
+
+}  //  End namespace TipPod
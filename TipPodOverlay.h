@@ -0,0 +1,222 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODOVERLAY_H__
+#define __TIPPODOVERLAY_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "TipPodDocument.h"
+
+namespace TipPod {
+
+class PodOverlay;
+class PodOverlayBlock;
+
+
+// *****************************************************************************
+//
+// Read-only view of a node in a PodOverlay: the node with its path in the
+// highest layer that has one, with the blocks of the same path in the
+// layers below merged into it.  Small, and passed by value like
+// PodNodeView.
+//
+// A default-constructed view, or one returned by a failed lookup, refers
+// to no node, and isNull() returns true.  Other methods must not be called
+// on it.
+//
+class PodOverlayNode
+{
+public:
+    PodOverlayNode() : m_overlay(NULL), m_layer(0), m_index(0) {}
+    PodOverlayNode(const PodOverlay* overlay, uint32_t layer, uint32_t index)
+        : m_overlay(overlay), m_layer(layer), m_index(index) {}
+
+    bool isNull() const { return m_overlay == NULL; }
+    const PodOverlay* overlay() const { return m_overlay; }
+
+    // Where the node comes from
+    uint32_t layer() const { return m_layer; }
+    PodNodeView view() const;
+
+    // The node with the same path in a lower layer, which this one
+    // overrides.  Null if there's none.
+    PodOverlayNode below() const;
+
+    // Everything but blocks is read from view()
+    const char* podName() const { return view().podName(); }
+    const char* podType() const { return view().podType(); }
+    PodNode::ValueType valueType() const { return view().valueType(); }
+    bool isBlock() const { return view().isBlock(); }
+    bool isIdentifier() const { return view().isIdentifier(); }
+
+    PodOverlayBlock asBlock() const;  // Throws if not a block
+    PodOverlayNode childByName(const std::string& name) const;  // Null if not found, or not a block
+    PodOverlayNode find(const std::string& path) const;  // See PodPath, null if not found
+
+    // New, mutable copy of the merged node, owned by the caller
+    PodNode* thaw() const;
+
+    bool operator==(const PodOverlayNode& other) const
+        {
+            return m_overlay == other.m_overlay && m_layer == other.m_layer
+                   && m_index == other.m_index;
+        }
+    bool operator!=(const PodOverlayNode& other) const { return !(*this == other); }
+
+private:
+    friend class PodOverlay;
+
+    const PodOverlay* m_overlay;
+    uint32_t          m_layer;
+    uint32_t          m_index;  // Of the node in its layer's snapshot
+};
+
+
+// *****************************************************************************
+//
+// The children of a merged block: those of the highest layer's block in
+// order, then those of each block below it whose names aren't in any
+// block above.
+//
+class PodOverlayBlock
+{
+public:
+    class const_iterator
+    {
+    public:
+        const_iterator() : m_overlay(NULL), m_top(), m_block(), m_position(0) {}
+
+        PodOverlayNode operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int) { const_iterator old(*this); ++*this; return old; }
+
+        bool operator==(const const_iterator& other) const
+            {
+                return m_block == other.m_block && m_position == other.m_position;
+            }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class PodOverlayBlock;
+        explicit const_iterator(const PodOverlayNode& block);
+        void skipHidden();
+
+        const PodOverlay* m_overlay;
+        PodOverlayNode    m_top;       // The merged block
+        PodOverlayNode    m_block;     // The layer's block being walked, null at the end
+        uint32_t          m_position;  // In m_block
+    };
+
+    explicit PodOverlayBlock(const PodOverlayNode& block) : m_block(block) {}
+
+    const_iterator begin() const { return const_iterator(m_block); }
+    const_iterator end() const { return const_iterator(); }
+
+private:
+    PodOverlayNode m_block;
+};
+
+
+// *****************************************************************************
+//
+// A stack of PodDocuments read as one, where each layer overrides those
+// below it, the way show, sequence and shot pods are layered:
+//
+//     std::vector<PodDocumentHandle> layers;
+//     layers.push_back(cache.get("fxAshFall.pod"));
+//     layers.push_back(cache.get("fxAshFall_bgAsh0.pod"));
+//     PodOverlay overlay(layers);
+//     PodOverlayNode fps = overlay.root().find("render.fps");
+//
+// RULES:
+//
+// * Layers are given bottom first, and the last one wins.
+// * Nodes are matched across layers by path, a name at a time.  The
+//   highest layer with a node at a path supplies its type and value.
+// * Blocks merge: a block's children are looked up in it, then in the
+//   block at the same path in each layer below, down to the first layer
+//   where that path isn't a block.  A node that isn't a block hides
+//   everything below it.
+// * Where a block has several children with one name, each is listed, but
+//   lookups see only the first, like childByName().
+//
+// NOTES:
+//
+// * Nothing is copied or merged up front.  Lookups walk down the layers
+//   as they go, using a hash table of (block, name) to child for each
+//   layer, built when the overlay is.  Where each node's counterpart in
+//   the layers below is remembered the first time it's needed.
+// * find() takes any PodPath.  Paths of names alone are split in place,
+//   so those lookups don't allocate; others are parsed each time, so keep
+//   a PodPath for them if they're repeated.
+// * flatten() makes an ordinary document of the merged pod, for callers
+//   that read it many times or want to save it.
+// * The overlay holds a reference to each layer.  It may be read from any
+//   number of threads.
+//
+class PodOverlay
+{
+public:
+    explicit PodOverlay(const std::vector<PodDocumentHandle>& layers);
+
+    size_t layerCount() const { return m_layers.size(); }
+    const PodDocument& layer(size_t i) const { return *m_layers[i].document; }
+
+    PodOverlayNode root() const;  // Null if there are no layers
+
+    // New document of the merged pod.  It has one reference, which the
+    // caller owns.
+    PodDocument* flatten(const std::string& filename="") const;
+
+    size_t memoryUsage() const;
+
+private:
+    friend class PodOverlayNode;
+    friend class PodOverlayBlock::const_iterator;
+
+    enum { NO_NODE = 0xffffffff };
+
+    // A (block, name) to first child hash table slot, for one layer
+    struct Slot
+    {
+        uint32_t block;  // NO_NODE if the slot is empty
+        uint32_t name;
+        uint32_t child;
+    };
+
+    struct Layer
+    {
+        PodDocumentHandle     document;
+        const PodSnapshot*    snapshot;
+        std::vector<Slot>     children;  // Size is a power of two
+        std::vector<uint64_t> below;     // Of each node, see BELOW_UNKNOWN
+    };
+
+    // below is (layer << 32 | index), or these
+    static const uint64_t BELOW_UNKNOWN = 0xffffffffffffffffULL;
+    static const uint64_t BELOW_NONE    = 0xfffffffffffffffeULL;
+
+    uint32_t child(uint32_t layer, uint32_t block, const char* name, size_t length) const;
+    uint32_t child(uint32_t layer, uint32_t block, uint32_t name) const;
+    PodOverlayNode below(uint32_t layer, uint32_t index) const;
+    PodOverlayNode childByName(PodOverlayNode block, const char* name, size_t length) const;
+    bool hidden(PodOverlayNode top, const PodOverlayNode& block, uint32_t position) const;
+    static void buildChildren(Layer& layer);
+
+    PodOverlay(const PodOverlay&);             // Not implemented
+    PodOverlay& operator=(const PodOverlay&);  // Not implemented
+
+private:
+    std::vector<Layer> m_layers;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODOVERLAY_H__
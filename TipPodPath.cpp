@@ -0,0 +1,393 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "TipPodExc.h"
+#include "TipPodOverlay.h"
+#include "TipPodPath.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+static bool isIdentifierStart(char c)
+{
+    return isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+
+// *****************************************************************************
+static bool isIdentifierChar(char c)
+{
+    return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+
+// *****************************************************************************
+PodPath::PodPath(const std::string& path)
+        : m_path(path),
+          m_steps()
+{
+    parse();
+}
+
+
+// *****************************************************************************
+void PodPath::parse()
+{
+    const std::string& path = m_path;
+    m_steps.reserve(std::count(path.begin(), path.end(), '.') + 1);
+    size_t i = 0;
+    while (i < path.size())
+    {
+        m_steps.push_back(Step());
+        Step& step = m_steps.back();
+
+        // Name, which may be scoped: Type::name
+        while (i < path.size() && isIdentifierStart(path[i]))
+        {
+            const size_t start = i;
+            while (i < path.size() && isIdentifierChar(path[i])) ++i;
+            step.name.append(path, start, i - start);
+            if (path.compare(i, 2, "::") == 0 && i + 2 < path.size() && isIdentifierStart(path[i + 2]))
+            {
+                step.name += "::";
+                i += 2;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        // Indexes: [3][-1]
+        while (i < path.size() && path[i] == '[')
+        {
+            const size_t start = ++i;
+            if (i < path.size() && path[i] == '-') ++i;
+            while (i < path.size() && isdigit(static_cast<unsigned char>(path[i]))) ++i;
+            if (i == start || path[i - 1] == '-' || i == path.size() || path[i] != ']')
+            {
+                throw PodPathError(path, start, "expected [integer]");
+            }
+            step.indexes.push_back(atoi(path.c_str() + start));
+            ++i;
+        }
+
+        if (step.name.empty() && step.indexes.empty())
+        {
+            throw PodPathError(path, i, "expected a name or [index]");
+        }
+
+        if (i < path.size())
+        {
+            if (path[i] != '.')
+            {
+                throw PodPathError(path, i, "expected '.'");
+            }
+            if (++i == path.size())
+            {
+                throw PodPathError(path, i, "expected a name or [index]");
+            }
+        }
+    }
+
+    for (size_t s = 0; s < m_steps.size(); ++s)
+    {
+        // The grammar allows names of the form identifier.identifier
+        Step& step = m_steps[s];
+        step.scope = step.name.rfind("::");
+        step.dotted = s + 1 < m_steps.size() && step.indexes.empty()
+                      && !step.name.empty() && step.scope == std::string::npos
+                      && !m_steps[s + 1].name.empty()
+                      && m_steps[s + 1].name.find("::") == std::string::npos;
+    }
+}
+
+
+// *****************************************************************************
+static bool isDottedName(const std::string& podName, const std::string& first,
+                         const std::string& second)
+{
+    return podName.size() == first.size() + 1 + second.size()
+           && podName.compare(0, first.size(), first) == 0
+           && podName[first.size()] == '.'
+           && podName.compare(first.size() + 1, second.size(), second) == 0;
+}
+
+
+// *****************************************************************************
+PodNode* PodPath::find(PodNode& root) const
+{
+    return const_cast<PodNode*>(find(static_cast<const PodNode&>(root)));
+}
+
+
+// *****************************************************************************
+const PodNode* PodPath::find(const PodNode& root) const
+{
+    const PodNode* node = &root;
+    for (size_t s = 0; s < m_steps.size() && node; ++s)
+    {
+        const Step* step = &m_steps[s];
+        if (!step->name.empty())
+        {
+            bool usedNext = false;
+            node = child(*node, s, usedNext);
+            if (usedNext)
+            {
+                step = &m_steps[++s];
+            }
+        }
+        for (size_t i = 0; i < step->indexes.size() && node; ++i)
+        {
+            if (!node->isBlock())
+            {
+                return NULL;
+            }
+            const PodNodeDeque& block = node->asBlock();
+            const int index = step->indexes[i] < 0 ? step->indexes[i] + int(block.size())
+                                                   : step->indexes[i];
+            node = index >= 0 && index < int(block.size()) ? block[index] : NULL;
+        }
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+PodNodeView PodPath::find(const PodNodeView& root) const
+{
+    PodNodeView node = root;
+    for (size_t s = 0; s < m_steps.size() && !node.isNull(); ++s)
+    {
+        const Step* step = &m_steps[s];
+        if (!step->name.empty())
+        {
+            bool usedNext = false;
+            node = child(node, s, usedNext);
+            if (usedNext)
+            {
+                step = &m_steps[++s];
+            }
+        }
+        for (size_t i = 0; i < step->indexes.size() && !node.isNull(); ++i)
+        {
+            if (!node.isBlock())
+            {
+                return PodNodeView();
+            }
+            const PodBlockView block = node.asBlock();
+            const int index = step->indexes[i] < 0 ? step->indexes[i] + int(block.size())
+                                                   : step->indexes[i];
+            node = index >= 0 && index < int(block.size()) ? block[index] : PodNodeView();
+        }
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+PodOverlayNode PodPath::find(const PodOverlayNode& root) const
+{
+    PodOverlayNode node = root;
+    for (size_t s = 0; s < m_steps.size() && !node.isNull(); ++s)
+    {
+        const Step* step = &m_steps[s];
+        if (!step->name.empty())
+        {
+            bool usedNext = false;
+            node = child(node, s, usedNext);
+            if (usedNext)
+            {
+                step = &m_steps[++s];
+            }
+        }
+        for (size_t i = 0; i < step->indexes.size() && !node.isNull(); ++i)
+        {
+            if (!node.isBlock())
+            {
+                return PodOverlayNode();
+            }
+
+            // Merged blocks can only be walked, so count them for negative indexes
+            const PodOverlayBlock block = node.asBlock();
+            PodOverlayBlock::const_iterator iter;
+            int index = step->indexes[i];
+            if (index < 0)
+            {
+                for (iter = block.begin(); iter != block.end(); ++iter) ++index;
+            }
+            node = PodOverlayNode();
+            for (iter = block.begin(); iter != block.end() && index >= 0; ++iter, --index)
+            {
+                if (index == 0) node = *iter;
+            }
+        }
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+//
+// The child step s names.  A scoped or dotted name that isn't some child's
+// name is looked for with its other meaning; usedNext is set if it's found
+// by its dotted name, which includes the next step's.
+//
+const PodNode* PodPath::child(const PodNode& node, size_t s, bool& usedNext) const
+{
+    if (!node.isBlock())
+    {
+        return NULL;
+    }
+
+    const Step& step = m_steps[s];
+    const PodNodeDeque& block = node.asBlock();
+    PodNodeDeque::const_iterator iter;
+    for (iter = block.begin(); iter != block.end(); ++iter)
+    {
+        if ((*iter)->podName() == step.name)
+        {
+            return *iter;
+        }
+    }
+
+    if (step.scope != std::string::npos)
+    {
+        for (iter = block.begin(); iter != block.end(); ++iter)
+        {
+            if ((*iter)->podName().compare(0, std::string::npos, step.name, step.scope + 2, std::string::npos) == 0
+                && (*iter)->podType().compare(0, std::string::npos, step.name, 0, step.scope) == 0)
+            {
+                return *iter;
+            }
+        }
+    }
+    else if (step.dotted)
+    {
+        for (iter = block.begin(); iter != block.end(); ++iter)
+        {
+            if (isDottedName((*iter)->podName(), step.name, m_steps[s + 1].name))
+            {
+                usedNext = true;
+                return *iter;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+// *****************************************************************************
+PodNodeView PodPath::child(const PodNodeView& node, size_t s, bool& usedNext) const
+{
+    if (!node.isBlock())
+    {
+        return PodNodeView();
+    }
+
+    // Names that aren't in the snapshot can't match any node
+    const Step& step = m_steps[s];
+    const PodSnapshot* snapshot = node.snapshot();
+    const PodBlockView block = node.asBlock();
+    PodBlockView::const_iterator iter;
+
+    const uint32_t name = snapshot->findString(step.name);
+    if (name != PodSnapshot::NO_STRING)
+    {
+        for (iter = block.begin(); iter != block.end(); ++iter)
+        {
+            if (snapshot->node((*iter).index()).podName == name)
+            {
+                return *iter;
+            }
+        }
+    }
+
+    if (step.scope != std::string::npos)
+    {
+        const uint32_t typedName = snapshot->findString(step.name.data() + step.scope + 2,
+                                                        step.name.size() - step.scope - 2);
+        const uint32_t podType = snapshot->findString(step.name.data(), step.scope);
+        if (typedName == PodSnapshot::NO_STRING || podType == PodSnapshot::NO_STRING)
+        {
+            return PodNodeView();
+        }
+        for (iter = block.begin(); iter != block.end(); ++iter)
+        {
+            const PodSnapshotNode& record = snapshot->node((*iter).index());
+            if (record.podName == typedName && record.podType == podType)
+            {
+                return *iter;
+            }
+        }
+    }
+    else if (step.dotted)
+    {
+        const uint32_t dottedName = snapshot->findString(step.name + "." + m_steps[s + 1].name);
+        if (dottedName == PodSnapshot::NO_STRING)
+        {
+            return PodNodeView();
+        }
+        for (iter = block.begin(); iter != block.end(); ++iter)
+        {
+            if (snapshot->node((*iter).index()).podName == dottedName)
+            {
+                usedNext = true;
+                return *iter;
+            }
+        }
+    }
+    return PodNodeView();
+}
+
+
+// *****************************************************************************
+PodOverlayNode PodPath::child(const PodOverlayNode& node, size_t s, bool& usedNext) const
+{
+    if (!node.isBlock())
+    {
+        return PodOverlayNode();
+    }
+
+    const Step& step = m_steps[s];
+    PodOverlayNode found = node.childByName(step.name);
+    if (!found.isNull())
+    {
+        return found;
+    }
+
+    if (step.scope != std::string::npos)
+    {
+        const char* typedName = step.name.c_str() + step.scope + 2;
+        const PodOverlayBlock block = node.asBlock();
+        for (PodOverlayBlock::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+        {
+            const PodOverlayNode child = *iter;
+            if (strcmp(child.podName(), typedName) == 0
+                && step.name.compare(0, step.scope, child.podType()) == 0)
+            {
+                return child;
+            }
+        }
+    }
+    else if (step.dotted)
+    {
+        found = node.childByName(step.name + "." + m_steps[s + 1].name);
+        if (!found.isNull())
+        {
+            usedNext = true;
+        }
+    }
+    return found;
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,87 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODPATH_H__
+#define __TIPPODPATH_H__
+
+#include <string>
+#include <vector>
+
+#include "TipPodNode.h"
+#include "TipPodSnapshot.h"
+
+namespace TipPod {
+
+class PodOverlayNode;
+
+
+// *****************************************************************************
+//
+// A path to a node below another, such as "render.shadows.resolution",
+// parsed once and then looked up in any number of pods.
+//
+// SYNTAX:
+//
+//     render.shadows       Child "render", then its child "shadows"
+//     lights[2]            Child "lights", then its third child
+//     [0]  [-1]            First, last child (indexes may be negative)
+//     Cam::main            Child named "Cam::main", the way the grammar
+//                          names scoped nodes, or else the child of type
+//                          "Cam" named "main"
+//     a.b                  Child "a", then its child "b", or else the child
+//                          named "a.b" (as the grammar allows)
+//     (empty)              The node the path is looked up from
+//
+// NOTES:
+//
+// * Names are matched against the first child with that name, the same as
+//   childByName().
+// * find() returns NULL (or a null view) if any step of the path is
+//   missing, including when a step isn't a block.  A malformed path throws
+//   PodPathError when it's constructed.
+// * PodPaths are immutable once constructed, so one may be shared by any
+//   number of threads.
+// * In a PodOverlay, names are looked up in merged blocks, and indexes
+//   count the merged block's children.
+// * PodNode::find(), PodNodeView::find() and PodOverlayNode::find() parse
+//   the path each time they are called.  Lookups that are repeated should
+//   keep a PodPath instead.
+//
+class PodPath
+{
+public:
+    explicit PodPath(const std::string& path);  // Throws PodPathError
+
+    const std::string& str() const { return m_path; }
+
+    PodNode* find(PodNode& root) const;
+    const PodNode* find(const PodNode& root) const;
+    PodNodeView find(const PodNodeView& root) const;
+    PodOverlayNode find(const PodOverlayNode& root) const;
+
+private:
+    struct Step
+    {
+        std::string      name;       // Empty for a step that's only indexes
+        size_t           scope;      // Of the last "::" in name, npos if none
+        bool             dotted;     // name + "." + the next step's name may be a node's name
+        std::vector<int> indexes;
+    };
+
+    void parse();
+    const PodNode* child(const PodNode& node, size_t s, bool& usedNext) const;
+    PodNodeView child(const PodNodeView& node, size_t s, bool& usedNext) const;
+    PodOverlayNode child(const PodOverlayNode& node, size_t s, bool& usedNext) const;
+
+private:
+    std::string       m_path;
+    std::vector<Step> m_steps;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODPATH_H__
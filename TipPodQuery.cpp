@@ -0,0 +1,269 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "TipPodNode.h"
+#include "TipPodQuery.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+const char* const PodQueryClient::DEFAULT_SOCKET = "/tmp/podqueryd.sock";
+
+
+// *****************************************************************************
+std::string PodQueryResult::asString() const
+{
+    std::ostringstream result;
+    switch (valueType)
+    {
+        case PodNode::INT:
+            result << intValue;
+            break;
+        case PodNode::FLOAT:
+            {
+                char number[FLOAT_TEXT_SIZE];
+                result.write(number, formatFloat(floatValue, number));
+            }
+            break;
+        case PodNode::BOOL:
+            result << (boolValue ? "true" : "false");
+            break;
+        default:
+            result << text;
+            break;
+    }
+    return result.str();
+}
+
+
+// *****************************************************************************
+PodQueryClient::PodQueryClient(const std::string& socketPath)
+        : m_fd(-1),
+          m_nextId(1),
+          m_pending(),
+          m_frame()
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error(socketPath + ": Socket path too long");
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(socketPath + ": " + strerror(errno));
+    }
+    if (connect(m_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        const int err = errno;
+        close(m_fd);
+        throw std::runtime_error(socketPath + ": " + strerror(err));
+    }
+}
+
+
+// *****************************************************************************
+PodQueryClient::~PodQueryClient()
+{
+    close(m_fd);
+}
+
+
+// *****************************************************************************
+std::vector<PodQueryResult> PodQueryClient::query(const std::string& filename,
+                                                  const std::vector<std::string>& paths)
+{
+    std::vector<PodQueryResult> results;
+    send(filename, paths);
+    receive(results);
+    return results;
+}
+
+
+// *****************************************************************************
+PodQueryResult PodQueryClient::query(const std::string& filename, const std::string& path)
+{
+    return query(filename, std::vector<std::string>(1, path)).front();
+}
+
+
+// *****************************************************************************
+void PodQueryClient::send(const std::string& filename, const std::vector<std::string>& paths)
+{
+    // The server has its own working directory
+    std::string path = filename;
+    if (char* real = realpath(filename.c_str(), NULL))
+    {
+        path = real;
+        free(real);
+    }
+    else if (!filename.empty() && filename[0] != '/')
+    {
+        char cwd[4096];
+        if (getcwd(cwd, sizeof(cwd)))
+        {
+            path = std::string(cwd) + "/" + filename;
+        }
+    }
+
+    if (path.size() > 0xffff || paths.size() > 0xffff)
+    {
+        throw std::runtime_error(filename + ": Too long a pod query");
+    }
+
+    const uint32_t id = m_nextId++;
+    m_frame.assign(sizeof(uint32_t), '\0');
+    appendRaw<uint32_t>(m_frame, id);
+    appendRaw<uint16_t>(m_frame, path.size());
+    appendRaw<uint16_t>(m_frame, paths.size());
+    m_frame += path;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (paths[i].size() > 0xffff)
+        {
+            throw std::runtime_error(paths[i] + ": Too long a pod query path");
+        }
+        appendRaw<uint16_t>(m_frame, paths[i].size());
+        m_frame += paths[i];
+    }
+    writeFrame(m_fd, m_frame);
+    m_pending.push_back(id);
+}
+
+
+// *****************************************************************************
+void PodQueryClient::receive(std::vector<PodQueryResult>& results)
+{
+    if (m_pending.empty())
+    {
+        throw std::runtime_error("No pod query to receive a reply to");
+    }
+    if (!readFrame(m_fd, m_frame))
+    {
+        throw std::runtime_error("Pod query server closed the connection");
+    }
+    const uint32_t id = m_pending.front();
+    m_pending.pop_front();
+
+    PodQueryReader reader(m_frame);
+    reader.take<uint32_t>();  // Length
+    if (reader.take<uint32_t>() != id)
+    {
+        throw std::runtime_error("Reply from pod query server is out of order");
+    }
+    if (reader.take<uint8_t>() != QueryProtocol::QUERY_OK)
+    {
+        throw std::runtime_error(reader.rest());
+    }
+
+    results.resize(reader.take<uint16_t>());
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        PodQueryResult& result = results[i];
+        result = PodQueryResult();
+        result.valueType = reader.take<uint8_t>();
+        switch (result.valueType)
+        {
+            case 0:
+            case PodNode::UNDEFINED:
+                break;
+            case PodNode::INT:
+                result.intValue = reader.take<int32_t>();
+                break;
+            case PodNode::FLOAT:
+                result.floatValue = reader.take<float>();
+                break;
+            case PodNode::BOOL:
+                result.boolValue = reader.take<uint8_t>() != 0;
+                break;
+            default:
+                result.text = reader.takeText(reader.take<uint32_t>());
+                break;
+        }
+    }
+}
+
+
+// *****************************************************************************
+static bool readFully(int fd, char* data, size_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t n = read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0)
+        {
+            throw std::runtime_error(std::string("Pod query: ") + strerror(errno));
+        }
+        if (n == 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+
+// *****************************************************************************
+bool readFrame(int fd, std::string& frame)
+{
+    uint32_t length;
+    if (!readFully(fd, reinterpret_cast<char*>(&length), sizeof(length)))
+    {
+        return false;
+    }
+    if (length > QueryProtocol::MAX_FRAME_LENGTH)
+    {
+        throw std::runtime_error("Pod query too long");
+    }
+    frame.resize(sizeof(length) + length);
+    memcpy(&frame[0], &length, sizeof(length));
+    if (length > 0 && !readFully(fd, &frame[sizeof(length)], length))
+    {
+        throw std::runtime_error("Pod query cut short");
+    }
+    return true;
+}
+
+
+// *****************************************************************************
+void writeFrame(int fd, std::string& frame)
+{
+    const uint32_t length = frame.size() - sizeof(length);
+    memcpy(&frame[0], &length, sizeof(length));
+
+    const char* data = frame.data();
+    size_t size = frame.size();
+    while (size > 0)
+    {
+        const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0)
+        {
+            throw std::runtime_error(std::string("Pod query: ") + strerror(errno));
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,195 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODQUERY_H__
+#define __TIPPODQUERY_H__
+
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "TipPodSnapshot.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// The protocol spoken between PodQueryClient and PodQueryServer over a Unix
+// domain socket.  Both ends are on the same host, so numbers are in the
+// host's byte order.
+//
+// A request asks for any number of paths (see PodPath, e.g.
+// "render.shadows") in one pod file:
+//
+//     uint32  length            Of everything after this field
+//     uint32  id                Chosen by the client, returned in the reply
+//     uint16  filenameLength
+//     uint16  pathCount
+//     char    filename[filenameLength]    Absolute
+//     pathCount times:
+//         uint16  pathLength
+//         char    path[pathLength]
+//
+// Replies come back in the order the requests were sent, so a client may
+// send several requests before reading any replies:
+//
+//     uint32  length            Of everything after this field
+//     uint32  id
+//     uint8   status            QUERY_OK or QUERY_ERROR
+//     QUERY_OK:
+//         uint16  resultCount   The same as the request's pathCount
+//         resultCount times:
+//             uint8   valueType     A PodNode::ValueType, 0 if the path wasn't found
+//             INT:    int32
+//             FLOAT:  float32
+//             BOOL:   uint8
+//             STRING, IDENTIFIER, EMBED, BLOCK (written as pod text):
+//                 uint32  textLength
+//                 char    text[textLength]
+//     QUERY_ERROR:
+//         char    message[]     The rest of the reply, e.g. a parse error
+//
+namespace QueryProtocol {
+    enum Status { QUERY_OK = 0, QUERY_ERROR = 1 };
+    enum Limits { MAX_FRAME_LENGTH = 64 * 1024 * 1024 };
+}
+
+
+// *****************************************************************************
+//
+// The value at one path, as returned by PodQueryClient
+//
+struct PodQueryResult
+{
+    PodQueryResult() : valueType(0), intValue(0), floatValue(0.0f), boolValue(false) {}
+
+    bool found() const { return valueType != 0; }
+    std::string asString() const;  // Any type, like PodNode::asString()
+
+    int         valueType;   // A PodNode::ValueType, or 0 if the path wasn't found
+    int         intValue;
+    float       floatValue;
+    bool        boolValue;
+    std::string text;        // Of STRING, IDENTIFIER and EMBED values, and BLOCKs as pod text
+};
+
+
+// *****************************************************************************
+//
+// Looks up values in pods through a PodQueryServer, which keeps them parsed,
+// rather than parsing them itself.
+//
+// NOTES:
+//
+// * query() sends one request and waits for its reply.  Ask for all the
+//   paths needed from a file at once, as each request is a round trip.
+// * To have several requests in flight, call send() for each and then
+//   receive() for each, in the same order.  Keep the number outstanding
+//   modest (tens, not thousands): the server answers as it reads, and if
+//   nobody is reading its replies both ends can stall.
+// * Errors, including those the server reports, such as a pod failing to
+//   parse, are thrown as std::runtime_error.
+// * Not thread safe; give each thread its own client.
+//
+class PodQueryClient
+{
+public:
+    static const char* const DEFAULT_SOCKET;
+
+    // Connects to the server.  Throws if it can't.
+    explicit PodQueryClient(const std::string& socketPath=DEFAULT_SOCKET);
+    ~PodQueryClient();
+
+    std::vector<PodQueryResult> query(const std::string& filename,
+                                      const std::vector<std::string>& paths);
+    PodQueryResult query(const std::string& filename, const std::string& path);
+
+    // Pipelining
+    void send(const std::string& filename, const std::vector<std::string>& paths);
+    void receive(std::vector<PodQueryResult>& results);  // Reply to the oldest request sent
+    size_t pending() const { return m_pending.size(); }
+
+private:
+    // Not copyable
+    PodQueryClient(const PodQueryClient&);
+    PodQueryClient& operator=(const PodQueryClient&);
+
+private:
+    int                  m_fd;
+    uint32_t             m_nextId;
+    std::deque<uint32_t> m_pending;  // Ids of requests sent but not yet received
+    std::string          m_frame;    // Reused for each request and reply
+};
+
+
+//
+// Used by the client and server
+//
+
+// Frames include their uint32 length.  writeFrame() fills it in, so frames
+// are built by appending to four bytes of anything.  readFrame() returns
+// false at end of file; both throw on errors.
+bool readFrame(int fd, std::string& frame);
+void writeFrame(int fd, std::string& frame);
+
+template <typename T>
+inline void appendRaw(std::string& frame, T value)
+{
+    frame.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+// *****************************************************************************
+//
+// Takes values, in order, from a frame.  Throws if the frame is too short.
+//
+class PodQueryReader
+{
+public:
+    explicit PodQueryReader(const std::string& frame)
+        : m_next(frame.data()), m_end(frame.data() + frame.size()) {}
+
+    template <typename T>
+    T take()
+    {
+        T value;
+        memcpy(&value, need(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    std::string takeText(size_t length)
+    {
+        const char* text = need(length);
+        return std::string(text, length);
+    }
+
+    std::string rest() { return takeText(m_end - m_next); }
+
+private:
+    const char* need(size_t length)
+    {
+        if (size_t(m_end - m_next) < length)
+        {
+            throw std::runtime_error("Malformed pod query");
+        }
+        const char* result = m_next;
+        m_next += length;
+        return result;
+    }
+
+private:
+    const char* m_next;
+    const char* m_end;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODQUERY_H__
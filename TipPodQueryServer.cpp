@@ -0,0 +1,305 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "TipPodPath.h"
+#include "TipPodQuery.h"
+#include "TipPodQueryServer.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+struct PodQueryConnection
+{
+    PodQueryServer* server;
+    int             fd;
+};
+
+
+// *****************************************************************************
+static void appendValue(std::string& reply, const PodNodeView& node)
+{
+    if (node.isNull())
+    {
+        appendRaw<uint8_t>(reply, 0);
+        return;
+    }
+
+    appendRaw<uint8_t>(reply, node.valueType());
+    switch (node.valueType())
+    {
+        case PodNode::UNDEFINED:
+            break;
+        case PodNode::INT:
+            appendRaw<int32_t>(reply, node.asInt());
+            break;
+        case PodNode::FLOAT:
+            appendRaw<float>(reply, node.asFloat());
+            break;
+        case PodNode::BOOL:
+            appendRaw<uint8_t>(reply, node.asBool());
+            break;
+        case PodNode::BLOCK:
+        {
+            std::ostringstream text;
+            node.write(text);
+            appendRaw<uint32_t>(reply, text.str().size());
+            reply += text.str();
+            break;
+        }
+        default:
+        {
+            const char* text = node.asCString();
+            appendRaw<uint32_t>(reply, strlen(text));
+            reply += text;
+            break;
+        }
+    }
+}
+
+
+// *****************************************************************************
+PodQueryServer::PodQueryServer(const std::string& socketPath, PodDocumentCache& cache)
+        : m_socketPath(socketPath),
+          m_cache(cache),
+          m_listenFd(-1),
+          m_connections(),
+          m_stats()
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error(socketPath + ": Socket path too long");
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    // Replace a socket nobody is listening on any more
+    struct stat st;
+    if (lstat(socketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool listening = fd >= 0
+            && connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0;
+        if (fd >= 0) close(fd);
+        if (listening)
+        {
+            throw std::runtime_error(socketPath + ": Another server is using this socket");
+        }
+        unlink(socketPath.c_str());
+    }
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0
+        || bind(m_listenFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0
+        || listen(m_listenFd, SOMAXCONN) != 0
+        || pipe2(m_stopPipe, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        const int err = errno;
+        if (m_listenFd >= 0) close(m_listenFd);
+        throw std::runtime_error(socketPath + ": " + strerror(err));
+    }
+
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_finished, NULL);
+}
+
+
+// *****************************************************************************
+PodQueryServer::~PodQueryServer()
+{
+    close(m_listenFd);
+    unlink(m_socketPath.c_str());
+
+    // Wake up every connection's thread, and wait for them to finish
+    pthread_mutex_lock(&m_mutex);
+    for (std::set<int>::const_iterator iter = m_connections.begin();
+            iter != m_connections.end(); ++iter)
+    {
+        shutdown(*iter, SHUT_RDWR);
+    }
+    while (!m_connections.empty())
+    {
+        pthread_cond_wait(&m_finished, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    close(m_stopPipe[0]);
+    close(m_stopPipe[1]);
+    pthread_cond_destroy(&m_finished);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+
+// *****************************************************************************
+void PodQueryServer::run()
+{
+    struct pollfd fds[2];
+    fds[0].fd = m_listenFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_stopPipe[0];
+    fds[1].events = POLLIN;
+
+    for (;;)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(m_socketPath + ": " + strerror(errno));
+        }
+        if (fds[1].revents)
+        {
+            char byte;
+            while (read(m_stopPipe[0], &byte, 1) > 0)
+            {
+            }
+            return;
+        }
+
+        const int fd = accept4(m_listenFd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;  // The client gave up, or we're out of descriptors for now
+        }
+
+        PodQueryConnection* connection = new PodQueryConnection;
+        connection->server = this;
+        connection->fd = fd;
+
+        pthread_mutex_lock(&m_mutex);
+        m_connections.insert(fd);
+        pthread_mutex_unlock(&m_mutex);
+
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+        pthread_t thread;
+        if (pthread_create(&thread, &attributes, connectionThread, connection) != 0)
+        {
+            pthread_mutex_lock(&m_mutex);
+            m_connections.erase(fd);
+            pthread_mutex_unlock(&m_mutex);
+            close(fd);
+            delete connection;
+        }
+        pthread_attr_destroy(&attributes);
+    }
+}
+
+
+// *****************************************************************************
+void PodQueryServer::stop()
+{
+    const char byte = 0;
+    if (write(m_stopPipe[1], &byte, 1) < 0)
+    {
+        // Full, so run() has been told already
+    }
+}
+
+
+// *****************************************************************************
+PodQueryServerStats PodQueryServer::stats() const
+{
+    return m_stats;
+}
+
+
+// *****************************************************************************
+void* PodQueryServer::connectionThread(void* arg)
+{
+    PodQueryConnection* connection = static_cast<PodQueryConnection*>(arg);
+    PodQueryServer* server = connection->server;
+    const int fd = connection->fd;
+    delete connection;
+
+    __sync_fetch_and_add(&server->m_stats.connections, 1);
+    server->serve(fd);
+
+    pthread_mutex_lock(&server->m_mutex);
+    server->m_connections.erase(fd);
+    close(fd);
+    pthread_cond_broadcast(&server->m_finished);
+    pthread_mutex_unlock(&server->m_mutex);
+    return NULL;
+}
+
+
+// *****************************************************************************
+//
+// Answer requests, in order, until the client hangs up.  A request that
+// can't be replied to, or too long a one, ends the connection, as there's
+// no telling where the next one starts.
+//
+void PodQueryServer::serve(int fd)
+{
+    std::string request;
+    std::string reply;
+    try
+    {
+        while (readFrame(fd, request))
+        {
+            answer(request, reply);
+            writeFrame(fd, reply);
+        }
+    }
+    catch (const std::exception&)
+    {
+    }
+}
+
+
+// *****************************************************************************
+void PodQueryServer::answer(const std::string& request, std::string& reply)
+{
+    PodQueryReader reader(request);
+    reader.take<uint32_t>();  // Length
+    const uint32_t id = reader.take<uint32_t>();
+    const uint16_t filenameLength = reader.take<uint16_t>();
+    const uint16_t pathCount = reader.take<uint16_t>();
+    const std::string filename = reader.takeText(filenameLength);
+
+    __sync_fetch_and_add(&m_stats.requests, 1);
+    __sync_fetch_and_add(&m_stats.paths, pathCount);
+
+    reply.assign(sizeof(uint32_t), '\0');
+    appendRaw<uint32_t>(reply, id);
+    try
+    {
+        PodDocumentHandle document = m_cache.get(filename);
+        const PodNodeView root = document->root();
+
+        appendRaw<uint8_t>(reply, QueryProtocol::QUERY_OK);
+        appendRaw<uint16_t>(reply, pathCount);
+        for (uint16_t i = 0; i < pathCount; ++i)
+        {
+            const uint16_t pathLength = reader.take<uint16_t>();
+            appendValue(reply, PodPath(reader.takeText(pathLength)).find(root));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // Most likely the pod didn't parse
+        __sync_fetch_and_add(&m_stats.errors, 1);
+        reply.resize(sizeof(uint32_t) * 2);
+        appendRaw<uint8_t>(reply, QueryProtocol::QUERY_ERROR);
+        reply += e.what();
+    }
+}
+
+
+}  //  End namespace TipPod
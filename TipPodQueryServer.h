@@ -0,0 +1,91 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODQUERYSERVER_H__
+#define __TIPPODQUERYSERVER_H__
+
+#include <set>
+#include <string>
+#include <pthread.h>
+
+#include "TipPodDocumentCache.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Counts of what a PodQueryServer has done, as returned by stats()
+//
+struct PodQueryServerStats
+{
+    PodQueryServerStats() : connections(0), requests(0), paths(0), errors(0) {}
+
+    unsigned long connections;
+    unsigned long requests;
+    unsigned long paths;       // Looked up, over all requests
+    unsigned long errors;      // Requests answered with an error
+};
+
+
+// *****************************************************************************
+//
+// Answers PodQueryClients' requests (see TipPodQuery.h) over a Unix domain
+// socket, from pods kept parsed in a PodDocumentCache.
+//
+// NOTES:
+//
+// * Each connection is served by its own thread, so a request for a pod
+//   that has to be parsed doesn't hold up requests for pods that don't.
+// * A socket left behind by a server that died is replaced, but it's an
+//   error for another server to be listening on the socket already.
+// * Pod files are read with the permissions of the server, so the socket
+//   should be only as accessible as the pods it serves.
+//
+class PodQueryServer
+{
+public:
+    // Starts listening.  Throws on error.
+    PodQueryServer(const std::string& socketPath, PodDocumentCache& cache);
+
+    // Closes all connections and removes the socket
+    ~PodQueryServer();
+
+    // Accept connections until stop() is called
+    void run();
+
+    // May be called from a signal handler or another thread
+    void stop();
+
+    PodQueryServerStats stats() const;
+    const std::string& socketPath() const { return m_socketPath; }
+
+private:
+    static void* connectionThread(void* arg);
+    void serve(int fd);
+    void answer(const std::string& request, std::string& reply);
+
+    // Not copyable
+    PodQueryServer(const PodQueryServer&);
+    PodQueryServer& operator=(const PodQueryServer&);
+
+private:
+    std::string       m_socketPath;
+    PodDocumentCache& m_cache;
+    int               m_listenFd;
+    int               m_stopPipe[2];   // stop() writes to this to wake run()
+
+    pthread_mutex_t   m_mutex;         // Guards m_connections
+    pthread_cond_t    m_finished;      // Signalled as each connection ends
+    std::set<int>     m_connections;   // Sockets being served
+
+    mutable PodQueryServerStats m_stats;  // Updated atomically
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODQUERYSERVER_H__
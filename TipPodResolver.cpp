@@ -0,0 +1,180 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "TipPodExc.h"
+#include "TipPodResolver.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+PodResolver::PodResolver(PodNode& root)
+        : m_root(root),
+          m_paths(),
+          m_lookups(),
+          m_resolved(),
+          m_changed(false)
+{
+    root.addObserver(this);
+}
+
+
+// *****************************************************************************
+PodResolver::~PodResolver()
+{
+    m_root.removeObserver(this);
+    for (PathMap::iterator iter = m_paths.begin(); iter != m_paths.end(); ++iter)
+    {
+        delete iter->second;
+    }
+}
+
+
+// *****************************************************************************
+PodNode* PodResolver::resolve(PodNode& node)
+{
+    return const_cast<PodNode*>(resolve(static_cast<const PodNode&>(node)));
+}
+
+
+// *****************************************************************************
+const PodNode* PodResolver::resolve(const PodNode& node)
+{
+    if (!node.isIdentifier())
+    {
+        return &node;
+    }
+    forgetIfChanged();
+
+    ResolvedMap::const_iterator known = m_resolved.find(&node);
+    if (known != m_resolved.end())
+    {
+        return known->second;
+    }
+
+    // Follow the chain until it leaves identifiers, or reaches a node
+    // whose answer is known already
+    std::vector<const PodNode*> chain;
+    const PodNode* current = &node;
+    while (current && current->isIdentifier())
+    {
+        known = m_resolved.find(current);
+        if (known != m_resolved.end())
+        {
+            current = known->second;
+            break;
+        }
+        if (std::find(chain.begin(), chain.end(), current) != chain.end())
+        {
+            std::ostringstream err;
+            err << "cycle of references ";
+            for (size_t i = 0; i < chain.size(); ++i)
+            {
+                err << "'" << chain[i]->podName() << "' -> ";
+            }
+            err << "'" << current->podName() << "' in '" << node.sourcefile()
+                << "', line " << node.sourceline();
+            throw PodReferenceError(&node, err.str());
+        }
+        chain.push_back(current);
+        current = lookup(*current, path(current->asIdentifier()));
+    }
+
+    for (size_t i = 0; i < chain.size(); ++i)
+    {
+        m_resolved[chain[i]] = current;
+    }
+    return current;
+}
+
+
+// *****************************************************************************
+PodNode* PodResolver::lookup(const PodNode& from, const std::string& identifier)
+{
+    forgetIfChanged();
+    return const_cast<PodNode*>(lookup(from, path(identifier)));
+}
+
+
+// *****************************************************************************
+const PodNode* PodResolver::lookup(const PodNode& from, const PodPath* path)
+{
+    for (const PodNode* scope = path ? from.parent() : NULL; scope; scope = scope->parent())
+    {
+        const std::pair<const PodNode*, const PodPath*> key(scope, path);
+        LookupMap::iterator iter = m_lookups.lower_bound(key);
+        if (iter == m_lookups.end() || iter->first != key)
+        {
+            iter = m_lookups.insert(iter, std::make_pair(key, path->find(*scope)));
+        }
+        if (iter->second && iter->second != &from)
+        {
+            return iter->second;
+        }
+        if (scope == &m_root)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+
+// *****************************************************************************
+//
+// NULL for an identifier that isn't a valid path, which can't name a node
+// (setIdentifierValue() takes any text).  The empty path would name the
+// block it's looked up in, so it's no good either.
+//
+const PodPath* PodResolver::path(const std::string& identifier)
+{
+    PathMap::iterator iter = m_paths.lower_bound(identifier);
+    if (iter == m_paths.end() || iter->first != identifier)
+    {
+        PodPath* parsed = NULL;
+        try
+        {
+            if (!identifier.empty()) parsed = new PodPath(identifier);
+        }
+        catch (const PodPathError&)
+        {
+        }
+        iter = m_paths.insert(iter, std::make_pair(identifier, parsed));
+    }
+    return iter->second;
+}
+
+
+// *****************************************************************************
+void PodResolver::forgetIfChanged()
+{
+    if (m_changed)
+    {
+        m_lookups.clear();
+        m_resolved.clear();
+        m_changed = false;
+    }
+}
+
+
+// *****************************************************************************
+void PodResolver::nodeRenamed(PodNode&)
+{
+    m_changed = true;
+}
+
+
+// *****************************************************************************
+void PodResolver::valueChanged(PodNode&)
+{
+    m_changed = true;
+}
+
+
+}  //  End namespace TipPod
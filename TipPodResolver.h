@@ -0,0 +1,93 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODRESOLVER_H__
+#define __TIPPODRESOLVER_H__
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "TipPodNode.h"
+#include "TipPodPath.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Finds what IDENTIFIER values refer to, such as the node "fps" names in
+//
+//     fps = 24;
+//     shot = { frameRate = fps; };
+//
+// and remembers the answers until the tree is changed.
+//
+// RULES:
+//
+// * An identifier is a PodPath ("fps", "show.fps", "Cam::main"), looked up
+//   in the block the identifier's node is in, then in each block around
+//   that, out to the resolver's root.  The first block it's found in wins.
+// * A node never refers to itself, so "fps = fps;" in a block names the
+//   fps of an enclosing block.
+// * resolve() follows a chain of identifiers to the first node that isn't
+//   one.  A chain that loops back on itself throws PodReferenceError.
+//
+// NOTES:
+//
+// * Watches the tree as a PodNodeObserver of the root, and forgets
+//   everything it has worked out when anything in the tree is changed
+//   (see PodNodeObserver for what counts).
+// * Answers are remembered for each identifier node, and for each
+//   identifier looked up in each block, so nodes that use the same name
+//   in the same block share the work.
+// * The root must outlive the resolver.  Not thread safe, like the tree.
+//
+class PodResolver : public PodNodeObserver
+{
+public:
+    explicit PodResolver(PodNode& root);
+    virtual ~PodResolver();
+
+    PodNode& root() const { return m_root; }
+
+    // The node this one refers to, which is the node itself unless it's an
+    // IDENTIFIER.  NULL if a name in the chain isn't found.
+    PodNode* resolve(PodNode& node);
+    const PodNode* resolve(const PodNode& node);
+
+    // The node an identifier names, as seen from the given node, without
+    // following it if it's an identifier too.  NULL if not found.
+    PodNode* lookup(const PodNode& from, const std::string& identifier);
+
+    // PodNodeObserver
+    virtual void nodeRenamed(PodNode& node);
+    virtual void valueChanged(PodNode& node);
+
+private:
+    const PodPath* path(const std::string& identifier);
+    const PodNode* lookup(const PodNode& from, const PodPath* path);
+    void forgetIfChanged();
+
+    PodResolver(const PodResolver&);             // Not implemented
+    PodResolver& operator=(const PodResolver&);  // Not implemented
+
+private:
+    typedef std::map<std::string, PodPath*>                                     PathMap;
+    typedef std::map<std::pair<const PodNode*, const PodPath*>, const PodNode*> LookupMap;
+    typedef std::map<const PodNode*, const PodNode*>                            ResolvedMap;
+
+    PodNode&    m_root;
+    PathMap     m_paths;     // Each identifier, parsed (or NULL); these don't depend on the tree
+    LookupMap   m_lookups;   // (block, path) to what path.find() returned there
+    ResolvedMap m_resolved;  // Identifier node to what resolve() returned
+    bool        m_changed;   // Since m_lookups and m_resolved were cleared
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODRESOLVER_H__
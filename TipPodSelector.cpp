@@ -0,0 +1,486 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <fnmatch.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "TipPodDocument.h"
+#include "TipPodExc.h"
+#include "TipPodSelector.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+static bool isPatternChar(char c, bool isName)
+{
+    return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '*' || c == '?'
+           || c == ':' || (isName && c == '.');
+}
+
+
+// *****************************************************************************
+static bool isPattern(const std::string& text)
+{
+    return text.find_first_of("*?") != std::string::npos;
+}
+
+
+// *****************************************************************************
+static bool matchText(const std::string& pattern, bool isPattern,
+                      const char* text, size_t length)
+{
+    if (isPattern)
+    {
+        return fnmatch(pattern.c_str(), text, 0) == 0;
+    }
+    return pattern.size() == length && memcmp(pattern.data(), text, length) == 0;
+}
+
+
+// *****************************************************************************
+PodSelector::PodSelector(const std::string& selector)
+        : m_selector(selector),
+          m_steps(),
+          m_unique(true)
+{
+    parse();
+}
+
+
+// *****************************************************************************
+void PodSelector::parse()
+{
+    const std::string& text = m_selector;
+    size_t anyDepthSteps = 0;
+    size_t i = 0;
+    do
+    {
+        Step step;
+        step.anyDepth = false;
+        step.podTypeIsPattern = false;
+        step.podNameIsPattern = false;
+        step.scopeTypeIsPattern = false;
+
+        if (text.compare(i, 2, "**") == 0 && (i + 2 == text.size() || text[i + 2] == '/'))
+        {
+            i += 2;
+            step.anyDepth = true;
+            if (!m_steps.empty() && m_steps.back().anyDepth)
+            {
+                continue;  // **/** is the same as **
+            }
+            ++anyDepthSteps;
+        }
+        else
+        {
+            const size_t start = i;
+            step.podType = parsePattern(i, false);
+            if (i < text.size() && text[i] == '#')
+            {
+                step.podName = parsePattern(++i, true);
+                if (step.podName.empty())
+                {
+                    throw PodSelectorError(text, i, "expected a name after '#'");
+                }
+            }
+            if (i < text.size() && text[i] == '@')
+            {
+                step.scopeType = parsePattern(++i, false);
+                if (step.scopeType.empty())
+                {
+                    throw PodSelectorError(text, i, "expected a scope type after '@'");
+                }
+            }
+            while (i < text.size() && text[i] == '[')
+            {
+                step.predicates.push_back(Predicate());
+                parsePredicate(i, step.predicates.back());
+            }
+            if (i == start)
+            {
+                throw PodSelectorError(text, i, "expected a type, '*', '**', '#', '@' or '['");
+            }
+
+            // "*" matches anything, the same as leaving it out
+            if (step.podType == "*") step.podType.clear();
+            if (step.podName == "*") step.podName.clear();
+            if (step.scopeType == "*") step.scopeType.clear();
+            step.podTypeIsPattern = isPattern(step.podType);
+            step.podNameIsPattern = isPattern(step.podName);
+            step.scopeTypeIsPattern = isPattern(step.scopeType);
+        }
+        m_steps.push_back(step);
+
+        if (i < text.size() && text[i] != '/')
+        {
+            throw PodSelectorError(text, i, "expected '/'");
+        }
+    }
+    while (i++ < text.size());
+
+    m_unique = anyDepthSteps <= 1;
+}
+
+
+// *****************************************************************************
+std::string PodSelector::parsePattern(size_t& i, bool isName) const
+{
+    const size_t start = i;
+    while (i < m_selector.size() && isPatternChar(m_selector[i], isName)) ++i;
+    return m_selector.substr(start, i - start);
+}
+
+
+// *****************************************************************************
+//
+// [path], [path op value], where i is at the '['
+//
+void PodSelector::parsePredicate(size_t& i, Predicate& predicate) const
+{
+    const std::string& text = m_selector;
+    const size_t open = i++;
+
+    // The path, which may have [index]es of its own
+    while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) ++i;
+    const size_t pathStart = i;
+    int depth = 0;
+    while (i < text.size() && !isspace(static_cast<unsigned char>(text[i]))
+           && (depth > 0 || strchr("=!<>]", text[i]) == NULL))
+    {
+        if (text[i] == '[') ++depth;
+        if (text[i] == ']') --depth;
+        ++i;
+    }
+    std::string path = text.substr(pathStart, i - pathStart);
+    if (path == ".") path.clear();
+    try
+    {
+        predicate.path = PodPath(path);
+    }
+    catch (const PodPathError& e)
+    {
+        throw PodSelectorError(text, pathStart, e.what());
+    }
+    while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) ++i;
+
+    // The comparison
+    static const struct { const char* text; Op op; } ops[] =
+    {
+        { "==", EQUAL }, { "!=", NOT_EQUAL }, { "<=", LESS_EQUAL }, { ">=", GREATER_EQUAL },
+        { "=", EQUAL }, { "<", LESS }, { ">", GREATER }
+    };
+    predicate.op = EXISTS;
+    for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); ++o)
+    {
+        if (text.compare(i, strlen(ops[o].text), ops[o].text) == 0)
+        {
+            predicate.op = ops[o].op;
+            i += strlen(ops[o].text);
+            break;
+        }
+    }
+
+    if (predicate.op != EXISTS)
+    {
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) ++i;
+        const size_t valueStart = i;
+        char* end = NULL;
+        const double number = i < text.size() ? strtod(text.c_str() + i, &end) : 0.0;
+        if (i < text.size() && text[i] == '"')
+        {
+            predicate.literalType = TEXT;
+            for (++i; i < text.size() && text[i] != '"'; ++i)
+            {
+                if (text[i] == '\\' && i + 1 < text.size()) ++i;
+                predicate.text += text[i];
+            }
+            if (i++ == text.size())
+            {
+                throw PodSelectorError(text, valueStart, "unterminated string");
+            }
+        }
+        else if (end != NULL && end != text.c_str() + i
+                 && (*end == ']' || isspace(static_cast<unsigned char>(*end))))
+        {
+            predicate.literalType = NUMBER;
+            predicate.number = number;
+            i = end - text.c_str();
+        }
+        else
+        {
+            predicate.text = parsePattern(i, true);
+            if (predicate.text.empty())
+            {
+                throw PodSelectorError(text, valueStart, "expected a number, string or identifier");
+            }
+            if (strcasecmp(predicate.text.c_str(), "true") == 0
+                || strcasecmp(predicate.text.c_str(), "false") == 0)
+            {
+                predicate.literalType = BOOLEAN;
+                predicate.boolean = tolower(predicate.text[0]) == 't';
+            }
+            else
+            {
+                predicate.literalType = TEXT;
+            }
+        }
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) ++i;
+    }
+
+    if (i == text.size() || text[i] != ']')
+    {
+        throw PodSelectorError(text, i, i == text.size() ? "unterminated '['" : "expected ']'");
+    }
+    if (predicate.op == EXISTS && path.empty())
+    {
+        throw PodSelectorError(text, open, "expected a path or comparison");
+    }
+    ++i;
+}
+
+
+// *****************************************************************************
+//
+// Comparing a value with a predicate's literal
+//
+template <typename T>
+bool PodSelector::compare(T a, T b, Op op)
+{
+    switch (op)
+    {
+        case EQUAL:         return a == b;
+        case NOT_EQUAL:     return a != b;
+        case LESS:          return a < b;
+        case LESS_EQUAL:    return a <= b;
+        case GREATER:       return a > b;
+        case GREATER_EQUAL: return a >= b;
+        default:            return true;
+    }
+}
+
+
+// *****************************************************************************
+bool PodSelector::compareText(const char* text, size_t length, const std::string& literal, Op op)
+{
+    const int order = memcmp(text, literal.data(), std::min(length, literal.size()));
+    return compare(order != 0 ? order : int(length > literal.size()) - int(length < literal.size()),
+                   0, op);
+}
+
+
+// *****************************************************************************
+bool PodSelector::matches(const PodNode& node, size_t s) const
+{
+    const Step& step = m_steps[s];
+    if (!step.podType.empty()
+        && !matchText(step.podType, step.podTypeIsPattern, node.podType().c_str(), node.podType().size()))
+    {
+        return false;
+    }
+    if (!step.podName.empty()
+        && !matchText(step.podName, step.podNameIsPattern, node.podName().c_str(), node.podName().size()))
+    {
+        return false;
+    }
+    if (!step.scopeType.empty())
+    {
+        if (!node.isBlock()
+            || !matchText(step.scopeType, step.scopeTypeIsPattern,
+                          node.blockScopeType().c_str(), node.blockScopeType().size()))
+        {
+            return false;
+        }
+    }
+
+    for (std::vector<Predicate>::const_iterator iter = step.predicates.begin();
+            iter != step.predicates.end(); ++iter)
+    {
+        const PodNode* target = iter->path.find(node);
+        if (target == NULL)
+        {
+            return false;
+        }
+        bool result = iter->op == EXISTS;
+        switch (iter->op == EXISTS ? PodNode::UNDEFINED : target->valueType())
+        {
+            case PodNode::INT:
+            case PodNode::FLOAT:
+                result = iter->literalType == NUMBER
+                         && compare<double>(target->isInt() ? target->asInt() : target->asFloat(),
+                                            iter->number, iter->op);
+                break;
+            case PodNode::BOOL:
+                result = iter->literalType == BOOLEAN
+                         && (iter->op == EQUAL || iter->op == NOT_EQUAL)
+                         && compare(target->asBool(), iter->boolean, iter->op);
+                break;
+            case PodNode::STRING:
+            case PodNode::IDENTIFIER:
+            case PodNode::EMBED:
+            {
+                if (iter->literalType != TEXT) break;
+                const std::string text = target->isString() ? target->asString()
+                                       : target->isIdentifier() ? target->asIdentifier()
+                                       : target->asEmbedScript();
+                result = compareText(text.data(), text.size(), iter->text, iter->op);
+                break;
+            }
+            default:
+                break;
+        }
+        if (!result)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// *****************************************************************************
+bool PodSelector::matches(const PodNodeView& node, size_t s) const
+{
+    const Step& step = m_steps[s];
+    const PodSnapshot* snapshot = node.snapshot();
+    const PodSnapshotNode& record = snapshot->node(node.index());
+    if (!step.podType.empty()
+        && !matchText(step.podType, step.podTypeIsPattern,
+                      snapshot->string(record.podType), snapshot->stringLength(record.podType)))
+    {
+        return false;
+    }
+    if (!step.podName.empty()
+        && !matchText(step.podName, step.podNameIsPattern,
+                      snapshot->string(record.podName), snapshot->stringLength(record.podName)))
+    {
+        return false;
+    }
+    if (!step.scopeType.empty())
+    {
+        if (record.valueType != PodNode::BLOCK
+            || !matchText(step.scopeType, step.scopeTypeIsPattern,
+                          snapshot->string(record.aux), snapshot->stringLength(record.aux)))
+        {
+            return false;
+        }
+    }
+
+    for (std::vector<Predicate>::const_iterator iter = step.predicates.begin();
+            iter != step.predicates.end(); ++iter)
+    {
+        const PodNodeView target = iter->path.find(node);
+        if (target.isNull())
+        {
+            return false;
+        }
+        bool result = iter->op == EXISTS;
+        switch (iter->op == EXISTS ? PodNode::UNDEFINED : target.valueType())
+        {
+            case PodNode::INT:
+            case PodNode::FLOAT:
+                result = iter->literalType == NUMBER
+                         && compare<double>(target.isInt() ? target.asInt() : target.asFloat(),
+                                            iter->number, iter->op);
+                break;
+            case PodNode::BOOL:
+                result = iter->literalType == BOOLEAN
+                         && (iter->op == EQUAL || iter->op == NOT_EQUAL)
+                         && compare(target.asBool(), iter->boolean, iter->op);
+                break;
+            case PodNode::STRING:
+            case PodNode::IDENTIFIER:
+            case PodNode::EMBED:
+            {
+                if (iter->literalType != TEXT) break;
+                const uint32_t value = snapshot->node(target.index()).value;
+                result = compareText(snapshot->string(value), snapshot->stringLength(value),
+                                     iter->text, iter->op);
+                break;
+            }
+            default:
+                break;
+        }
+        if (!result)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// *****************************************************************************
+//
+// "**/Type..." or "**/#name..." run from the root of a snapshot can start
+// from every node of that type or name, rather than from the root.
+//
+bool PodSelector::candidates(const PodNodeView& root, const PodSnapshotIndex* index,
+                             PodSnapshotIndex::Range& range) const
+{
+    if (index == NULL || root.isNull() || &index->snapshot() != root.snapshot()
+        || root.index() != root.snapshot()->root().index()
+        || m_steps.size() < 2 || !m_steps[0].anyDepth)
+    {
+        return false;
+    }
+
+    const Step& step = m_steps[1];
+    const PodSnapshot* snapshot = root.snapshot();
+    if (!step.podName.empty() && !step.podNameIsPattern)
+    {
+        const uint32_t name = snapshot->findString(step.podName);
+        range = name == PodSnapshot::NO_STRING ? PodSnapshotIndex::Range(NULL, NULL)
+                                               : index->byName(name);
+        return true;
+    }
+    if (!step.podType.empty() && !step.podTypeIsPattern)
+    {
+        const uint32_t podType = snapshot->findString(step.podType);
+        range = podType == PodSnapshot::NO_STRING ? PodSnapshotIndex::Range(NULL, NULL)
+                                                  : index->byType(podType);
+        return true;
+    }
+    return false;
+}
+
+
+// *****************************************************************************
+PodNodeSelection PodSelector::select(PodNode& root) const
+{
+    return PodNodeSelection(*this, &root);
+}
+
+
+// *****************************************************************************
+ConstPodNodeSelection PodSelector::select(const PodNode& root) const
+{
+    return ConstPodNodeSelection(*this, &root);
+}
+
+
+// *****************************************************************************
+PodViewSelection PodSelector::select(const PodNodeView& root, const PodSnapshotIndex* index) const
+{
+    PodSnapshotIndex::Range range(NULL, NULL);
+    if (candidates(root, index, range))
+    {
+        return PodViewSelection(*this, root.snapshot(), range);
+    }
+    return PodViewSelection(*this, root);
+}
+
+
+// *****************************************************************************
+PodViewSelection PodSelector::select(const PodDocument& document) const
+{
+    return select(document.root(), &document.index());
+}
+
+
+}  //  End namespace TipPod
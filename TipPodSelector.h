@@ -0,0 +1,322 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODSELECTOR_H__
+#define __TIPPODSELECTOR_H__
+
+#include <set>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "TipPodNode.h"
+#include "TipPodPath.h"
+#include "TipPodSnapshot.h"
+#include "TipPodSnapshotIndex.h"
+
+namespace TipPod {
+
+class PodDocument;
+template <typename Node> class PodSelection;
+
+typedef PodSelection<PodNode*>       PodNodeSelection;
+typedef PodSelection<const PodNode*> ConstPodNodeSelection;
+typedef PodSelection<PodNodeView>    PodViewSelection;
+
+
+// *****************************************************************************
+//
+// A query for all the nodes in a tree that match a pattern, such as
+// "**/Light[intensity>2]", parsed once and then run on any number of pods.
+//
+// SYNTAX:
+//
+// A selector is a list of steps separated by '/'.  The first step matches
+// children of the node the selector is run on, the next their children,
+// and so on.  A step is:
+//
+//     **                   Any number of levels, including none
+//     Light                Nodes of type Light
+//     *                    Any node
+//     #key                 Nodes named key
+//     Light#key            Both
+//     @Range               Blocks with scope type Range (frames = Range {...})
+//     [path]               Nodes with a node at this path (see PodPath)
+//     [path op value]      ... whose value compares as given
+//
+// where
+//
+// * Types, names and scope types may be patterns with '*' and '?', e.g.
+//   "Light*", "#node_?".
+// * op is one of == (or =), !=, <, <=, > and >=.
+// * value is a number, "string", true, false, or a bare identifier.
+//   Numbers compare with INT and FLOAT values, true and false with BOOLs,
+//   and strings and identifiers with STRING, IDENTIFIER and EMBED values.
+//   Comparing different kinds of value is false.
+// * A path of "." or nothing is the node itself: "**/#intensity[>2]".
+// * A step may have any number of [...] predicates, all of which must hold.
+//
+// NOTES:
+//
+// * Matches are found as they're asked for, by stepping a PodSelection
+//   (see below), so taking the first few matches is cheap.
+// * Matches come out parent before child, except that those found with an
+//   index come out in the order the index lists them.  With one "**" or
+//   none, each node comes out once; with more, a set of those already
+//   returned is kept so none comes out twice.
+// * Selectors that start with "**/" and then a type or name without
+//   wildcards can use a PodSnapshotIndex rather than walk the whole tree.
+//   Running one on a PodDocument uses the document's index.
+// * PodSelectors are immutable once constructed, so one may be shared by
+//   any number of threads.
+//
+class PodSelector
+{
+public:
+    explicit PodSelector(const std::string& selector);  // Throws PodSelectorError
+
+    const std::string& str() const { return m_selector; }
+
+    // The selector must outlive the selections
+    PodNodeSelection select(PodNode& root) const;
+    ConstPodNodeSelection select(const PodNode& root) const;
+    PodViewSelection select(const PodNodeView& root, const PodSnapshotIndex* index=NULL) const;
+    PodViewSelection select(const PodDocument& document) const;
+
+private:
+    template <typename Node> friend class PodSelection;
+
+    enum Op { EXISTS, EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+    enum LiteralType { NUMBER, BOOLEAN, TEXT };
+
+    struct Predicate
+    {
+        Predicate() : path(""), op(EXISTS), literalType(TEXT), number(0.0), boolean(false), text() {}
+
+        PodPath     path;
+        Op          op;
+        LiteralType literalType;
+        double      number;
+        bool        boolean;
+        std::string text;
+    };
+
+    struct Step
+    {
+        bool                   anyDepth;   // "**"; nothing else is set
+        std::string            podType;    // Empty matches any
+        std::string            podName;
+        std::string            scopeType;
+        bool                   podTypeIsPattern;
+        bool                   podNameIsPattern;
+        bool                   scopeTypeIsPattern;
+        std::vector<Predicate> predicates;
+    };
+
+    void parse();
+    std::string parsePattern(size_t& i, bool isName) const;
+    void parsePredicate(size_t& i, Predicate& predicate) const;
+
+    size_t size() const { return m_steps.size(); }
+    bool anyDepth(size_t s) const { return m_steps[s].anyDepth; }
+    bool matches(const PodNode& node, size_t s) const;
+    bool matches(const PodNode* node, size_t s) const { return matches(*node, s); }
+    bool matches(const PodNodeView& node, size_t s) const;
+
+    template <typename T> static bool compare(T a, T b, Op op);
+    static bool compareText(const char* text, size_t length, const std::string& literal, Op op);
+
+    // For a selector that can be answered from an index, the nodes that
+    // may match its second step.  Returns false if it can't be.
+    bool candidates(const PodNodeView& root, const PodSnapshotIndex* index,
+                    PodSnapshotIndex::Range& range) const;
+
+private:
+    std::string       m_selector;
+    std::vector<Step> m_steps;
+    bool              m_unique;  // At most one "**", so no match can be found twice
+};
+
+
+//
+// Used by PodSelection, to walk either kind of tree
+//
+inline size_t podSelectorChildCount(const PodNode* node)
+{
+    return node->isBlock() ? node->asBlock().size() : 0;
+}
+inline PodNode* podSelectorChild(PodNode* node, size_t i) { return node->asBlock()[i]; }
+inline const PodNode* podSelectorChild(const PodNode* node, size_t i) { return node->asBlock()[i]; }
+inline uintptr_t podSelectorId(const PodNode* node) { return reinterpret_cast<uintptr_t>(node); }
+inline bool podSelectorIsNull(const PodNode* node) { return node == NULL; }
+
+inline size_t podSelectorChildCount(const PodNodeView& node)
+{
+    return node.isBlock() ? node.asBlock().size() : 0;
+}
+inline PodNodeView podSelectorChild(const PodNodeView& node, size_t i) { return node.asBlock()[i]; }
+inline uintptr_t podSelectorId(const PodNodeView& node) { return node.index(); }
+inline bool podSelectorIsNull(const PodNodeView& node) { return node.isNull(); }
+
+
+// *****************************************************************************
+//
+// The nodes a PodSelector matches in a tree, found one at a time:
+//
+//     for (PodViewSelection s = selector.select(document); !s.done(); ++s)
+//     {
+//         const PodNodeView light = *s;
+//         ...
+//     }
+//
+// The tree must not be changed while a selection of it is being stepped.
+//
+template <typename Node>
+class PodSelection
+{
+public:
+    PodSelection(const PodSelector& selector, Node root)
+        : m_selector(&selector), m_stack(), m_current(), m_done(false), m_seen(),
+          m_candidate(NULL), m_candidatesEnd(NULL), m_snapshot(NULL)
+        {
+            if (!podSelectorIsNull(root)) push(root, 0);
+            advance();
+        }
+
+    // Start with nodes from an index, which may match the selector's second step
+    PodSelection(const PodSelector& selector, const PodSnapshot* snapshot,
+                 const PodSnapshotIndex::Range& candidates)
+        : m_selector(&selector), m_stack(), m_current(), m_done(false), m_seen(),
+          m_candidate(candidates.begin()), m_candidatesEnd(candidates.end()), m_snapshot(snapshot)
+        {
+            advance();
+        }
+
+    bool done() const { return m_done; }
+    Node operator*() const { return m_current; }
+    PodSelection& operator++() { advance(); return *this; }
+
+private:
+    struct Frame
+    {
+        Node   parent;
+        size_t next;    // Child to match next
+        size_t count;
+        size_t step;    // Which the children are matched against
+    };
+
+    void push(Node parent, size_t step)
+        {
+            const size_t count = podSelectorChildCount(parent);
+            if (count == 0) return;
+            Frame frame;
+            frame.parent = parent;
+            frame.next = 0;
+            frame.count = count;
+            frame.step = step;
+            m_stack.push_back(frame);
+        }
+
+    // Match a node against a step other than "**".  Returns true if it's a
+    // result, otherwise arranges for its children to be matched against
+    // the next step.
+    bool visit(Node node, size_t step)
+        {
+            if (!m_selector->matches(node, step)) return false;
+            if (step + 1 == m_selector->size()) return true;
+            push(node, step + 1);
+            return false;
+        }
+
+    void advance()
+        {
+            for (;;)
+            {
+                Node node;
+                bool result;
+                if (!m_stack.empty())
+                {
+                    Frame& frame = m_stack.back();
+                    if (frame.next == frame.count)
+                    {
+                        m_stack.pop_back();
+                        continue;
+                    }
+                    node = podSelectorChild(frame.parent, frame.next++);
+                    const size_t step = frame.step;  // push() may move frame
+                    if (m_selector->anyDepth(step))
+                    {
+                        // The node may be at this level, or any below
+                        push(node, step);
+                        result = step + 1 == m_selector->size() || visit(node, step + 1);
+                    }
+                    else
+                    {
+                        result = visit(node, step);
+                    }
+                }
+                else if (nextCandidate(node))
+                {
+                    // Only once everything under the last one is done, so
+                    // the stack stays as shallow as a walk's
+                    result = visit(node, 1);
+                }
+                else
+                {
+                    m_done = true;
+                    m_current = Node();
+                    return;
+                }
+
+                if (result && (m_selector->m_unique || m_seen.insert(podSelectorId(node)).second))
+                {
+                    m_current = node;
+                    return;
+                }
+            }
+        }
+
+    bool nextCandidate(Node& node);
+
+private:
+    const PodSelector*  m_selector;
+    std::vector<Frame>  m_stack;
+    Node                m_current;
+    bool                m_done;
+    std::set<uintptr_t> m_seen;
+
+    const uint32_t*     m_candidate;      // From an index, each taken when the stack is empty
+    const uint32_t*     m_candidatesEnd;
+    const PodSnapshot*  m_snapshot;
+};
+
+
+// Only selections of snapshots have candidates from an index.  Specialized
+// per type, so that for PodNodes the compiler sees there are none.
+template <>
+inline bool PodSelection<PodNodeView>::nextCandidate(PodNodeView& node)
+{
+    if (m_candidate == m_candidatesEnd) return false;
+    node = PodNodeView(m_snapshot, *m_candidate++);
+    return true;
+}
+
+template <>
+inline bool PodSelection<PodNode*>::nextCandidate(PodNode*&)
+{
+    return false;
+}
+
+template <>
+inline bool PodSelection<const PodNode*>::nextCandidate(const PodNode*&)
+{
+    return false;
+}
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODSELECTOR_H__
@@ -0,0 +1,395 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "TipPod.h"
+#include "TipPodSharedStore.h"
+#include "TipPodSource.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+const char* const PodSharedStore::DEFAULT_DIRECTORY = "/dev/shm";
+
+// Each user's segments are in their own directory, SEGMENT_PREFIX + uid.
+// Segments are named SEGMENT_PREFIX + hash of the path + "-" + hash of the
+// contents + SEGMENT_SUFFIX, and the lock files SEGMENT_PREFIX + hash of
+// the path + LOCK_SUFFIX.
+static const char SEGMENT_PREFIX[] = "tippod-";
+static const char SEGMENT_SUFFIX[] = ".podb";
+static const char LOCK_SUFFIX[] = ".lock";
+
+// Temporary files from writeFileAtomically() older than this were left
+// behind by a writer that died.
+static const time_t ABANDONED_SECONDS = 3600;
+
+
+// *****************************************************************************
+static std::string hex(uint64_t value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+
+// *****************************************************************************
+static bool endsWith(const std::string& text, const char* suffix)
+{
+    const size_t length = strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+
+// *****************************************************************************
+//
+// Remove a lock file, unless a process is publishing with it.  One that
+// has it open and is waiting for it ends up locking the removed file, so
+// at worst two processes parse the same pod.
+//
+static void removeLockFile(const std::string& lockName)
+{
+    const int fd = open(lockName.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) return;
+    if (flock(fd, LOCK_EX | LOCK_NB) == 0)
+    {
+        unlink(lockName.c_str());
+    }
+    close(fd);  // Releases the lock
+}
+
+
+// *****************************************************************************
+PodSharedStore::PodSharedStore(const std::string& directory)
+        : m_directory(),
+          m_stats()
+{
+    struct stat st;
+    if (stat(directory.c_str(), &st) != 0)
+    {
+        throw std::runtime_error(directory + ": " + strerror(errno));
+    }
+    if (!S_ISDIR(st.st_mode))
+    {
+        throw std::runtime_error(directory + ": Not a directory");
+    }
+
+    //
+    // Other users can create files in a shared directory such as /dev/shm,
+    // and could put a segment of their own where we'd map it, or hold its
+    // lock forever.  So only trust a directory that's ours alone.
+    //
+    char uid[32];
+    snprintf(uid, sizeof(uid), "%lu", static_cast<unsigned long>(geteuid()));
+    m_directory = directory + "/" + SEGMENT_PREFIX + uid;
+    if (mkdir(m_directory.c_str(), 0700) != 0 && errno != EEXIST)
+    {
+        throw std::runtime_error(m_directory + ": " + strerror(errno));
+    }
+    if (lstat(m_directory.c_str(), &st) != 0)
+    {
+        throw std::runtime_error(m_directory + ": " + strerror(errno));
+    }
+    if (!S_ISDIR(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & 077) != 0)
+    {
+        throw std::runtime_error(m_directory + ": Not a directory private to this user");
+    }
+}
+
+
+// *****************************************************************************
+PodDocumentHandle PodSharedStore::get(const std::string& filename)
+{
+    std::string path = filename;
+    if (char* real = realpath(filename.c_str(), NULL))
+    {
+        path = real;
+        free(real);
+    }
+
+    // The file has to be read to find its segment, so read it into a
+    // buffer we can parse from if the segment doesn't exist yet.
+    PodSource* source = PodSource::fromFile(filename);
+    const std::string pathHash = hex(hashBytes(path.data(), path.size()));
+    const std::string prefix = SEGMENT_PREFIX + pathHash + "-";
+    const std::string segment = m_directory + "/" + prefix
+                                + hex(hashBytes(source->data(), source->size()))
+                                + SEGMENT_SUFFIX;
+
+    PodSnapshot* snapshot = map(segment);
+    if (snapshot)
+    {
+        source->unref();
+        __sync_fetch_and_add(&m_stats.hits, 1);
+        return PodDocumentHandle(PodDocument::create(snapshot, filename));
+    }
+
+    //
+    // Only one process at a time parses and publishes a given pod; the rest
+    // wait here, then map what it published.  If the lock can't be had,
+    // everyone parses, which is slower but still correct.
+    //
+    const std::string lockName = m_directory + "/" + SEGMENT_PREFIX + pathHash + LOCK_SUFFIX;
+    const int lockFd = open(lockName.c_str(), O_RDONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (lockFd >= 0)
+    {
+        while (flock(lockFd, LOCK_EX) != 0 && errno == EINTR)
+        {
+        }
+    }
+
+    try
+    {
+        snapshot = map(segment);
+        if (snapshot)
+        {
+            __sync_fetch_and_add(&m_stats.waits, 1);
+        }
+        else
+        {
+            PodNode* rootNode = parseSource(source, PARSE_DEFAULT);
+            PodSnapshot* privateSnapshot = NULL;
+            try
+            {
+                privateSnapshot = freeze(*rootNode);
+            }
+            catch (...)
+            {
+                delete rootNode;
+                throw;
+            }
+            delete rootNode;
+
+            try
+            {
+                publish(segment, prefix, *privateSnapshot);
+                __sync_fetch_and_add(&m_stats.publishes, 1);
+                snapshot = map(segment);
+            }
+            catch (const std::exception&)
+            {
+                // Shared memory is only an optimization; the caller still gets the pod.
+                __sync_fetch_and_add(&m_stats.publishErrors, 1);
+            }
+
+            // Use the shared copy rather than our own, so there's only one
+            if (snapshot)
+            {
+                delete privateSnapshot;
+            }
+            else
+            {
+                snapshot = privateSnapshot;
+            }
+        }
+    }
+    catch (...)
+    {
+        if (lockFd >= 0) close(lockFd);
+        source->unref();
+        throw;
+    }
+
+    if (lockFd >= 0) close(lockFd);  // Releases the lock
+    source->unref();
+    return PodDocumentHandle(PodDocument::create(snapshot, filename));
+}
+
+
+// *****************************************************************************
+//
+// Returns NULL if the segment doesn't exist, is damaged, or isn't only
+// ours to write.
+//
+PodSnapshot* PodSharedStore::map(const std::string& segment)
+{
+    const int fd = open(segment.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)
+        || st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    PodSnapshot* snapshot = NULL;
+    try
+    {
+        snapshot = PodSnapshot::load(fd, segment);
+        futimens(fd, NULL);  // For removeStale()
+    }
+    catch (const std::exception&)
+    {
+        // Damaged; publishing the pod again will replace it.
+        snapshot = NULL;
+    }
+    close(fd);
+    return snapshot;
+}
+
+
+// *****************************************************************************
+void PodSharedStore::publish(const std::string& segment, const std::string& prefix,
+                             const PodSnapshot& snapshot)
+{
+    struct iovec piece;
+    piece.iov_base = const_cast<char*>(snapshot.data());
+    piece.iov_len = snapshot.size();
+    writeFileAtomically(segment, &piece, 1);
+
+    // Remove earlier versions of the pod
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) return;
+
+    const std::string published = segment.substr(m_directory.size() + 1);
+    while (struct dirent* d = readdir(dir))
+    {
+        const std::string name = d->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0
+            && endsWith(name, SEGMENT_SUFFIX)
+            && name != published
+            && unlink((m_directory + "/" + name).c_str()) == 0)
+        {
+            __sync_fetch_and_add(&m_stats.removed, 1);
+        }
+    }
+    closedir(dir);
+}
+
+
+// *****************************************************************************
+void PodSharedStore::removeStale(time_t maxIdleSeconds)
+{
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) return;
+
+    // The most recently used version of each pod, by the hash of its path
+    std::map<std::string, std::pair<time_t, std::string> > newest;
+    std::map<std::string, std::pair<time_t, std::string> >::iterator iter;
+    std::vector<std::string> lockNames;
+
+    const time_t now = time(NULL);
+    while (struct dirent* d = readdir(dir))
+    {
+        const std::string name = d->d_name;
+        if (name.compare(0, sizeof(SEGMENT_PREFIX) - 1, SEGMENT_PREFIX) != 0)
+        {
+            continue;
+        }
+        if (endsWith(name, LOCK_SUFFIX))
+        {
+            lockNames.push_back(name);
+            continue;
+        }
+
+        const std::string fullName = m_directory + "/" + name;
+        struct stat st;
+        if (stat(fullName.c_str(), &st) != 0) continue;  // Removed by someone else
+
+        if (!endsWith(name, SEGMENT_SUFFIX))
+        {
+            // A temporary file
+            if (now - st.st_mtime > ABANDONED_SECONDS)
+            {
+                unlink(fullName.c_str());
+            }
+            continue;
+        }
+
+        if (now - st.st_mtime > maxIdleSeconds)
+        {
+            if (unlink(fullName.c_str()) == 0)
+            {
+                __sync_fetch_and_add(&m_stats.removed, 1);
+            }
+            continue;
+        }
+
+        // Of two versions of a pod, remove the one used least recently
+        const std::string pathHash = name.substr(0, name.rfind('-'));
+        iter = newest.find(pathHash);
+        if (iter == newest.end())
+        {
+            newest[pathHash] = std::make_pair(st.st_mtime, fullName);
+            continue;
+        }
+        std::string older = fullName;
+        if (st.st_mtime > iter->second.first)
+        {
+            older = iter->second.second;
+            iter->second = std::make_pair(st.st_mtime, fullName);
+        }
+        if (unlink(older.c_str()) == 0)
+        {
+            __sync_fetch_and_add(&m_stats.removed, 1);
+        }
+    }
+    closedir(dir);
+
+    // Locks of pods with no segments left
+    for (size_t i = 0; i < lockNames.size(); ++i)
+    {
+        const std::string pathHash = lockNames[i].substr(0, lockNames[i].size()
+                                                            - (sizeof(LOCK_SUFFIX) - 1));
+        if (newest.find(pathHash) == newest.end())
+        {
+            removeLockFile(m_directory + "/" + lockNames[i]);
+        }
+    }
+}
+
+
+// *****************************************************************************
+void PodSharedStore::clear()
+{
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) return;
+
+    while (struct dirent* d = readdir(dir))
+    {
+        const std::string name = d->d_name;
+        if (name.compare(0, sizeof(SEGMENT_PREFIX) - 1, SEGMENT_PREFIX) != 0)
+        {
+            continue;
+        }
+        if (endsWith(name, LOCK_SUFFIX))
+        {
+            removeLockFile(m_directory + "/" + name);
+        }
+        else
+        {
+            unlink((m_directory + "/" + name).c_str());
+        }
+    }
+    closedir(dir);
+}
+
+
+// *****************************************************************************
+PodSharedStoreStats PodSharedStore::stats() const
+{
+    return m_stats;
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,107 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODSHAREDSTORE_H__
+#define __TIPPODSHAREDSTORE_H__
+
+#include <string>
+#include <ctime>
+#include <stdint.h>
+
+#include "TipPodDocument.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Counts of what a PodSharedStore has done, as returned by stats()
+//
+struct PodSharedStoreStats
+{
+    PodSharedStoreStats()
+        : hits(0), waits(0), publishes(0), publishErrors(0), removed(0) {}
+
+    unsigned long hits;          // Mapped a segment that was already there
+    unsigned long waits;         // Hits after waiting for another process to publish
+    unsigned long publishes;     // Segments parsed and published by this process
+    unsigned long publishErrors; // Segments that couldn't be published (e.g. no space)
+    unsigned long removed;       // Stale segments removed
+};
+
+
+// *****************************************************************************
+//
+// Frozen pods in shared memory, so that all the processes on a host which
+// read the same pod share one copy of it rather than each parsing the file
+// into its own heap.
+//
+// NOTES:
+//
+// * Each pod is a .podb segment in a directory of the user's own under
+//   'directory', which should be on a memory file system such as /dev/shm.
+//   Segments are mapped read-only with PodSnapshot::load(); snapshots
+//   contain no pointers, so they work at any address.
+// * Only processes of the same user share segments.  The user's directory
+//   is made mode 0700, and a store won't use one that others could write
+//   to, nor map a segment that isn't the user's own.
+// * Segments are named for the real path of the pod and a hash of its
+//   contents, so a pod that changes gets a new segment, and processes
+//   which still have the old one mapped are unaffected.
+// * The first process to want a pod parses it and publishes the segment by
+//   renaming it into place, so nobody sees a partly written one.  Others
+//   wanting the same pod meanwhile wait for it (using flock() on a lock
+//   file) rather than parsing it too.
+// * Publishing a new version of a pod removes the old ones.  removeStale()
+//   also removes segments nobody has used for a while, files left by
+//   processes which died while publishing, and the lock files of pods with
+//   no segments left.  Removing a segment doesn't affect processes which
+//   have it mapped.
+// * If a segment can't be published, get() still returns the pod, in
+//   private memory.
+//
+class PodSharedStore
+{
+public:
+    static const char* const DEFAULT_DIRECTORY;    // /dev/shm
+    static const time_t DEFAULT_MAX_IDLE_SECONDS = 24 * 60 * 60;
+
+    // Throws if the directory doesn't exist, or the user's directory in it
+    // can't be made or isn't private to the user
+    explicit PodSharedStore(const std::string& directory=DEFAULT_DIRECTORY);
+
+    // The given pod, mapped from its shared segment, which is published if
+    // it doesn't exist yet.  Throws on parse errors.
+    PodDocumentHandle get(const std::string& filename);
+
+    // Remove old versions of segments, those which haven't been used for
+    // maxIdleSeconds, and files abandoned by processes which died.
+    void removeStale(time_t maxIdleSeconds=DEFAULT_MAX_IDLE_SECONDS);
+
+    // Remove every segment, and their lock files
+    void clear();
+
+    PodSharedStoreStats stats() const;
+    const std::string& directory() const { return m_directory; }  // The user's directory
+
+private:
+    PodSnapshot* map(const std::string& segment);
+    void publish(const std::string& segment, const std::string& prefix, const PodSnapshot& snapshot);
+
+    // Not copyable
+    PodSharedStore(const PodSharedStore&);
+    PodSharedStore& operator=(const PodSharedStore&);
+
+private:
+    std::string m_directory;
+
+    mutable PodSharedStoreStats m_stats;  // Updated atomically
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODSHAREDSTORE_H__
@@ -0,0 +1,941 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "TipPodSnapshot.h"
+#include "TipPodValue.h"
+#include "TipPodBlockPodValue.h"
+#include "TipPodExc.h"
+#include "TipPodPath.h"
+#include "TipPodUtils.h"
+#include "TipPodWriteBuffer.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// A snapshot's memory starts with this header, followed by the sections it
+// describes, each aligned to 8 bytes:
+//
+//    nodes       nodeCount PodSnapshotNodes, the root first
+//    strings     stringCount PodSnapshotStrings, the empty string first
+//    hash table  hashSize uint32_ts, (1 + index of a string) or 0 if empty.
+//                hashSize is a power of two, with at least one slot
+//                empty, and the table is probed linearly from
+//                hashBytes(text) & (hashSize - 1).
+//    chars       The text of all the strings, each followed by a NUL
+//
+// Offsets are from the start of the header.  Everything is in the byte
+// order of the machine that made the snapshot.
+//
+// This is also the format of .podb files, so any change to it must bump
+// SNAPSHOT_VERSION.
+//
+struct PodSnapshotHeader
+{
+    char     magic[4];     // "PODB"
+    uint32_t version;
+    uint32_t byteOrder;    // SNAPSHOT_BYTE_ORDER, as written by the machine that made it
+    uint32_t nodeCount;
+    uint32_t nodesOffset;
+    uint32_t stringCount;
+    uint32_t stringsOffset;
+    uint32_t hashSize;
+    uint32_t hashOffset;
+    uint32_t charsSize;
+    uint32_t charsOffset;
+    uint32_t totalSize;
+    uint32_t reserved[4];
+};
+
+static const char     SNAPSHOT_MAGIC[4]   = { 'P', 'O', 'D', 'B' };
+static const uint32_t SNAPSHOT_VERSION    = 1;
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+
+// *****************************************************************************
+//
+// Accumulates the nodes and strings of a snapshot, for freeze().
+//
+class SnapshotBuilder
+{
+public:
+    SnapshotBuilder() : nodes(), strings(), chars(), hashTable(16, 0)
+        {
+            intern(std::string());  // So the empty string is always 0
+        }
+
+    void addNode(const PodNode& node, uint32_t parent);
+    void addBlock(uint32_t index, const PodNode& node);
+    uint32_t intern(const std::string& text);
+    char* build(size_t& size) const;
+
+private:
+    void rehash(size_t size);
+
+private:
+    std::vector<PodSnapshotNode>   nodes;
+    std::vector<PodSnapshotString> strings;
+    std::string                    chars;
+    std::vector<uint32_t>          hashTable;
+};
+
+
+// *****************************************************************************
+static uint32_t checkedSize(size_t size)
+{
+    if (size >= 0xffffffffu)
+    {
+        throw std::runtime_error("Pod too large to freeze");
+    }
+    return static_cast<uint32_t>(size);
+}
+
+
+// *****************************************************************************
+static size_t align8(size_t offset)
+{
+    return (offset + 7) & ~size_t(7);
+}
+
+
+// *****************************************************************************
+void SnapshotBuilder::addNode(const PodNode& node, uint32_t parent)
+{
+    PodSnapshotNode record;
+    record.podName = intern(node.podName());
+    record.podType = intern(node.podType());
+    record.valueType = node.valueType();
+    record.value = 0;
+    record.count = 0;
+    record.aux = 0;
+    record.parent = parent;
+
+    const PodValue* value = node.value();
+    switch (node.valueType())
+    {
+        case PodNode::STRING:
+            record.value = intern(static_cast<const StringPodValue*>(value)->value());
+            break;
+        case PodNode::IDENTIFIER:
+            record.value = intern(static_cast<const IdentifierPodValue*>(value)->value());
+            break;
+        case PodNode::EMBED:
+            record.value = intern(static_cast<const EmbedPodValue*>(value)->value());
+            record.aux = intern(static_cast<const EmbedPodValue*>(value)->language());
+            break;
+        case PodNode::INT:
+            {
+                const int v = static_cast<const IntPodValue*>(value)->value();
+                memcpy(&record.value, &v, sizeof(v));
+            }
+            break;
+        case PodNode::FLOAT:
+            {
+                const float v = static_cast<const FloatPodValue*>(value)->value();
+                memcpy(&record.value, &v, sizeof(v));
+            }
+            break;
+        case PodNode::BOOL:
+            record.value = static_cast<const BoolPodValue*>(value)->value() ? 1 : 0;
+            break;
+        case PodNode::BLOCK:
+            record.aux = intern(node.blockScopeType());  // Nodes are filled in by addBlock()
+            break;
+        default:
+            break;
+    }
+    nodes.push_back(record);
+    checkedSize(nodes.size());
+}
+
+
+// *****************************************************************************
+//
+// The nodes of a block are added together, followed by those of each nested
+// block in turn.
+//
+void SnapshotBuilder::addBlock(uint32_t index, const PodNode& node)
+{
+    const PodNodeDeque& block = node.asBlock();
+    const uint32_t first = checkedSize(nodes.size());
+    for (PodNodeDeque::const_iterator iter = block.begin();
+            iter != block.end(); ++iter)
+    {
+        addNode(**iter, index);
+    }
+    nodes[index].value = first;
+    nodes[index].count = checkedSize(block.size());
+
+    for (size_t i = 0; i < block.size(); ++i)
+    {
+        if (block[i]->isBlock())
+        {
+            addBlock(first + i, *block[i]);
+        }
+    }
+}
+
+
+// *****************************************************************************
+uint32_t SnapshotBuilder::intern(const std::string& text)
+{
+    const size_t mask = hashTable.size() - 1;
+    size_t slot = hashBytes(text.data(), text.size()) & mask;
+    while (hashTable[slot])
+    {
+        const PodSnapshotString& s = strings[hashTable[slot] - 1];
+        if (s.length == text.size()
+            && memcmp(chars.data() + s.offset, text.data(), text.size()) == 0)
+        {
+            return hashTable[slot] - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    PodSnapshotString s;
+    s.offset = checkedSize(chars.size());
+    s.length = checkedSize(text.size());
+    chars.append(text);
+    chars.push_back('\0');
+    checkedSize(chars.size());
+
+    strings.push_back(s);
+    hashTable[slot] = strings.size();
+
+    // Keep the table at most half full
+    if (strings.size() * 2 > hashTable.size())
+    {
+        rehash(hashTable.size() * 2);
+    }
+    return strings.size() - 1;
+}
+
+
+// *****************************************************************************
+void SnapshotBuilder::rehash(size_t size)
+{
+    std::vector<uint32_t> table(size, 0);
+    const size_t mask = size - 1;
+    for (size_t i = 0; i < strings.size(); ++i)
+    {
+        size_t slot = hashBytes(chars.data() + strings[i].offset, strings[i].length) & mask;
+        while (table[slot])
+        {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = i + 1;
+    }
+    hashTable.swap(table);
+}
+
+
+// *****************************************************************************
+char* SnapshotBuilder::build(size_t& size) const
+{
+    PodSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.nodeCount = nodes.size();
+    header.stringCount = strings.size();
+    header.hashSize = hashTable.size();
+    header.charsSize = chars.size();
+
+    size_t offset = align8(sizeof(header));
+    header.nodesOffset = checkedSize(offset);
+    offset = align8(offset + nodes.size() * sizeof(PodSnapshotNode));
+    header.stringsOffset = checkedSize(offset);
+    offset = align8(offset + strings.size() * sizeof(PodSnapshotString));
+    header.hashOffset = checkedSize(offset);
+    offset = align8(offset + hashTable.size() * sizeof(uint32_t));
+    header.charsOffset = checkedSize(offset);
+    offset = align8(offset + chars.size());
+    header.totalSize = checkedSize(offset);
+
+    char* data = static_cast<char*>(calloc(header.totalSize, 1));
+    if (!data)
+    {
+        throw std::bad_alloc();
+    }
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + header.nodesOffset, &nodes[0], nodes.size() * sizeof(PodSnapshotNode));
+    memcpy(data + header.stringsOffset, &strings[0], strings.size() * sizeof(PodSnapshotString));
+    memcpy(data + header.hashOffset, &hashTable[0], hashTable.size() * sizeof(uint32_t));
+    memcpy(data + header.charsOffset, chars.data(), chars.size());
+
+    size = header.totalSize;
+    return data;
+}
+
+
+// *****************************************************************************
+PodSnapshot* freeze(const PodNode& node)
+{
+    SnapshotBuilder builder;
+    builder.addNode(node, PodSnapshot::NO_NODE);
+    if (node.isBlock())
+    {
+        builder.addBlock(0, node);
+    }
+
+    size_t size = 0;
+    char* data = builder.build(size);
+    return new PodSnapshot(data, size, PodSnapshot::MALLOCED);
+}
+
+
+// *****************************************************************************
+PodSnapshot::PodSnapshot(const char* data, size_t size, Storage storage)
+        : m_data(data),
+          m_mappedSize(size),
+          m_storage(storage)
+{
+    const PodSnapshotHeader* header = reinterpret_cast<const PodSnapshotHeader*>(m_data);
+    m_size = header->totalSize;
+    m_nodes = reinterpret_cast<const PodSnapshotNode*>(m_data + header->nodesOffset);
+    m_strings = reinterpret_cast<const PodSnapshotString*>(m_data + header->stringsOffset);
+    m_hashTable = reinterpret_cast<const uint32_t*>(m_data + header->hashOffset);
+    m_chars = m_data + header->charsOffset;
+    m_nodeCount = header->nodeCount;
+    m_stringCount = header->stringCount;
+    m_hashMask = header->hashSize - 1;
+}
+
+
+// *****************************************************************************
+PodSnapshot::~PodSnapshot()
+{
+    switch (m_storage)
+    {
+        case MALLOCED: free(const_cast<char*>(m_data)); break;
+        case MAPPED:   munmap(const_cast<char*>(m_data), m_mappedSize); break;
+    }
+}
+
+
+// *****************************************************************************
+static bool inBounds(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size)
+{
+    return offset % 8 == 0 && offset + count * elementSize <= size;
+}
+
+
+// *****************************************************************************
+//
+// Check that data holds a snapshot that can be read without going out of 
+// bounds or looping forever.  Returns NULL if so, or what's wrong with it.
+//
+const char* PodSnapshot::validate(const char* data, size_t size)
+{
+    if (size < sizeof(PodSnapshotHeader))
+    {
+        return "too small";
+    }
+    const PodSnapshotHeader* header = reinterpret_cast<const PodSnapshotHeader*>(data);
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0)
+    {
+        return "not a .podb file";
+    }
+    if (header->version != SNAPSHOT_VERSION)
+    {
+        return "unsupported version";
+    }
+    if (header->byteOrder != SNAPSHOT_BYTE_ORDER)
+    {
+        return "written on a machine with a different byte order";
+    }
+    if (header->totalSize > size
+        || !inBounds(header->nodesOffset, header->nodeCount, sizeof(PodSnapshotNode), header->totalSize)
+        || !inBounds(header->stringsOffset, header->stringCount, sizeof(PodSnapshotString), header->totalSize)
+        || !inBounds(header->hashOffset, header->hashSize, sizeof(uint32_t), header->totalSize)
+        || !inBounds(header->charsOffset, header->charsSize, 1, header->totalSize))
+    {
+        return "truncated";
+    }
+
+    //
+    // Strings, including the hash table, which must have at least one
+    // empty slot for lookups to end.
+    //
+    const PodSnapshotString* strings = reinterpret_cast<const PodSnapshotString*>(data + header->stringsOffset);
+    const char* chars = data + header->charsOffset;
+    const uint32_t stringCount = header->stringCount;
+    if (stringCount == 0 || strings[0].length != 0)
+    {
+        return "bad string table";
+    }
+    for (uint32_t i = 0; i < stringCount; ++i)
+    {
+        const uint64_t end = uint64_t(strings[i].offset) + strings[i].length;
+        if (end >= header->charsSize || chars[end] != '\0')
+        {
+            return "bad string table";
+        }
+    }
+    const uint32_t* hashTable = reinterpret_cast<const uint32_t*>(data + header->hashOffset);
+    if (header->hashSize <= stringCount || (header->hashSize & (header->hashSize - 1)) != 0)
+    {
+        return "bad hash table";
+    }
+    bool hasEmptySlot = false;  // Else findString() of a missing string never stops
+    for (uint32_t i = 0; i < header->hashSize; ++i)
+    {
+        if (hashTable[i] > stringCount)
+        {
+            return "bad hash table";
+        }
+        hasEmptySlot |= hashTable[i] == 0;
+    }
+    if (!hasEmptySlot)
+    {
+        return "bad hash table";
+    }
+
+    //
+    // Nodes.  Every node must come after its parent, so the nodes of a 
+    // block can't contain the block itself.
+    //
+    const PodSnapshotNode* nodes = reinterpret_cast<const PodSnapshotNode*>(data + header->nodesOffset);
+    const uint32_t nodeCount = header->nodeCount;
+    if (nodeCount == 0 || nodes[0].parent != NO_NODE)
+    {
+        return "bad root node";
+    }
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+        const PodSnapshotNode& node = nodes[i];
+        if (node.podName >= stringCount || node.podType >= stringCount
+            || (i > 0 && node.parent >= i))
+        {
+            return "bad node";
+        }
+        switch (node.valueType)
+        {
+            case PodNode::UNDEFINED:
+            case PodNode::INT:
+            case PodNode::FLOAT:
+            case PodNode::BOOL:
+                break;
+            case PodNode::STRING:
+            case PodNode::IDENTIFIER:
+                if (node.value >= stringCount) return "bad node";
+                break;
+            case PodNode::EMBED:
+                if (node.value >= stringCount || node.aux >= stringCount) return "bad node";
+                break;
+            case PodNode::BLOCK:
+                if (node.aux >= stringCount
+                    || (node.count > 0 && node.value <= i)
+                    || uint64_t(node.value) + node.count > nodeCount)
+                {
+                    return "bad node";
+                }
+                break;
+            default:
+                return "bad node";
+        }
+    }
+    return NULL;
+}
+
+
+// *****************************************************************************
+PodSnapshot* PodSnapshot::load(const std::string& filename)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+
+    try
+    {
+        PodSnapshot* snapshot = load(fd, filename);
+        close(fd);
+        return snapshot;
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+}
+
+
+// *****************************************************************************
+PodSnapshot* PodSnapshot::load(int fd, const std::string& filename)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+
+    const size_t size = st.st_size;
+    if (size == 0)
+    {
+        throw std::runtime_error(filename + ": empty file");
+    }
+    void* data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+
+    if (const char* problem = validate(static_cast<const char*>(data), size))
+    {
+        munmap(data, size);
+        throw std::runtime_error(filename + ": " + problem);
+    }
+
+    try
+    {
+        return new PodSnapshot(static_cast<const char*>(data), size, MAPPED);
+    }
+    catch (...)
+    {
+        munmap(data, size);
+        throw;
+    }
+}
+
+
+// *****************************************************************************
+void PodSnapshot::save(const std::string& filename) const
+{
+    struct iovec piece;
+    piece.iov_base = const_cast<char*>(m_data);
+    piece.iov_len = size();
+    writeFileAtomically(filename, &piece, 1);
+}
+
+
+// *****************************************************************************
+PodNodeView PodSnapshot::root() const
+{
+    return PodNodeView(this, 0);
+}
+
+
+// *****************************************************************************
+uint32_t PodSnapshot::findString(const char* text, size_t length) const
+{
+    size_t slot = hashBytes(text, length) & m_hashMask;
+    while (m_hashTable[slot])
+    {
+        const uint32_t index = m_hashTable[slot] - 1;
+        if (m_strings[index].length == length
+            && memcmp(m_chars + m_strings[index].offset, text, length) == 0)
+        {
+            return index;
+        }
+        slot = (slot + 1) & m_hashMask;
+    }
+    return NO_STRING;
+}
+
+
+// *****************************************************************************
+bool PodNodeView::isValid() const
+{
+    return valueType() != PodNode::UNDEFINED || record().podName != 0;
+}
+
+
+// *****************************************************************************
+PodNodeView PodNodeView::parent() const
+{
+    const uint32_t parent = record().parent;
+    return parent == PodSnapshot::NO_NODE ? PodNodeView() : PodNodeView(m_snapshot, parent);
+}
+
+
+// *****************************************************************************
+std::string PodNodeView::asString() const
+{
+    std::ostringstream result;
+    switch (valueType())
+    {
+        case PodNode::STRING:
+        case PodNode::IDENTIFIER:
+        case PodNode::EMBED:
+            result << asCString();
+            break;
+        case PodNode::INT:
+            result << asInt();
+            break;
+        case PodNode::FLOAT:
+            {
+                char text[FLOAT_TEXT_SIZE];
+                result.write(text, formatFloat(asFloat(), text));
+            }
+            break;
+        case PodNode::BLOCK:
+            write(result);
+            break;
+        default:
+            throw ValueTypeError(__FUNCTION__, valueType());
+    }
+    return result.str();
+}
+
+
+// *****************************************************************************
+const char* PodNodeView::asCString() const
+{
+    if (!isValueType(PodNode::STRING | PodNode::IDENTIFIER | PodNode::EMBED))
+    {
+        throw ValueTypeError(__FUNCTION__, valueType());
+    }
+    return m_snapshot->string(record().value);
+}
+
+
+// *****************************************************************************
+bool PodNodeView::asBool() const
+{
+    switch (valueType())
+    {
+        case PodNode::BOOL:  return record().value != 0;
+        case PodNode::INT:   return static_cast<bool>(asInt());
+        case PodNode::FLOAT: return static_cast<bool>(asFloat());
+        default:             break;
+    }
+    throw ValueTypeError(__FUNCTION__, valueType());
+}
+
+
+// *****************************************************************************
+int PodNodeView::asInt() const
+{
+    switch (valueType())
+    {
+        case PodNode::INT:
+            {
+                int result;
+                memcpy(&result, &record().value, sizeof(result));
+                return result;
+            }
+        case PodNode::FLOAT:
+            return static_cast<int>(asFloat());
+        case PodNode::BOOL:
+            return static_cast<int>(asBool());
+        case PodNode::STRING:
+            {
+                int result;
+                if (stringToInt(asCString(), m_snapshot->stringLength(record().value), result))
+                {
+                    return result;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    throw ValueTypeError(__FUNCTION__, valueType());
+}
+
+
+// *****************************************************************************
+float PodNodeView::asFloat() const
+{
+    switch (valueType())
+    {
+        case PodNode::FLOAT:
+            {
+                float result;
+                memcpy(&result, &record().value, sizeof(result));
+                return result;
+            }
+        case PodNode::INT:
+            return static_cast<float>(asInt());
+        case PodNode::STRING:
+            {
+                float result;
+                if (stringToFloat(asCString(), m_snapshot->stringLength(record().value), result))
+                {
+                    return result;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    throw ValueTypeError(__FUNCTION__, valueType());
+}
+
+
+// *****************************************************************************
+PodBlockView PodNodeView::asBlock() const
+{
+    if (!isBlock())
+    {
+        throw ValueTypeError(__FUNCTION__, valueType());
+    }
+    return PodBlockView(m_snapshot, record().value, record().count);
+}
+
+
+// *****************************************************************************
+const char* PodNodeView::blockScopeType() const
+{
+    if (!isBlock())
+    {
+        throw ValueTypeError(__FUNCTION__, valueType());
+    }
+    return m_snapshot->string(record().aux);
+}
+
+
+// *****************************************************************************
+PodNodeView PodNodeView::childWith(uint32_t PodSnapshotNode::* field,
+                                   const std::string& text) const
+{
+    const PodBlockView block = asBlock();
+
+    // If the text isn't in the snapshot, no node can have it
+    const uint32_t string = m_snapshot->findString(text);
+    if (string == PodSnapshot::NO_STRING)
+    {
+        return PodNodeView();
+    }
+
+    for (PodBlockView::const_iterator iter = block.begin();
+            iter != block.end(); ++iter)
+    {
+        if (m_snapshot->node((*iter).index()).*field == string)
+        {
+            return *iter;
+        }
+    }
+    return PodNodeView();
+}
+
+
+// *****************************************************************************
+PodNodeView PodNodeView::childByName(const std::string& name) const
+{
+    return childWith(&PodSnapshotNode::podName, name);
+}
+
+
+// *****************************************************************************
+PodNodeView PodNodeView::firstChildOfType(const std::string& podType) const
+{
+    return childWith(&PodSnapshotNode::podType, podType);
+}
+
+
+// *****************************************************************************
+PodNodeView PodNodeView::find(const std::string& path) const
+{
+    return PodPath(path).find(*this);
+}
+
+
+// *****************************************************************************
+const char* PodNodeView::asIdentifier() const
+{
+    if (!isIdentifier())
+    {
+        throw ValueTypeError(__FUNCTION__, valueType());
+    }
+    return m_snapshot->string(record().value);
+}
+
+
+// *****************************************************************************
+const char* PodNodeView::asEmbedScript() const
+{
+    if (!isEmbedScript())
+    {
+        throw ValueTypeError(__FUNCTION__, valueType());
+    }
+    return m_snapshot->string(record().value);
+}
+
+
+// *****************************************************************************
+const char* PodNodeView::embedScriptLanguage() const
+{
+    if (!isEmbedScript())
+    {
+        throw ValueTypeError(__FUNCTION__, valueType());
+    }
+    return m_snapshot->string(record().aux);
+}
+
+
+// *****************************************************************************
+//
+// Same as PodNode::write().  Values are written by the PodValue classes, so
+// the output is the same as for the PodNode that was frozen.
+//
+void PodNodeView::write(std::ostream& output, int indent) const
+{
+    PodWriteBuffer buffer(output);
+    write(buffer, indent);
+    buffer.flush();
+}
+
+
+// *****************************************************************************
+void PodNodeView::write(PodWriteBuffer& output, int indent) const
+{
+    if (!isValid()) return;
+
+    const PodSnapshotNode& node = record();
+    if (isBlock() && parent().isNull() && node.podName == 0 && node.podType == 0)
+    {
+        // At the top-level, don't output enclosing braces, just the
+        // nodes in the block.
+        const PodBlockView block = asBlock();
+        for (PodBlockView::const_iterator iter = block.begin();
+                iter != block.end(); ++iter)
+        {
+            (*iter).write(output, indent);
+        }
+    }
+    else
+    {
+        output.indent(indent);
+
+        if (node.podType != 0)
+        {
+            output.append(podType());
+            output.append(' ');
+        }
+        if (node.podName != 0)
+        {
+            output.append(podName());
+        }
+        if (valueType() != PodNode::UNDEFINED)
+        {
+            if (node.podName != 0) output.append(" = ", 3);
+            writeValue(output, indent);
+        }
+        output.append(";\n", 2);
+    }
+}
+
+
+// *****************************************************************************
+void PodNodeView::writeValue(PodWriteBuffer& output, int indent) const
+{
+    switch (valueType())
+    {
+        case PodNode::STRING:
+            StringPodValue(asCString()).write(output, indent);
+            break;
+        case PodNode::INT:
+            IntPodValue(asInt()).write(output, indent);
+            break;
+        case PodNode::FLOAT:
+            FloatPodValue(asFloat()).write(output, indent);
+            break;
+        case PodNode::BOOL:
+            BoolPodValue(asBool()).write(output, indent);
+            break;
+        case PodNode::IDENTIFIER:
+            IdentifierPodValue(asIdentifier()).write(output, indent);
+            break;
+        case PodNode::EMBED:
+            EmbedPodValue(asEmbedScript(), embedScriptLanguage()).write(output, indent);
+            break;
+        case PodNode::BLOCK:
+            {
+                // Same as BlockPodValue::write()
+                if (*blockScopeType())
+                {
+                    output.append(blockScopeType());
+                    output.append(' ');
+                }
+                output.append("{\n", 2);
+                const PodBlockView block = asBlock();
+                for (PodBlockView::const_iterator iter = block.begin();
+                        iter != block.end(); ++iter)
+                {
+                    (*iter).write(output, indent+1);
+                }
+                output.indent(indent);
+                output.append('}');
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+// *****************************************************************************
+PodNode* PodNodeView::thaw() const
+{
+    PodValue* value = NULL;
+    switch (valueType())
+    {
+        case PodNode::STRING:     value = new StringPodValue(asCString()); break;
+        case PodNode::INT:        value = new IntPodValue(asInt()); break;
+        case PodNode::FLOAT:      value = new FloatPodValue(asFloat()); break;
+        case PodNode::BOOL:       value = new BoolPodValue(asBool()); break;
+        case PodNode::IDENTIFIER: value = new IdentifierPodValue(asIdentifier()); break;
+        case PodNode::EMBED:
+            value = new EmbedPodValue(asEmbedScript(), embedScriptLanguage());
+            break;
+        case PodNode::BLOCK:
+            {
+                BlockPodValue* blockValue = new BlockPodValue;
+                value = blockValue;
+                try
+                {
+                    blockValue->setScopeType(blockScopeType());
+                    const PodBlockView block = asBlock();
+                    PodNodeDeque& nodes = blockValue->value();
+                    nodes.reserve(block.size());
+                    for (PodBlockView::const_iterator iter = block.begin();
+                            iter != block.end(); ++iter)
+                    {
+                        nodes.push_back((*iter).thaw());
+                    }
+                }
+                catch (...)
+                {
+                    delete blockValue;
+                    throw;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    return new PodNode(podName(), podType(), value);
+}
+
+
+// *****************************************************************************
+PodNodeView PodBlockView::at(size_t i) const
+{
+    if (i >= m_count)
+    {
+        throw std::out_of_range("PodBlockView index out of range");
+    }
+    return (*this)[i];
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,316 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODSNAPSHOT_H__
+#define __TIPPODSNAPSHOT_H__
+
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <stdint.h>
+
+#include "TipPodNode.h"
+
+namespace TipPod {
+
+class PodSnapshot;
+class PodNodeView;
+class PodBlockView;
+
+
+// *****************************************************************************
+//
+// Layout of a frozen node.  Nodes are numbered by their position in the
+// snapshot, starting with the root at 0.  The nodes of each block are
+// stored contiguously, so a block only records where they start and how
+// many there are.  Names, types and string values are indices into the
+// snapshot's table of (unique) strings.
+//
+struct PodSnapshotNode
+{
+    uint32_t podName;    // String
+    uint32_t podType;    // String
+    uint32_t valueType;  // PodNode::ValueType
+    uint32_t value;      // STRING, IDENTIFIER, EMBED: String
+                         // INT, FLOAT, BOOL: The bits of the value
+                         // BLOCK: First node in the block
+    uint32_t count;      // BLOCK: Number of nodes in the block
+    uint32_t aux;        // BLOCK: String for the scope type
+                         // EMBED: String for the language
+    uint32_t parent;     // Node, or PodSnapshot::NO_NODE for the root
+};
+
+
+struct PodSnapshotString
+{
+    uint32_t offset;     // Start of the (NUL-terminated) text
+    uint32_t length;     // Not counting the NUL
+};
+
+
+// *****************************************************************************
+//
+// A PodSnapshot is an immutable copy of a tree of PodNodes, made with
+// freeze(), and read through PodNodeViews.
+//
+// NOTES:
+//
+// * The whole snapshot is a single block of memory with no pointers in it
+//   (see PodSnapshotHeader in TipPodSnapshot.cpp), so it's compact and 
+//   quick to walk.  It's saved to disk as is, as a .podb file, and loading
+//   one just maps it into memory.
+// * Each distinct string is stored once.  Lookups by name or type first
+//   find the string in a hash table, and then only compare string indices.
+// * Nothing in a snapshot changes after it's created, so it may be read
+//   from any number of threads at once without locking.
+// * PodNodeViews refer to the snapshot, which must outlive them.
+//
+class PodSnapshot
+{
+public:
+    enum { NO_NODE = 0xffffffff, NO_STRING = 0xffffffff };
+
+    ~PodSnapshot();
+
+    // Map a .podb file, as written by save(), into memory.  The file is 
+    // checked, but nothing in it is copied or converted.  Throws on error.
+    static PodSnapshot* load(const std::string& filename);
+
+    // As above, for a file which is already open.  The snapshot must start
+    // at the beginning of the file, but may be followed by other data.  The
+    // file may be closed once this returns.
+    static PodSnapshot* load(int fd, const std::string& filename);
+
+    // Write this snapshot to a .podb file.  Throws on error.
+    void save(const std::string& filename) const;
+
+    PodNodeView root() const;
+
+    size_t nodeCount() const { return m_nodeCount; }
+    size_t stringCount() const { return m_stringCount; }
+
+    // The snapshot's memory, which is exactly what save() writes
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    // Index of the given string in this snapshot, or NO_STRING
+    uint32_t findString(const char* text, size_t length) const;
+    uint32_t findString(const std::string& text) const
+        {
+            return findString(text.data(), text.size());
+        }
+
+    // NUL-terminated text of a string in this snapshot
+    const char* string(uint32_t index) const { return m_chars + m_strings[index].offset; }
+    size_t stringLength(uint32_t index) const { return m_strings[index].length; }
+
+    const PodSnapshotNode& node(uint32_t index) const { return m_nodes[index]; }
+
+private:
+    friend PodSnapshot* freeze(const PodNode& node);
+
+    enum Storage { MALLOCED, MAPPED };
+
+    PodSnapshot(const char* data, size_t size, Storage storage);  // Takes ownership of data
+    static const char* validate(const char* data, size_t size);
+
+    PodSnapshot(const PodSnapshot&);             // Not implemented
+    PodSnapshot& operator=(const PodSnapshot&);  // Not implemented
+
+private:
+    const char* m_data;
+    size_t      m_size;        // Of the snapshot
+    size_t      m_mappedSize;  // Of m_data, which may extend past the snapshot
+    Storage     m_storage;     // How to free m_data
+
+    // Pointers into m_data
+    const PodSnapshotNode*   m_nodes;
+    const PodSnapshotString* m_strings;
+    const uint32_t*          m_hashTable;  // 1 + index of a string, or 0 if empty
+    const char*              m_chars;
+
+    uint32_t m_nodeCount;
+    uint32_t m_stringCount;
+    uint32_t m_hashMask;
+};
+
+
+// Make a snapshot of the given node and everything under it.  The result
+// is owned by the caller.
+PodSnapshot* freeze(const PodNode& node);
+
+
+// *****************************************************************************
+//
+// Read-only view of a node in a PodSnapshot, with the same accessors as
+// PodNode.  Views are small and meant to be passed by value.
+//
+// NOTES:
+//
+// * A default-constructed view, or one returned by a failed lookup, refers
+//   to no node at all, and isNull() returns true.  Other methods must not be
+//   called on it.
+// * Accessors that throw ValueTypeError for a PodNode do so here as well.
+// * Text is returned as pointers into the snapshot rather than as copies,
+//   except by asString(), which converts values of any type like
+//   PodNode::asString() does.
+//
+class PodNodeView
+{
+public:
+    PodNodeView() : m_snapshot(NULL), m_index(PodSnapshot::NO_NODE) {}
+    PodNodeView(const PodSnapshot* snapshot, uint32_t index)
+        : m_snapshot(snapshot), m_index(index) {}
+
+    bool isNull() const { return m_snapshot == NULL; }
+    bool isValid() const;
+
+    const PodSnapshot* snapshot() const { return m_snapshot; }
+    uint32_t index() const { return m_index; }
+
+    const char* podName() const { return m_snapshot->string(record().podName); }
+    const char* podType() const { return m_snapshot->string(record().podType); }
+
+    // Null if this is the root of the snapshot
+    PodNodeView parent() const;
+
+    //
+    // Getting this node's value(s)
+    //
+    PodNode::ValueType valueType() const { return PodNode::ValueType(record().valueType); }
+    bool isValueType(int type) const { return (type & record().valueType) != 0; }
+    std::string valueTypeName() const { return PodNode::valueTypeName(valueType()); }
+
+    bool isString() const { return valueType() == PodNode::STRING; }
+    std::string asString() const;
+    const char* asCString() const;  // Text of a STRING, IDENTIFIER or EMBED, throws otherwise
+
+    bool isBool() const { return valueType() == PodNode::BOOL; }
+    bool asBool() const;
+
+    bool isNumeric() const { return isValueType(PodNode::INT | PodNode::FLOAT); }
+
+    bool isInt() const { return valueType() == PodNode::INT; }
+    int asInt() const;
+
+    bool isFloat() const { return valueType() == PodNode::FLOAT; }
+    float asFloat() const;
+
+    bool isBlock() const { return valueType() == PodNode::BLOCK; }
+    PodBlockView asBlock() const;           // Throws if not a block
+    const char* blockScopeType() const;     // Throws if not a block
+    PodNodeView childByName(const std::string& name) const;      // Returns first match, null if not found
+    PodNodeView firstChildOfType(const std::string& podType) const;  // Returns first match, null if not found
+    PodNodeView find(const std::string& path) const;  // See PodPath, null if not found
+
+    bool isIdentifier() const { return valueType() == PodNode::IDENTIFIER; }
+    const char* asIdentifier() const;       // Throws if value is not an identifier
+
+    bool isEmbedScript() const { return valueType() == PodNode::EMBED; }
+    const char* asEmbedScript() const;      // Throws if value is not an embedded script
+    const char* embedScriptLanguage() const; // Throws if not an embedded script
+
+    //
+    // Serialization, identical to that of the PodNode which was frozen
+    //
+    void write(std::ostream& output, int indent=0) const;
+    void write(PodWriteBuffer& output, int indent=0) const;
+
+    // Make a new, mutable, copy of this node, owned by the caller
+    PodNode* thaw() const;
+
+private:
+    const PodSnapshotNode& record() const { return m_snapshot->node(m_index); }
+    void writeValue(PodWriteBuffer& output, int indent) const;
+    PodNodeView childWith(uint32_t PodSnapshotNode::* field, const std::string& text) const;
+
+private:
+    const PodSnapshot* m_snapshot;
+    uint32_t           m_index;
+};
+
+
+inline bool operator==(const PodNodeView& a, const PodNodeView& b)
+{
+    return a.snapshot() == b.snapshot() && a.index() == b.index();
+}
+
+
+inline bool operator!=(const PodNodeView& a, const PodNodeView& b)
+{
+    return !(a == b);
+}
+
+
+// *****************************************************************************
+//
+// The nodes of a block in a PodSnapshot, as returned by PodNodeView::asBlock()
+//
+class PodBlockView
+{
+public:
+    class const_iterator
+    {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef PodNodeView                     value_type;
+        typedef ptrdiff_t                       difference_type;
+        typedef const PodNodeView*              pointer;
+        typedef PodNodeView                     reference;
+
+        const_iterator() : m_snapshot(NULL), m_index(0) {}
+        const_iterator(const PodSnapshot* snapshot, uint32_t index)
+            : m_snapshot(snapshot), m_index(index) {}
+
+        PodNodeView operator*() const { return PodNodeView(m_snapshot, m_index); }
+        PodNodeView operator[](difference_type n) const { return PodNodeView(m_snapshot, m_index + n); }
+
+        const_iterator& operator++() { ++m_index; return *this; }
+        const_iterator operator++(int) { const_iterator tmp(*this); ++m_index; return tmp; }
+        const_iterator& operator--() { --m_index; return *this; }
+        const_iterator operator--(int) { const_iterator tmp(*this); --m_index; return tmp; }
+        const_iterator& operator+=(difference_type n) { m_index += n; return *this; }
+        const_iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return const_iterator(m_snapshot, m_index + n); }
+        const_iterator operator-(difference_type n) const { return const_iterator(m_snapshot, m_index - n); }
+        difference_type operator-(const const_iterator& other) const
+            {
+                return difference_type(m_index) - difference_type(other.m_index);
+            }
+
+        bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+        bool operator<(const const_iterator& other) const { return m_index < other.m_index; }
+
+    private:
+        const PodSnapshot* m_snapshot;
+        uint32_t           m_index;
+    };
+    typedef const_iterator iterator;
+
+    PodBlockView() : m_snapshot(NULL), m_first(0), m_count(0) {}
+    PodBlockView(const PodSnapshot* snapshot, uint32_t first, uint32_t count)
+        : m_snapshot(snapshot), m_first(first), m_count(count) {}
+
+    const_iterator begin() const { return const_iterator(m_snapshot, m_first); }
+    const_iterator end() const { return const_iterator(m_snapshot, m_first + m_count); }
+
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    PodNodeView operator[](size_t i) const { return PodNodeView(m_snapshot, m_first + i); }
+    PodNodeView at(size_t i) const;  // Throws std::out_of_range
+
+private:
+    const PodSnapshot* m_snapshot;
+    uint32_t           m_first;
+    uint32_t           m_count;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODSNAPSHOT_H__
@@ -0,0 +1,75 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include "TipPodSnapshotIndex.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+PodSnapshotIndex::PodSnapshotIndex(const PodSnapshot& snapshot)
+        : m_snapshot(snapshot),
+          m_typeStarts(),
+          m_byType(),
+          m_nameStarts(),
+          m_byName()
+{
+    build(snapshot, &PodSnapshotNode::podType, m_typeStarts, m_byType);
+    build(snapshot, &PodSnapshotNode::podName, m_nameStarts, m_byName);
+}
+
+
+// *****************************************************************************
+size_t PodSnapshotIndex::memoryUsage() const
+{
+    return sizeof(*this)
+           + (m_typeStarts.capacity() + m_byType.capacity()
+              + m_nameStarts.capacity() + m_byName.capacity()) * sizeof(uint32_t);
+}
+
+
+// *****************************************************************************
+PodSnapshotIndex::Range PodSnapshotIndex::range(const std::vector<uint32_t>& starts,
+                                                const std::vector<uint32_t>& nodes,
+                                                uint32_t string) const
+{
+    if (string + 1 >= starts.size() || nodes.empty())
+    {
+        return Range(NULL, NULL);
+    }
+    const uint32_t* data = &nodes[0];
+    return Range(data + starts[string], data + starts[string + 1]);
+}
+
+
+// *****************************************************************************
+//
+// Count the nodes with each string, then place each node after those
+// before it with the same string.
+//
+void PodSnapshotIndex::build(const PodSnapshot& snapshot, uint32_t PodSnapshotNode::* field,
+                             std::vector<uint32_t>& starts, std::vector<uint32_t>& nodes)
+{
+    const uint32_t root = snapshot.root().index();
+    starts.assign(snapshot.stringCount() + 1, 0);
+    for (uint32_t i = 0; i < snapshot.nodeCount(); ++i)
+    {
+        if (i != root) ++starts[snapshot.node(i).*field + 1];
+    }
+    for (size_t i = 1; i < starts.size(); ++i)
+    {
+        starts[i] += starts[i - 1];
+    }
+
+    nodes.resize(starts.back());
+    std::vector<uint32_t> next(starts.begin(), starts.end() - 1);
+    for (uint32_t i = 0; i < snapshot.nodeCount(); ++i)
+    {
+        if (i != root) nodes[next[snapshot.node(i).*field]++] = i;
+    }
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,81 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODSNAPSHOTINDEX_H__
+#define __TIPPODSNAPSHOTINDEX_H__
+
+#include <vector>
+#include <stdint.h>
+
+#include "TipPodSnapshot.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Every node in a PodSnapshot, listed by podType and by podName, so that
+// finding all the nodes of a type or with a name anywhere in a large pod
+// doesn't mean walking all of it.
+//
+// NOTES:
+//
+// * Built in one pass over the snapshot, which must outlive the index.
+// * Snapshots never change, so neither does the index, and it may be read
+//   from any number of threads.
+// * Nodes are listed in the order they're stored in the snapshot, which is
+//   not quite document order.  The root isn't listed.
+//
+class PodSnapshotIndex
+{
+public:
+    explicit PodSnapshotIndex(const PodSnapshot& snapshot);
+
+    const PodSnapshot& snapshot() const { return m_snapshot; }
+
+    // A range of node indexes in the snapshot, empty if there are none.
+    // The string is a string index (see PodSnapshot::findString()).
+    class Range
+    {
+    public:
+        Range(const uint32_t* begin, const uint32_t* end) : m_begin(begin), m_end(end) {}
+        const uint32_t* begin() const { return m_begin; }
+        const uint32_t* end() const { return m_end; }
+        size_t size() const { return m_end - m_begin; }
+        bool empty() const { return m_begin == m_end; }
+    private:
+        const uint32_t* m_begin;
+        const uint32_t* m_end;
+    };
+
+    Range byType(uint32_t podType) const { return range(m_typeStarts, m_byType, podType); }
+    Range byName(uint32_t podName) const { return range(m_nameStarts, m_byName, podName); }
+
+    size_t memoryUsage() const;
+
+private:
+    Range range(const std::vector<uint32_t>& starts, const std::vector<uint32_t>& nodes,
+                uint32_t string) const;
+    static void build(const PodSnapshot& snapshot, uint32_t PodSnapshotNode::* field,
+                      std::vector<uint32_t>& starts, std::vector<uint32_t>& nodes);
+
+    PodSnapshotIndex(const PodSnapshotIndex&);             // Not implemented
+    PodSnapshotIndex& operator=(const PodSnapshotIndex&);  // Not implemented
+
+private:
+    const PodSnapshot& m_snapshot;
+
+    // The nodes with string i are nodes[starts[i]] up to nodes[starts[i + 1]]
+    std::vector<uint32_t> m_typeStarts;
+    std::vector<uint32_t> m_byType;
+    std::vector<uint32_t> m_nameStarts;
+    std::vector<uint32_t> m_byName;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODSNAPSHOTINDEX_H__
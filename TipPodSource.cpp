@@ -0,0 +1,153 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "TipPodSource.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+PodSource::PodSource(const std::string& name, size_t size)
+        : m_name(name),
+          m_data(NULL),
+          m_size(size),
+          m_refCount(1)
+{
+    m_data = static_cast<char*>(std::malloc(m_size + 2));
+    if (!m_data)
+    {
+        throw std::bad_alloc();
+    }
+    m_data[m_size] = '\0';
+    m_data[m_size + 1] = '\0';
+}
+
+
+// *****************************************************************************
+PodSource::~PodSource()
+{
+    std::free(m_data);
+    m_data = NULL;
+}
+
+
+// *****************************************************************************
+PodSource* PodSource::fromFile(const std::string& filename)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error(strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        const int err = errno;
+        close(fd);
+        throw std::runtime_error(strerror(err));
+    }
+
+    PodSource* source = NULL;
+    try
+    {
+        source = new PodSource(filename, st.st_size);
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+
+    //
+    // Read the whole file in one go.  We deliberately don't mmap() here:
+    // flex writes into the buffer while scanning, and needs two NULs past
+    // the end of the text.
+    //
+    size_t total = 0;
+    while (total < source->m_size)
+    {
+        const ssize_t n = read(fd, source->m_data + total, source->m_size - total);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            const int err = n < 0 ? errno : EIO;
+            close(fd);
+            source->unref();
+            throw std::runtime_error(strerror(err));
+        }
+        total += n;
+    }
+    close(fd);
+
+    return source;
+}
+
+
+// *****************************************************************************
+PodSource* PodSource::fromText(const std::string& text, const std::string& name)
+{
+    PodSource* source = new PodSource(name, text.size());
+    memcpy(source->m_data, text.data(), text.size());
+    return source;
+}
+
+
+// *****************************************************************************
+void PodSource::ref() const
+{
+    __sync_add_and_fetch(&m_refCount, 1);
+}
+
+
+// *****************************************************************************
+void PodSource::unref() const
+{
+    if (__sync_sub_and_fetch(&m_refCount, 1) == 0)
+    {
+        delete this;
+    }
+}
+
+
+// *****************************************************************************
+PodNodeFormat::PodNodeFormat(PodSource* source)
+        : source(source),
+          begin(NULL),
+          start(NULL),
+          valueBegin(NULL),
+          open(NULL),
+          tailBegin(NULL),
+          valueEnd(NULL),
+          end(NULL),
+          whole(false),
+          edited(false),
+          renamed(false),
+          valueChanged(false)
+{
+    source->ref();
+}
+
+
+// *****************************************************************************
+PodNodeFormat::~PodNodeFormat()
+{
+    source->unref();
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,119 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODSOURCE_H__
+#define __TIPPODSOURCE_H__
+
+#include <string>
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Instances of this class hold the complete text of a Pod file (or string)
+// in one contiguous buffer, which the lexer scans in place.
+//
+// NOTES:
+//
+// * Values created in zero-copy mode (see TipPod::PARSE_ZERO_COPY) refer to
+//   spans of this buffer rather than holding their own copies of the text.
+//   Each of them holds a reference, so the buffer lives exactly as long as
+//   the last value that needs it.
+// * Instances are reference counted and must be created with fromFile() or
+//   fromText(), and released with unref() rather than deleted.
+//
+class PodSource
+{
+public:
+    static PodSource* fromFile(const std::string& filename);  // Throws on error
+    static PodSource* fromText(const std::string& text, const std::string& name="");
+
+    const std::string& name() const { return m_name; }  // File name, may be empty
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }  // Excludes the trailing NULs
+    bool contains(const char* text) const { return text >= m_data && text < m_data + m_size; }
+
+    // Buffer with the two trailing NULs flex requires for yy_scan_buffer().
+    char* scanBuffer() { return m_data; }
+    size_t scanBufferSize() const { return m_size + 2; }
+
+    void ref() const;
+    void unref() const;  // Deletes this once the last reference is released
+
+private:
+    PodSource(const std::string& name, size_t size);
+    ~PodSource();
+
+    // Not copyable
+    PodSource(const PodSource&);
+    PodSource& operator=(const PodSource&);
+
+private:
+    std::string  m_name;
+    char*        m_data;
+    size_t       m_size;
+    mutable int  m_refCount;
+};
+
+
+// *****************************************************************************
+//
+// Where the text of a node parsed with TipPod::PARSE_KEEP_FORMAT is in its
+// source, so that write() can copy what hasn't changed since.  Each part
+// runs up to the next:
+//
+//     begin       Comments and spaces after the node before it, or the '{'
+//     start       First token, "type name = "
+//     valueBegin  Value.  For a block, "scopeType {" up to 'open', then its
+//                 nodes, then the text from 'tailBegin' up to and including
+//                 the '}'
+//     valueEnd    Up to and including the ';'
+//     end
+//
+// NOTES:
+//
+// * valueBegin and valueEnd are NULL if the node had no value, and open
+//   and tailBegin unless it was a block.
+// * The root node from parseSource() has one for the whole text; its
+//   nodes start at 'open' and 'tailBegin' is after the last one.
+// * Holds a reference to the source.
+//
+struct PodNodeFormat
+{
+    explicit PodNodeFormat(PodSource* source);
+    ~PodNodeFormat();
+
+    PodSource*  source;
+    const char* begin;
+    const char* start;
+    const char* valueBegin;
+    const char* open;
+    const char* tailBegin;
+    const char* valueEnd;
+    const char* end;
+    bool        whole;         // Root node, for the whole source
+    bool        edited;        // Anything changed since, here or under it
+    bool        renamed;       // podName or podType set since
+    bool        valueChanged;  // Value replaced since; not set by syncBlock()
+
+private:
+    // Not copyable
+    PodNodeFormat(const PodNodeFormat&);
+    PodNodeFormat& operator=(const PodNodeFormat&);
+};
+
+
+// Parse the text held by 'source', scanning it in place.  Takes TipPod::ParseFlags.
+// Throws on error.
+class PodNode;
+PodNode* parseSource(PodSource* source, int flags);
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODSOURCE_H__
@@ -0,0 +1,78 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <stdexcept>
+
+#include "TipPodSourcePodValue.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Specializations for SourcePodValue::decode()
+//
+template <>
+void SourcePodValue<std::string, PodNode::STRING>::decode() const
+{
+    std::string& result = const_cast<std::string&>(m_value);
+    if (m_escaped)
+    {
+        unescapeString(m_text, m_length, result);
+    }
+    else
+    {
+        result.assign(m_text, m_length);
+    }
+}
+
+
+template <>
+void SourcePodValue<std::string, PodNode::IDENTIFIER>::decode() const
+{
+    const_cast<std::string&>(m_value).assign(m_text, m_length);
+}
+
+
+template <>
+void SourcePodValue<int, PodNode::INT>::decode() const
+{
+    if (!stringToInt(m_text, m_length, const_cast<int&>(m_value)))
+    {
+        throw std::runtime_error("Out of range value: " + std::string(m_text, m_length));
+    }
+}
+
+
+template <>
+void SourcePodValue<float, PodNode::FLOAT>::decode() const
+{
+    if (!stringToFloat(m_text, m_length, const_cast<float&>(m_value)))
+    {
+        throw std::runtime_error("Out of range value: " + std::string(m_text, m_length));
+    }
+}
+
+
+// *****************************************************************************
+//
+// Specializations for SourcePodValue::write()
+//
+template <>
+void SourcePodValue<int, PodNode::INT>::write(PodWriteBuffer& output, int indent) const
+{
+    output.append(m_text, m_length);
+}
+
+
+template <>
+void SourcePodValue<float, PodNode::FLOAT>::write(PodWriteBuffer& output, int indent) const
+{
+    output.append(m_text, m_length);
+}
+
+
+}  //  End namespace TipPod
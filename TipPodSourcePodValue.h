@@ -0,0 +1,100 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODSOURCEPODVALUE_H__
+#define __TIPPODSOURCEPODVALUE_H__
+
+#include <string>
+
+#include "TipPodValue.h"
+#include "TipPodSource.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// A typed value whose text is a span of a PodSource buffer, as created when
+// parsing in zero-copy or lazy scalar mode.  The text is only decoded into a
+// ValueType (escape sequences expanded, numbers converted) the first time 
+// value() is called.
+//
+// NOTES:
+//
+// * Behaves exactly like the TypedPodValue it derives from, including for
+//   dynamic_cast and type().
+// * Holds a reference to the PodSource, so the buffer stays alive as long as
+//   this value does.
+// * Decoding happens in const methods, so a node must not be read from
+//   several threads at once until its value has been decoded.
+// * copy() returns a plain TypedPodValue holding the decoded value.
+//
+template<typename ValueType, PodNode::ValueType SemanticType>
+class SourcePodValue : public TypedPodValue<ValueType, SemanticType>
+{
+public:
+    SourcePodValue(const PodSource* source, const char* text, size_t length, bool escaped=false)
+        : TypedPodValue<ValueType, SemanticType>(),
+          m_source(source), m_text(text), m_length(length),
+          m_escaped(escaped), m_decoded(false)
+        {
+            m_source->ref();
+        }
+    virtual ~SourcePodValue() { m_source->unref(); }
+
+    virtual const ValueType& value() const
+        {
+            if (!m_decoded)
+            {
+                decode();
+                m_decoded = true;
+            }
+            return this->m_value;
+        }
+
+    using PodValue::write;
+    virtual void write(PodWriteBuffer& output, int indent=0) const
+        {
+            value();
+            TypedPodValue<ValueType, SemanticType>::write(output, indent);
+        }
+
+    virtual PodValue* copy() const
+        {
+            return new TypedPodValue<ValueType, SemanticType>(value());
+        }
+
+protected:
+    void decode() const;  // Fills in m_value from the source text
+
+protected:
+    const PodSource* m_source;  // Buffer holding the text of this value
+    const char*      m_text;    // Start of the text, within m_source
+    size_t           m_length;
+    bool             m_escaped; // Text contains escape sequences to be decoded
+    mutable bool     m_decoded; // m_value has been filled in
+};
+
+
+template <> void SourcePodValue<std::string, PodNode::STRING>::decode() const;
+template <> void SourcePodValue<std::string, PodNode::IDENTIFIER>::decode() const;
+template <> void SourcePodValue<int, PodNode::INT>::decode() const;     // Throws if out of range
+template <> void SourcePodValue<float, PodNode::FLOAT>::decode() const; // Throws if out of range
+
+// Numbers are written exactly as they appeared in the source.
+template <> void SourcePodValue<int, PodNode::INT>::write(PodWriteBuffer& output, int indent) const;
+template <> void SourcePodValue<float, PodNode::FLOAT>::write(PodWriteBuffer& output, int indent) const;
+
+
+typedef SourcePodValue<std::string, PodNode::STRING>     SourceStringPodValue;
+typedef SourcePodValue<std::string, PodNode::IDENTIFIER> SourceIdentifierPodValue;
+typedef SourcePodValue<int, PodNode::INT>                SourceIntPodValue;
+typedef SourcePodValue<float, PodNode::FLOAT>            SourceFloatPodValue;
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODSOURCEPODVALUE_H__
@@ -4,9 +4,14 @@
 //******************************************************************************
 
 #include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
 #include <limits>
+#include <stdexcept>
 #include <sstream>
 #include <cstdlib>
+#include <cstring>
 
 #include "TipPodUtils.h"
 
@@ -14,33 +19,39 @@ namespace TipPod {
 
 
 // *****************************************************************************
-bool stringToFloat(const std::string& str, float& result)
+//
+// Conversions of NUL-terminated text of the given length.
+//
+static bool cstringToFloat(const char* str, size_t length, float& result)
 {
-    if (str.empty()) return false;
+    if (length == 0) return false;
 
     char* endPtr = 0;
     errno = 0;
 
-    result = std::strtof(str.c_str(), &endPtr);
-    if (errno == ERANGE)
+    // strtof() also sets ERANGE for subnormals, which are exact enough to
+    // keep (and formatFloat() writes them); only overflow and underflow to
+    // zero are out of range
+    result = std::strtof(str, &endPtr);
+    if (errno == ERANGE && (result == 0.0f || result > std::numeric_limits<float>::max()
+                            || result < -std::numeric_limits<float>::max()))
     {
         return false;
     }
 
-    return endPtr == str.c_str() + str.size(); // ensure the whole string was parsed
+    return endPtr == str + length; // ensure the whole string was parsed
 }
 
 
-// *****************************************************************************
-bool stringToInt(const std::string& str, int& result)
+static bool cstringToInt(const char* str, size_t length, int& result)
 {
-    if (str.empty()) return false;
+    if (length == 0) return false;
 
     char* endPtr = 0;
     errno = 0;
 
     const int base = 0; // "auto"; 0xNNN=16, 0NNN=8, NNN=10
-    const long longval = std::strtol(str.c_str(), &endPtr, base);
+    const long longval = std::strtol(str, &endPtr, base);
     if (errno == ERANGE)
     {
         return false;
@@ -52,7 +63,375 @@ bool stringToInt(const std::string& str, int& result)
     }
 
     result = static_cast<int>(longval);
-    return endPtr == str.c_str() + str.size(); // ensure the whole string was parsed
+    return endPtr == str + length; // ensure the whole string was parsed
+}
+
+
+// *****************************************************************************
+bool stringToFloat(const std::string& str, float& result)
+{
+    return cstringToFloat(str.c_str(), str.size(), result);
+}
+
+
+// *****************************************************************************
+bool stringToInt(const std::string& str, int& result)
+{
+    return cstringToInt(str.c_str(), str.size(), result);
+}
+
+
+// *****************************************************************************
+//
+// Numeric lexemes are short, so these copy the text to a NUL-terminated
+// buffer on the stack rather than into a std::string.
+//
+bool stringToFloat(const char* text, size_t length, float& result)
+{
+    char buffer[64];
+    if (length >= sizeof(buffer))
+    {
+        return stringToFloat(std::string(text, length), result);
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return cstringToFloat(buffer, length, result);
+}
+
+
+bool stringToInt(const char* text, size_t length, int& result)
+{
+    char buffer[64];
+    if (length >= sizeof(buffer))
+    {
+        return stringToInt(std::string(text, length), result);
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return cstringToInt(buffer, length, result);
+}
+
+
+// *****************************************************************************
+//
+// formatFloat() finds the shortest decimal that reads back as the same float
+// with the Ryu algorithm (Ulf Adams, "Ryu: Fast Float-to-String Conversion",
+// PLDI 2018), specialized for 32-bit floats: the interval of reals that
+// round to the float is scaled by a power of ten using 64-bit fixed-point
+// powers of five, and digits are dropped while both ends stay distinct.
+//
+static const int FLOAT_MANTISSA_BITS = 23;
+static const int FLOAT_BIAS = 127;
+static const int FLOAT_POW5_INV_BITCOUNT = 59;
+static const int FLOAT_POW5_BITCOUNT = 61;
+
+// floor(2^(pow5bits(i) - 1 + 59) / 5^i) + 1
+static const uint64_t FLOAT_POW5_INV_SPLIT[31] = {
+    576460752303423489ULL, 461168601842738791ULL, 368934881474191033ULL,
+    295147905179352826ULL, 472236648286964522ULL, 377789318629571618ULL,
+    302231454903657294ULL, 483570327845851670ULL, 386856262276681336ULL,
+    309485009821345069ULL, 495176015714152110ULL, 396140812571321688ULL,
+    316912650057057351ULL, 507060240091291761ULL, 405648192073033409ULL,
+    324518553658426727ULL, 519229685853482763ULL, 415383748682786211ULL,
+    332306998946228969ULL, 531691198313966350ULL, 425352958651173080ULL,
+    340282366920938464ULL, 544451787073501542ULL, 435561429658801234ULL,
+    348449143727040987ULL, 557518629963265579ULL, 446014903970612463ULL,
+    356811923176489971ULL, 570899077082383953ULL, 456719261665907162ULL,
+    365375409332725730ULL
+};
+
+// The top 61 bits of 5^i
+static const uint64_t FLOAT_POW5_SPLIT[48] = {
+    1152921504606846976ULL, 1441151880758558720ULL, 1801439850948198400ULL,
+    2251799813685248000ULL, 1407374883553280000ULL, 1759218604441600000ULL,
+    2199023255552000000ULL, 1374389534720000000ULL, 1717986918400000000ULL,
+    2147483648000000000ULL, 1342177280000000000ULL, 1677721600000000000ULL,
+    2097152000000000000ULL, 1310720000000000000ULL, 1638400000000000000ULL,
+    2048000000000000000ULL, 1280000000000000000ULL, 1600000000000000000ULL,
+    2000000000000000000ULL, 1250000000000000000ULL, 1562500000000000000ULL,
+    1953125000000000000ULL, 1220703125000000000ULL, 1525878906250000000ULL,
+    1907348632812500000ULL, 1192092895507812500ULL, 1490116119384765625ULL,
+    1862645149230957031ULL, 1164153218269348144ULL, 1455191522836685180ULL,
+    1818989403545856475ULL, 2273736754432320594ULL, 1421085471520200371ULL,
+    1776356839400250464ULL, 2220446049250313080ULL, 1387778780781445675ULL,
+    1734723475976807094ULL, 2168404344971008868ULL, 1355252715606880542ULL,
+    1694065894508600678ULL, 2117582368135750847ULL, 1323488980084844279ULL,
+    1654361225106055349ULL, 2067951531382569187ULL, 1292469707114105741ULL,
+    1615587133892632177ULL, 2019483917365790221ULL, 1262177448353618888ULL
+};
+
+
+// *****************************************************************************
+static inline int pow5bits(int e)  // ceil(log2(5^e)), or 1 if e is 0
+{
+    return int((uint32_t(e) * 1217359) >> 19) + 1;
+}
+
+
+static inline uint32_t log10Pow2(int e)  // floor(log10(2^e))
+{
+    return (uint32_t(e) * 78913) >> 18;
+}
+
+
+static inline uint32_t log10Pow5(int e)  // floor(log10(5^e))
+{
+    return (uint32_t(e) * 732923) >> 20;
+}
+
+
+static inline bool multipleOfPowerOf5(uint32_t value, uint32_t p)
+{
+    uint32_t count = 0;
+    for (; value % 5 == 0; value /= 5) ++count;
+    return count >= p;
+}
+
+
+static inline bool multipleOfPowerOf2(uint32_t value, uint32_t p)
+{
+    return (value & ((1u << p) - 1)) == 0;
+}
+
+
+static inline uint32_t mulShift(uint32_t m, uint64_t factor, int shift)  // shift > 32
+{
+    const uint64_t low = uint64_t(m) * uint32_t(factor);
+    const uint64_t high = uint64_t(m) * uint32_t(factor >> 32);
+    return uint32_t(((low >> 32) + high) >> (shift - 32));
+}
+
+
+// *****************************************************************************
+//
+// The shortest digits which read back as the float with the given bits
+// (sign aside), as digits * 10^exponent
+//
+static void shortestDigits(uint32_t ieeeMantissa, uint32_t ieeeExponent,
+                           uint32_t& digits, int& exponent)
+{
+    int e2;
+    uint32_t m2;
+    if (ieeeExponent == 0)
+    {
+        e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+        m2 = ieeeMantissa;
+    }
+    else
+    {
+        e2 = int(ieeeExponent) - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+        m2 = (1u << FLOAT_MANTISSA_BITS) | ieeeMantissa;
+    }
+    const bool acceptBounds = (m2 & 1) == 0;  // Ties read back to even mantissas
+
+    // The float, and halfway to its neighbours, all times 4
+    const uint32_t mv = 4 * m2;
+    const uint32_t mp = 4 * m2 + 2;
+    const uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+    const uint32_t mm = 4 * m2 - 1 - mmShift;
+
+    // Scale them by a power of ten
+    uint32_t vr, vp, vm;
+    int e10;
+    bool vmIsTrailingZeros = false, vrIsTrailingZeros = false;
+    uint32_t lastRemovedDigit = 0;
+    if (e2 >= 0)
+    {
+        const uint32_t q = log10Pow2(e2);
+        e10 = int(q);
+        const int k = FLOAT_POW5_INV_BITCOUNT + pow5bits(q) - 1;
+        const int i = -e2 + int(q) + k;
+        vr = mulShift(mv, FLOAT_POW5_INV_SPLIT[q], i);
+        vp = mulShift(mp, FLOAT_POW5_INV_SPLIT[q], i);
+        vm = mulShift(mm, FLOAT_POW5_INV_SPLIT[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10)
+        {
+            // The loop below won't remove a digit, so work out the last one
+            // removed here
+            const int l = FLOAT_POW5_INV_BITCOUNT + pow5bits(q - 1) - 1;
+            lastRemovedDigit = mulShift(mv, FLOAT_POW5_INV_SPLIT[q - 1], -e2 + int(q) - 1 + l) % 10;
+        }
+        if (q <= 9)
+        {
+            // Only one of mp, mv and mm can be a multiple of 5, if any
+            if (mv % 5 == 0)
+            {
+                vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+            }
+            else if (acceptBounds)
+            {
+                vmIsTrailingZeros = multipleOfPowerOf5(mm, q);
+            }
+            else
+            {
+                vp -= multipleOfPowerOf5(mp, q);
+            }
+        }
+    }
+    else
+    {
+        const uint32_t q = log10Pow5(-e2);
+        e10 = int(q) + e2;
+        const int i = -e2 - int(q);
+        const int k = pow5bits(i) - FLOAT_POW5_BITCOUNT;
+        int j = int(q) - k;
+        vr = mulShift(mv, FLOAT_POW5_SPLIT[i], j);
+        vp = mulShift(mp, FLOAT_POW5_SPLIT[i], j);
+        vm = mulShift(mm, FLOAT_POW5_SPLIT[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10)
+        {
+            j = int(q) - 1 - (pow5bits(i + 1) - FLOAT_POW5_BITCOUNT);
+            lastRemovedDigit = mulShift(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10;
+        }
+        if (q <= 1)
+        {
+            // mv = 4 * m2 has at least q trailing zero bits, so vr has q
+            // trailing zero digits; mm has one iff mmShift is 1
+            vrIsTrailingZeros = true;
+            if (acceptBounds)
+            {
+                vmIsTrailingZeros = mmShift == 1;
+            }
+            else
+            {
+                --vp;
+            }
+        }
+        else if (q < 31)
+        {
+            vrIsTrailingZeros = multipleOfPowerOf2(mv, q - 1);
+        }
+    }
+
+    // Drop digits while the interval still holds a shorter number
+    int removed = 0;
+    if (vmIsTrailingZeros || vrIsTrailingZeros)
+    {
+        while (vp / 10 > vm / 10)
+        {
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        if (vmIsTrailingZeros)
+        {
+            while (vm % 10 == 0)
+            {
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+        }
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+        {
+            lastRemovedDigit = 4;  // Exactly halfway: round to even
+        }
+        digits = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros))
+                       || lastRemovedDigit >= 5);
+    }
+    else
+    {
+        while (vp / 10 > vm / 10)
+        {
+            lastRemovedDigit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        digits = vr + (vr == vm || lastRemovedDigit >= 5);
+    }
+    exponent = e10 + removed;
+}
+
+
+// *****************************************************************************
+size_t formatFloat(float value, char* text)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t ieeeMantissa = bits & ((1u << FLOAT_MANTISSA_BITS) - 1);
+    const uint32_t ieeeExponent = (bits >> FLOAT_MANTISSA_BITS) & 0xff;
+
+    char* out = text;
+    if (ieeeExponent == 0xff)
+    {
+        const char* special = ieeeMantissa ? "nan" : (bits >> 31) ? "-inf" : "inf";
+        const size_t length = strlen(special);
+        memcpy(text, special, length);
+        return length;
+    }
+    if (bits >> 31) *out++ = '-';
+    if (ieeeExponent == 0 && ieeeMantissa == 0)
+    {
+        memcpy(out, "0.0", 3);
+        return out + 3 - text;
+    }
+
+    uint32_t digits;
+    int exponent;
+    shortestDigits(ieeeMantissa, ieeeExponent, digits, exponent);
+
+    char buffer[10];
+    int count = 0;
+    for (; digits; digits /= 10) buffer[9 - count++] = char('0' + digits % 10);
+    const char* first = buffer + 10 - count;
+    const int point = count + exponent;  // Digits before the decimal point
+
+    // Like printf's "%g": fixed unless the first digit is more than four
+    // places after the point, or would be past the ninth before it
+    if (point > -4 && point <= 9)
+    {
+        if (point <= 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = point; i < 0; ++i) *out++ = '0';
+            memcpy(out, first, count);
+            out += count;
+        }
+        else if (point >= count)
+        {
+            memcpy(out, first, count);
+            out += count;
+            for (int i = count; i < point; ++i) *out++ = '0';
+            *out++ = '.';
+            *out++ = '0';
+        }
+        else
+        {
+            memcpy(out, first, point);
+            out += point;
+            *out++ = '.';
+            memcpy(out, first + point, count - point);
+            out += count - point;
+        }
+    }
+    else
+    {
+        *out++ = first[0];
+        if (count > 1)
+        {
+            *out++ = '.';
+            memcpy(out, first + 1, count - 1);
+            out += count - 1;
+        }
+        int scientific = point - 1;
+        *out++ = 'e';
+        *out++ = scientific < 0 ? '-' : '+';
+        if (scientific < 0) scientific = -scientific;
+        if (scientific >= 10) *out++ = char('0' + scientific / 10);
+        else *out++ = '0';
+        *out++ = char('0' + scientific % 10);
+    }
+    return out - text;
 }
 
 
@@ -70,6 +449,245 @@ std::vector<std::string> splitlines(const std::string &s)
 }
 
 
+// *****************************************************************************
+void unescapeString(const char* text, size_t length, std::string& result)
+{
+    //
+    // This must stay in sync with the <STRING> rules in lexer.l.  Anything 
+    // that isn't one of the recognized escapes is taken literally, including
+    // a backslash followed by some other character.
+    //
+    result.reserve(result.size() + length);
+    const char* end = text + length;
+    while (text < end)
+    {
+        const char c = *text++;
+        if (c == '\\' && text < end)
+        {
+            switch (*text)
+            {
+                case 'b':  result.push_back('\b');  ++text; continue;
+                case 't':  result.push_back('\t');  ++text; continue;
+                case 'n':  result.push_back('\n');  ++text; continue;
+                case 'f':  result.push_back('\f');  ++text; continue;
+                case 'r':  result.push_back('\r');  ++text; continue;
+                case '"':  result.push_back('"');   ++text; continue;
+                case '\\': result.push_back('\\');  ++text; continue;
+            }
+        }
+        else if (c == '\r' && text < end && *text == '\n')
+        {
+            // {NewLine} inside a string is always stored as a bare '\n'
+            result.push_back('\n');
+            ++text;
+            continue;
+        }
+        result.push_back(c);
+    }
+}
+
+
+// *****************************************************************************
+char escapeCode(char c)
+{
+    // This must stay the inverse of unescapeString()
+    switch (c)
+    {
+        case '\b': return 'b';
+        case '\t': return 't';
+        case '\n': return 'n';
+        case '\f': return 'f';
+        case '\r': return 'r';
+        case '"':  return '"';
+        case '\\': return '\\';
+    }
+    return '\0';
+}
+
+
+// *****************************************************************************
+//
+// Whether any of eight characters might be escaped: a control character,
+// a quote or a backslash.  Each test sets the top bit of a byte where it
+// matches, as in "Bit Twiddling Hacks" (Sean Eron Anderson).
+//
+static inline bool mayEscape(uint64_t word)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t quotes = word ^ (ones * '"');
+    const uint64_t backslashes = word ^ (ones * '\\');
+    return (((word - ones * 0x20) & ~word)
+            | ((quotes - ones) & ~quotes)
+            | ((backslashes - ones) & ~backslashes))
+           & (ones * 0x80);
+}
+
+
+// *****************************************************************************
+static inline char* escapeChar(char c, char* result)
+{
+    const char code = escapeCode(c);
+    if (code)
+    {
+        *result++ = '\\';
+        *result++ = code;
+    }
+    else
+    {
+        *result++ = c;
+    }
+    return result;
+}
+
+
+// *****************************************************************************
+size_t escapeString(const char* text, size_t length, char* result)
+{
+    char* out = result;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, text + i, sizeof(word));
+        if (mayEscape(word))
+        {
+            for (size_t j = i; j < i + 8; ++j) out = escapeChar(text[j], out);
+        }
+        else
+        {
+            memcpy(out, &word, sizeof(word));
+            out += sizeof(word);
+        }
+    }
+    for (; i < length; ++i)
+    {
+        out = escapeChar(text[i], out);
+    }
+    return out - result;
+}
+
+
+// *****************************************************************************
+size_t plainLength(const char* text, size_t length)
+{
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, text + i, sizeof(word));
+        if (mayEscape(word)) break;
+    }
+    for (; i < length; ++i)
+    {
+        const unsigned char c = text[i];
+        if (c < 0x20 || c == '"' || c == '\\') break;
+    }
+    return i;
+}
+
+
+// *****************************************************************************
+uint64_t hashBytes(const void* data, size_t length, uint64_t seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+// *****************************************************************************
+uint64_t hashBytesFast(const void* data, size_t length, uint64_t seed)
+{
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const unsigned char* end = bytes + (length & ~size_t(7));
+    uint64_t hash = seed ^ (length * m);
+    for (; bytes != end; bytes += 8)
+    {
+        uint64_t k;
+        memcpy(&k, bytes, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        hash ^= k;
+        hash *= m;
+    }
+
+    switch (length & 7)
+    {
+        case 7: hash ^= uint64_t(bytes[6]) << 48;  // fall through
+        case 6: hash ^= uint64_t(bytes[5]) << 40;  // fall through
+        case 5: hash ^= uint64_t(bytes[4]) << 32;  // fall through
+        case 4: hash ^= uint64_t(bytes[3]) << 24;  // fall through
+        case 3: hash ^= uint64_t(bytes[2]) << 16;  // fall through
+        case 2: hash ^= uint64_t(bytes[1]) << 8;   // fall through
+        case 1: hash ^= uint64_t(bytes[0]);
+                hash *= m;
+    }
+
+    hash ^= hash >> r;
+    hash *= m;
+    hash ^= hash >> r;
+    return hash;
+}
+
+
+// *****************************************************************************
+void writeFileAtomically(const std::string& filename, const struct iovec* pieces, int count)
+{
+    // The temporary file is in the same directory, so rename() can't fail
+    // by crossing file systems.
+    std::vector<char> tmpname(filename.begin(), filename.end());
+    const char suffix[] = ".XXXXXX";
+    tmpname.insert(tmpname.end(), suffix, suffix + sizeof(suffix));
+
+    const int fd = mkstemp(&tmpname[0]);
+    if (fd < 0)
+    {
+        throw std::runtime_error(filename + ": " + strerror(errno));
+    }
+    fchmod(fd, 0644);  // mkstemp() only allows the owner to read
+
+    int err = 0;
+    for (int i = 0; i < count && !err; ++i)
+    {
+        const char* data = static_cast<const char*>(pieces[i].iov_base);
+        size_t remaining = pieces[i].iov_len;
+        while (remaining > 0)
+        {
+            const ssize_t n = write(fd, data, remaining);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0)
+            {
+                err = n < 0 ? errno : EIO;
+                break;
+            }
+            data += n;
+            remaining -= n;
+        }
+    }
+
+    if (close(fd) != 0 && !err)
+    {
+        err = errno;
+    }
+    if (!err && rename(&tmpname[0], filename.c_str()) != 0)
+    {
+        err = errno;
+    }
+    if (err)
+    {
+        unlink(&tmpname[0]);
+        throw std::runtime_error(filename + ": " + strerror(err));
+    }
+}
 
 
 }  //  End namespace TipPod
@@ -8,6 +8,8 @@
 
 #include <string>
 #include <vector>
+#include <stdint.h>
+#include <sys/uio.h>
 
 namespace TipPod {
 
@@ -15,8 +17,58 @@ namespace TipPod {
 bool stringToFloat(const std::string& str, float& result);
 bool stringToInt(const std::string& str, int& result);
 
+// As above, for text which need not be NUL-terminated.
+bool stringToFloat(const char* text, size_t length, float& result);
+bool stringToInt(const char* text, size_t length, int& result);
+
+// Write the shortest text that reads back as exactly 'value', in the form
+// the parser reads as a float ("1.0", "0.001", "3.4028235e+38") whatever
+// the locale.  'text' must have room for FLOAT_TEXT_SIZE characters; it
+// isn't NUL-terminated.  Returns the length.
+const size_t FLOAT_TEXT_SIZE = 16;
+size_t formatFloat(float value, char* text);
+
 std::vector<std::string> splitlines(const std::string &s);
 
+// Decode the escape sequences the lexer recognizes inside a double-quoted
+// string, appending the result to 'result'.
+void unescapeString(const char* text, size_t length, std::string& result);
+
+// The inverse: the character after the backslash that 'c' is written as
+// inside a double-quoted string, or '\0' if it's written as it is.  Quotes,
+// backslashes and \b, \t, \n, \f and \r are escaped.
+char escapeCode(char c);
+
+// Write 'text' with the characters escapeCode() escapes escaped, for
+// inside a double-quoted string.  'result' must have room for twice the
+// length.  Returns the length written.  Looks at eight characters at a
+// time, and copies those with nothing to escape as they are.
+size_t escapeString(const char* text, size_t length, char* result);
+
+// How many characters at the start of 'text' are plain: not control
+// characters, quotes or backslashes, which a JSON string must escape.
+// Looks at eight characters at a time, like escapeString().
+size_t plainLength(const char* text, size_t length);
+
+// 64-bit FNV-1a hash of the given bytes.  Stable across runs and platforms,
+// so it may be stored in files.  Pass a previous result as 'seed' to hash
+// data in several pieces.
+const uint64_t HASH_SEED = 14695981039346656037ULL;
+uint64_t hashBytes(const void* data, size_t length, uint64_t seed=HASH_SEED);
+
+// 64-bit MurmurHash64A of the given bytes, which reads them 8 at a time
+// and is several times faster than hashBytes() on all but the shortest
+// text.  Stable across runs, and across machines of the same byte order.
+// The length is hashed too, so pieces hashed one after another, each
+// seeded with the last result, can't run together.
+uint64_t hashBytesFast(const void* data, size_t length, uint64_t seed=HASH_SEED);
+
+// Write the given pieces, one after another, to a new file which then
+// replaces 'filename'.  Readers see either the old file or the complete new
+// one, and concurrent writers don't interfere with each other.  Throws on
+// error.
+void writeFileAtomically(const std::string& filename, const struct iovec* pieces, int count);
+
 
 }  //  End namespace TipPod
 
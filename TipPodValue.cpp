@@ -20,65 +20,62 @@
 namespace TipPod {
 
 
+// *****************************************************************************
+void PodValue::write(std::ostream& output, int indent) const
+{
+    PodWriteBuffer buffer(output);
+    write(buffer, indent);
+    buffer.flush();
+}
+
+
 // *****************************************************************************
 //
 // Specializations for TypedPodValue::write()
 //
 template <> 
-void TypedPodValue<std::string, PodNode::STRING>::write(std::ostream& output, int indent) const
+void TypedPodValue<std::string, PodNode::STRING>::write(PodWriteBuffer& output, int indent) const
 {
-    // Replace '"' with '\"' during serialization.  Backslashes are removed from strings
-    // by the parser during reading.
-
-    std::string outstr(m_value);
-
-    static const std::string doubleQuote("\"");
-    static const std::string escapedDoubleQuote("\\\"");
-    size_t start_pos = 0;
-    while ((start_pos = outstr.find(doubleQuote, start_pos)) != std::string::npos) 
-    {
-        outstr.replace(start_pos, doubleQuote.length(), escapedDoubleQuote);
-        start_pos += escapedDoubleQuote.length();
-    }
-
-    output << "\"" << outstr << "\"";
+    // Escaped so that the parser reads back exactly the same string
+    output.append('"');
+    output.appendEscaped(m_value);
+    output.append('"');
 }
 
 
 template <> 
-void TypedPodValue<int, PodNode::INT>::write(std::ostream& output, int indent) const
+void TypedPodValue<int, PodNode::INT>::write(PodWriteBuffer& output, int indent) const
 {
-    output << m_value;
+    output.appendInt(m_value);
 }
 
 
 template <> 
-void TypedPodValue<float, PodNode::FLOAT>::write(std::ostream& output, int indent) const
+void TypedPodValue<float, PodNode::FLOAT>::write(PodWriteBuffer& output, int indent) const
 {
-    char tmp[32];
-    snprintf(tmp, 32, "%0.8g", m_value);
-    if (strchr(tmp, '.') == NULL)
-    {
-        output << tmp << ".0";
-    }
-    else
-    {
-        output << tmp;
-    }
+    char text[FLOAT_TEXT_SIZE];
+    output.append(text, formatFloat(m_value, text));
 }
 
 
 template <> 
-void TypedPodValue<std::string, PodNode::IDENTIFIER>::write(std::ostream& output, int indent) const
+void TypedPodValue<std::string, PodNode::IDENTIFIER>::write(PodWriteBuffer& output, int indent) const
 {
-    output << m_value;
+    output.append(m_value);
 }
 
 
 template <> 
-void TypedPodValue<bool, PodNode::BOOL>::write(std::ostream& output, int indent) const
+void TypedPodValue<bool, PodNode::BOOL>::write(PodWriteBuffer& output, int indent) const
 {
-    output << (m_value ? "true" : "false");
+    if (m_value)
+    {
+        output.append("true", 4);
+    }
+    else
+    {
+        output.append("false", 5);
+    }
 }
 
 
@@ -183,9 +180,8 @@ std::string PodValue::repr() const
         case PodNode::FLOAT:
             if (const FloatPodValue* v = dynamic_cast<const FloatPodValue*>(this))
             {
-                std::ostringstream result;
-                result << v->value();
-                return result.str();
+                char text[FLOAT_TEXT_SIZE];
+                return std::string(text, formatFloat(v->value(), text));
             }
             else
             {
@@ -243,6 +239,7 @@ std::ostream& operator<<(std::ostream& output, const PodValue& pv)
         default: output << "UNDEFINED"; break;
     }
     output << ")";
+    return output;
 }
 
 
@@ -12,6 +12,7 @@
 #include <string>
 
 #include "TipPodNode.h"
+#include "TipPodWriteBuffer.h"
 
 namespace TipPod {
 
@@ -40,9 +41,11 @@ public:
     virtual PodNode::ValueType type() const { return m_type; }
 
     //
-    // Serialization
+    // Serialization.  Subclasses write to a PodWriteBuffer; writing to a
+    // stream goes through one.
     //
-    virtual void write(std::ostream& output, int indent=0) const = 0;
+    virtual void write(PodWriteBuffer& output, int indent=0) const = 0;
+    void write(std::ostream& output, int indent=0) const;
 
     //
     //
@@ -80,7 +83,8 @@ public:
 
     virtual const ValueType& value() const { return m_value; }
 
-    virtual void write(std::ostream& output, int indent=0) const;
+    using PodValue::write;
+    virtual void write(PodWriteBuffer& output, int indent=0) const;
 
     virtual PodValue* copy() const
         { 
@@ -107,12 +111,17 @@ public:
         : PodValue(PodNode::EMBED), m_value(text), m_language(language) {}
     virtual ~TypedPodValue() {}
 
-    virtual void write(std::ostream& output, int indent=0) const
+    using PodValue::write;
+    virtual void write(PodWriteBuffer& output, int indent=0) const
     {
         // TODO: Deal with indents properly
-        output << "<" << m_language << ">" 
-               << m_value
-               << "</" << m_language << ">";
+        output.append('<');
+        output.append(m_language);
+        output.append('>');
+        output.append(m_value);
+        output.append("</", 2);
+        output.append(m_language);
+        output.append('>');
     }
 
     virtual const std::string& value() const { return m_value; }
@@ -0,0 +1,603 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <errno.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+
+#include "TipPodWire.h"
+#include "TipPodValue.h"
+#include "TipPodBlockPodValue.h"
+
+namespace TipPod {
+
+
+const size_t PodWireWriter::DEFAULT_CHUNK_SIZE;
+
+static const char WIRE_MAGIC[4] = { 'P', 'o', 'W', char(WIRE_VERSION) };
+static const size_t HEADER_SIZE = 4;
+
+
+// *****************************************************************************
+//
+// Little-endian, whatever the host; compilers make these single moves
+// where it's little-endian already
+//
+static inline void putUint16(char* out, uint16_t value)
+{
+    out[0] = char(value);
+    out[1] = char(value >> 8);
+}
+
+
+static inline void putUint32(char* out, uint32_t value)
+{
+    out[0] = char(value);
+    out[1] = char(value >> 8);
+    out[2] = char(value >> 16);
+    out[3] = char(value >> 24);
+}
+
+
+static inline uint16_t getUint16(const char* in)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    return uint16_t(bytes[0] | (bytes[1] << 8));
+}
+
+
+static inline uint32_t getUint32(const char* in)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8)
+           | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+}
+
+
+// *****************************************************************************
+static char* newChunkBuffer(size_t chunkSize)
+{
+    char* buffer = static_cast<char*>(malloc(HEADER_SIZE + chunkSize));
+    if (!buffer)
+    {
+        throw std::bad_alloc();
+    }
+    return buffer;
+}
+
+
+// *****************************************************************************
+//
+// Chunks are at least big enough for any fixed-size value, and no bigger
+// than a reader takes
+//
+static size_t chunkSizeFor(size_t chunkSize)
+{
+    if (chunkSize < 16) return 16;
+    if (chunkSize > WIRE_MAX_CHUNK_SIZE) return WIRE_MAX_CHUNK_SIZE;
+    return chunkSize;
+}
+
+
+// *****************************************************************************
+PodWireWriter::PodWireWriter(int fd, size_t chunkSize)
+        : m_fd(fd),
+          m_stream(NULL),
+          m_string(NULL),
+          m_buffer(newChunkBuffer(chunkSizeFor(chunkSize))),
+          m_next(m_buffer + HEADER_SIZE),
+          m_end(m_next + chunkSizeFor(chunkSize))
+{
+}
+
+
+// *****************************************************************************
+PodWireWriter::PodWireWriter(std::ostream& output, size_t chunkSize)
+        : m_fd(-1),
+          m_stream(&output),
+          m_string(NULL),
+          m_buffer(newChunkBuffer(chunkSizeFor(chunkSize))),
+          m_next(m_buffer + HEADER_SIZE),
+          m_end(m_next + chunkSizeFor(chunkSize))
+{
+}
+
+
+// *****************************************************************************
+PodWireWriter::PodWireWriter(std::string& output, size_t chunkSize)
+        : m_fd(-1),
+          m_stream(NULL),
+          m_string(&output),
+          m_buffer(newChunkBuffer(chunkSizeFor(chunkSize))),
+          m_next(m_buffer + HEADER_SIZE),
+          m_end(m_next + chunkSizeFor(chunkSize))
+{
+}
+
+
+// *****************************************************************************
+PodWireWriter::~PodWireWriter()
+{
+    free(m_buffer);
+}
+
+
+// *****************************************************************************
+void PodWireWriter::write(const PodNode& node)
+{
+    try
+    {
+        append(WIRE_MAGIC, sizeof(WIRE_MAGIC));
+        writeNode(node);
+        sendChunk(true);
+    }
+    catch (...)
+    {
+        m_next = m_buffer + HEADER_SIZE;  // Not sent with the next message
+        throw;
+    }
+}
+
+
+// *****************************************************************************
+void PodWireWriter::writeNode(const PodNode& node)
+{
+    const PodValue* value = node.value();
+    const PodNode::ValueType type = node.valueType();
+    int number = 0;
+    uint8_t tag = WIRE_UNDEFINED;
+    switch (type)
+    {
+        case PodNode::STRING:     tag = WIRE_STRING; break;
+        case PodNode::FLOAT:      tag = WIRE_FLOAT; break;
+        case PodNode::IDENTIFIER: tag = WIRE_IDENTIFIER; break;
+        case PodNode::EMBED:      tag = WIRE_EMBED; break;
+        case PodNode::BLOCK:      tag = WIRE_BLOCK; break;
+        case PodNode::BOOL:
+            tag = static_cast<const BoolPodValue*>(value)->value() ? WIRE_TRUE : WIRE_FALSE;
+            break;
+        case PodNode::INT:
+            number = static_cast<const IntPodValue*>(value)->value();
+            tag = number >= -128 && number <= 127 ? WIRE_INT8
+                  : number >= -32768 && number <= 32767 ? WIRE_INT16 : WIRE_INT32;
+            break;
+        default:
+            break;
+    }
+    const bool scoped = type == PodNode::BLOCK && !node.blockScopeType().empty();
+    if (!node.podName().empty()) tag |= WIRE_NAMED;
+    if (!node.podType().empty()) tag |= WIRE_TYPED;
+    if (scoped) tag |= WIRE_SCOPED;
+
+    appendByte(tag);
+    if (tag & WIRE_NAMED) writeString(node.podName());
+    if (tag & WIRE_TYPED) writeString(node.podType());
+    if (scoped) writeString(node.blockScopeType());
+
+    switch (tag & WIRE_KIND_MASK)
+    {
+        case WIRE_STRING:
+            writeString(static_cast<const StringPodValue*>(value)->value());
+            break;
+        case WIRE_INT8:
+            appendByte(uint8_t(number));
+            break;
+        case WIRE_INT16:
+            putUint16(room(2), uint16_t(number));
+            break;
+        case WIRE_INT32:
+            putUint32(room(4), uint32_t(number));
+            break;
+        case WIRE_FLOAT:
+        {
+            const float real = static_cast<const FloatPodValue*>(value)->value();
+            uint32_t bits;
+            memcpy(&bits, &real, sizeof(bits));
+            putUint32(room(4), bits);
+            break;
+        }
+        case WIRE_IDENTIFIER:
+            writeString(static_cast<const IdentifierPodValue*>(value)->value());
+            break;
+        case WIRE_EMBED:
+        {
+            const EmbedPodValue* embed = static_cast<const EmbedPodValue*>(value);
+            writeString(embed->value());
+            writeString(embed->language());
+            break;
+        }
+        case WIRE_BLOCK:
+        {
+            const PodNodeDeque& block = node.asBlock();
+            uint32_t count = 0;
+            PodNodeDeque::const_iterator iter;
+            for (iter = block.begin(); iter != block.end(); ++iter)
+            {
+                if ((*iter)->isValid()) ++count;
+            }
+            writeVarint(count);
+            for (iter = block.begin(); iter != block.end(); ++iter)
+            {
+                if ((*iter)->isValid()) writeNode(**iter);
+            }
+            break;
+        }
+    }
+}
+
+
+// *****************************************************************************
+void PodWireWriter::writeString(const std::string& text)
+{
+    writeVarint(uint32_t(text.size()));
+    append(text.data(), text.size());
+}
+
+
+// *****************************************************************************
+void PodWireWriter::writeVarint(uint32_t value)
+{
+    char* out = room(5);
+    char* start = out;
+    for (; value >= 0x80; value >>= 7)
+    {
+        *out++ = char(value | 0x80);
+    }
+    *out++ = char(value);
+    m_next -= 5 - (out - start);
+}
+
+
+// *****************************************************************************
+void PodWireWriter::append(const char* data, size_t length)
+{
+    while (length > size_t(m_end - m_next))
+    {
+        const size_t part = m_end - m_next;
+        memcpy(m_next, data, part);
+        m_next += part;
+        data += part;
+        length -= part;
+        sendChunk(false);
+    }
+    memcpy(m_next, data, length);
+    m_next += length;
+}
+
+
+// *****************************************************************************
+void PodWireWriter::sendChunk(bool last)
+{
+    const size_t length = m_next - m_buffer - HEADER_SIZE;
+    putUint32(m_buffer, uint32_t(length) | (last ? WIRE_LAST_CHUNK : 0));
+
+    const char* data = m_buffer;
+    size_t remaining = HEADER_SIZE + length;
+    m_next = m_buffer + HEADER_SIZE;  // Dropped even if writing fails
+    if (m_string)
+    {
+        m_string->append(data, remaining);
+        return;
+    }
+    if (m_stream)
+    {
+        m_stream->write(data, remaining);
+        return;
+    }
+    while (remaining > 0)
+    {
+        const ssize_t n = ::write(m_fd, data, remaining);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+        {
+            throw std::runtime_error(std::string("Writing pod wire message: ")
+                                     + strerror(n < 0 ? errno : EIO));
+        }
+        data += n;
+        remaining -= n;
+    }
+}
+
+
+// *****************************************************************************
+PodWireReader::PodWireReader(int fd)
+        : m_fd(fd),
+          m_data(NULL),
+          m_dataEnd(NULL),
+          m_buffer(HEADER_SIZE + PodWireWriter::DEFAULT_CHUNK_SIZE),
+          m_next(NULL),
+          m_chunkEnd(NULL),
+          m_lastChunk(true),
+          m_text(),
+          m_joined()
+{
+    m_data = m_dataEnd = &m_buffer[0];
+}
+
+
+// *****************************************************************************
+PodWireReader::PodWireReader(const char* data, size_t length)
+        : m_fd(-1),
+          m_data(data),
+          m_dataEnd(data + length),
+          m_buffer(),
+          m_next(NULL),
+          m_chunkEnd(NULL),
+          m_lastChunk(true),
+          m_text(),
+          m_joined()
+{
+}
+
+
+// *****************************************************************************
+PodWireReader::~PodWireReader()
+{
+}
+
+
+// *****************************************************************************
+PodNode* PodWireReader::read()
+{
+    if (!readChunk(true))
+    {
+        return NULL;
+    }
+    if (memcmp(take(sizeof(WIRE_MAGIC)), WIRE_MAGIC, sizeof(WIRE_MAGIC)) != 0)
+    {
+        fail("Not a pod wire message, or not version " + std::string(1, '0' + WIRE_VERSION));
+    }
+    PodNode* node = readNode(0);
+    if (m_next != m_chunkEnd || !m_lastChunk)
+    {
+        delete node;
+        fail("More data after the node");
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+PodNode* PodWireReader::readNode(int depth)
+{
+    if (depth > WIRE_MAX_DEPTH)
+    {
+        std::ostringstream err;
+        err << "Nested more than " << WIRE_MAX_DEPTH << " deep";
+        fail(err.str());
+    }
+
+    const uint8_t tag = takeByte();
+    const int kind = tag & WIRE_KIND_MASK;
+    if ((tag & ~(WIRE_KIND_MASK | WIRE_NAMED | WIRE_TYPED | WIRE_SCOPED)) || kind > WIRE_BLOCK)
+    {
+        fail("Unknown tag");
+    }
+    if ((tag & WIRE_SCOPED) && kind != WIRE_BLOCK)
+    {
+        fail("Scope type on a value that isn't a block");
+    }
+    std::string name, podType, scopeType;
+    if (tag & WIRE_NAMED) readString(name);
+    if (tag & WIRE_TYPED) readString(podType);
+    if (tag & WIRE_SCOPED) readString(scopeType);
+
+    PodValue* value = NULL;
+    switch (kind)
+    {
+        case WIRE_STRING:
+            readString(m_text);
+            value = new StringPodValue(m_text);
+            break;
+        case WIRE_INT8:
+            value = new IntPodValue(int8_t(takeByte()));
+            break;
+        case WIRE_INT16:
+            value = new IntPodValue(int16_t(getUint16(take(2))));
+            break;
+        case WIRE_INT32:
+            value = new IntPodValue(int32_t(getUint32(take(4))));
+            break;
+        case WIRE_FLOAT:
+        {
+            const uint32_t bits = getUint32(take(4));
+            float real;
+            memcpy(&real, &bits, sizeof(real));
+            value = new FloatPodValue(real);
+            break;
+        }
+        case WIRE_FALSE:
+            value = new BoolPodValue(false);
+            break;
+        case WIRE_TRUE:
+            value = new BoolPodValue(true);
+            break;
+        case WIRE_IDENTIFIER:
+            readString(m_text);
+            value = new IdentifierPodValue(m_text);
+            break;
+        case WIRE_EMBED:
+        {
+            std::string language;
+            readString(m_text);
+            readString(language);
+            value = new EmbedPodValue(m_text, language);
+            break;
+        }
+        case WIRE_BLOCK:
+        {
+            const uint32_t count = readVarint();
+            BlockPodValue* block = new BlockPodValue;
+            try
+            {
+                block->setScopeType(scopeType);
+                PodNodeDeque& children = block->value();
+                children.reserve(count < 4096 ? count : 4096);  // The count may be wrong
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    children.push_back(readNode(depth + 1));
+                }
+            }
+            catch (...)
+            {
+                delete block;
+                throw;
+            }
+            value = block;
+            break;
+        }
+    }
+    return new PodNode(name, podType, value);
+}
+
+
+// *****************************************************************************
+void PodWireReader::readString(std::string& result)
+{
+    const uint32_t length = readVarint();
+    if (length <= size_t(m_chunkEnd - m_next))
+    {
+        result.assign(m_next, length);
+        m_next += length;
+    }
+    else
+    {
+        result.assign(joinChunks(length), length);
+    }
+}
+
+
+// *****************************************************************************
+uint32_t PodWireReader::readVarint()
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        const uint8_t byte = takeByte();
+        value |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    fail("Varint longer than five bytes");
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// The next 'length' bytes of the message, which run on past the current
+// chunk, copied together
+//
+const char* PodWireReader::joinChunks(size_t length)
+{
+    m_joined.assign(m_next, m_chunkEnd);
+    m_next = m_chunkEnd;
+    while (m_joined.size() < length)
+    {
+        nextChunk();
+        const size_t part = std::min(length - m_joined.size(), size_t(m_chunkEnd - m_next));
+        m_joined.append(m_next, part);
+        m_next += part;
+    }
+    return m_joined.data();
+}
+
+
+// *****************************************************************************
+void PodWireReader::nextChunk()
+{
+    if (m_lastChunk)
+    {
+        fail("Message cut short");
+    }
+    readChunk(false);
+}
+
+
+// *****************************************************************************
+//
+// Make the next chunk the current one.  Returns false if the stream ends
+// before a message starts.
+//
+bool PodWireReader::readChunk(bool firstOfMessage)
+{
+    if (!load(HEADER_SIZE))
+    {
+        if (firstOfMessage && m_data == m_dataEnd) return false;
+        fail("Message cut short");
+    }
+    const uint32_t header = getUint32(m_data);
+    const size_t length = header & ~WIRE_LAST_CHUNK;
+    if (length > WIRE_MAX_CHUNK_SIZE)
+    {
+        fail("Chunk longer than WIRE_MAX_CHUNK_SIZE");
+    }
+    m_data += HEADER_SIZE;
+    if (!load(length))
+    {
+        fail("Message cut short");
+    }
+    m_lastChunk = (header & WIRE_LAST_CHUNK) != 0;
+    m_next = m_data;
+    m_chunkEnd = m_data + length;
+    m_data += length;
+    return true;
+}
+
+
+// *****************************************************************************
+//
+// Make sure the next 'length' bytes of the stream are in memory, reading
+// more from the file descriptor if need be.  Returns false if it ends
+// first.  Only called once the current chunk has been used up, since
+// what's left is moved to the start of the buffer.
+//
+bool PodWireReader::load(size_t length)
+{
+    if (size_t(m_dataEnd - m_data) >= length) return true;
+    if (m_fd < 0) return false;
+
+    const size_t kept = m_dataEnd - m_data;
+    if (m_buffer.size() < length)
+    {
+        std::vector<char> bigger(std::max(length, 2 * m_buffer.size()));
+        memcpy(&bigger[0], m_data, kept);
+        m_buffer.swap(bigger);
+    }
+    else
+    {
+        memmove(&m_buffer[0], m_data, kept);
+    }
+    m_data = &m_buffer[0];
+    m_dataEnd = m_data + kept;
+    m_next = m_chunkEnd = NULL;
+
+    char* end = &m_buffer[0] + m_buffer.size();
+    while (size_t(m_dataEnd - m_data) < length)
+    {
+        const ssize_t n = ::read(m_fd, const_cast<char*>(m_dataEnd), end - m_dataEnd);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0)
+        {
+            throw std::runtime_error(std::string("Reading pod wire message: ") + strerror(errno));
+        }
+        if (n == 0) return false;
+        m_dataEnd += n;
+    }
+    return true;
+}
+
+
+// *****************************************************************************
+void PodWireReader::fail(const std::string& message) const
+{
+    throw std::runtime_error("Bad pod wire message: " + message);
+}
+
+
+}  //  End namespace TipPod
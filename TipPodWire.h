@@ -0,0 +1,216 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODWIRE_H__
+#define __TIPPODWIRE_H__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "TipPodNode.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// A compact binary encoding of PodNode trees, for passing pods between
+// processes through pipes and sockets without writing and parsing text:
+//
+//     PodWireWriter writer(fd);            PodWireReader reader(fd);
+//     writer.write(*rootNode);             while (PodNode* node = reader.read())
+//                                          {
+//                                              ...
+//                                              delete node;
+//                                          }
+//
+// Unlike PodSnapshot's .podb files, which are laid out to be mapped into
+// memory, this is written and read in one pass, a piece at a time, and
+// the two ends needn't share a machine: numbers are little-endian.
+//
+// A stream is any number of messages, each one PodNode and everything
+// under it, sent as one or more chunks:
+//
+//     uint32  header            Length of the data, up to WIRE_MAX_CHUNK_SIZE,
+//                               plus WIRE_LAST_CHUNK on the message's last one
+//     char    data[length]
+//
+// The data of a message's chunks, put together, is:
+//
+//     char    magic[4]          "PoW" and WIRE_VERSION
+//     node
+//
+// where a node is:
+//
+//     uint8   tag               A WireKind, plus WIRE_NAMED, WIRE_TYPED and
+//                               WIRE_SCOPED for what follows it
+//     string  name              If WIRE_NAMED
+//     string  podType           If WIRE_TYPED
+//     string  scopeType         If WIRE_SCOPED, only on blocks
+//     WIRE_STRING, WIRE_IDENTIFIER:  string
+//     WIRE_INT8, WIRE_INT16, WIRE_INT32:  int8, int16 or int32, whichever
+//                               is the smallest that holds the value
+//     WIRE_FLOAT:               float32
+//     WIRE_EMBED:               string text, string language
+//     WIRE_BLOCK:               varint childCount, then each child node
+//     WIRE_UNDEFINED, WIRE_FALSE, WIRE_TRUE:  nothing more
+//
+// and a string is a varint length followed by its bytes.  Varints are
+// LEB128: seven bits a byte, least significant first, with the top bit
+// set on all but the last.
+//
+// RULES:
+//
+// * What's read back is the same as what was written, down to nameless
+//   nodes with no value, which write() skips.  Where the nodes came from
+//   (sourcefile(), sourceline()) isn't sent.
+// * A reader throws std::runtime_error if a message isn't one, or is cut
+//   short, or nests more than WIRE_MAX_DEPTH deep.  The stream can't be
+//   read past a bad message, nor written to after write() throws.
+//
+// NOTES:
+//
+// * Each write() sends the message before it returns, so the reader can
+//   read it straight away; there's nothing to flush.  Chunks let a large
+//   message go out as it's encoded without being held in memory whole,
+//   while the reader still knows how much to read.
+// * Writing to a pipe or socket whose reader has gone raises SIGPIPE, as
+//   write(2) does; ignore it to have write() throw instead.
+// * PodQueryServer's protocol is separate; it answers lookups, and stays
+//   on one machine.
+//
+enum WireKind {
+                WIRE_UNDEFINED  = 0,
+                WIRE_STRING     = 1,
+                WIRE_INT8       = 2,
+                WIRE_INT16      = 3,
+                WIRE_INT32      = 4,
+                WIRE_FLOAT      = 5,
+                WIRE_FALSE      = 6,
+                WIRE_TRUE       = 7,
+                WIRE_IDENTIFIER = 8,
+                WIRE_EMBED      = 9,
+                WIRE_BLOCK      = 10,
+
+                WIRE_KIND_MASK  = 0x0f,
+                WIRE_NAMED      = 1<<4,
+                WIRE_TYPED      = 1<<5,
+                WIRE_SCOPED     = 1<<6,
+              };
+
+const uint8_t  WIRE_VERSION = 1;
+const uint32_t WIRE_LAST_CHUNK = 1u << 31;
+const size_t   WIRE_MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+const int      WIRE_MAX_DEPTH = 1000;
+
+
+// *****************************************************************************
+//
+// Writes pods as messages to a file descriptor, a stream, or the end of
+// a string, in chunks of up to chunkSize.  Throws std::runtime_error if
+// writing to a file descriptor fails, like PodWriteBuffer.
+//
+class PodWireWriter
+{
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit PodWireWriter(int fd, size_t chunkSize=DEFAULT_CHUNK_SIZE);
+    explicit PodWireWriter(std::ostream& output, size_t chunkSize=DEFAULT_CHUNK_SIZE);
+    explicit PodWireWriter(std::string& output, size_t chunkSize=DEFAULT_CHUNK_SIZE);
+    ~PodWireWriter();
+
+    void write(const PodNode& node);  // One message
+
+private:
+    PodWireWriter(const PodWireWriter&);             // Not implemented
+    PodWireWriter& operator=(const PodWireWriter&);  // Not implemented
+
+    void writeNode(const PodNode& node);
+    void writeString(const std::string& text);
+    void writeVarint(uint32_t value);
+    void append(const char* data, size_t length);
+    void appendByte(uint8_t byte)
+        {
+            if (m_next == m_end) sendChunk(false);
+            *m_next++ = char(byte);
+        }
+    char* room(size_t length)  // For fixed-size values, up to 8 bytes
+        {
+            if (size_t(m_end - m_next) < length) sendChunk(false);
+            char* result = m_next;
+            m_next += length;
+            return result;
+        }
+    void sendChunk(bool last);
+
+    int           m_fd;       // -1 if not writing to a file descriptor
+    std::ostream* m_stream;   // NULL if not writing to a stream
+    std::string*  m_string;   // NULL if not writing to a string
+    char*         m_buffer;   // Header, then the chunk's data
+    char*         m_next;
+    char*         m_end;
+};
+
+
+// *****************************************************************************
+//
+// Reads messages written by PodWireWriter from a file descriptor, or from
+// data in memory, which isn't copied and must outlive the reader.
+//
+class PodWireReader
+{
+public:
+    explicit PodWireReader(int fd);
+    PodWireReader(const char* data, size_t length);
+    ~PodWireReader();
+
+    // The next message's node, owned by the caller, or NULL at the end of
+    // the stream
+    PodNode* read();
+
+private:
+    PodWireReader(const PodWireReader&);             // Not implemented
+    PodWireReader& operator=(const PodWireReader&);  // Not implemented
+
+    PodNode* readNode(int depth);
+    void readString(std::string& result);
+    uint32_t readVarint();
+    const char* take(size_t length)  // Contiguous, good until the next take
+        {
+            if (size_t(m_chunkEnd - m_next) < length) return joinChunks(length);
+            const char* result = m_next;
+            m_next += length;
+            return result;
+        }
+    uint8_t takeByte()
+        {
+            while (m_next == m_chunkEnd) nextChunk();
+            return uint8_t(*m_next++);
+        }
+    const char* joinChunks(size_t length);
+    void nextChunk();
+    bool readChunk(bool firstOfMessage);
+    bool load(size_t length);
+    void fail(const std::string& message) const;
+
+    int               m_fd;         // -1 if reading from memory
+    const char*       m_data;       // What's been read and not yet taken
+    const char*       m_dataEnd;
+    std::vector<char> m_buffer;     // What m_data points into, reading a file descriptor
+    const char*       m_next;       // In the current chunk's data
+    const char*       m_chunkEnd;
+    bool              m_lastChunk;  // The current chunk ends the message
+    std::string       m_text;       // Scratch, for strings
+    std::string       m_joined;     // Values that straddle chunks, put together
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODWIRE_H__
@@ -0,0 +1,192 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "TipPodWriteBuffer.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+const size_t PodWriteBuffer::DEFAULT_CHUNK_SIZE;
+
+// Enough for 32 levels of indentation, which are written in one piece
+static const char INDENT[] =
+    "                                                                "
+    "                                                                ";
+static const size_t INDENT_LENGTH = sizeof(INDENT) - 1;
+
+
+// *****************************************************************************
+PodWriteBuffer::PodWriteBuffer()
+        : m_fd(-1),
+          m_output(NULL),
+          m_chunkSize(0),
+          m_buffer(NULL),
+          m_next(NULL),
+          m_end(NULL)
+{
+    grow(4096);
+}
+
+
+// *****************************************************************************
+PodWriteBuffer::PodWriteBuffer(int fd, size_t chunkSize)
+        : m_fd(fd),
+          m_output(NULL),
+          m_chunkSize(chunkSize ? chunkSize : DEFAULT_CHUNK_SIZE),
+          m_buffer(NULL),
+          m_next(NULL),
+          m_end(NULL)
+{
+    grow(m_chunkSize);
+}
+
+
+// *****************************************************************************
+PodWriteBuffer::PodWriteBuffer(std::ostream& output, size_t chunkSize)
+        : m_fd(-1),
+          m_output(&output),
+          m_chunkSize(chunkSize ? chunkSize : DEFAULT_CHUNK_SIZE),
+          m_buffer(NULL),
+          m_next(NULL),
+          m_end(NULL)
+{
+    grow(m_chunkSize);
+}
+
+
+// *****************************************************************************
+PodWriteBuffer::~PodWriteBuffer()
+{
+    try
+    {
+        flush();
+    }
+    catch (...)
+    {
+    }
+    free(m_buffer);
+}
+
+
+// *****************************************************************************
+void PodWriteBuffer::appendEscaped(const char* text, size_t length)
+{
+    if (2 * length > size_t(m_end - m_next)) makeRoom(2 * length);
+    m_next += escapeString(text, length, m_next);
+}
+
+
+// *****************************************************************************
+void PodWriteBuffer::appendInt(int value)
+{
+    char digits[16];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    unsigned int magnitude = value < 0 ? 0u - unsigned(value) : unsigned(value);
+    do
+    {
+        *--start = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) *--start = '-';
+    append(start, end - start);
+}
+
+
+// *****************************************************************************
+void PodWriteBuffer::indent(int level)
+{
+    for (size_t remaining = level > 0 ? size_t(level) * 4 : 0; remaining > 0; )
+    {
+        const size_t length = remaining < INDENT_LENGTH ? remaining : INDENT_LENGTH;
+        append(INDENT, length);
+        remaining -= length;
+    }
+}
+
+
+// *****************************************************************************
+void PodWriteBuffer::flush()
+{
+    if (m_fd < 0 && !m_output) return;
+
+    const char* data = m_buffer;
+    size_t remaining = size();
+    m_next = m_buffer;  // Dropped even if writing fails, so it isn't tried again
+    if (m_output)
+    {
+        m_output->write(data, remaining);
+        return;
+    }
+    while (remaining > 0)
+    {
+        const ssize_t n = ::write(m_fd, data, remaining);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+        {
+            throw std::runtime_error(std::string("Writing pod: ")
+                                     + strerror(n < 0 ? errno : EIO));
+        }
+        data += n;
+        remaining -= n;
+    }
+}
+
+
+// *****************************************************************************
+void PodWriteBuffer::makeRoom(size_t length)
+{
+    if (m_chunkSize)
+    {
+        flush();
+        if (length <= size_t(m_end - m_next)) return;
+    }
+    const size_t capacity = m_end - m_buffer;
+    grow(std::max(capacity * 2, size() + length));
+}
+
+
+// *****************************************************************************
+void PodWriteBuffer::grow(size_t capacity)
+{
+    const size_t used = size();
+    char* buffer = static_cast<char*>(realloc(m_buffer, capacity));
+    if (!buffer)
+    {
+        throw std::bad_alloc();
+    }
+    m_buffer = buffer;
+    m_next = buffer + used;
+    m_end = buffer + capacity;
+}
+
+
+// *****************************************************************************
+void writeNodeHead(PodWriteBuffer& output, const std::string& podType,
+                   const std::string& podName, bool hasValue)
+{
+    if (!podType.empty())
+    {
+        output.append(podType);
+        output.append(' ');
+    }
+    if (!podName.empty())
+    {
+        output.append(podName);
+        if (hasValue) output.append(" = ", 3);
+    }
+}
+
+
+}  //  End namespace TipPod
@@ -0,0 +1,94 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODWRITEBUFFER_H__
+#define __TIPPODWRITEBUFFER_H__
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace TipPod {
+
+
+// *****************************************************************************
+//
+// Where PodNode::write() and the PodValue classes put the text they write.
+// It's collected in memory and handed to a file descriptor or stream in
+// large chunks, rather than streamed a piece at a time:
+//
+//     PodWriteBuffer output(fd);
+//     node->write(output);
+//     output.flush();
+//
+// NOTES:
+//
+// * Lines aren't flushed as they're written; only when the buffer fills,
+//   and by flush().  The destructor flushes too, but can't report errors,
+//   so call flush() first.
+// * Created without a file descriptor or stream, everything written is
+//   kept, and is in data() and size().
+// * Throws std::runtime_error if writing to a file descriptor fails, and
+//   std::ios_base::failure if the stream is set to throw.
+//
+class PodWriteBuffer
+{
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+    PodWriteBuffer();
+    explicit PodWriteBuffer(int fd, size_t chunkSize=DEFAULT_CHUNK_SIZE);
+    explicit PodWriteBuffer(std::ostream& output, size_t chunkSize=DEFAULT_CHUNK_SIZE);
+    ~PodWriteBuffer();
+
+    void append(const char* text, size_t length)
+        {
+            if (length > size_t(m_end - m_next)) makeRoom(length);
+            memcpy(m_next, text, length);
+            m_next += length;
+        }
+    void append(const std::string& text) { append(text.data(), text.size()); }
+    void append(const char* text) { append(text, strlen(text)); }
+    void append(char c)
+        {
+            if (m_next == m_end) makeRoom(1);
+            *m_next++ = c;
+        }
+    void appendEscaped(const char* text, size_t length);  // For inside "", see escapeCode()
+    void appendEscaped(const std::string& text) { appendEscaped(text.data(), text.size()); }
+    void appendInt(int value);
+    void indent(int level);    // Four spaces per level
+
+    void flush();              // Hand everything written so far on
+    const char* data() const { return m_buffer; }
+    size_t size() const { return m_next - m_buffer; }  // Not yet flushed
+
+private:
+    PodWriteBuffer(const PodWriteBuffer&);             // Not implemented
+    PodWriteBuffer& operator=(const PodWriteBuffer&);  // Not implemented
+
+    void makeRoom(size_t length);
+    void grow(size_t capacity);
+
+    int           m_fd;         // -1 if not writing to a file descriptor
+    std::ostream* m_output;     // NULL if not writing to a stream
+    size_t        m_chunkSize;  // Flushed once this much is written
+    char*         m_buffer;
+    char*         m_next;       // Where the next text goes
+    char*         m_end;
+};
+
+
+// "type name = " at the start of a node, or as much of it as the node has;
+// " = " only if a value follows the name.  PodNode::write() and PodWriter
+// both start nodes with it, so they write the same text.
+void writeNodeHead(PodWriteBuffer& output, const std::string& podType,
+                   const std::string& podName, bool hasValue=true);
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODWRITEBUFFER_H__
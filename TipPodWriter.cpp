@@ -0,0 +1,202 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "TipPodWriter.h"
+#include "TipPodWriteBuffer.h"
+#include "TipPodUtils.h"
+
+namespace TipPod {
+
+
+// *****************************************************************************
+PodWriter::PodWriter(int fd)
+        : m_owned(new PodWriteBuffer(fd)),
+          m_output(*m_owned),
+          m_depth(0)
+{
+}
+
+
+// *****************************************************************************
+PodWriter::PodWriter(std::ostream& output)
+        : m_owned(new PodWriteBuffer(output)),
+          m_output(*m_owned),
+          m_depth(0)
+{
+}
+
+
+// *****************************************************************************
+PodWriter::PodWriter(PodWriteBuffer& output)
+        : m_owned(NULL),
+          m_output(output),
+          m_depth(0)
+{
+}
+
+
+// *****************************************************************************
+PodWriter::~PodWriter()
+{
+    delete m_owned;
+}
+
+
+// *****************************************************************************
+//
+// Same as PodNode::write(), up to the value
+//
+void PodWriter::beginNode(const std::string& name, const std::string& podType)
+{
+    m_output.indent(m_depth);
+    writeNodeHead(m_output, podType, name);
+}
+
+
+// *****************************************************************************
+void PodWriter::endNode()
+{
+    m_output.append(";\n", 2);
+}
+
+
+// *****************************************************************************
+void PodWriter::beginBlock(const std::string& name, const std::string& podType,
+                           const std::string& scopeType)
+{
+    beginNode(name, podType);
+    if (!scopeType.empty())
+    {
+        m_output.append(scopeType);
+        m_output.append(' ');
+    }
+    m_output.append("{\n", 2);
+    ++m_depth;
+}
+
+
+// *****************************************************************************
+void PodWriter::endBlock()
+{
+    if (m_depth == 0)
+    {
+        throw std::logic_error("PodWriter::endBlock() without a block to end");
+    }
+    --m_depth;
+    m_output.indent(m_depth);
+    m_output.append('}');
+    endNode();
+}
+
+
+// *****************************************************************************
+void PodWriter::scalar(const std::string& name, const std::string& value,
+                       const std::string& podType)
+{
+    beginNode(name, podType);
+    m_output.append('"');
+    m_output.appendEscaped(value);
+    m_output.append('"');
+    endNode();
+}
+
+
+// *****************************************************************************
+void PodWriter::scalar(const std::string& name, const char* value, const std::string& podType)
+{
+    beginNode(name, podType);
+    m_output.append('"');
+    m_output.appendEscaped(value, strlen(value));
+    m_output.append('"');
+    endNode();
+}
+
+
+// *****************************************************************************
+void PodWriter::scalar(const std::string& name, int value, const std::string& podType)
+{
+    beginNode(name, podType);
+    m_output.appendInt(value);
+    endNode();
+}
+
+
+// *****************************************************************************
+void PodWriter::scalar(const std::string& name, float value, const std::string& podType)
+{
+    beginNode(name, podType);
+    char text[FLOAT_TEXT_SIZE];
+    m_output.append(text, formatFloat(value, text));
+    endNode();
+}
+
+
+// *****************************************************************************
+void PodWriter::scalar(const std::string& name, bool value, const std::string& podType)
+{
+    beginNode(name, podType);
+    if (value)
+    {
+        m_output.append("true", 4);
+    }
+    else
+    {
+        m_output.append("false", 5);
+    }
+    endNode();
+}
+
+
+// *****************************************************************************
+void PodWriter::identifier(const std::string& name, const std::string& value,
+                           const std::string& podType)
+{
+    beginNode(name, podType);
+    m_output.append(value);
+    endNode();
+}
+
+
+// *****************************************************************************
+void PodWriter::embed(const std::string& name, const std::string& text,
+                      const std::string& language, const std::string& podType)
+{
+    beginNode(name, podType);
+    m_output.append('<');
+    m_output.append(language);
+    m_output.append('>');
+    m_output.append(text);
+    m_output.append("</", 2);
+    m_output.append(language);
+    m_output.append('>');
+    endNode();
+}
+
+
+// *****************************************************************************
+void PodWriter::node(const PodNode& node)
+{
+    node.write(m_output, m_depth);
+}
+
+
+// *****************************************************************************
+void PodWriter::finish()
+{
+    if (m_depth != 0)
+    {
+        std::ostringstream err;
+        err << "PodWriter::finish() with " << m_depth << " block(s) still open";
+        throw std::logic_error(err.str());
+    }
+    m_output.flush();
+}
+
+
+}  //  End namespace TipPod
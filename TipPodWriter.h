@@ -0,0 +1,102 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#ifndef __TIPPODWRITER_H__
+#define __TIPPODWRITER_H__
+
+#include <iostream>
+#include <string>
+
+#include "TipPodNode.h"
+
+namespace TipPod {
+
+class PodWriteBuffer;
+
+
+// *****************************************************************************
+//
+// Writes a pod node by node as it's generated, without building a tree
+// of PodNodes first:
+//
+//     PodWriter writer(fd);
+//     writer.beginBlock("shot", "Shot");
+//     writer.scalar("frames", 240);
+//     writer.scalar("camera", "cam_main");
+//     writer.endBlock();
+//     writer.finish();
+//
+// writes the same text as PodNode::write() would for the same nodes,
+// escapes and all:
+//
+//     Shot shot = {
+//         frames = 240;
+//         camera = "cam_main";
+//     };
+//
+// RULES:
+//
+// * Every beginBlock() must be matched by an endBlock().  finish() throws
+//   std::logic_error if a block is still open, and so does endBlock() if
+//   none is.
+// * Names, types, identifiers and embedded scripts are written as given,
+//   as PodNode::write() does; they aren't checked.
+//
+// NOTES:
+//
+// * Writing to a file descriptor or stream, the text goes out in chunks
+//   of PodWriteBuffer::DEFAULT_CHUNK_SIZE, so memory stays the same
+//   however much is written.  Given a PodWriteBuffer, it's up to that.
+// * Throws what PodWriteBuffer throws if writing fails.
+// * The destructor flushes, but can't report errors; call finish().
+//
+class PodWriter
+{
+public:
+    explicit PodWriter(int fd);
+    explicit PodWriter(std::ostream& output);
+    explicit PodWriter(PodWriteBuffer& output);  // Not owned; not flushed until finish()
+    ~PodWriter();
+
+    // A block, and the nodes in it up to the matching endBlock()
+    void beginBlock(const std::string& name, const std::string& podType="",
+                    const std::string& scopeType="");
+    void endBlock();
+
+    // Nodes with values.  Any name or type may be empty.
+    void scalar(const std::string& name, const std::string& value, const std::string& podType="");
+    void scalar(const std::string& name, const char* value, const std::string& podType="");
+    void scalar(const std::string& name, int value, const std::string& podType="");
+    void scalar(const std::string& name, float value, const std::string& podType="");
+    void scalar(const std::string& name, bool value, const std::string& podType="");
+    void identifier(const std::string& name, const std::string& value,
+                    const std::string& podType="");
+    void embed(const std::string& name, const std::string& text, const std::string& language,
+               const std::string& podType="");
+
+    // A node that already exists, and everything under it.  A root node
+    // from parseFile() writes the nodes in it, as PodNode::write() does.
+    void node(const PodNode& node);
+
+    int depth() const { return m_depth; }  // Blocks open
+    void finish();                          // Throws if a block is open, then flushes
+
+private:
+    PodWriter(const PodWriter&);             // Not implemented
+    PodWriter& operator=(const PodWriter&);  // Not implemented
+
+    void beginNode(const std::string& name, const std::string& podType);
+    void endNode();
+
+    PodWriteBuffer* m_owned;   // NULL if given a PodWriteBuffer
+    PodWriteBuffer& m_output;
+    int             m_depth;
+};
+
+
+}  //  End namespace TipPod
+
+
+#endif    // End #ifndef __TIPPODWRITER_H__
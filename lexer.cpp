@@ -4,6 +4,7 @@
 #include <sstream>
 #include <stdexcept>
 #include "LexerContext.h"
+#include "TipPod.h"
 #include "TipPodNode.h"
 #include "TipPodUtils.h"
 #include "TipPodValue.h"
@@ -11,18 +12,20 @@
 
     /*
         The YY_USER_ACTION macro lets us manually track the current 
-        line and column.  See also 'struct YYLTYPE' in parser.y.
+        line and column.  See also 'struct YYLTYPE' in parser.y.  A string,
+        embedded script or comment starts where its first part was matched.
     */
 #define YY_USER_ACTION {yylloc->first_line = yylineno;                              \
                         yylloc->first_column = yylloc->current_column;              \
                         yylloc->current_column = yylloc->current_column + yyleng;   \
                         yylloc->last_column = yylloc->current_column;               \
                         yylloc->last_line = yylineno;                               \
-                        yylloc->current_line += yytext;}
+                        if (YY_START == INITIAL) yylloc->first_byte = yytext;       \
+                        yylloc->last_byte = yytext + yyleng;}
 
 
 
-#line 26 "lexer.cpp"
+#line 29 "lexer.cpp"
 
 #define  YY_INT_ALIGNED short int
 
@@ -1281,7 +1284,7 @@ static yyconst flex_int32_t yy_rule_can_match_eol[39] =
 
 
 
-#line 1285 "lexer.cpp"
+#line 1288 "lexer.cpp"
 
 #define INITIAL 0
 #define EMBED 1
@@ -1511,13 +1514,13 @@ YY_DECL
     register int yy_act;
     struct yyguts_t * yyg = (struct yyguts_t*)yyscanner;
 
-#line 61 "lexer.l"
+#line 64 "lexer.l"
 
     /********************************************************************/
     /* Rules Section */
     /********************************************************************/
 
-#line 1521 "lexer.cpp"
+#line 1524 "lexer.cpp"
 
     yylval = yylval_param;
 
@@ -1614,36 +1617,42 @@ do_action:    /* This label is used only to access EOF actions. */
 case 1:
 /* rule 1 can match eol */
 YY_RULE_SETUP
-#line 66 "lexer.l"
-{ yylloc->newline(); }
+#line 69 "lexer.l"
+{ yylloc->newline(yytext + yyleng); }
     YY_BREAK
 case 2:
 /* rule 2 can match eol */
 YY_RULE_SETUP
-#line 68 "lexer.l"
+#line 71 "lexer.l"
 ;    /* Skip whitespace */
     YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 70 "lexer.l"
+#line 73 "lexer.l"
 { return T_PERIOD; }
     YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 72 "lexer.l"
+#line 75 "lexer.l"
 { yylval->_int = (yytext[0] == 't' || yytext[0] == 'T');
                           return T_BOOLCONST; }
     YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 75 "lexer.l"
-{ yylval->_string = yytext;
+#line 78 "lexer.l"
+{ yylval->_span.text = yytext;
+                          yylval->_span.length = yyleng;
+                          yylval->_span.escaped = false;
                           return T_IDENTIFIER; }
     YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 78 "lexer.l"
-{ if (TipPod::stringToFloat(yytext, yylval->_float))
+#line 83 "lexer.l"
+{ yylval->_span.text = yytext;
+                          yylval->_span.length = yyleng;
+                          yylval->_span.escaped = false;
+                          if ((yyextra->flags & TipPod::PARSE_LAZY_SCALARS)
+                              || TipPod::stringToFloat(yytext, yyleng, yylval->_float))
                           {
                               return T_FLOAT; 
                           }
@@ -1657,8 +1666,12 @@ YY_RULE_SETUP
     YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 90 "lexer.l"
-{ if (TipPod::stringToInt(yytext, yylval->_int))
+#line 99 "lexer.l"
+{ yylval->_span.text = yytext;
+                          yylval->_span.length = yyleng;
+                          yylval->_span.escaped = false;
+                          if ((yyextra->flags & TipPod::PARSE_LAZY_SCALARS)
+                              || TipPod::stringToInt(yytext, yyleng, yylval->_int))
                           {
                             return T_INTEGER; 
                           }
@@ -1672,37 +1685,37 @@ YY_RULE_SETUP
     YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 101 "lexer.l"
+#line 114 "lexer.l"
 { return T_EQUAL; }
     YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 103 "lexer.l"
+#line 116 "lexer.l"
 { return T_SCOPE; }
     YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 105 "lexer.l"
+#line 118 "lexer.l"
 { return T_SEMICOLON; }
     YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 107 "lexer.l"
+#line 120 "lexer.l"
 { return T_OPENBRACE; }
     YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 109 "lexer.l"
+#line 122 "lexer.l"
 { return T_CLOSEBRACE; }
     YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 111 "lexer.l"
+#line 124 "lexer.l"
 { return T_OPENBRACKET; }
     YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 113 "lexer.l"
+#line 126 "lexer.l"
 { return T_CLOSEBRACKET; }
     YY_BREAK
 /********************************/
@@ -1710,7 +1723,7 @@ YY_RULE_SETUP
 /********************************/
 case 15:
 YY_RULE_SETUP
-#line 120 "lexer.l"
+#line 133 "lexer.l"
 { std::string lang(yytext);
                           lang = lang.substr(1, lang.size() - 2); /* Strip off the angle brackets */
                           yylval->_value = new TipPod::EmbedPodValue("", lang);
@@ -1720,7 +1733,7 @@ YY_RULE_SETUP
     YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 127 "lexer.l"
+#line 140 "lexer.l"
 { TipPod::EmbedPodValue* ev = dynamic_cast<TipPod::EmbedPodValue*>(yylval->_value);
                           if (yytext == "</" + ev->language() + ">")
                           {
@@ -1744,15 +1757,15 @@ YY_RULE_SETUP
 case 17:
 /* rule 17 can match eol */
 YY_RULE_SETUP
-#line 147 "lexer.l"
+#line 160 "lexer.l"
 { /* Accumulate text within the <> and </> tags */
                            yylval->_string += yytext;
-                           yylloc->newline();
+                           yylloc->newline(yytext + yyleng);
                         }
     YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 152 "lexer.l"
+#line 165 "lexer.l"
 {  /* Accumulate text within the <> and </> tags */
                            yylval->_string += yytext;
                         }
@@ -1763,123 +1776,130 @@ YY_RULE_SETUP
 case 19:
 /* rule 19 can match eol */
 YY_RULE_SETUP
-#line 161 "lexer.l"
-{ yylloc->newline(); } /* C++ style comment */
+#line 174 "lexer.l"
+{ yylloc->newline(yytext + yyleng); } /* C++ style comment */
     YY_BREAK
 case 20:
 /* rule 20 can match eol */
 YY_RULE_SETUP
-#line 162 "lexer.l"
-{ yylloc->newline(); } /* Script style comment */
+#line 175 "lexer.l"
+{ yylloc->newline(yytext + yyleng); } /* Script style comment */
     YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 163 "lexer.l"
+#line 176 "lexer.l"
 { BEGIN COMMENT; }     /* Begin C-style block comment */
     YY_BREAK
 case 22:
 /* rule 22 can match eol */
 YY_RULE_SETUP
-#line 164 "lexer.l"
-{ yylloc->newline(); } 
+#line 177 "lexer.l"
+{ yylloc->newline(yytext + yyleng); } 
     YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 165 "lexer.l"
+#line 178 "lexer.l"
 ;                      /* do nothing in comments */
     YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 166 "lexer.l"
+#line 179 "lexer.l"
 { BEGIN 0; } ;         /* end C-style block comment */
     YY_BREAK
 /************/
 /* Strings */
 /************/
+/*
+       The token is the span of the source text between the quotes.  The 
+       escape rules only note that the span needs decoding, which is done
+       by TipPod::unescapeString() (so keep the two in sync).
+    */
 case 25:
 YY_RULE_SETUP
-#line 175 "lexer.l"
-{ yylval->_string.clear();
+#line 193 "lexer.l"
+{ yylval->_span.text = yytext + 1;
+                          yylval->_span.escaped = false;
                           BEGIN STRING;           
                         }
     YY_BREAK
 case 26:
 /* rule 26 can match eol */
 YY_RULE_SETUP
-#line 179 "lexer.l"
-{ yylval->_string += "\n"; yylloc->newline(); }
+#line 198 "lexer.l"
+{ yylval->_span.escaped |= (yyleng > 1); /* "\r\n" is stored as "\n" */
+                          yylloc->newline(yytext + yyleng); }
     YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 180 "lexer.l"
-{ yylval->_string += "\b"; }
+#line 200 "lexer.l"
+{ yylval->_span.escaped = true; }
     YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 181 "lexer.l"
-{ yylval->_string += "\t"; }
+#line 201 "lexer.l"
+{ yylval->_span.escaped = true; }
     YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 182 "lexer.l"
-{ yylval->_string += "\n"; }
+#line 202 "lexer.l"
+{ yylval->_span.escaped = true; }
     YY_BREAK
 case 30:
 YY_RULE_SETUP
-#line 183 "lexer.l"
-{ yylval->_string += "\f"; }
+#line 203 "lexer.l"
+{ yylval->_span.escaped = true; }
     YY_BREAK
 case 31:
 YY_RULE_SETUP
-#line 184 "lexer.l"
-{ yylval->_string += "\r"; }
+#line 204 "lexer.l"
+{ yylval->_span.escaped = true; }
     YY_BREAK
 case 32:
 YY_RULE_SETUP
-#line 185 "lexer.l"
-{ yylval->_string += "\""; }
+#line 205 "lexer.l"
+{ yylval->_span.escaped = true; }
     YY_BREAK
 case 33:
 YY_RULE_SETUP
-#line 186 "lexer.l"
-{ yylval->_string += "'"; }
+#line 206 "lexer.l"
+;    /* Stored as is */
     YY_BREAK
 case 34:
 YY_RULE_SETUP
-#line 187 "lexer.l"
-{ yylval->_string += "\\"; }
+#line 207 "lexer.l"
+{ yylval->_span.escaped = true; }
     YY_BREAK
 case 35:
 YY_RULE_SETUP
-#line 188 "lexer.l"
-{
+#line 208 "lexer.l"
+{ yylval->_span.length = yytext - yylval->_span.text;
                           BEGIN 0;
                           return T_STRING;
                         }
     YY_BREAK
 case 36:
 YY_RULE_SETUP
-#line 192 "lexer.l"
-{ yylval->_string += yytext;}
+#line 212 "lexer.l"
+;    /* Part of the span */
     YY_BREAK
 case YY_STATE_EOF(INITIAL):
 case YY_STATE_EOF(EMBED):
 case YY_STATE_EOF(COMMENT):
 case YY_STATE_EOF(STRING):
-#line 195 "lexer.l"
+#line 215 "lexer.l"
 { yyterminate(); }
     YY_BREAK
 case 37:
 YY_RULE_SETUP
-#line 197 "lexer.l"
+#line 217 "lexer.l"
 { printf("Unknown token: '%s'\n", yytext); yyterminate(); }
     YY_BREAK
 case 38:
 YY_RULE_SETUP
-#line 201 "lexer.l"
+#line 221 "lexer.l"
 ECHO;
     YY_BREAK
-#line 1883 "lexer.cpp"
+#line 1903 "lexer.cpp"
 
     case YY_END_OF_BUFFER:
         {
@@ -3058,7 +3078,7 @@ void yyfree (void * ptr , yyscan_t yyscanner)
 
 #define YYTABLES_NAME "yytables"
 
-#line 201 "lexer.l"
+#line 221 "lexer.l"
 
 
     /********************************************************************/
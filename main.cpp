@@ -8,14 +8,357 @@
 #include <stdio.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include "TipPod.h"
+#include "TipPodDiff.h"
+#include "TipPodDiskCache.h"
+#include "TipPodJson.h"
+#include "TipPodMerge.h"
+#include "TipPodSnapshot.h"
+#include "TipPodValue.h"
+#include "TipPodWire.h"
 #include "parser.h"
 #include "lexer.h"
 
 using namespace TipPod;
 
+
+// *****************************************************************************
+static bool hasExtension(const std::string& filename, const std::string& ext)
+{
+    return filename.size() >= ext.size() 
+           && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+
+// *****************************************************************************
+static bool isPodb(const std::string& filename)
+{
+    return hasExtension(filename, ".podb");
+}
+
+
 // *****************************************************************************
+static bool isJson(const std::string& filename)
+{
+    return hasExtension(filename, ".json");
+}
+
+
+// *****************************************************************************
+static bool isWire(const std::string& filename)
+{
+    return hasExtension(filename, ".podw");
+}
+
+
+// *****************************************************************************
+static std::string readWhole(const std::string& filename)
+{
+    std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Could not open " + filename);
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+
+// *****************************************************************************
+static PodNode* readJson(const std::string& filename)
+{
+    return fromJson(readWhole(filename), filename);
+}
+
+
+// *****************************************************************************
+//
+// The first message in a file of pod wire messages
+//
+static PodNode* readWire(const std::string& filename)
+{
+    const std::string data = readWhole(filename);
+    PodWireReader reader(data.data(), data.size());
+    PodNode* rootNode = reader.read();
+    if (!rootNode)
+    {
+        throw std::runtime_error("No pod wire message in " + filename);
+    }
+    return rootNode;
+}
+
+
+// *****************************************************************************
+//
+// Convert between .pod, .podb, .json and .podw (pod wire message) files,
+// going by the file extensions.  Any other combination (.pod to .pod, .podb to .podb) works
+// too.
+//
+static void convert(const std::string& input, const std::string& output)
+{
+    PodSnapshot* snapshot = NULL;
+    PodNode* rootNode = NULL;
+    try
+    {
+        if (isPodb(input))
+        {
+            snapshot = PodSnapshot::load(input);
+        }
+        else if (isJson(input))
+        {
+            rootNode = readJson(input);
+        }
+        else if (isWire(input))
+        {
+            rootNode = readWire(input);
+        }
+        else
+        {
+            rootNode = parseFile(input);
+        }
+
+        if (isPodb(output))
+        {
+            if (!snapshot) snapshot = freeze(*rootNode);
+            snapshot->save(output);
+        }
+        else
+        {
+            if (!rootNode && (isJson(output) || isWire(output)))
+            {
+                rootNode = snapshot->root().thaw();
+            }
+            std::ofstream file(output.c_str(), std::ios::out | std::ios::binary);
+            if (rootNode && isJson(output))
+            {
+                toJson(*rootNode, file);
+            }
+            else if (rootNode && isWire(output))
+            {
+                PodWireWriter writer(file);
+                writer.write(*rootNode);
+            }
+            else if (rootNode)
+            {
+                rootNode->write(file);
+            }
+            else
+            {
+                snapshot->root().write(file);
+            }
+            file.close();
+            if (!file)
+            {
+                throw std::runtime_error("Could not write " + output);
+            }
+        }
+    }
+    catch (...)
+    {
+        delete snapshot;
+        delete rootNode;
+        throw;
+    }
+    delete snapshot;
+    delete rootNode;
+}
+
+
+// *****************************************************************************
+//
+// Write a pod back out as it was, comments and all, with the value at
+// 'path' set to 'value' (pod text, such as 1.5 or "text") if given
+//
+static void rewrite(const std::string& input, const std::string& output,
+                    const std::string& path, const std::string& value)
+{
+    PodNode* rootNode = parseFile(input, PARSE_KEEP_FORMAT);
+    PodNode* valueNode = NULL;
+    try
+    {
+        if (!path.empty())
+        {
+            PodNode* node = rootNode->find(path);
+            if (!node)
+            {
+                throw std::runtime_error("No " + path + " in " + input);
+            }
+            valueNode = parseText("value = " + value + ";");
+            const PodNode* newValue = valueNode->childByName("value");
+            if (newValue->isBlock())
+            {
+                throw std::runtime_error("Can't set " + path + " to a block, only to a single value");
+            }
+            node->setValue(*newValue);
+        }
+
+        std::ofstream file(output.c_str());
+        rootNode->write(file);
+        file.close();
+        if (!file)
+        {
+            throw std::runtime_error("Could not write " + output);
+        }
+    }
+    catch (...)
+    {
+        delete valueNode;
+        delete rootNode;
+        throw;
+    }
+    delete valueNode;
+    delete rootNode;
+}
+
+
+// *****************************************************************************
+//
+// Parse a pod through a PodDiskCache in 'directory', write it to output,
+// and print what the cache did
+//
+static void parseCached(const std::string& directory, const std::string& input,
+                        const std::string& output, size_t maxBytes, bool verifyContent)
+{
+    PodDiskCache cache(directory, maxBytes, verifyContent);
+    PodNode* rootNode = cache.parseFile(input);
+    std::ofstream file(output.c_str());
+    rootNode->write(file);
+    delete rootNode;
+    file.close();
+    if (!file)
+    {
+        throw std::runtime_error("Could not write " + output);
+    }
+
+    const PodDiskCacheStats stats = cache.stats();
+    std::cout << "hits " << stats.hits << " misses " << stats.misses
+              << " stale " << stats.stale << " stores " << stats.stores
+              << " evictions " << stats.evictions << std::endl;
+}
+
+
+// *****************************************************************************
+//
+// A node's type and value, on one line
+//
+static std::string describe(const PodNode& node)
+{
+    std::ostringstream text;
+    if (!node.podType().empty()) text << node.podType() << " ";
+    if (node.isBlock())
+    {
+        const size_t size = node.asBlock().size();
+        text << "{ " << size << (size == 1 ? " node }" : " nodes }");
+    }
+    else if (node.value())
+    {
+        node.value()->write(text, 0);
+    }
+    return text.str();
+}
+
+
+// *****************************************************************************
+//
+// Print what changed from one pod to another, a line each:
+//
+//     - path                    Removed
+//     + path = value            Added
+//     ~ path: value -> value    Changed
+//
+static void printDiff(const std::string& before, const std::string& after)
+{
+    PodNode* beforeNode = parseFile(before);
+    PodNode* afterNode = NULL;
+    try
+    {
+        afterNode = parseFile(after);
+        const std::vector<PodDiffEntry> changes = diff(*beforeNode, *afterNode);
+        for (size_t i = 0; i < changes.size(); ++i)
+        {
+            const PodDiffEntry& entry = changes[i];
+            switch (entry.kind)
+            {
+                case PodDiffEntry::REMOVED:
+                    std::cout << "- " << entry.path << std::endl;
+                    break;
+                case PodDiffEntry::ADDED:
+                    std::cout << "+ " << entry.path << " = " << describe(*entry.after) << std::endl;
+                    break;
+                case PodDiffEntry::CHANGED:
+                    std::cout << "~ " << entry.path << ": " << describe(*entry.before)
+                              << " -> " << describe(*entry.after) << std::endl;
+                    break;
+            }
+        }
+    }
+    catch (...)
+    {
+        delete beforeNode;
+        delete afterNode;
+        throw;
+    }
+    delete beforeNode;
+    delete afterNode;
+}
+
+
+// *****************************************************************************
+//
+// Merge theirs' changes from base into ours, and write the result to
+// stdout.  Conflicts are listed on stderr, and kept as they are in ours.
+// Returns the number of conflicts.
+//
+static size_t printMerge(const std::string& base, const std::string& ours,
+                         const std::string& theirs)
+{
+    std::vector<PodNode*> nodes;
+    size_t conflicts = 0;
+    try
+    {
+        nodes.push_back(parseFile(base));
+        nodes.push_back(parseFile(ours));
+        nodes.push_back(parseFile(theirs));
+        const std::vector<PodMergeConflict> found = merge(*nodes[0], *nodes[1], *nodes[2]);
+        for (size_t i = 0; i < found.size(); ++i)
+        {
+            const PodMergeConflict& conflict = found[i];
+            std::cerr << "CONFLICT " << (conflict.path.empty() ? "(top level)" : conflict.path)
+                      << ": " << (conflict.base ? describe(*conflict.base) : "(none)")
+                      << ", ours " << (conflict.ours ? describe(*conflict.ours) : "(removed)")
+                      << ", theirs " << (conflict.theirs ? describe(*conflict.theirs) : "(removed)")
+                      << std::endl;
+        }
+        conflicts = found.size();
+        nodes[1]->write(std::cout);
+    }
+    catch (...)
+    {
+        for (size_t i = 0; i < nodes.size(); ++i) delete nodes[i];
+        throw;
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) delete nodes[i];
+    return conflicts;
+}
+
+
+// *****************************************************************************
+//
+// Usage:  parser file ...                    Parse and dump each file
+//         parser --convert input output      Convert between .pod, .podb, .json and .podw
+//         parser --rewrite input output [path value]
+//                                            Write a pod out keeping its formatting,
+//                                            setting one value first
+//         parser --diff before after         Print what changed between two pods
+//         parser --merge base ours theirs    Print the three-way merge, exit 1 if
+//                                            there were conflicts
+//         parser --cached [--verify] [--max-bytes n] directory input output
+//                                            Convert a pod through a PodDiskCache,
+//                                            printing its stats
+//
 int main(int argc, char **argv)
 {
     PodNode* rootNode = NULL;
@@ -26,6 +369,80 @@ int main(int argc, char **argv)
         yydebug = 0;
 #endif
 
+        if (argc > 1 && std::string(argv[1]) == "--convert")
+        {
+            if (argc != 4)
+            {
+                std::cerr << "Usage: " << argv[0] << " --convert input output" << std::endl;
+                return 1;
+            }
+            convert(argv[2], argv[3]);
+            return 0;
+        }
+
+        if (argc > 1 && std::string(argv[1]) == "--rewrite")
+        {
+            if (argc != 4 && argc != 6)
+            {
+                std::cerr << "Usage: " << argv[0] << " --rewrite input output [path value]"
+                          << std::endl;
+                return 1;
+            }
+            rewrite(argv[2], argv[3], argc == 6 ? argv[4] : "", argc == 6 ? argv[5] : "");
+            return 0;
+        }
+
+        if (argc > 1 && std::string(argv[1]) == "--diff")
+        {
+            if (argc != 4)
+            {
+                std::cerr << "Usage: " << argv[0] << " --diff before after" << std::endl;
+                return 1;
+            }
+            printDiff(argv[2], argv[3]);
+            return 0;
+        }
+
+        if (argc > 1 && std::string(argv[1]) == "--merge")
+        {
+            if (argc != 5)
+            {
+                std::cerr << "Usage: " << argv[0] << " --merge base ours theirs" << std::endl;
+                return 1;
+            }
+            return printMerge(argv[2], argv[3], argv[4]) ? 1 : 0;
+        }
+
+        if (argc > 1 && std::string(argv[1]) == "--cached")
+        {
+            bool verifyContent = false;
+            size_t maxBytes = PodDiskCache::DEFAULT_MAX_BYTES;
+            int i = 2;
+            for (; i < argc && argv[i][0] == '-'; ++i)
+            {
+                if (std::string(argv[i]) == "--verify")
+                {
+                    verifyContent = true;
+                }
+                else if (std::string(argv[i]) == "--max-bytes" && i + 1 < argc)
+                {
+                    maxBytes = strtoul(argv[++i], NULL, 10);
+                }
+                else
+                {
+                    break;
+                }
+            }
+            if (argc - i != 3)
+            {
+                std::cerr << "Usage: " << argv[0] << " --cached [--verify] [--max-bytes n] "
+                          << "directory input output" << std::endl;
+                return 1;
+            }
+            parseCached(argv[i], argv[i + 1], argv[i + 2], maxBytes, verifyContent);
+            return 0;
+        }
+
         for (int i = 1; i < argc; ++i)
         {
             rootNode = parseFile(argv[i]);
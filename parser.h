@@ -1,8 +1,9 @@
-/* A Bison parser, made by GNU Bison 3.0.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2013 Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
    This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
@@ -15,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -30,6 +31,10 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 #ifndef YY_YY_PARSER_H_INCLUDED
 # define YY_YY_PARSER_H_INCLUDED
 /* Debug traces.  */
@@ -40,7 +45,7 @@
 extern int yydebug;
 #endif
 /* "%code requires" blocks.  */
-#line 15 "parser.y" /* yacc.c:1909  */
+#line 15 "parser.y"
 
 
 #include <cstdarg>
@@ -61,14 +66,40 @@ struct YYLTYPE
     int last_line;
     int first_column;
     int last_column;
-    std::string sourcefile;
 
-    void newline() { current_column = 0; current_line.clear(); }
+    void newline(const char* next) { current_column = 0; line_begin = next; }
     int         current_column;
-    std::string current_line;
+    const char* line_begin;     /* Start of the current line in the source text */
+
+    const char* first_byte;     /* Span of the source text, for PARSE_KEEP_FORMAT */
+    const char* last_byte;
 };
 #define YYLTYPE_IS_DECLARED 1
 
+    /* Bison's own, but carrying the span of the source text along too */
+#define YYLLOC_DEFAULT(Current, Rhs, N)                                     \
+    do                                                                      \
+    {                                                                       \
+        if (N)                                                              \
+        {                                                                   \
+            (Current).first_line   = YYRHSLOC(Rhs, 1).first_line;           \
+            (Current).first_column = YYRHSLOC(Rhs, 1).first_column;         \
+            (Current).first_byte   = YYRHSLOC(Rhs, 1).first_byte;           \
+            (Current).last_line    = YYRHSLOC(Rhs, N).last_line;            \
+            (Current).last_column  = YYRHSLOC(Rhs, N).last_column;          \
+            (Current).last_byte    = YYRHSLOC(Rhs, N).last_byte;            \
+        }                                                                   \
+        else                                                                \
+        {                                                                   \
+            (Current).first_line   = (Current).last_line   =                \
+                YYRHSLOC(Rhs, 0).last_line;                                 \
+            (Current).first_column = (Current).last_column =                \
+                YYRHSLOC(Rhs, 0).last_column;                               \
+            (Current).first_byte   = (Current).last_byte   =                \
+                YYRHSLOC(Rhs, 0).last_byte;                                 \
+        }                                                                   \
+    } while (0)
+
 
     /* 
        The YYSTYPE struct takes the place of the more common '%union'
@@ -78,12 +109,13 @@ struct YYLTYPE
     */
 struct YYSTYPE
 {
-    YYSTYPE() : _token(0), _int(0), _float(0.0f), _string(), _node(NULL), _value(NULL) {}
+    YYSTYPE() : _token(0), _int(0), _float(0.0f), _string(), _span(), _node(NULL), _value(NULL) {}
 
     int                     _token;
     int                     _int;
     float                   _float;
     std::string             _string;
+    TipPod::LexerSpan       _span;
     TipPod::PodNode*        _node;
     TipPod::PodValue*       _value;
 };
@@ -94,29 +126,33 @@ void yyerror(YYLTYPE* llocp,
              const char *errmsg);
 
 
-#line 98 "parser.h" /* yacc.c:1909  */
+#line 130 "parser.h"
 
-/* Token type.  */
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
   enum yytokentype
   {
-    END = 0,
-    T_IDENTIFIER = 258,
-    T_STRING = 259,
-    T_FLOAT = 260,
-    T_INTEGER = 261,
-    T_BOOLCONST = 262,
-    T_EMBED = 263,
-    T_SCOPE = 264,
-    T_EQUAL = 265,
-    T_PERIOD = 266,
-    T_SEMICOLON = 267,
-    T_OPENBRACE = 268,
-    T_CLOSEBRACE = 269,
-    T_OPENBRACKET = 270,
-    T_CLOSEBRACKET = 271
+    YYEMPTY = -2,
+    END = 0,                       /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    T_IDENTIFIER = 258,            /* "identifier"  */
+    T_STRING = 259,                /* "string"  */
+    T_FLOAT = 260,                 /* "float"  */
+    T_INTEGER = 261,               /* "integer"  */
+    T_BOOLCONST = 262,             /* "boolean"  */
+    T_EMBED = 263,                 /* "embed tag"  */
+    T_SCOPE = 264,                 /* "::"  */
+    T_EQUAL = 265,                 /* "="  */
+    T_PERIOD = 266,                /* "."  */
+    T_SEMICOLON = 267,             /* ";"  */
+    T_OPENBRACE = 268,             /* "{"  */
+    T_CLOSEBRACE = 269,            /* "}"  */
+    T_OPENBRACKET = 270,           /* "["  */
+    T_CLOSEBRACKET = 271           /* "]"  */
   };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
 
 /* Value type.  */
@@ -137,6 +173,8 @@ struct YYLTYPE
 
 
 
+
 int yyparse (void *scanner, TipPod::LexerContext *ctx);
 
+
 #endif /* !YY_YY_PARSER_H_INCLUDED  */
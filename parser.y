@@ -32,14 +32,40 @@ struct YYLTYPE
     int last_line;
     int first_column;
     int last_column;
-    std::string sourcefile;
 
-    void newline() { current_column = 0; current_line.clear(); }
+    void newline(const char* next) { current_column = 0; line_begin = next; }
     int         current_column;
-    std::string current_line;
+    const char* line_begin;     /* Start of the current line in the source text */
+
+    const char* first_byte;     /* Span of the source text, for PARSE_KEEP_FORMAT */
+    const char* last_byte;
 };
 #define YYLTYPE_IS_DECLARED 1
 
+    /* Bison's own, but carrying the span of the source text along too */
+#define YYLLOC_DEFAULT(Current, Rhs, N)                                     \
+    do                                                                      \
+    {                                                                       \
+        if (N)                                                              \
+        {                                                                   \
+            (Current).first_line   = YYRHSLOC(Rhs, 1).first_line;           \
+            (Current).first_column = YYRHSLOC(Rhs, 1).first_column;         \
+            (Current).first_byte   = YYRHSLOC(Rhs, 1).first_byte;           \
+            (Current).last_line    = YYRHSLOC(Rhs, N).last_line;            \
+            (Current).last_column  = YYRHSLOC(Rhs, N).last_column;          \
+            (Current).last_byte    = YYRHSLOC(Rhs, N).last_byte;            \
+        }                                                                   \
+        else                                                                \
+        {                                                                   \
+            (Current).first_line   = (Current).last_line   =                \
+                YYRHSLOC(Rhs, 0).last_line;                                 \
+            (Current).first_column = (Current).last_column =                \
+                YYRHSLOC(Rhs, 0).last_column;                               \
+            (Current).first_byte   = (Current).last_byte   =                \
+                YYRHSLOC(Rhs, 0).last_byte;                                 \
+        }                                                                   \
+    } while (0)
+
 
     /* 
        The YYSTYPE struct takes the place of the more common '%union'
@@ -49,12 +75,13 @@ struct YYLTYPE
     */
 struct YYSTYPE
 {
-    YYSTYPE() : _token(0), _int(0), _float(0.0f), _string(), _node(NULL), _value(NULL) {}
+    YYSTYPE() : _token(0), _int(0), _float(0.0f), _string(), _span(), _node(NULL), _value(NULL) {}
 
     int                     _token;
     int                     _int;
     float                   _float;
     std::string             _string;
+    TipPod::LexerSpan       _span;
     TipPod::PodNode*        _node;
     TipPod::PodValue*       _value;
 };
@@ -92,8 +119,8 @@ void yyerror(YYLTYPE* llocp,
     /* Bison declarations */
     /********************************************************************/
 
-%term<_string>  T_IDENTIFIER    "identifier"
-%term<_string>  T_STRING        "string"
+%term<_span>    T_IDENTIFIER    "identifier"
+%term<_span>    T_STRING        "string"
 %term<_float>   T_FLOAT         "float"
 %term<_int>     T_INTEGER       "integer"
 %term<_int>     T_BOOLCONST     "boolean"
@@ -108,9 +135,9 @@ void yyerror(YYLTYPE* llocp,
 %token<_token>  T_CLOSEBRACKET  "]"
 %token END 0 "end of file"  /* Docs say "do this to make a nicer end-of-file error msg" */
 
-%type<_string>      identifier
-%type<_string>      variable_name
-%type<_string>      type_name
+%type<_span>        identifier
+%type<_span>        variable_name
+%type<_span>        type_name
 %type<_value>       pod_value
 %type<_value>       constant
 %type<_value>       block
@@ -118,6 +145,14 @@ void yyerror(YYLTYPE* llocp,
 
 %start pod_nodes
 
+%initial-action
+{
+    @$.first_line = @$.last_line = 1;
+    @$.first_column = @$.last_column = 0;
+    @$.newline(ctx->source->data());
+    @$.first_byte = @$.last_byte = ctx->source->data();
+}
+
 
     /********************************************************************/
     /* Grammar rules */
@@ -135,24 +170,27 @@ pod_nodes:
 pod_node: 
         type_name variable_name T_EQUAL pod_value T_SEMICOLON
         {
-            TipPod::PodNode* pn = new TipPod::PodNode($2, $1, $4);
+            TipPod::PodNode* pn = new TipPod::PodNode(ctx->str($2), ctx->str($1), $4);
             pn->setSource(ctx->sourcefile, yyget_lineno(scanner));
+            ctx->keepFormat(pn, @1.first_byte, @4.first_byte, @4.last_byte, @5.last_byte);
             ctx->current.second.push_back(pn);
             $$ = pn;
         }
     |   
         variable_name T_EQUAL pod_value T_SEMICOLON
         {
-            TipPod::PodNode* pn = new TipPod::PodNode($1, "", $3);
+            TipPod::PodNode* pn = new TipPod::PodNode(ctx->str($1), "", $3);
             pn->setSource(ctx->sourcefile, yyget_lineno(scanner));
+            ctx->keepFormat(pn, @1.first_byte, @3.first_byte, @3.last_byte, @4.last_byte);
             ctx->current.second.push_back(pn);
             $$ = pn;
         }
     | 
         type_name variable_name T_SEMICOLON
         {
-            TipPod::PodNode* pn = new TipPod::PodNode($2, $1);
+            TipPod::PodNode* pn = new TipPod::PodNode(ctx->str($2), ctx->str($1));
             pn->setSource(ctx->sourcefile, yyget_lineno(scanner));
+            ctx->keepFormat(pn, @1.first_byte, NULL, NULL, @3.last_byte);
             ctx->current.second.push_back(pn);
             $$ = pn;
         }
@@ -161,6 +199,7 @@ pod_node:
         {
             TipPod::PodNode* pn = new TipPod::PodNode("", "", $1);
             pn->setSource(ctx->sourcefile, yyget_lineno(scanner));
+            ctx->keepFormat(pn, @1.first_byte, @1.first_byte, @1.last_byte, @2.last_byte);
             ctx->current.second.push_back(pn);
             $$ = pn;
         }
@@ -175,23 +214,21 @@ variable_name:
     |
         identifier T_OPENBRACKET T_INTEGER T_CLOSEBRACKET
         {
-            std::cerr << "WARNING: Deprecated syntax '" << $1 
-                      << "[" << $3 << "]'" 
-                      << "in file '" << ctx->sourcefile << "', line " << yyget_lineno(scanner)
+            std::cerr << "WARNING: Deprecated syntax '" << ctx->str($1)
+                      << "[" << ctx->str($<_span>3) << "]'" 
+                      << "in file '" << ctx->source->name() << "', line " << yyget_lineno(scanner)
                       << std::endl;
             $$ = $1;
         }
     |
         identifier T_PERIOD identifier
         {
-            $1.append("." + $3);
-            $$ = $1;
+            $$ = ctx->join($1, ".", $3);
         }
     |
         type_name T_SCOPE identifier
         {
-            $1.append("::" + $3);
-            $$ = $1;
+            $$ = ctx->join($1, "::", $3);
         }
 ;
 
@@ -204,8 +241,7 @@ type_name:
     |
         type_name T_SCOPE identifier
         {
-            $1.append("::" + $3);
-            $$ = $1;
+            $$ = ctx->join($1, "::", $3);
         }
 ;
 
@@ -220,16 +256,15 @@ identifier:
 block_begin:
         T_OPENBRACE
         {
-            ctx->stack.push(ctx->current);
-            ctx->current.first.clear();
-            ctx->current.second.clear();
+            TipPod::LexerSpan noScopeType = { "", 0, false };
+            ctx->pushScope(noScopeType);
+            ctx->openBlockFormat(@1.last_byte);
         }
     |
         type_name T_OPENBRACE
         {
-            ctx->stack.push(ctx->current);
-            ctx->current.first = $1;
-            ctx->current.second.clear();
+            ctx->pushScope($1);
+            ctx->openBlockFormat(@2.last_byte);
         }
 ;
 
@@ -237,9 +272,9 @@ block_begin:
 block: 
         block_begin pod_nodes T_CLOSEBRACE
         {
-            TipPod::PodValue* pv = new TipPod::BlockPodValue(ctx->current.second, ctx->current.first);
-            ctx->current = ctx->stack.top();
-            ctx->stack.pop();
+            TipPod::BlockPodValue* pv = new TipPod::BlockPodValue;
+            ctx->popScope(pv);
+            ctx->closeBlockFormat();
 
             $$ = pv;
         }
@@ -249,13 +284,13 @@ block:
 constant:
         T_INTEGER
         {
-            TipPod::PodValue* pv = new TipPod::IntPodValue(int($1));
+            TipPod::PodValue* pv = ctx->newIntValue($<_span>1, $1);
             $$ = pv;
         }
     |
         T_FLOAT
         {
-            TipPod::PodValue* pv = new TipPod::FloatPodValue(float($1));
+            TipPod::PodValue* pv = ctx->newFloatValue($<_span>1, $1);
             $$ = pv;
         }
     | 
@@ -267,7 +302,7 @@ constant:
     | 
         T_STRING
         {
-            TipPod::PodValue* pv = new TipPod::StringPodValue($1);
+            TipPod::PodValue* pv = ctx->newStringValue($1);
             $$ = pv;
         }
     | 
@@ -286,7 +321,7 @@ pod_value:
             }
           | variable_name
             { 
-                TipPod::PodValue* pv = new TipPod::IdentifierPodValue($1);
+                TipPod::PodValue* pv = ctx->newIdentifierValue($1);
                 $$ = pv;
             }
 ;
@@ -308,7 +343,7 @@ void yyerror(YYLTYPE* llocp,
     std::ostringstream err;
 
     err << errmsg;
-    err << " in file '" << ctx->sourcefile;
+    err << " in file '" << ctx->source->name();
     err << "', line " << llocp->first_line;
     err << ", column " << llocp->first_column;
     if (llocp->last_line != llocp->first_line)
@@ -322,9 +357,9 @@ void yyerror(YYLTYPE* llocp,
     }
     err << std::endl;
 
-    // TODO: Figure out how to print the whole line, rather than just
-    // the start up to the error.
-    err << std::endl << llocp->current_line << std::endl;
+    const char* line_end = llocp->line_begin;
+    while (*line_end && *line_end != '\n' && *line_end != '\r') ++line_end;
+    err << std::endl << std::string(llocp->line_begin, line_end) << std::endl;
     for (size_t i = 0; i < llocp->first_column; ++i) err << " ";
     for (size_t i = llocp->first_column; i < llocp->last_column; ++i) err << "^";
 
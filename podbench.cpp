@@ -0,0 +1,1853 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "TipPod.h"
+#include "TipPodDiff.h"
+#include "TipPodDiskCache.h"
+#include "TipPodDocumentCache.h"
+#include "TipPodJson.h"
+#include "TipPodMerge.h"
+#include "TipPodNodeIndex.h"
+#include "TipPodOverlay.h"
+#include "TipPodPath.h"
+#include "TipPodQuery.h"
+#include "TipPodResolver.h"
+#include "TipPodSelector.h"
+#include "TipPodSharedStore.h"
+#include "TipPodSnapshot.h"
+#include "TipPodSnapshotIndex.h"
+#include "TipPodUtils.h"
+#include "TipPodValue.h"
+#include "TipPodWire.h"
+#include "TipPodWriteBuffer.h"
+#include "TipPodWriter.h"
+
+using namespace TipPod;
+
+
+// *****************************************************************************
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+// *****************************************************************************
+static double median(std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+
+// *****************************************************************************
+static void report(const std::string& what, const std::vector<double>& times)
+{
+    std::cout << "    " << what;
+    for (size_t i = what.size(); i < 32; ++i) std::cout << " ";
+    std::cout << median(times) * 1000.0 << " ms" << std::endl;
+}
+
+
+// *****************************************************************************
+//
+// Time for a job to get at the first node of a pod: parsing it directly,
+// through an empty disk cache (cold), and through a full one (warm).
+//
+static int benchCache(const std::string& directory, const std::string& filename, int runs)
+{
+    std::vector<double> parse, cold, warm;
+    for (int i = 0; i < runs; ++i)
+    {
+        double start = now();
+        PodNode* rootNode = parseFile(filename);
+        rootNode->asBlock().front();
+        parse.push_back(now() - start);
+        delete rootNode;
+
+        PodDiskCache(directory).clear();
+
+        start = now();
+        PodDiskCache coldCache(directory);
+        PodSnapshot* snapshot = coldCache.load(filename);
+        snapshot->root().asBlock()[0];
+        cold.push_back(now() - start);
+        delete snapshot;
+
+        start = now();
+        PodDiskCache warmCache(directory);
+        snapshot = warmCache.load(filename);
+        snapshot->root().asBlock()[0];
+        warm.push_back(now() - start);
+        delete snapshot;
+
+        if (warmCache.stats().hits != 1 || coldCache.stats().stores != 1)
+        {
+            std::cerr << "ERROR: cache did not behave as expected" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << filename << ", median of " << runs << " runs:" << std::endl;
+    report("parseFile", parse);
+    report("cold cache (parse + store)", cold);
+    report("warm cache (mmap)", warm);
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Time to get a pod through an in-process PodDocumentCache, on a miss
+// (parse + freeze) and on a hit.
+//
+static int benchMemoryCache(const std::string& filename, int runs)
+{
+    std::vector<double> miss, hit;
+    for (int i = 0; i < runs; ++i)
+    {
+        PodDocumentCache cache;
+
+        double start = now();
+        PodDocumentHandle document = cache.get(filename);
+        document->root().asBlock()[0];
+        miss.push_back(now() - start);
+
+        start = now();
+        document = cache.get(filename);
+        document->root().asBlock()[0];
+        hit.push_back(now() - start);
+
+        if (cache.stats().hits != 1 || cache.stats().misses != 1)
+        {
+            std::cerr << "ERROR: cache did not behave as expected" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << filename << ", median of " << runs << " runs:" << std::endl;
+    report("miss (parse + freeze)", miss);
+    report("hit", hit);
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Many processes starting at once and all wanting the same pod from a
+// PodSharedStore: one parses and publishes it, and the rest wait and map it.
+// Each process reports how long it took and what it did.
+//
+static int benchSharedStore(const std::string& directory, const std::string& filename,
+                            int processes)
+{
+    PodSharedStore(directory).clear();
+
+    std::cout << filename << ", " << processes << " processes:" << std::endl;
+    for (int i = 0; i < processes; ++i)
+    {
+        if (fork() == 0)
+        {
+            const double start = now();
+            PodSharedStore store(directory);
+            PodDocumentHandle document = store.get(filename);
+            document->root().asBlock()[0];
+            const PodSharedStoreStats stats = store.stats();
+            std::cout << "    " << i << ": " << (now() - start) * 1000.0 << " ms"
+                      << (stats.publishes ? ", published" : stats.waits ? ", waited" : ", mapped")
+                      << std::endl;
+            _exit(0);
+        }
+    }
+
+    int failures = 0;
+    for (int i = 0; i < processes; ++i)
+    {
+        int status;
+        wait(&status);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failures;
+    }
+    PodSharedStore(directory).clear();
+    return failures ? 1 : 0;
+}
+
+
+// *****************************************************************************
+//
+// The way callers looked up paths before PodPath: split the path and call
+// childByName() for each part.
+//
+static const PodNode* findByHand(const PodNode* node, const std::string& path)
+{
+    size_t start = 0;
+    while (node && start < path.size())
+    {
+        size_t end = path.find('.', start);
+        if (end == std::string::npos) end = path.size();
+        if (!node->isBlock()) return NULL;
+        node = node->childByName(path.substr(start, end - start));
+        start = end + 1;
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+static void reportPerLookup(const std::string& what, double seconds, int lookups)
+{
+    std::cout << "    " << what;
+    for (size_t i = what.size(); i < 32; ++i) std::cout << " ";
+    std::cout << seconds / lookups * 1e9 << " ns" << std::endl;
+}
+
+
+// *****************************************************************************
+//
+// Time to look up the same path over and over, in a parsed pod and in a
+// snapshot of it.
+//
+static int benchPath(const std::string& filename, const std::string& path, int lookups)
+{
+    PodNode* rootNode = parseFile(filename);
+    PodSnapshot* snapshot = freeze(*rootNode);
+    const PodNodeView rootView = snapshot->root();
+    const PodPath podPath(path);
+
+    const PodNode* expected = podPath.find(*rootNode);
+    if (!expected || rootNode->find(path) != expected || rootView.find(path).isNull())
+    {
+        std::cerr << "ERROR: " << path << " not found the same way by every method" << std::endl;
+        delete snapshot;
+        delete rootNode;
+        return 1;
+    }
+
+    // Only plain names can be found by hand
+    const bool canFindByHand = findByHand(rootNode, path) == expected;
+    size_t found = 0;
+    double start = now();
+    for (int i = 0; canFindByHand && i < lookups; ++i) found += findByHand(rootNode, path) != NULL;
+    const double byHand = now() - start;
+
+    start = now();
+    for (int i = 0; i < lookups; ++i) found += rootNode->find(path) != NULL;
+    const double byString = now() - start;
+
+    start = now();
+    for (int i = 0; i < lookups; ++i) found += podPath.find(*rootNode) != NULL;
+    const double compiled = now() - start;
+
+    start = now();
+    for (int i = 0; i < lookups; ++i) found += !podPath.find(rootView).isNull();
+    const double compiledView = now() - start;
+
+    std::cout << filename << " " << path << ", " << lookups << " lookups:" << std::endl;
+    if (canFindByHand) reportPerLookup("childByName() chain", byHand, lookups);
+    reportPerLookup("PodNode::find()", byString, lookups);
+    reportPerLookup("PodPath, PodNode", compiled, lookups);
+    reportPerLookup("PodPath, PodNodeView", compiledView, lookups);
+
+    delete snapshot;
+    delete rootNode;
+    return found == size_t(lookups) * (canFindByHand ? 4 : 3) ? 0 : 1;
+}
+
+
+// *****************************************************************************
+static void collectByType(PodNode* node, const std::string& podType, std::vector<PodNode*>& found)
+{
+    if (!node->isBlock()) return;
+    const PodNodeDeque& block = static_cast<const PodNode*>(node)->asBlock();
+    for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+    {
+        if ((*iter)->podType() == podType) found.push_back(*iter);
+        collectByType(*iter, podType, found);
+    }
+}
+
+
+// *****************************************************************************
+//
+// Time to find every node of a type by walking the tree and with a
+// PodNodeIndex, and what keeping the index up to date adds to changes.
+//
+static int benchIndex(const std::string& filename, const std::string& podType, int runs)
+{
+    PodNode* rootNode = parseFile(filename);
+
+    std::vector<double> walk, indexed, build, renames, values;
+    size_t walked = 0, found = 0;
+    PodNodeIndex* index = NULL;
+    for (int i = 0; i < runs; ++i)
+    {
+        double start = now();
+        std::vector<PodNode*> nodes;
+        collectByType(rootNode, podType, nodes);
+        walk.push_back(now() - start);
+        walked = nodes.size();
+
+        delete index;
+        start = now();
+        index = new PodNodeIndex(*rootNode);
+        build.push_back(now() - start);
+
+        start = now();
+        found = index->byType(podType).size();
+        indexed.push_back(now() - start);
+    }
+
+    // Change every node of the type, with and without the index watching.
+    // Values are only set on leaves, so as not to delete any of the others.
+    std::vector<PodNode*> nodes, leaves;
+    collectByType(rootNode, podType, nodes);
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        if (!nodes[i]->isBlock()) leaves.push_back(nodes[i]);
+    }
+    for (int watched = 1; watched >= 0; --watched)
+    {
+        if (!watched)
+        {
+            delete index;
+            index = NULL;
+        }
+        double start = now();
+        for (size_t i = 0; i < nodes.size(); ++i) nodes[i]->setPodName(nodes[i]->podName() + "_");
+        renames.push_back(now() - start);
+        start = now();
+        for (size_t i = 0; i < leaves.size(); ++i) leaves[i]->setValue(int(i));
+        values.push_back(now() - start);
+    }
+
+    std::cout << filename << " " << podType << ", " << found << " nodes:" << std::endl;
+    report("Tree walk", walk);
+    report("PodNodeIndex::byType()", indexed);
+    report("Building the index", build);
+    report("setPodName() each, indexed", std::vector<double>(1, renames[0]));
+    report("setPodName() each, no index", std::vector<double>(1, renames[1]));
+    report("setValue() each leaf, indexed", std::vector<double>(1, values[0]));
+    report("setValue() each leaf, no index", std::vector<double>(1, values[1]));
+
+    delete rootNode;
+    return found == walked ? 0 : 1;
+}
+
+
+// *****************************************************************************
+static PodNode* deepestLeaf(PodNode* node)
+{
+    while (node->isBlock() && !node->asBlock().empty())
+    {
+        node = node->asBlock().back();
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+//
+// How PodNode::write() worked before PodWriteBuffer: a piece at a time to
+// the stream, flushing every line
+//
+static void writeByHand(const PodNode& node, std::ostream& output, int indent)
+{
+    const bool topLevel = !node.parent() && node.podName().empty() && node.podType().empty();
+    if (!topLevel)
+    {
+        for (int i = 0; i < indent; ++i) output << "    ";
+        if (!node.podType().empty()) output << node.podType() << " ";
+        if (!node.podName().empty()) output << node.podName();
+        if (node.valueType() != PodNode::UNDEFINED && !node.podName().empty()) output << " = ";
+    }
+
+    switch (node.valueType())
+    {
+        case PodNode::BLOCK:
+            {
+                if (!topLevel)
+                {
+                    if (!node.blockScopeType().empty()) output << node.blockScopeType() << " ";
+                    output << "{" << std::endl;
+                }
+                const PodNodeDeque& block = node.asBlock();
+                for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+                {
+                    writeByHand(**iter, output, topLevel ? indent : indent + 1);
+                }
+                if (topLevel) return;
+                for (int i = 0; i < indent; ++i) output << "    ";
+                output << "}";
+            }
+            break;
+        case PodNode::STRING:
+            {
+                std::string text(node.asString());
+                for (size_t pos = 0; (pos = text.find('"', pos)) != std::string::npos; pos += 2)
+                {
+                    text.replace(pos, 1, "\\\"");
+                }
+                output << "\"" << text << "\"";
+            }
+            break;
+        case PodNode::FLOAT:
+            {
+                char tmp[32];
+                snprintf(tmp, 32, "%0.8g", node.asFloat());
+                output << tmp << (strchr(tmp, '.') ? "" : ".0");
+            }
+            break;
+        case PodNode::INT:
+            output << node.asInt();
+            break;
+        default:
+            node.value()->write(output, indent);
+            break;
+    }
+    output << ";" << std::endl;
+}
+
+
+// *****************************************************************************
+static void reportRate(const std::string& what, const std::vector<double>& times, size_t bytes)
+{
+    std::cout << "    " << what;
+    for (size_t i = what.size(); i < 32; ++i) std::cout << " ";
+    std::cout << median(times) * 1000.0 << " ms, "
+              << bytes / median(times) / (1024 * 1024) << " MB/s" << std::endl;
+}
+
+
+// *****************************************************************************
+//
+// Time to write a parsed pod to a file the way write() used to, with
+// write() to a stream and straight to a file descriptor, and into memory.
+//
+static int benchWrite(const std::string& filename, const std::string& output, int runs)
+{
+    PodNode* rootNode = parseFile(filename);
+    std::vector<double> byHand, stream, fd, memory;
+    size_t bytes = 0;
+    for (int i = 0; i < runs; ++i)
+    {
+        double start = now();
+        {
+            std::ofstream file(output.c_str());
+            writeByHand(*rootNode, file, 0);
+        }
+        byHand.push_back(now() - start);
+
+        start = now();
+        {
+            std::ofstream file(output.c_str());
+            rootNode->write(file);
+        }
+        stream.push_back(now() - start);
+
+        start = now();
+        const int descriptor = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (descriptor < 0)
+        {
+            throw std::runtime_error(output + ": " + strerror(errno));
+        }
+        {
+            PodWriteBuffer buffer(descriptor);
+            rootNode->write(buffer);
+            buffer.flush();
+        }
+        close(descriptor);
+        fd.push_back(now() - start);
+
+        start = now();
+        PodWriteBuffer buffer;
+        rootNode->write(buffer);
+        bytes = buffer.size();
+        memory.push_back(now() - start);
+    }
+
+    std::cout << filename << ", " << bytes / 1024 << " KB:" << std::endl;
+    reportRate("By hand, a piece at a time", byHand, bytes);
+    reportRate("write(), to a stream", stream, bytes);
+    reportRate("write(), to a file descriptor", fd, bytes);
+    reportRate("write(), into memory", memory, bytes);
+
+    delete rootNode;
+    return 0;
+}
+
+
+// *****************************************************************************
+static void writeToFile(const PodNode& node, const std::string& output)
+{
+    const int descriptor = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0)
+    {
+        throw std::runtime_error(output + ": " + strerror(errno));
+    }
+    PodWriteBuffer buffer(descriptor);
+    node.write(buffer);
+    buffer.flush();
+    close(descriptor);
+}
+
+
+// *****************************************************************************
+//
+// Time to parse a pod as usual and with PARSE_KEEP_FORMAT, and to save it
+// to a file after changing one value deep in it, against copying the file.
+//
+static int benchRewrite(const std::string& filename, const std::string& output, int runs)
+{
+    std::string text;
+    {
+        std::ifstream file(filename.c_str(), std::ios::binary);
+        text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::vector<double> parsed, parsedKeeping, copied, written, kept;
+    size_t keptBytes = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        double start = now();
+        PodNode* rootNode = parseFile(filename);
+        parsed.push_back(now() - start);
+        start = now();
+        PodNode* keptNode = parseFile(filename, PARSE_KEEP_FORMAT);
+        parsedKeeping.push_back(now() - start);
+
+        start = now();
+        {
+            const int descriptor = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            PodWriteBuffer buffer(descriptor);
+            buffer.append(text);
+            buffer.flush();
+            close(descriptor);
+        }
+        copied.push_back(now() - start);
+
+        deepestLeaf(rootNode)->setValue(run + 1);
+        start = now();
+        writeToFile(*rootNode, output);
+        written.push_back(now() - start);
+
+        deepestLeaf(keptNode)->setValue(run + 1);
+        start = now();
+        writeToFile(*keptNode, output);
+        kept.push_back(now() - start);
+
+        PodWriteBuffer keptText;
+        keptNode->write(keptText);
+        keptBytes = keptText.size();
+        delete keptNode;
+        delete rootNode;
+    }
+
+    std::cout << filename << ", " << text.size() / 1024 << " KB, one value changed, "
+              << keptBytes / 1024 << " KB written keeping its format:" << std::endl;
+    report("Parse", parsed);
+    report("Parse with PARSE_KEEP_FORMAT", parsedKeeping);
+    reportRate("Copying the file", copied, text.size());
+    reportRate("write()", written, text.size());
+    reportRate("write(), keeping its format", kept, text.size());
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Time to format a pod full of computed floats the way write() used to
+// ("%0.8g", which doesn't always read back the same) and with
+// formatFloat(), and to write the whole pod each way.
+//
+static int benchFloats(int count, int runs)
+{
+    std::vector<float> values(count);
+    srand(1);
+    for (int i = 0; i < count; ++i)
+    {
+        // Mostly scene-sized numbers, some tiny or huge
+        const double scale = i % 10 ? 1000.0 : pow(10.0, rand() % 40 - 20);
+        values[i] = float((rand() / double(RAND_MAX) - 0.5) * scale);
+    }
+
+    PodNode rootNode;
+    PodNodeDeque rows;
+    for (int i = 0; i < count; i += 100)
+    {
+        PodNodeDeque row;
+        for (int j = i; j < count && j < i + 100; ++j)
+        {
+            row.push_back(new PodNode());
+            row.back()->setValue(values[j]);
+        }
+        rows.push_back(new PodNode("", "", NULL));
+        rows.back()->setValue(row, "");
+    }
+    rootNode.setValue(rows, "");
+
+    std::vector<double> printed, formatted, byHand, written;
+    size_t printedBytes = 0, formattedBytes = 0, podBytes = 0;
+    size_t printedWrong = 0, formattedWrong = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        char text[32];
+        double start = now();
+        printedBytes = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            printedBytes += snprintf(text, sizeof(text), "%0.8g", values[i]);
+            if (!strchr(text, '.')) printedBytes += 2;
+        }
+        printed.push_back(now() - start);
+
+        start = now();
+        formattedBytes = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            formattedBytes += formatFloat(values[i], text);
+        }
+        formatted.push_back(now() - start);
+
+        start = now();
+        {
+            std::ostringstream output;
+            writeByHand(rootNode, output, 0);
+        }
+        byHand.push_back(now() - start);
+
+        start = now();
+        PodWriteBuffer buffer;
+        rootNode.write(buffer);
+        podBytes = buffer.size();
+        written.push_back(now() - start);
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%0.8g", values[i]);
+        printedWrong += strtof(text, NULL) != values[i];
+        text[formatFloat(values[i], text)] = '\0';
+        formattedWrong += strtof(text, NULL) != values[i];
+    }
+
+    std::cout << count << " floats:" << std::endl;
+    reportRate("\"%0.8g\"", printed, printedBytes);
+    reportRate("formatFloat()", formatted, formattedBytes);
+    reportRate("Whole pod, by hand", byHand, podBytes);
+    reportRate("Whole pod, write()", written, podBytes);
+    std::cout << "    Read back differently: " << printedWrong << " with \"%0.8g\", "
+              << formattedWrong << " with formatFloat()" << std::endl;
+    std::cout << "    Average length: " << double(printedBytes) / count << " with \"%0.8g\", "
+              << double(formattedBytes) / count << " with formatFloat()" << std::endl;
+    return formattedWrong != 0;
+}
+
+
+// *****************************************************************************
+//
+// Time to escape strings for writing the way write() used to (copying each
+// string, and replacing quotes one at a time) and with appendEscaped(),
+// for plain text, text full of quotes, and Windows paths and multi-line
+// text.  Each escaped string must unescape to the original.
+//
+static int benchStrings(int count, int runs)
+{
+    const char* kinds[] = { "plain", "quotes", "paths and lines" };
+    srand(1);
+    int wrong = 0;
+    for (int kind = 0; kind < 3; ++kind)
+    {
+        std::vector<std::string> strings(count);
+        size_t bytes = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            std::ostringstream text;
+            switch (kind)
+            {
+                case 0:
+                    text << "some string value " << rand() << " without anything to escape";
+                    break;
+                case 1:
+                    for (int j = 0; j < 8; ++j) text << "\"q" << rand() % 100 << "\"";
+                    break;
+                default:
+                    text << "C:\\shots\\seq" << rand() % 100 << "\\take\tnotes:\nline two\r\n";
+                    break;
+            }
+            strings[i] = text.str();
+            bytes += strings[i].size();
+        }
+
+        std::vector<double> byHand, escaped;
+        for (int run = 0; run < runs; ++run)
+        {
+            double start = now();
+            PodWriteBuffer oldBuffer;
+            for (int i = 0; i < count; ++i)
+            {
+                std::string text(strings[i]);
+                for (size_t pos = 0; (pos = text.find('"', pos)) != std::string::npos; pos += 2)
+                {
+                    text.replace(pos, 1, "\\\"");
+                }
+                oldBuffer.append(text);
+            }
+            byHand.push_back(now() - start);
+
+            start = now();
+            PodWriteBuffer buffer;
+            for (int i = 0; i < count; ++i)
+            {
+                buffer.appendEscaped(strings[i]);
+            }
+            escaped.push_back(now() - start);
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            PodWriteBuffer buffer;
+            buffer.appendEscaped(strings[i]);
+            std::string text;
+            unescapeString(buffer.data(), buffer.size(), text);
+            wrong += text != strings[i];
+        }
+
+        std::cout << count << " strings, " << kinds[kind] << ":" << std::endl;
+        reportRate("Copy and replace quotes", byHand, bytes);
+        reportRate("appendEscaped()", escaped, bytes);
+    }
+
+    if (wrong)
+    {
+        std::cerr << "ERROR: " << wrong << " strings didn't unescape to the original" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+static const int NODES_PER_SHOT = 8;  // Counting the shot's block
+
+
+// *****************************************************************************
+static std::string shotName(int shot)
+{
+    char name[32];
+    return std::string(name, snprintf(name, sizeof(name), "shot_%d", shot));
+}
+
+
+// *****************************************************************************
+static void writeShots(PodWriter& writer, int count)
+{
+    for (int shot = 0; shot * NODES_PER_SHOT < count; ++shot)
+    {
+        writer.beginBlock(shotName(shot), "Shot");
+        writer.scalar("frames", 24 + shot % 240);
+        writer.scalar("fps", 23.976f);
+        writer.scalar("scale", 0.5f + shot % 7 * 0.125f);
+        writer.scalar("comment", "Camera \"A\", slate 12");
+        writer.scalar("final", shot % 3 == 0);
+        writer.identifier("camera", "cam_main");
+        writer.embed("notes", "print('hello')", "python");
+        writer.endBlock();
+    }
+}
+
+
+// *****************************************************************************
+//
+// The same nodes as writeShots(), as PodNodes
+//
+static PodNode* buildShots(int count)
+{
+    PodNode* rootNode = new PodNode();
+    PodNodeDeque shots;
+    for (int shot = 0; shot * NODES_PER_SHOT < count; ++shot)
+    {
+        PodNodeDeque children;
+        children.push_back(new PodNode("frames"));
+        children.back()->setValue(24 + shot % 240);
+        children.push_back(new PodNode("fps"));
+        children.back()->setValue(23.976f);
+        children.push_back(new PodNode("scale"));
+        children.back()->setValue(0.5f + shot % 7 * 0.125f);
+        children.push_back(new PodNode("comment"));
+        children.back()->setValue(std::string("Camera \"A\", slate 12"));
+        children.push_back(new PodNode("final"));
+        children.back()->setValue(shot % 3 == 0);
+        children.push_back(new PodNode("camera"));
+        children.back()->setIdentifierValue("cam_main");
+        children.push_back(new PodNode("notes"));
+        children.back()->setEmbedScriptValue("print('hello')", "python");
+        shots.push_back(new PodNode(shotName(shot), "Shot"));
+        shots.back()->setValue(children);
+    }
+    rootNode->setValue(shots);
+    return rootNode;
+}
+
+
+// *****************************************************************************
+static double peakMegabytes()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+
+// *****************************************************************************
+//
+// Time to generate a pod of 'count' nodes and write it to a file with
+// PodWriter, and by building PodNodes and writing those, and how much the
+// process's peak memory grows for each.  Building PodNodes is skipped past
+// a million nodes.  Both must write the same text.
+//
+static int benchGenerate(int count, const std::string& output)
+{
+    const double startMemory = peakMegabytes();
+    double start = now();
+    const int descriptor = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0)
+    {
+        throw std::runtime_error(output + ": " + strerror(errno));
+    }
+    {
+        PodWriter writer(descriptor);
+        writeShots(writer, count);
+        writer.finish();
+    }
+    close(descriptor);
+    const std::vector<double> streamed(1, now() - start);
+    const double streamedMemory = peakMegabytes() - startMemory;
+
+    std::string text;
+    {
+        std::ifstream file(output.c_str(), std::ios::binary);
+        text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    const size_t bytes = text.size();
+
+    // The same bytes, already in memory, for how fast the file can go
+    start = now();
+    {
+        const int rawDescriptor = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        PodWriteBuffer buffer(rawDescriptor);
+        buffer.append(text);
+        buffer.flush();
+        close(rawDescriptor);
+    }
+    const std::vector<double> raw(1, now() - start);
+
+    std::cout << count << " nodes, " << bytes / 1024 << " KB:" << std::endl;
+    reportRate("Copying the text", raw, bytes);
+    reportRate("PodWriter", streamed, bytes);
+    std::cout << "        peak memory grew " << streamedMemory << " MB" << std::endl;
+
+    int wrong = 0;
+    if (count <= 1000000)
+    {
+        const double treeStartMemory = peakMegabytes();
+        start = now();
+        PodNode* rootNode = buildShots(count);
+        {
+            std::ofstream file(output.c_str());
+            rootNode->write(file);
+        }
+        const std::vector<double> tree(1, now() - start);
+        reportRate("PodNodes, then write()", tree, bytes);
+        std::cout << "        peak memory grew " << peakMegabytes() - treeStartMemory << " MB"
+                  << std::endl;
+
+        PodWriteBuffer written;
+        rootNode->write(written);
+        wrong = std::string(written.data(), written.size()) != text;
+        delete rootNode;
+    }
+
+    if (wrong)
+    {
+        std::cout << "PodWriter and write() wrote different text" << std::endl;
+    }
+    return wrong;
+}
+
+
+// *****************************************************************************
+//
+// Time to hash a whole pod with contentHash(), the first time and once it's
+// cached, and after a change deep in the tree, against writing it out and
+// hashing the text the way change detection used to be done.
+//
+static int benchHash(const std::string& filename, int runs)
+{
+    PodNode* rootNode = parseFile(filename);
+    PodSnapshot* snapshot = freeze(*rootNode);
+    std::ostringstream text;
+    rootNode->write(text);
+    const size_t textSize = text.str().size();
+
+    std::vector<double> written, cold, cached, changed;
+    uint64_t first = 0;
+    size_t mismatches = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        double start = now();
+        std::ostringstream output;
+        rootNode->write(output);
+        const std::string pod = output.str();
+        hashBytes(pod.data(), pod.size());
+        written.push_back(now() - start);
+
+        PodNode* copy = snapshot->root().thaw();  // Nothing hashed yet
+        start = now();
+        const uint64_t hash = copy->contentHash();
+        cold.push_back(now() - start);
+        if (run == 0) first = hash;
+        mismatches += hash != first;
+
+        start = now();
+        mismatches += copy->contentHash() != hash;
+        cached.push_back(now() - start);
+
+        deepestLeaf(copy)->setValue(run + 1);
+        start = now();
+        mismatches += copy->contentHash() == hash;
+        changed.push_back(now() - start);
+        delete copy;
+    }
+
+    std::cout << filename << ", " << textSize / (1024 * 1024) << " MB written, "
+              << std::hex << first << std::dec << ":" << std::endl;
+    report("write() and hashBytes()", written);
+    report("contentHash(), first time", cold);
+    report("contentHash(), cached", cached);
+    report("contentHash(), after a change", changed);
+    std::cout << "    Hashed                          "
+              << textSize / median(cold) / (1024 * 1024) << " MB/s of pod text" << std::endl;
+
+    delete snapshot;
+    delete rootNode;
+    if (mismatches)
+    {
+        std::cerr << "ERROR: " << mismatches << " content hashes were wrong" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Time to get the text of every top-level block with asString(), the
+// first time, once it's kept, and after a change deep in one of them,
+// against writing each to an ostringstream the way asString() used to,
+// and to get it without a copy with writtenText().
+//
+static int benchText(const std::string& filename, int runs)
+{
+    PodNode* rootNode = parseFile(filename);
+    const PodNodeDeque& blocks = rootNode->asBlock();
+    std::vector<double> written, cold, kept, view, changed;
+    size_t bytes = 0, mismatches = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        std::vector<std::string> expected;
+        double start = now();
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            if (!blocks[i]->isBlock()) continue;
+            std::ostringstream output;
+            blocks[i]->write(output);
+            expected.push_back(output.str());
+        }
+        written.push_back(now() - start);
+
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            blocks[i]->syncBlock();  // Nothing kept
+        }
+        start = now();
+        for (size_t i = 0, j = 0; i < blocks.size(); ++i)
+        {
+            if (!blocks[i]->isBlock()) continue;
+            const size_t same = blocks[i]->asString() == expected[j++];
+            mismatches += !same;
+        }
+        cold.push_back(now() - start);
+
+        start = now();
+        bytes = 0;
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            if (blocks[i]->isBlock()) bytes += blocks[i]->asString().size();
+        }
+        kept.push_back(now() - start);
+
+        start = now();
+        size_t viewed = 0;
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            if (blocks[i]->isBlock()) viewed += blocks[i]->writtenText().size();
+        }
+        view.push_back(now() - start);
+        mismatches += viewed != bytes;
+
+        deepestLeaf(rootNode)->setValue(run + 1);
+        start = now();
+        size_t rewritten = 0;
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            if (blocks[i]->isBlock()) rewritten += blocks[i]->asString().size();
+        }
+        changed.push_back(now() - start);
+        mismatches += rewritten < bytes;
+    }
+
+    std::cout << filename << ", " << blocks.size() << " top-level nodes, "
+              << bytes / 1024 << " KB of blocks:" << std::endl;
+    report("write() to an ostringstream", written);
+    report("asString(), first time", cold);
+    report("asString(), kept", kept);
+    report("writtenText(), kept", view);
+    report("asString(), after a change", changed);
+
+    delete rootNode;
+    if (mismatches)
+    {
+        std::cerr << "ERROR: " << mismatches << " texts were wrong" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Time to diff two pods, with nothing hashed yet and then again, against
+// writing both out and comparing the text, which only tells whether
+// anything changed
+//
+static int benchDiff(const std::string& beforeFile, const std::string& afterFile, int runs)
+{
+    PodNode* parsed = parseFile(beforeFile);
+    PodSnapshot* before = freeze(*parsed);
+    delete parsed;
+    parsed = parseFile(afterFile);
+    PodSnapshot* after = freeze(*parsed);
+    delete parsed;
+
+    std::vector<double> written, cold, warm;
+    size_t changes = 0, mismatches = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        PodNode* beforeNode = before->root().thaw();
+        PodNode* afterNode = after->root().thaw();
+
+        double start = now();
+        std::ostringstream beforeText, afterText;
+        beforeNode->write(beforeText);
+        afterNode->write(afterText);
+        const bool same = beforeText.str() == afterText.str();
+        written.push_back(now() - start);
+
+        start = now();
+        changes = diff(*beforeNode, *afterNode).size();
+        cold.push_back(now() - start);
+
+        start = now();
+        mismatches += diff(*beforeNode, *afterNode).size() != changes;
+        warm.push_back(now() - start);
+        mismatches += same != (changes == 0);
+
+        delete beforeNode;
+        delete afterNode;
+    }
+
+    std::cout << beforeFile << " -> " << afterFile << ", " << changes << " changes:" << std::endl;
+    report("write() both and compare", written);
+    report("diff(), nothing hashed", cold);
+    report("diff(), hashed already", warm);
+
+    delete before;
+    delete after;
+    if (mismatches)
+    {
+        std::cerr << "ERROR: diff() found different changes each time" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+static int benchMerge(const std::string& baseFile, const std::string& ourFile,
+                      const std::string& theirFile, int runs)
+{
+    PodSnapshot* pods[3];
+    const std::string* files[3] = { &baseFile, &ourFile, &theirFile };
+    for (int i = 0; i < 3; ++i)
+    {
+        PodNode* parsed = parseFile(*files[i]);
+        pods[i] = freeze(*parsed);
+        delete parsed;
+    }
+
+    std::vector<double> cold, warm;
+    size_t conflicts = 0, mismatches = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        PodNode* base = pods[0]->root().thaw();
+        PodNode* theirs = pods[2]->root().thaw();
+
+        // Nothing hashed: what a one-off merge costs
+        PodNode* ours = pods[1]->root().thaw();
+        double start = now();
+        conflicts = merge(*base, *ours, *theirs).size();
+        cold.push_back(now() - start);
+        delete ours;
+
+        // Base and theirs hashed already, as when merging into several pods
+        ours = pods[1]->root().thaw();
+        start = now();
+        mismatches += merge(*base, *ours, *theirs).size() != conflicts;
+        warm.push_back(now() - start);
+        delete ours;
+
+        delete base;
+        delete theirs;
+    }
+
+    std::cout << baseFile << " -> " << ourFile << " + " << theirFile << ", "
+              << conflicts << " conflicts:" << std::endl;
+    report("merge(), nothing hashed", cold);
+    report("merge(), base and theirs hashed", warm);
+
+    for (int i = 0; i < 3; ++i) delete pods[i];
+    if (mismatches)
+    {
+        std::cerr << "ERROR: merge() found different conflicts each time" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+static void collectIdentifiers(PodNode* node, std::vector<PodNode*>& found)
+{
+    if (node->isIdentifier()) found.push_back(node);
+    if (!node->isBlock()) return;
+    const PodNodeDeque& block = static_cast<const PodNode*>(node)->asBlock();
+    for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+    {
+        collectIdentifiers(*iter, found);
+    }
+}
+
+
+// *****************************************************************************
+//
+// The way tools followed references before PodResolver: look for the name
+// in each enclosing block, every time
+//
+static const PodNode* resolveByHand(const PodNode* node)
+{
+    for (int depth = 0; node && node->isIdentifier() && depth < 100; ++depth)
+    {
+        const std::string identifier = node->asIdentifier();
+        const PodNode* found = NULL;
+        for (const PodNode* scope = node->parent(); scope && !found; scope = scope->parent())
+        {
+            found = scope->find(identifier);
+            if (found == node) found = NULL;
+        }
+        node = found;
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+//
+// Time to resolve every identifier in a pod by hand, with a new
+// PodResolver, with one that has seen them all before, and with one after
+// a change to the tree.
+//
+static int benchResolve(const std::string& filename, int runs)
+{
+    PodNode* rootNode = parseFile(filename);
+    std::vector<PodNode*> identifiers;
+    collectIdentifiers(rootNode, identifiers);
+
+    std::vector<double> byHand, cold, warm, changed;
+    size_t mismatches = 0, unresolved = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        std::vector<const PodNode*> expected(identifiers.size());
+        double start = now();
+        for (size_t i = 0; i < identifiers.size(); ++i) expected[i] = resolveByHand(identifiers[i]);
+        byHand.push_back(now() - start);
+
+        PodResolver resolver(*rootNode);
+        start = now();
+        for (size_t i = 0; i < identifiers.size(); ++i)
+        {
+            mismatches += resolver.resolve(*identifiers[i]) != expected[i];
+        }
+        cold.push_back(now() - start);
+
+        start = now();
+        for (size_t i = 0; i < identifiers.size(); ++i) resolver.resolve(*identifiers[i]);
+        warm.push_back(now() - start);
+
+        rootNode->asBlock().back()->setPodName(rootNode->asBlock().back()->podName());
+        start = now();
+        for (size_t i = 0; i < identifiers.size(); ++i) resolver.resolve(*identifiers[i]);
+        changed.push_back(now() - start);
+
+        unresolved = std::count(expected.begin(), expected.end(), static_cast<const PodNode*>(NULL));
+    }
+
+    std::cout << filename << ", " << identifiers.size() << " identifiers, "
+              << unresolved << " unresolved:" << std::endl;
+    report("By hand", byHand);
+    report("PodResolver, new", cold);
+    report("PodResolver, seen before", warm);
+    report("PodResolver, after a change", changed);
+
+    delete rootNode;
+    if (mismatches)
+    {
+        std::cerr << "ERROR: " << mismatches << " identifiers resolved differently" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+template <typename Node>
+static size_t countMatches(PodSelection<Node> selection)
+{
+    size_t count = 0;
+    for (; !selection.done(); ++selection) ++count;
+    return count;
+}
+
+
+// *****************************************************************************
+//
+// Time to find every match of a selector by walking a parsed pod, by walking
+// a snapshot of it, and with an index of the snapshot (which is built once).
+//
+static int benchSelect(const std::string& filename, const std::string& selector, int runs)
+{
+    PodNode* rootNode = parseFile(filename);
+    PodSnapshot* snapshot = freeze(*rootNode);
+    const PodNodeView rootView = snapshot->root();
+    const PodSelector podSelector(selector);
+
+    double start = now();
+    const PodSnapshotIndex index(*snapshot);
+    const double indexTime = now() - start;
+
+    const size_t expected = countMatches(podSelector.select(static_cast<const PodNode&>(*rootNode)));
+    std::vector<double> walk, walkView, indexed;
+    size_t found = 0;
+    for (int i = 0; i < runs; ++i)
+    {
+        start = now();
+        found += countMatches(podSelector.select(static_cast<const PodNode&>(*rootNode)));
+        walk.push_back(now() - start);
+
+        start = now();
+        found += countMatches(podSelector.select(rootView));
+        walkView.push_back(now() - start);
+
+        start = now();
+        found += countMatches(podSelector.select(rootView, &index));
+        indexed.push_back(now() - start);
+    }
+
+    std::cout << filename << " " << selector << ", " << expected << " matches:" << std::endl;
+    report("PodNode walk", walk);
+    report("PodNodeView walk", walkView);
+    report("PodNodeView, indexed", indexed);
+    report("Building the index", std::vector<double>(1, indexTime));
+    std::cout << "    Index size                      " << index.memoryUsage() / 1024 << " KB" << std::endl;
+
+    delete snapshot;
+    delete rootNode;
+    if (found != expected * runs * 3)
+    {
+        std::cerr << "ERROR: " << selector << " matched differently by each method" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// How layered pods were combined before PodOverlay: merge a copy of each
+// layer into a copy of the one below, block by block
+//
+static void mergeByHand(PodNode* into, const PodNodeView& from)
+{
+    PodNodeDeque& nodes = into->asBlock();
+    const PodBlockView fromNodes = from.asBlock();
+    for (PodBlockView::const_iterator iter = fromNodes.begin(); iter != fromNodes.end(); ++iter)
+    {
+        PodNode* existing = into->childByName((*iter).podName());
+        if (existing && existing->isBlock() && (*iter).isBlock())
+        {
+            mergeByHand(existing, *iter);
+        }
+        else if (existing)
+        {
+            *std::find(nodes.begin(), nodes.end(), existing) = (*iter).thaw();
+            delete existing;
+        }
+        else
+        {
+            nodes.push_back((*iter).thaw());
+        }
+    }
+}
+
+
+// *****************************************************************************
+static void collectPaths(const PodNode* node, const std::string& prefix,
+                         std::vector<std::string>& paths)
+{
+    const PodNodeDeque& block = node->asBlock();
+    for (PodNodeDeque::const_iterator iter = block.begin(); iter != block.end(); ++iter)
+    {
+        const std::string path = prefix + (*iter)->podName();
+        if ((*iter)->isBlock())
+        {
+            collectPaths(*iter, path + ".", paths);
+        }
+        else
+        {
+            paths.push_back(path);
+        }
+    }
+}
+
+
+// *****************************************************************************
+//
+// Time to combine layered pods by merging copies of them, and with a
+// PodOverlay, then to look up every value in the result
+//
+static int benchOverlay(const std::vector<std::string>& filenames, int runs)
+{
+    std::vector<PodDocumentHandle> layers;
+    for (size_t i = 0; i < filenames.size(); ++i)
+    {
+        PodNode* rootNode = parseFile(filenames[i]);
+        layers.push_back(PodDocumentHandle(PodDocument::create(freeze(*rootNode), filenames[i])));
+        delete rootNode;
+    }
+
+    std::vector<std::string> paths;
+    std::vector<double> merge, mergeLookup, build, lookup, flatten;
+    size_t mismatches = 0, memory = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        double start = now();
+        PodNode* merged = layers[0]->thaw();
+        for (size_t i = 1; i < layers.size(); ++i) mergeByHand(merged, layers[i]->root());
+        merged->syncBlock();
+        merge.push_back(now() - start);
+
+        if (paths.empty()) collectPaths(merged, "", paths);
+        std::vector<const PodNode*> expected(paths.size());
+        start = now();
+        for (size_t i = 0; i < paths.size(); ++i) expected[i] = merged->find(paths[i]);
+        mergeLookup.push_back(now() - start);
+
+        start = now();
+        PodOverlay overlay(layers);
+        build.push_back(now() - start);
+        memory = overlay.memoryUsage();
+
+        std::vector<PodOverlayNode> found(paths.size());
+        start = now();
+        const PodOverlayNode rootNode = overlay.root();
+        for (size_t i = 0; i < paths.size(); ++i) found[i] = rootNode.find(paths[i]);
+        lookup.push_back(now() - start);
+
+        start = now();
+        PodDocument* flat = overlay.flatten();
+        flatten.push_back(now() - start);
+        flat->unref();
+
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            mismatches += found[i].isNull() || !expected[i]
+                          || found[i].view().asString() != expected[i]->asString();
+        }
+        delete merged;
+    }
+
+    std::cout << filenames.size() << " layers, " << paths.size() << " values:" << std::endl;
+    report("By hand, copy and merge", merge);
+    report("By hand, look up every value", mergeLookup);
+    report("PodOverlay, new", build);
+    report("PodOverlay, look up every value", lookup);
+    report("PodOverlay, flatten", flatten);
+    std::cout << "    PodOverlay size                 " << memory / 1024 << " KB" << std::endl;
+
+    if (mismatches)
+    {
+        std::cerr << "ERROR: " << mismatches << " values differ" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+struct QueryLoad
+{
+    std::string         socketPath;
+    std::string         filename;
+    std::string         path;
+    double              seconds;
+    int                 depth;      // Requests each connection keeps in flight
+    std::vector<double> latencies;  // Filled in by the thread
+    std::string         error;
+};
+
+
+// *****************************************************************************
+static void* queryLoadThread(void* arg)
+{
+    QueryLoad* load = static_cast<QueryLoad*>(arg);
+    try
+    {
+        PodQueryClient client(load->socketPath);
+        const std::vector<std::string> paths(1, load->path);
+        std::vector<PodQueryResult> results;
+        std::deque<double> sent;
+
+        const double end = now() + load->seconds;
+        while (now() < end)
+        {
+            while (int(client.pending()) < load->depth)
+            {
+                client.send(load->filename, paths);
+                sent.push_back(now());
+            }
+            client.receive(results);
+            load->latencies.push_back(now() - sent.front());
+            sent.pop_front();
+        }
+        while (client.pending())
+        {
+            client.receive(results);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        load->error = e.what();
+    }
+    return NULL;
+}
+
+
+// *****************************************************************************
+//
+// Queries per second and latency of a running podqueryd, from a number of
+// connections each keeping a number of requests in flight.
+//
+static int benchQuery(const std::string& socketPath, const std::string& filename,
+                      const std::string& path, double seconds, int connections, int depth)
+{
+    std::vector<QueryLoad> loads(connections);
+    std::vector<pthread_t> threads(connections);
+    for (int i = 0; i < connections; ++i)
+    {
+        loads[i].socketPath = socketPath;
+        loads[i].filename = filename;
+        loads[i].path = path;
+        loads[i].seconds = seconds;
+        loads[i].depth = depth;
+        pthread_create(&threads[i], NULL, queryLoadThread, &loads[i]);
+    }
+
+    std::vector<double> latencies;
+    for (int i = 0; i < connections; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        if (!loads[i].error.empty())
+        {
+            std::cerr << "ERROR: " << loads[i].error << std::endl;
+            return 1;
+        }
+        latencies.insert(latencies.end(), loads[i].latencies.begin(), loads[i].latencies.end());
+    }
+    if (latencies.empty())
+    {
+        std::cerr << "ERROR: no queries were answered" << std::endl;
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << filename << " " << path << ", " << connections << " connections, "
+              << depth << " in flight each:" << std::endl;
+    std::cout << "    queries per second              " << latencies.size() / seconds << std::endl;
+    const char* labels[] = { "p50 latency", "p99 latency", "p99.9 latency", "max latency" };
+    const double fractions[] = { 0.5, 0.99, 0.999, 1.0 };
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const size_t index = std::min(latencies.size() - 1, size_t(latencies.size() * fractions[i]));
+        const std::string label = labels[i];
+        std::cout << "    " << label << std::string(32 - label.size(), ' ')
+                  << latencies[index] * 1e6 << " us" << std::endl;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Time to write a parsed pod as JSON and read it back, against writing
+// and parsing it as a pod.  Rates are of the text written or read.
+//
+static int benchJson(const std::string& filename, int runs)
+{
+    PodNode* rootNode = parseFile(filename);
+    std::string podText;
+    {
+        PodWriteBuffer buffer;
+        rootNode->write(buffer);
+        podText.assign(buffer.data(), buffer.size());
+    }
+
+    std::vector<double> podWrite, jsonWrite, podParse, jsonRead;
+    size_t jsonBytes = 0, mismatches = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        double start = now();
+        {
+            PodWriteBuffer buffer;
+            rootNode->write(buffer);
+        }
+        podWrite.push_back(now() - start);
+
+        start = now();
+        PodWriteBuffer json;
+        toJson(*rootNode, json);
+        jsonWrite.push_back(now() - start);
+        jsonBytes = json.size();
+
+        start = now();
+        PodNode* parsed = parseText(podText);
+        podParse.push_back(now() - start);
+        delete parsed;
+
+        start = now();
+        PodNode* read = fromJson(json.data(), json.size());
+        jsonRead.push_back(now() - start);
+        mismatches += read->contentHash() != rootNode->contentHash();
+        delete read;
+    }
+
+    std::cout << filename << ", " << podText.size() / 1024 << " KB as a pod, "
+              << jsonBytes / 1024 << " KB as JSON:" << std::endl;
+    reportRate("write(), into memory", podWrite, podText.size());
+    reportRate("toJson(), into memory", jsonWrite, jsonBytes);
+    reportRate("parseText()", podParse, podText.size());
+    reportRate("fromJson()", jsonRead, jsonBytes);
+
+    delete rootNode;
+    if (mismatches)
+    {
+        std::cerr << mismatches << " pods read back from JSON differed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Send a pod from one process to another through a pipe, as text or as a
+// wire message, and make it a PodNode again
+//
+static double sendThroughPipe(const PodNode& rootNode, bool wire)
+{
+    const double start = now();
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        throw std::runtime_error("pipe() failed");
+    }
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        if (wire)
+        {
+            PodWireWriter writer(fds[1]);
+            writer.write(rootNode);
+        }
+        else
+        {
+            PodWriteBuffer buffer(fds[1]);
+            rootNode.write(buffer);
+            buffer.flush();
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    PodNode* received = NULL;
+    if (wire)
+    {
+        PodWireReader reader(fds[0]);
+        received = reader.read();
+    }
+    else
+    {
+        std::string text;
+        char chunk[65536];
+        ssize_t n;
+        while ((n = read(fds[0], chunk, sizeof(chunk))) > 0) text.append(chunk, n);
+        received = parseText(text);
+    }
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    const double elapsed = now() - start;
+    if (!received || received->contentHash() != rootNode.contentHash())
+    {
+        delete received;
+        throw std::runtime_error("The pod sent through the pipe came back different");
+    }
+    delete received;
+    return elapsed;
+}
+
+
+// *****************************************************************************
+//
+// Time to encode a parsed pod as a wire message and decode it, against
+// writing and parsing it as text, in memory and sent through a pipe to
+// another process.  Rates are of the text or message.
+//
+static int benchWire(const std::string& filename, int runs)
+{
+    PodNode* rootNode = parseFile(filename);
+    std::string podText;
+    {
+        PodWriteBuffer buffer;
+        rootNode->write(buffer);
+        podText.assign(buffer.data(), buffer.size());
+    }
+
+    std::vector<double> podWrite, wireWrite, podParse, wireRead, podPipe, wirePipe;
+    size_t wireBytes = 0, mismatches = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        double start = now();
+        {
+            PodWriteBuffer buffer;
+            rootNode->write(buffer);
+        }
+        podWrite.push_back(now() - start);
+
+        start = now();
+        std::string message;
+        {
+            PodWireWriter writer(message);
+            writer.write(*rootNode);
+        }
+        wireWrite.push_back(now() - start);
+        wireBytes = message.size();
+
+        start = now();
+        PodNode* parsed = parseText(podText);
+        podParse.push_back(now() - start);
+        delete parsed;
+
+        start = now();
+        PodWireReader reader(message.data(), message.size());
+        PodNode* read = reader.read();
+        wireRead.push_back(now() - start);
+        mismatches += read->contentHash() != rootNode->contentHash();
+        delete read;
+
+        podPipe.push_back(sendThroughPipe(*rootNode, false));
+        wirePipe.push_back(sendThroughPipe(*rootNode, true));
+    }
+
+    std::cout << filename << ", " << podText.size() / 1024 << " KB as a pod, "
+              << wireBytes / 1024 << " KB as a wire message:" << std::endl;
+    reportRate("write(), into memory", podWrite, podText.size());
+    reportRate("PodWireWriter, into memory", wireWrite, wireBytes);
+    reportRate("parseText()", podParse, podText.size());
+    reportRate("PodWireReader, from memory", wireRead, wireBytes);
+    reportRate("Through a pipe, as text", podPipe, podText.size());
+    reportRate("Through a pipe, wire message", wirePipe, wireBytes);
+
+    delete rootNode;
+    if (mismatches)
+    {
+        std::cerr << mismatches << " pods read back from wire messages differed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// *****************************************************************************
+static int usage(const char* argv0)
+{
+    std::cerr << "Usage: " << argv0 << " cache cache_directory file.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " memcache file.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " shared shm_directory file.pod [processes]" << std::endl;
+    std::cerr << "       " << argv0 << " path file.pod path [lookups]" << std::endl;
+    std::cerr << "       " << argv0 << " hash file.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " text file.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " write file.pod output.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " rewrite file.pod output.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " json file.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " wire file.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " floats count [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " strings count [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " generate count output.pod" << std::endl;
+    std::cerr << "       " << argv0 << " diff before.pod after.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " merge base.pod ours.pod theirs.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " resolve file.pod [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " index file.pod podType [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " select file.pod selector [runs]" << std::endl;
+    std::cerr << "       " << argv0 << " overlay file.pod file.pod..." << std::endl;
+    std::cerr << "       " << argv0 << " query socket file.pod path [seconds [connections [depth]]]" << std::endl;
+    return 1;
+}
+
+
+// *****************************************************************************
+int main(int argc, char **argv)
+{
+    try
+    {
+        const std::string mode = argc > 1 ? argv[1] : "";
+        if (mode == "cache" && (argc == 4 || argc == 5))
+        {
+            return benchCache(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 5);
+        }
+        if (mode == "memcache" && (argc == 3 || argc == 4))
+        {
+            return benchMemoryCache(argv[2], argc == 4 ? atoi(argv[3]) : 5);
+        }
+        if (mode == "shared" && (argc == 4 || argc == 5))
+        {
+            return benchSharedStore(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 8);
+        }
+        if (mode == "path" && (argc == 4 || argc == 5))
+        {
+            return benchPath(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 100000);
+        }
+        if (mode == "hash" && (argc == 3 || argc == 4))
+        {
+            return benchHash(argv[2], argc == 4 ? atoi(argv[3]) : 5);
+        }
+        if (mode == "text" && (argc == 3 || argc == 4))
+        {
+            return benchText(argv[2], argc == 4 ? atoi(argv[3]) : 5);
+        }
+        if (mode == "write" && (argc == 4 || argc == 5))
+        {
+            return benchWrite(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 5);
+        }
+        if (mode == "rewrite" && (argc == 4 || argc == 5))
+        {
+            return benchRewrite(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 5);
+        }
+        if (mode == "json" && (argc == 3 || argc == 4))
+        {
+            return benchJson(argv[2], argc == 4 ? atoi(argv[3]) : 5);
+        }
+        if (mode == "wire" && (argc == 3 || argc == 4))
+        {
+            return benchWire(argv[2], argc == 4 ? atoi(argv[3]) : 5);
+        }
+        if (mode == "floats" && (argc == 3 || argc == 4))
+        {
+            return benchFloats(atoi(argv[2]), argc == 4 ? atoi(argv[3]) : 5);
+        }
+        if (mode == "strings" && (argc == 3 || argc == 4))
+        {
+            return benchStrings(atoi(argv[2]), argc == 4 ? atoi(argv[3]) : 5);
+        }
+        if (mode == "generate" && argc == 4)
+        {
+            return benchGenerate(atoi(argv[2]), argv[3]);
+        }
+        if (mode == "diff" && (argc == 4 || argc == 5))
+        {
+            return benchDiff(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 5);
+        }
+        if (mode == "merge" && (argc == 5 || argc == 6))
+        {
+            return benchMerge(argv[2], argv[3], argv[4], argc == 6 ? atoi(argv[5]) : 5);
+        }
+        if (mode == "resolve" && (argc == 3 || argc == 4))
+        {
+            return benchResolve(argv[2], argc == 4 ? atoi(argv[3]) : 5);
+        }
+        if (mode == "index" && (argc == 4 || argc == 5))
+        {
+            return benchIndex(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 5);
+        }
+        if (mode == "select" && (argc == 4 || argc == 5))
+        {
+            return benchSelect(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 5);
+        }
+        if (mode == "overlay" && argc >= 4)
+        {
+            return benchOverlay(std::vector<std::string>(argv + 2, argv + argc), 5);
+        }
+        if (mode == "query" && argc >= 5 && argc <= 8)
+        {
+            return benchQuery(argv[2], argv[3], argv[4],
+                              argc > 5 ? atof(argv[5]) : 5.0,
+                              argc > 6 ? atoi(argv[6]) : 4,
+                              argc > 7 ? atoi(argv[7]) : 8);
+        }
+        return usage(argv[0]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,68 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TipPodQuery.h"
+
+using namespace TipPod;
+
+
+// *****************************************************************************
+static int usage(const char* argv0)
+{
+    std::cerr << "Usage: " << argv0 << " [-s socket] file.pod path..." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Prints the values at dotted paths (e.g. render.shadows.resolution)" << std::endl;
+    std::cerr << "in a pod, looked up by podqueryd.  Exits with 1 if any isn't found." << std::endl;
+    return 2;
+}
+
+
+// *****************************************************************************
+int main(int argc, char **argv)
+{
+    std::string socketPath = PodQueryClient::DEFAULT_SOCKET;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-s") == 0)
+    {
+        socketPath = argv[2];
+        first = 3;
+    }
+    if (argc - first < 2)
+    {
+        return usage(argv[0]);
+    }
+
+    try
+    {
+        PodQueryClient client(socketPath);
+        const std::vector<std::string> paths(argv + first + 1, argv + argc);
+        const std::vector<PodQueryResult> results = client.query(argv[first], paths);
+
+        int status = 0;
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            if (results[i].found())
+            {
+                std::cout << paths[i] << " = " << results[i].asString() << std::endl;
+            }
+            else
+            {
+                std::cout << paths[i] << ": not found" << std::endl;
+                status = 1;
+            }
+        }
+        return status;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 2;
+    }
+}
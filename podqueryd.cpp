@@ -0,0 +1,95 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+
+#include "TipPodDocumentCache.h"
+#include "TipPodQuery.h"
+#include "TipPodQueryServer.h"
+
+using namespace TipPod;
+
+
+static PodQueryServer* theServer = NULL;
+
+
+// *****************************************************************************
+static void stopServer(int)
+{
+    if (theServer) theServer->stop();
+}
+
+
+// *****************************************************************************
+static int usage(const char* argv0)
+{
+    std::cerr << "Usage: " << argv0 << " [-s socket] [-m cache_megabytes] [-p poll_seconds]" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Serves pod lookups to podquery and other PodQueryClients." << std::endl;
+    std::cerr << "-p polls pods for changes instead of using inotify, e.g. for NFS." << std::endl;
+    return 1;
+}
+
+
+// *****************************************************************************
+int main(int argc, char **argv)
+{
+    std::string socketPath = PodQueryClient::DEFAULT_SOCKET;
+    size_t maxBytes = PodDocumentCache::DEFAULT_MAX_BYTES;
+    bool useInotify = true;
+    double pollSeconds = 1.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "-s") == 0)
+        {
+            socketPath = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-m") == 0)
+        {
+            maxBytes = size_t(atof(argv[++i]) * 1024 * 1024);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-p") == 0)
+        {
+            useInotify = false;
+            pollSeconds = atof(argv[++i]);
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+
+    try
+    {
+        PodDocumentCache cache(maxBytes, useInotify, pollSeconds);
+        PodQueryServer server(socketPath, cache);
+
+        theServer = &server;
+        signal(SIGINT, stopServer);
+        signal(SIGTERM, stopServer);
+        signal(SIGPIPE, SIG_IGN);
+
+        server.run();
+        theServer = NULL;
+
+        const PodQueryServerStats stats = server.stats();
+        const PodDocumentCacheStats cacheStats = cache.stats();
+        std::cerr << "podqueryd: " << stats.connections << " connections, "
+                  << stats.requests << " requests, " << stats.paths << " paths, "
+                  << stats.errors << " errors; cache: " << cacheStats.hits << " hits, "
+                  << cacheStats.misses << " misses" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,829 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+//
+// Checks of the library that test.py runs, for what can't be seen through
+// the parser's command line.  Each returns 0, or throws.
+//
+
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "TipPod.h"
+#include "TipPodDiff.h"
+#include "TipPodExc.h"
+#include "TipPodNodeIndex.h"
+#include "TipPodOverlay.h"
+#include "TipPodPath.h"
+#include "TipPodResolver.h"
+#include "TipPodSelector.h"
+#include "TipPodSnapshotIndex.h"
+#include "TipPodValue.h"
+#include "TipPodWriteBuffer.h"
+#include "TipPodWriter.h"
+
+using namespace TipPod;
+
+
+// *****************************************************************************
+//
+// The nodes under 'node', in document order, and by type and name
+//
+typedef std::map<std::string, std::multiset<PodNode*> > NodesByKey;
+
+static void listNodes(PodNode& node, std::vector<PodNode*>& nodes,
+                      NodesByKey& byType, NodesByKey& byName)
+{
+    if (!node.isBlock()) return;
+    PodNodeDeque& block = node.asBlock();
+    for (PodNodeIter iter = block.begin(); iter != block.end(); ++iter)
+    {
+        nodes.push_back(*iter);
+        byType[(*iter)->podType()].insert(*iter);
+        byName[(*iter)->podName()].insert(*iter);
+        listNodes(**iter, nodes, byType, byName);
+    }
+}
+
+
+// *****************************************************************************
+//
+// Throw unless the index lists what a walk of its root finds.  Until the
+// tree is changed, the lists must be in document order too.
+//
+static void checkIndexMatches(const PodNodeIndex& index, std::vector<PodNode*>& nodes,
+                              bool inOrder, int changes)
+{
+    NodesByKey byType, byName;
+    nodes.clear();
+    listNodes(index.root(), nodes, byType, byName);
+
+    std::ostringstream err;
+    err << "PodNodeIndex differs from the tree after " << changes << " change(s): ";
+    if (index.size() != nodes.size())
+    {
+        err << index.size() << " nodes listed, " << nodes.size() << " in the tree";
+        throw std::runtime_error(err.str());
+    }
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const NodesByKey& expected = pass == 0 ? byType : byName;
+        for (NodesByKey::const_iterator iter = expected.begin(); iter != expected.end(); ++iter)
+        {
+            const std::vector<PodNode*>& listed = pass == 0 ? index.byType(iter->first)
+                                                            : index.byName(iter->first);
+            if (std::multiset<PodNode*>(listed.begin(), listed.end()) != iter->second)
+            {
+                err << (pass == 0 ? "type '" : "name '") << iter->first << "' lists "
+                    << listed.size() << " nodes, the tree has " << iter->second.size();
+                throw std::runtime_error(err.str());
+            }
+            if (inOrder)
+            {
+                std::vector<PodNode*> ordered;
+                for (size_t i = 0; i < nodes.size(); ++i)
+                {
+                    if (iter->second.count(nodes[i])) ordered.push_back(nodes[i]);
+                }
+                if (ordered != listed)
+                {
+                    err << (pass == 0 ? "type '" : "name '") << iter->first
+                        << "' isn't in document order";
+                    throw std::runtime_error(err.str());
+                }
+            }
+        }
+    }
+}
+
+
+// *****************************************************************************
+static PodNode* newIndexTestNode(const char* name, const char* podType, int children)
+{
+    PodNode* node = new PodNode(name, podType, NULL);
+    if (children > 0)
+    {
+        PodNodeDeque block;
+        for (int i = 0; i < children; ++i)
+        {
+            block.push_back(new PodNode(i % 2 ? "key" : "", "Light", NULL));
+            block.back()->setValue(i);
+        }
+        node->setValue(block, "");
+    }
+    else
+    {
+        node->setValue(children);
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+//
+// Make 'count' random changes to a pod, of every kind PodNodeIndex has to
+// follow, and check the index against the tree after each one
+//
+static int testIndex(const std::string& input, int count)
+{
+    static const char* names[] = { "a", "key", "", "lights" };
+    static const char* types[] = { "Light", "Camera", "", "Shader" };
+
+    PodNode* rootNode = parseFile(input);
+    PodNodeIndex* index = NULL;
+    try
+    {
+        index = new PodNodeIndex(*rootNode);
+        std::vector<PodNode*> nodes;
+        checkIndexMatches(*index, nodes, true, 0);
+
+        srand(1);
+        for (int change = 1; change <= count; ++change)
+        {
+            PodNode* node = nodes.empty() ? rootNode : nodes[rand() % nodes.size()];
+            PodNode* parent = node->parent() ? node->parent() : rootNode;
+            switch (rand() % 9)
+            {
+                case 0:
+                    node->setPodName(names[rand() % 4]);
+                    break;
+                case 1:
+                    node->setPodType(types[rand() % 4]);
+                    break;
+                case 2:
+                    if (node->isBlock() && rand() % 4) break;  // Else the tree soon dwindles
+                    node->setValue(rand() % 100);
+                    break;
+                case 3:
+                    if (node->isBlock() && rand() % 4) break;
+                    node->setValue(std::string("text"));
+                    break;
+                case 4:
+                {
+                    PodNodeDeque block;
+                    for (int i = rand() % 4; i > 0; --i)
+                    {
+                        block.push_back(newIndexTestNode(names[rand() % 4], types[rand() % 4],
+                                                         rand() % 3));
+                    }
+                    node->setValue(block, "");
+                    break;
+                }
+                case 5:
+                {
+                    // Copy another node's value (not a block's, which can't be copied)
+                    const PodNode* other = nodes[rand() % nodes.size()];
+                    if (!other->isBlock()) node->setValue(*other);
+                    break;
+                }
+                case 6:
+                {
+                    // Delete it before syncBlock() says it's gone
+                    if (node == rootNode) break;
+                    PodNodeDeque& block = parent->asBlock();
+                    block.erase(std::find(block.begin(), block.end(), node));
+                    delete node;
+                    block.insert(block.begin() + rand() % (block.size() + 1),
+                                 newIndexTestNode(names[rand() % 4], types[rand() % 4],
+                                                  rand() % 3));
+                    parent->syncBlock();
+                    break;
+                }
+                case 7:
+                {
+                    // Add a node with children to a block
+                    if (!node->isBlock()) break;
+                    PodNodeDeque& block = node->asBlock();
+                    block.insert(block.begin() + rand() % (block.size() + 1),
+                                 newIndexTestNode(names[rand() % 4], types[rand() % 4], 2));
+                    node->syncBlock();
+                    break;
+                }
+                default:
+                {
+                    PodNodeDeque& block = parent->asBlock();
+                    std::reverse(block.begin(), block.end());
+                    parent->syncBlock();
+                    break;
+                }
+            }
+            checkIndexMatches(*index, nodes, false, change);
+        }
+        std::cout << "PodNodeIndex matched the tree through " << count << " changes, "
+                  << nodes.size() << " nodes at the end" << std::endl;
+    }
+    catch (...)
+    {
+        delete index;
+        delete rootNode;
+        throw;
+    }
+    delete index;
+    delete rootNode;
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// The node at 'path' in 'root', or throw
+//
+static PodNode* findOrThrow(PodNode* root, const std::string& path)
+{
+    PodNode* node = root->find(path);
+    if (!node)
+    {
+        throw std::runtime_error("No node at '" + path + "'");
+    }
+    return node;
+}
+
+
+// *****************************************************************************
+//
+// A copy of 'node' and everything under it, without a parent
+//
+static PodNode* copyNode(const PodNode& node)
+{
+    PodNode* copy = new PodNode(node.podName(), node.podType());
+    if (node.isBlock())
+    {
+        PodNodeDeque block;
+        for (PodNodeDeque::const_iterator iter = node.asBlock().begin();
+             iter != node.asBlock().end(); ++iter)
+        {
+            block.push_back(copyNode(**iter));
+        }
+        copy->setValue(block, node.blockScopeType());
+    }
+    else
+    {
+        copy->setValue(node);
+    }
+    return copy;
+}
+
+
+// *****************************************************************************
+//
+// Have every node keep its writtenText(), or throw unless what each kept is
+// what write() writes now
+//
+static void keepWrittenText(const PodNode& node, bool check)
+{
+    if (check)
+    {
+        PodWriteBuffer buffer;
+        node.write(buffer);
+        if (node.writtenText() != std::string(buffer.data(), buffer.size()))
+        {
+            throw std::runtime_error("writtenText() of '" + node.podName() + "' is out of date: "
+                                     + node.writtenText());
+        }
+    }
+    else
+    {
+        node.writtenText();
+    }
+    if (!node.isBlock()) return;
+    for (PodNodeDeque::const_iterator iter = node.asBlock().begin();
+         iter != node.asBlock().end(); ++iter)
+    {
+        keepWrittenText(**iter, check);
+    }
+}
+
+
+// *****************************************************************************
+//
+// Read a pod keeping its formatting, change the nodes of one block by hand,
+// and write it out again:
+//
+//     reverse path                Reverse the nodes of the block at 'path'
+//     insert path index text      Insert the node 'text' parses to there
+//     delete path                 Delete the node at 'path'
+//
+// The block is synced with syncBlock(), or the whole pod is with syncRoot.
+// What diff() finds changed from the pod as read is printed, a path a
+// line; it's diffed once before the edit too, so hashes are kept from
+// before.  The same goes for written text, which must be up to date
+// after.  An inserted node has its text kept before it's inserted.
+//
+static int testEdit(const std::string& input, const std::string& output,
+                    const std::vector<std::string>& args, bool syncRoot)
+{
+    PodNode* original = parseFile(input);
+    PodNode* rootNode = NULL;
+    try
+    {
+        rootNode = parseFile(input, PARSE_KEEP_FORMAT);
+        if (!diff(*original, *rootNode).empty())
+        {
+            throw std::runtime_error("The pod differs from itself");
+        }
+        keepWrittenText(*rootNode, false);
+
+        const std::string& op = args[0];
+        PodNode* block = NULL;
+        if (op == "reverse" && args.size() == 2)
+        {
+            block = findOrThrow(rootNode, args[1]);
+            std::reverse(block->asBlock().begin(), block->asBlock().end());
+        }
+        else if (op == "insert" && args.size() == 4)
+        {
+            block = findOrThrow(rootNode, args[1]);
+            PodNode* parsed = parseText(args[3]);
+            PodNode* node = copyNode(*parsed->asBlock()[0]);
+            delete parsed;
+            keepWrittenText(*node, false);
+            PodNodeDeque& nodes = block->asBlock();
+            nodes.insert(nodes.begin() + atoi(args[2].c_str()), node);
+        }
+        else if (op == "delete" && args.size() == 2)
+        {
+            PodNode* node = findOrThrow(rootNode, args[1]);
+            block = node->parent();
+            PodNodeDeque& nodes = block->asBlock();
+            nodes.erase(std::find(nodes.begin(), nodes.end(), node));
+            delete node;
+        }
+        else
+        {
+            throw std::runtime_error("Unknown edit '" + op + "'");
+        }
+        (syncRoot ? rootNode : block)->syncBlock();
+        keepWrittenText(*rootNode, true);
+
+        const std::vector<PodDiffEntry> changes = diff(*original, *rootNode);
+        for (size_t i = 0; i < changes.size(); ++i)
+        {
+            const char* kinds[] = { "+", "-", "~" };  // By PodDiffEntry::Kind
+            std::cout << kinds[changes[i].kind] << " " << changes[i].path << std::endl;
+        }
+
+        std::ofstream file(output.c_str(), std::ios::binary);
+        rootNode->write(file);
+        if (!file)
+        {
+            throw std::runtime_error("Can't write " + output);
+        }
+    }
+    catch (...)
+    {
+        delete original;
+        delete rootNode;
+        throw;
+    }
+    delete original;
+    delete rootNode;
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// A path that finds 'node' from the root: its name where that's the first
+// child with the name, else its index, like "lights[1].intensity"
+//
+static std::string nodePath(const PodNode& node)
+{
+    const PodNode* parent = node.parent();
+    if (!parent) return "";
+    std::ostringstream step;
+    if (!node.podName().empty() && parent->childByName(node.podName()) == &node)
+    {
+        step << node.podName();
+    }
+    else
+    {
+        const PodNodeDeque& block = parent->asBlock();
+        step << "[" << std::find(block.begin(), block.end(), &node) - block.begin() << "]";
+    }
+    const std::string path = nodePath(*parent);
+    return path.empty() || step.str()[0] == '[' ? path + step.str() : path + "." + step.str();
+}
+
+
+// *****************************************************************************
+static std::string nodePath(const PodNodeView& node)
+{
+    const PodNodeView parent = node.parent();
+    if (parent.isNull()) return "";
+    std::ostringstream step;
+    if (*node.podName() && parent.childByName(node.podName()) == node)
+    {
+        step << node.podName();
+    }
+    else
+    {
+        step << "[" << node.index() - (*parent.asBlock().begin()).index() << "]";
+    }
+    const std::string path = nodePath(parent);
+    return path.empty() || step.str()[0] == '[' ? path + step.str() : path + "." + step.str();
+}
+
+
+static std::string nodePath(const PodNode* node) { return nodePath(*node); }
+
+
+// *****************************************************************************
+template <typename Node>
+static std::vector<std::string> matchPaths(PodSelection<Node> selection)
+{
+    std::vector<std::string> paths;
+    for (; !selection.done(); ++selection) paths.push_back(nodePath(*selection));
+    return paths;
+}
+
+
+// *****************************************************************************
+//
+// Print the path of each node a selector matches in a pod, in the order a
+// walk of the tree finds them.  A walk of a snapshot must find the same,
+// and so must an index of it, in any order.
+//
+static int testSelect(const std::string& input, const std::string& selector)
+{
+    const PodSelector podSelector(selector);
+    PodNode* rootNode = parseFile(input);
+    PodSnapshot* snapshot = NULL;
+    PodSnapshotIndex* index = NULL;
+    try
+    {
+        snapshot = freeze(*rootNode);
+        index = new PodSnapshotIndex(*snapshot);
+        const std::vector<std::string> paths = matchPaths(podSelector.select(*rootNode));
+        if (matchPaths(podSelector.select(snapshot->root())) != paths)
+        {
+            throw std::runtime_error("A snapshot matched differently from the tree");
+        }
+        std::vector<std::string> indexed = matchPaths(podSelector.select(snapshot->root(), index));
+        std::vector<std::string> sorted(paths);
+        std::sort(indexed.begin(), indexed.end());
+        std::sort(sorted.begin(), sorted.end());
+        if (indexed != sorted)
+        {
+            throw std::runtime_error("An index matched differently from the tree");
+        }
+        for (size_t i = 0; i < paths.size(); ++i) std::cout << paths[i] << std::endl;
+    }
+    catch (...)
+    {
+        delete index;
+        delete snapshot;
+        delete rootNode;
+        throw;
+    }
+    delete index;
+    delete snapshot;
+    delete rootNode;
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Layer pods with a PodOverlay and print which layer the node at 'path'
+// comes from, then the node with any block merged.  A flattened copy of
+// the overlay must have the same node there.
+//
+static int testOverlay(const std::string& path, const std::vector<std::string>& filenames)
+{
+    std::vector<PodDocumentHandle> layers;
+    for (size_t i = 0; i < filenames.size(); ++i)
+    {
+        PodNode* rootNode = parseFile(filenames[i]);
+        try
+        {
+            layers.push_back(PodDocumentHandle(PodDocument::create(freeze(*rootNode),
+                                                                   filenames[i])));
+        }
+        catch (...)
+        {
+            delete rootNode;
+            throw;
+        }
+        delete rootNode;
+    }
+    const PodOverlay overlay(layers);
+    const PodDocumentHandle flat(overlay.flatten());
+    const PodOverlayNode node = overlay.root().find(path);
+    const PodNodeView flatNode = flat->root().find(path);
+    if (node.isNull())
+    {
+        if (!flatNode.isNull())
+        {
+            throw std::runtime_error("Flattening found a node at '" + path + "'");
+        }
+        std::cout << path << ": not found" << std::endl;
+        return 0;
+    }
+
+    PodNode* merged = node.thaw();
+    std::ostringstream text, flatText;
+    merged->write(text);
+    delete merged;
+    flatNode.write(flatText);
+    if (text.str() != flatText.str())
+    {
+        throw std::runtime_error("Flattening gave a different node at '" + path + "': "
+                                 + flatText.str());
+    }
+    std::cout << "layer " << node.layer() << ": " << text.str();
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Print the path (as nodePath() gives it) of the node a PodPath finds in a
+// pod, or that it found none.  Finding it in a snapshot, and with
+// PodNode::find(), must give the same node.
+//
+static int testFind(const std::string& input, const std::string& path)
+{
+    const PodPath podPath(path);
+    PodNode* rootNode = parseFile(input);
+    PodSnapshot* snapshot = NULL;
+    try
+    {
+        snapshot = freeze(*rootNode);
+        const PodNode* node = podPath.find(static_cast<const PodNode&>(*rootNode));
+        const PodNodeView view = podPath.find(snapshot->root());
+        if (rootNode->find(path) != node)
+        {
+            throw std::runtime_error("PodNode::find() found a different node");
+        }
+        if (view.isNull() != !node || (node && nodePath(view) != nodePath(*node)))
+        {
+            throw std::runtime_error("A snapshot found a different node");
+        }
+        if (node)
+        {
+            std::cout << path << ": " << (node == rootNode ? "(root)" : nodePath(*node))
+                      << std::endl;
+        }
+        else
+        {
+            std::cout << path << ": not found" << std::endl;
+        }
+    }
+    catch (...)
+    {
+        delete snapshot;
+        delete rootNode;
+        throw;
+    }
+    delete snapshot;
+    delete rootNode;
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// What 'resolver' resolves the node at 'path' to, as a line to print
+//
+static std::string resolvedPath(PodResolver& resolver, const std::string& path)
+{
+    const PodNode* node = findOrThrow(&resolver.root(), path);
+    try
+    {
+        const PodNode* resolved = resolver.resolve(*node);
+        return path + " -> " + (resolved ? nodePath(*resolved) : "not found");
+    }
+    catch (const PodReferenceError& e)
+    {
+        return path + ": " + e.what();
+    }
+}
+
+
+// *****************************************************************************
+//
+// Resolve nodes with one PodResolver, editing the tree in between, and
+// print what each resolves to.  Each item is a path to resolve, or one of
+//
+//     set path value              Set the node at 'path' to what 'value' parses to
+//     rename path name            Rename the node at 'path'
+//     delete path                 Delete the node at 'path'
+//
+// A new resolver must resolve each node the same, so none of what the
+// first one remembers may be out of date.
+//
+static int testResolve(const std::string& input, const std::vector<std::string>& items)
+{
+    PodNode* rootNode = parseFile(input);
+    PodResolver* resolver = NULL;
+    try
+    {
+        resolver = new PodResolver(*rootNode);
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            if (items[i] == "set" && i + 2 < items.size())
+            {
+                PodNode* parsed = parseText("value = " + items[i + 2] + ";");
+                try
+                {
+                    findOrThrow(rootNode, items[i + 1])->setValue(*parsed->asBlock()[0]);
+                }
+                catch (...)
+                {
+                    delete parsed;
+                    throw;
+                }
+                delete parsed;
+                i += 2;
+            }
+            else if (items[i] == "rename" && i + 2 < items.size())
+            {
+                findOrThrow(rootNode, items[i + 1])->setPodName(items[i + 2]);
+                i += 2;
+            }
+            else if (items[i] == "delete" && i + 1 < items.size())
+            {
+                PodNode* node = findOrThrow(rootNode, items[++i]);
+                PodNode* parent = node->parent();
+                PodNodeDeque& nodes = parent->asBlock();
+                nodes.erase(std::find(nodes.begin(), nodes.end(), node));
+                delete node;
+                parent->syncBlock();
+            }
+            else
+            {
+                const std::string resolved = resolvedPath(*resolver, items[i]);
+                PodResolver fresh(*rootNode);
+                if (resolvedPath(fresh, items[i]) != resolved)
+                {
+                    throw std::runtime_error("Out of date: " + resolved + ", a new resolver gives "
+                                             + resolvedPath(fresh, items[i]));
+                }
+                std::cout << resolved << std::endl;
+            }
+        }
+    }
+    catch (...)
+    {
+        delete resolver;
+        delete rootNode;
+        throw;
+    }
+    delete resolver;
+    delete rootNode;
+    return 0;
+}
+
+
+// *****************************************************************************
+//
+// Write 'node' and everything under it a node at a time, the way a
+// generator would, rather than with PodWriter::node()
+//
+static void writeNodes(PodWriter& writer, const PodNode& node)
+{
+    const std::string& name = node.podName();
+    const std::string& podType = node.podType();
+    switch (node.valueType())
+    {
+        case PodNode::BLOCK:
+        {
+            const bool root = !node.parent() && name.empty() && podType.empty();
+            if (!root) writer.beginBlock(name, podType, node.blockScopeType());
+            for (PodNodeDeque::const_iterator iter = node.asBlock().begin();
+                 iter != node.asBlock().end(); ++iter)
+            {
+                writeNodes(writer, **iter);
+            }
+            if (!root) writer.endBlock();
+            break;
+        }
+        case PodNode::STRING:
+            writer.scalar(name, node.asString(), podType);
+            break;
+        case PodNode::INT:
+            writer.scalar(name, node.asInt(), podType);
+            break;
+        case PodNode::FLOAT:
+            writer.scalar(name, node.asFloat(), podType);
+            break;
+        case PodNode::BOOL:
+            writer.scalar(name, node.asBool(), podType);
+            break;
+        case PodNode::IDENTIFIER:
+            writer.identifier(name, node.asIdentifier(), podType);
+            break;
+        case PodNode::EMBED:
+            writer.embed(name, node.asEmbedScript(), node.embedScriptLanguage(), podType);
+            break;
+        default:
+            writer.node(node);  // Nothing else writes a node without a value
+            break;
+    }
+}
+
+
+// *****************************************************************************
+//
+// Throw unless writing a pod a node at a time with PodWriter gives the
+// same text as write()
+//
+static int testWriter(const std::string& input)
+{
+    PodNode* rootNode = parseFile(input);
+    try
+    {
+        PodWriteBuffer expected, written;
+        rootNode->write(expected);
+        PodWriter writer(written);
+        writeNodes(writer, *rootNode);
+        writer.finish();
+        const std::string text(written.data(), written.size());
+        if (text != std::string(expected.data(), expected.size()))
+        {
+            throw std::runtime_error("PodWriter wrote:\n" + text);
+        }
+        std::cout << "PodWriter wrote what write() does, " << written.size() << " bytes" << std::endl;
+    }
+    catch (...)
+    {
+        delete rootNode;
+        throw;
+    }
+    delete rootNode;
+    return 0;
+}
+
+
+// *****************************************************************************
+static int usage(const char* argv0)
+{
+    std::cerr << "Usage: " << argv0 << " index file.pod [changes]" << std::endl;
+    std::cerr << "       " << argv0 << " edit [--sync-root] file.pod output.pod edit..." << std::endl;
+    std::cerr << "       " << argv0 << " find file.pod path" << std::endl;
+    std::cerr << "       " << argv0 << " select file.pod selector" << std::endl;
+    std::cerr << "       " << argv0 << " overlay path layer.pod..." << std::endl;
+    std::cerr << "       " << argv0 << " resolve file.pod path|edit..." << std::endl;
+    std::cerr << "       " << argv0 << " writer file.pod" << std::endl;
+    return 1;
+}
+
+
+// *****************************************************************************
+int main(int argc, char **argv)
+{
+    try
+    {
+        const std::string mode = argc > 1 ? argv[1] : "";
+        if (mode == "index" && (argc == 3 || argc == 4))
+        {
+            return testIndex(argv[2], argc == 4 ? atoi(argv[3]) : 1000);
+        }
+        if (mode == "edit")
+        {
+            const bool syncRoot = argc > 2 && std::string(argv[2]) == "--sync-root";
+            const int first = syncRoot ? 3 : 2;
+            if (argc - first >= 3)
+            {
+                return testEdit(argv[first], argv[first + 1],
+                                std::vector<std::string>(argv + first + 2, argv + argc), syncRoot);
+            }
+        }
+        if (mode == "find" && argc == 4)
+        {
+            return testFind(argv[2], argv[3]);
+        }
+        if (mode == "select" && argc == 4)
+        {
+            return testSelect(argv[2], argv[3]);
+        }
+        if (mode == "overlay" && argc >= 4)
+        {
+            return testOverlay(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+        }
+        if (mode == "resolve" && argc >= 4)
+        {
+            return testResolve(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+        }
+        if (mode == "writer" && argc == 3)
+        {
+            return testWriter(argv[2]);
+        }
+        return usage(argv[0]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+}
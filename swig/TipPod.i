@@ -9,6 +9,13 @@
 #include <unistd.h>
 
 #include "TipPod.h"
+#include "TipPodJson.h"
 %}
 
 %include "TipPod.h"
+
+// PodNode.toJson() returns the text; see TipPodNode.i
+%ignore TipPod::toJson;
+%ignore TipPod::fromJson(const char*, size_t, const std::string&);
+%newobject TipPod::fromJson;
+%include "TipPodJson.h"
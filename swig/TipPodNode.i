@@ -8,6 +8,10 @@
 // Not useful in python
 %ignore operator<<;
 %ignore *::PodNode(const std::string& podName, const std::string& podType, PodValue* value);
+%ignore TipPod::PodNode::addObserver;
+%ignore TipPod::PodNode::removeObserver;
+%ignore TipPod::PodNode::write(PodWriteBuffer&, int) const;
+%ignore TipPod::PodNodeObserver;
 
 
 // *****************************************************************************
@@ -18,6 +22,7 @@
 #include "TipPodNode.h"
 #include "TipPodValue.h"
 #include "TipPodBlockPodValue.h"
+#include "TipPodJson.h"
 
 
 // *****************************************************************************
@@ -196,7 +201,7 @@ static PyObject* PyObjectFromPodNodeValue(TipPod::PodNode* node)
                 if (!PodNodeDeque_swigType) 
                 {
                     // Get the SWIG type descriptor for TipPod::PodNodeDeque
-                    PodNodeDeque_swigType = SWIG_TypeQuery("std::deque<TipPod::PodNode*>*");
+                    PodNodeDeque_swigType = SWIG_TypeQuery("TipPod::PodNodeVector *");
                     assert(PodNodeDeque_swigType);
                 }
 
@@ -205,7 +210,7 @@ static PyObject* PyObjectFromPodNodeValue(TipPod::PodNode* node)
                                                                        node->asBlock().end());
                 result = SWIG_NewPointerObj(SWIG_as_voidptr(block), 
                                             PodNodeDeque_swigType, 
-                                            0);
+                                            SWIG_POINTER_OWN);
             }
             break;
         case TipPod::PodNode::UNDEFINED:
@@ -248,11 +253,19 @@ static PyObject* PyObjectFromPodNodeValue(TipPod::PodNode* node)
     }
 
 
-    std::string __str__()
+    // Made straight from the kept writtenText()
+    PyObject* __str__()
     {
-        std::ostringstream str;
-        $self->write(str);
-        return str.str();
+        const std::string& text = $self->writtenText();
+        return PyString_FromStringAndSize(text.data(), text.size());
+    }
+
+
+    // As TipPodJson.h writes it, without going through python objects
+    PyObject* toJson() const
+    {
+        const std::string json = TipPod::toJson(*$self);
+        return PyString_FromStringAndSize(json.data(), json.size());
     }
 
 
@@ -273,16 +286,45 @@ static PyObject* PyObjectFromPodNodeValue(TipPod::PodNode* node)
     }
 
 
+    // Nodes are equal if they're the same node, or have the same name,
+    // type and value (see contentEquals()).
+    //
+    // NOTES:
+    //
+    // * Before contentHash(), == meant the same node.  It no longer does:
+    //   'node in nodes' and nodes.remove(node) match any node with the same
+    //   content.  Compare with 'is' for the same node.
+    // * Nodes aren't hashable (__hash__ is None).  Nodes can be edited, and
+    //   a hash that agreed with == would change with them, losing nodes
+    //   kept in sets and dicts.  Key those by id(node) instead.
+    //
+    %feature("docstring", "Whether the nodes have the same name, type and value; "
+                          "compare with 'is' for the same node") __eq__;
     bool __eq__(PyObject* other) const
     {
         if (TipPod::PodNode* otherNode = podNodeFromPyObject(other))
         {
-            return $self == otherNode;
+            return $self->contentEquals(*otherNode);
         }
         return false;
     }
 
 
+    bool __ne__(PyObject* other) const
+    {
+        if (TipPod::PodNode* otherNode = podNodeFromPyObject(other))
+        {
+            return !$self->contentEquals(*otherNode);
+        }
+        return true;
+    }
+
+
+    %pythoncode %{
+    __hash__ = None
+    %}
+
+
     TipPod::PodNode* __getitem__(PyObject* key)
     {
         if (PyInt_Check(key))
@@ -336,6 +378,7 @@ static PyObject* PyObjectFromPodNodeValue(TipPod::PodNode* node)
             $self->setValue(block);
         }
         node->setValue(podValueFromPyObject(value));
+        $self->syncBlock();
     }
 
 
@@ -364,6 +407,7 @@ static PyObject* PyObjectFromPodNodeValue(TipPod::PodNode* node)
             if ((*iter) == node)
             {
                 block.erase(iter);
+                $self->syncBlock();
                 return;
             }
         }
@@ -509,6 +553,7 @@ static PyObject* PyObjectFromPodNodeValue(TipPod::PodNode* node)
                 block.push_back(new TipPod::PodNode("", "", podValueFromPyObject(item)));
             }
         }
+        $self->syncBlock();
     }
 
 
@@ -558,7 +603,7 @@ static PyObject* PyObjectFromPodNodeValue(TipPod::PodNode* node)
 
 #endif // End #ifdef SWIGPYTHON
 
-%template(PodNodeDeque) std::deque<TipPod::PodNode*>;
+%include "TipPodNodeVector.i"
 %template(StringVector) std::vector<std::string>;
 
 %include "TipPodNode.h"
@@ -0,0 +1,118 @@
+//******************************************************************************
+// Copyright (c) 2014 Tippett Studio. All rights reserved.
+// $Id$
+//******************************************************************************
+
+//
+// PodNodeVector replaced std::deque<PodNode*> as the container for the nodes
+// of a block.  It's exposed to python under the old name, PodNodeDeque, with
+// the parts of the sequence protocol that the std::deque wrapper provided.
+//
+
+%{
+#include "TipPodNodeVector.h"
+%}
+
+%rename(PodNodeDeque) TipPod::PodNodeVector;
+
+// Raw pointer iterators and references aren't useful in python
+%ignore TipPod::PodNodeVector::PodNodeVector(InputIterator, InputIterator);
+%ignore TipPod::PodNodeVector::operator=;
+%ignore TipPod::PodNodeVector::operator[];
+%ignore TipPod::PodNodeVector::begin;
+%ignore TipPod::PodNodeVector::end;
+%ignore TipPod::PodNodeVector::rbegin;
+%ignore TipPod::PodNodeVector::rend;
+%ignore TipPod::PodNodeVector::at;
+%ignore TipPod::PodNodeVector::front;
+%ignore TipPod::PodNodeVector::back;
+%ignore TipPod::PodNodeVector::insert;
+%ignore TipPod::PodNodeVector::erase;
+%ignore TipPod::operator==(const PodNodeVector&, const PodNodeVector&);
+%ignore TipPod::operator!=(const PodNodeVector&, const PodNodeVector&);
+
+#ifdef SWIGPYTHON
+
+%{
+// *****************************************************************************
+//
+// Return a valid index into a PodNodeVector given a python-style
+// array index (which can be negative).
+//
+static size_t vectorIndex(const TipPod::PodNodeVector* vec, int index)
+{
+    const int size = int(vec->size());
+    if (index < 0)
+    {
+        index += size;
+    }
+    if (index < 0 || index >= size)
+    {
+        throw std::out_of_range("PodNodeDeque index out of range");
+    }
+    return index;
+}
+%}
+
+%extend TipPod::PodNodeVector
+{
+    size_t __len__() const { return $self->size(); }
+    bool __nonzero__() const { return !$self->empty(); }
+    bool __bool__() const { return !$self->empty(); }
+
+    TipPod::PodNode* __getitem__(int index) const
+    {
+        return (*$self)[vectorIndex($self, index)];
+    }
+
+    void __setitem__(int index, TipPod::PodNode* node)
+    {
+        (*$self)[vectorIndex($self, index)] = node;
+    }
+
+    void __delitem__(int index)
+    {
+        $self->erase($self->begin() + vectorIndex($self, index));
+    }
+
+    void append(TipPod::PodNode* node) { $self->push_back(node); }
+
+    TipPod::PodNode* pop()
+    {
+        if ($self->empty())
+        {
+            throw std::out_of_range("pop from empty PodNodeDeque");
+        }
+        TipPod::PodNode* node = $self->back();
+        $self->pop_back();
+        return node;
+    }
+
+    TipPod::PodNode* front() const
+    {
+        if ($self->empty())
+        {
+            throw std::out_of_range("front of empty PodNodeDeque");
+        }
+        return $self->front();
+    }
+
+    TipPod::PodNode* back() const
+    {
+        if ($self->empty())
+        {
+            throw std::out_of_range("back of empty PodNodeDeque");
+        }
+        return $self->back();
+    }
+
+    %pythoncode %{
+    def __iter__(self):
+        for i in xrange(len(self)):
+            yield self[i]
+    %}
+}
+
+#endif // End #ifdef SWIGPYTHON
+
+%include "TipPodNodeVector.h"
@@ -19,6 +19,7 @@
 %include "std_string.i"
 %include "std_wstring.i"
 %include "std_except.i"
+%include "stdint.i"
 
 %{
 #include <stdexcept>
@@ -49,6 +50,16 @@ public:
         PyErr_SetString(PyExc_ValueError, err.what());
         SWIG_fail;
     }
+    catch (const TipPod::PodPathError& err)
+    {
+        PyErr_SetString(PyExc_ValueError, err.what());
+        SWIG_fail;
+    }
+    catch (const TipPod::PodSelectorError& err)
+    {
+        PyErr_SetString(PyExc_ValueError, err.what());
+        SWIG_fail;
+    }
     SWIG_CATCH_STDEXCEPT
 }
 
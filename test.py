@@ -6,7 +6,12 @@
 
 import sys
 import os
+import shutil
+import socket
+import struct
 import subprocess
+import tempfile
+import time
 
 
 TEST_PODS_DIR = [
@@ -15,12 +20,56 @@ TEST_PODS_DIR = [
                  ("./testmuds", ".mud"),
                  ]
 PARSER = "./parser"
+PODTEST = "./podtest"
 LOG_FILE = "./test.log"
 
 results = list()
 if os.path.exists(LOG_FILE):
     os.remove(LOG_FILE)
 
+
+class TestFailure(Exception):
+    pass
+
+
+def check(condition, message):
+    if not condition:
+        raise TestFailure(message)
+
+
+def run(args, program=PARSER):
+    """Run the parser, or another program, and return its exit status and output"""
+    p = subprocess.Popen([program] + args,
+                         stdout=subprocess.PIPE,
+                         stderr=subprocess.STDOUT)
+    output = p.communicate()[0]
+    return p.returncode, output
+
+
+def record(label, test):
+    """Run test(), which raises TestFailure if it fails, and log the result"""
+    try:
+        test()
+        returncode, output = 0, ""
+    except TestFailure, e:
+        returncode, output = 1, str(e) + "\n"
+    results.append( (returncode, output) )
+    testlog = file(LOG_FILE, 'a')
+    testlog.write("-"*80)
+    testlog.write("\n")
+    testlog.write("Test: %s\n" % label)
+    testlog.write("returncode: %d\n" % returncode)
+    if returncode != 0:
+        print "[31;1mFAIL[0m: %s" % label
+        print "\t", filter(bool, output.splitlines())[-1]
+        testlog.write("\n")
+        testlog.write(output)
+        testlog.write("\n")
+        testlog.write("\n")
+    else:
+        print "[32;1mPASS[0m: %s" % label
+        sys.stdout.flush()
+
 for d, ext in TEST_PODS_DIR:
     for f in filter(lambda f: f.endswith(ext), 
                     os.listdir(d)):
@@ -47,6 +96,880 @@ for d, ext in TEST_PODS_DIR:
             print "[32;1mPASS[0m: %s" % f
             sys.stdout.flush()
 
+#
+# .pod -> .podb -> .pod must give the same text as writing the parsed .pod,
+# and so must .pod -> .json -> .pod and .pod -> .podw -> .pod, and reading
+# that text and writing it again.  Writing it keeping
+# its formatting must give back the file exactly.
+#
+tmpdir = tempfile.mkdtemp()
+
+
+def testRoundTrip(f):
+    def test():
+        name = os.path.splitext(os.path.basename(f))[0]
+        podb = os.path.join(tmpdir, name + ".podb")
+        roundtrip = os.path.join(tmpdir, name + ".roundtrip.pod")
+        expected = os.path.join(tmpdir, name + ".expected.pod")
+        rewritten = os.path.join(tmpdir, name + ".rewritten.pod")
+        kept = os.path.join(tmpdir, name + ".kept.pod")
+        json = os.path.join(tmpdir, name + ".json")
+        fromjson = os.path.join(tmpdir, name + ".fromjson.pod")
+        wire = os.path.join(tmpdir, name + ".podw")
+        fromwire = os.path.join(tmpdir, name + ".fromwire.pod")
+
+        for args in ([f, expected], [f, podb], [podb, roundtrip], [expected, rewritten],
+                     [f, json], [json, fromjson], [f, wire], [wire, fromwire]):
+            returncode, output = run(["--convert"] + args)
+            check(returncode == 0, output)
+        for via, back in ((podb, roundtrip), (json, fromjson), (wire, fromwire)):
+            check(file(expected).read() == file(back).read(),
+                  "Round trip through %s changed the pod" % via)
+        check(file(expected).read() == file(rewritten).read(),
+              "Reading the written pod back changed it")
+        returncode, output = run(["--rewrite", f, kept])
+        check(returncode == 0, output)
+        check(file(f).read() == file(kept).read(),
+              "Writing the pod keeping its formatting changed it")
+    return test
+
+
+for f in filter(lambda f: f.endswith(".pod"), 
+                os.listdir("./testpods")):
+    f = os.path.join("./testpods", f)
+    record("round trip %s" % f, testRoundTrip(f))
+shutil.rmtree(tmpdir)
+
+#
+# Reading a pod through a PodDiskCache must give the pod, whether the cache
+# had it (under any name for the file) or not, had it from before an edit,
+# or had a damaged copy; and many processes must be able to fill one cache
+# at once.
+#
+tmpdir = tempfile.mkdtemp()
+cachedPod = os.path.join(tmpdir, "cached.pod")
+cacheDir = os.path.join(tmpdir, "cache")
+
+
+def writePod(path, text, mtime=1000000000):
+    f = file(path, "w")
+    f.write(text)
+    f.close()
+    os.utime(path, (mtime, mtime))
+
+
+def readCached(path, flags=[], directory=cacheDir, current=True):
+    """Read a pod through the cache, and return the cache's stats"""
+    out = os.path.join(tmpdir, "out.pod")
+    expected = os.path.join(tmpdir, "expected.pod")
+    returncode, stats = run(["--cached"] + flags + [directory, path, out])
+    check(returncode == 0, stats)
+    if current:
+        returncode, output = run(["--convert", path, expected])
+        check(returncode == 0, output)
+        check(file(out).read() == file(expected).read(),
+              "Reading %s through the cache changed it" % path)
+    words = stats.split()
+    return dict(zip(words[::2], map(int, words[1::2])))
+
+
+def testMissThenHit():
+    writePod(cachedPod, 'shot = { start = 1001; name = "sh010"; };\n')
+    stats = readCached(cachedPod)
+    check(stats["misses"] == 1 and stats["stores"] == 1, "First read wasn't a miss: %s" % stats)
+    stats = readCached(cachedPod)
+    check(stats["hits"] == 1, "Second read wasn't a hit: %s" % stats)
+
+
+def testOtherNames():
+    link = os.path.join(tmpdir, "link.pod")
+    os.symlink(cachedPod, link)
+    for name in (link, os.path.join(tmpdir, ".", "cached.pod")):
+        stats = readCached(name)
+        check(stats["hits"] == 1, "Reading it as %s wasn't a hit: %s" % (name, stats))
+
+
+def testEdited():
+    writePod(cachedPod, 'shot = { start = 1001; end = 1100; name = "sh010"; };\n', 1000000100)
+    stats = readCached(cachedPod)
+    check(stats["stale"] == 1, "Reading it after an edit wasn't stale: %s" % stats)
+
+
+def testVerifyContent():
+    # The same size and modification time, so only the content tells
+    writePod(cachedPod, 'shot = { start = 1001; end = 1100; name = "sh020"; };\n', 1000000100)
+    stats = readCached(cachedPod, current=False)
+    check(stats["hits"] == 1, "Without --verify, the entry should still be used: %s" % stats)
+    stats = readCached(cachedPod, ["--verify"])
+    check(stats["stale"] == 1, "With --verify, the entry should be stale: %s" % stats)
+
+
+def testDamaged():
+    for name in os.listdir(cacheDir):
+        f = file(os.path.join(cacheDir, name), "r+")
+        f.seek(16)
+        f.write("damaged" * 8)
+        f.close()
+    stats = readCached(cachedPod)
+    check(stats["stale"] == 1, "A damaged entry wasn't stale: %s" % stats)
+
+
+def testEviction():
+    other = os.path.join(tmpdir, "other.pod")
+    writePod(other, "frames = { 1; 2; 3; };\n")
+    stats = readCached(other, ["--max-bytes", "1"])
+    check(stats["evictions"] >= 1, "Nothing was evicted: %s" % stats)
+
+
+def testConcurrent():
+    directory = os.path.join(tmpdir, "shared")
+    outs = [os.path.join(tmpdir, "concurrent%d.pod" % i) for i in range(8)]
+    procs = [subprocess.Popen([PARSER, "--cached", directory, cachedPod, out],
+                              stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+             for out in outs]
+    for p in procs:
+        output = p.communicate()[0]
+        check(p.returncode == 0, output)
+    expected = os.path.join(tmpdir, "expected.pod")
+    run(["--convert", cachedPod, expected])
+    for out in outs:
+        check(file(out).read() == file(expected).read(), "%s isn't the pod" % out)
+
+
+record("disk cache: miss, then hit", testMissThenHit)
+record("disk cache: hit through other names", testOtherNames)
+record("disk cache: stale after an edit", testEdited)
+record("disk cache: verifying content", testVerifyContent)
+record("disk cache: damaged entry", testDamaged)
+record("disk cache: eviction", testEviction)
+record("disk cache: processes filling one cache at once", testConcurrent)
+shutil.rmtree(tmpdir)
+
+#
+# Floats are written in the shortest form that reads back exactly, and must
+# read back, subnormals and the largest float included
+#
+tmpdir = tempfile.mkdtemp()
+
+
+def testFloatRoundTrip():
+    text = """tiny = 1e-45;
+subnormal = 1.1754942e-38;
+smallest = 1.1754944e-38;
+largest = 3.4028235e+38;
+negative = -3.4028235e+38;
+"""
+    pod = os.path.join(tmpdir, "floats.pod")
+    writePod(pod, text)
+    for via in ["floats.out.pod", "floats.podb", "floats.json", "floats.podw"]:
+        converted = os.path.join(tmpdir, via)
+        back = os.path.join(tmpdir, via + ".back.pod")
+        for args in ([pod, converted], [converted, back]):
+            returncode, output = run(["--convert"] + args)
+            check(returncode == 0, output)
+        check(file(back).read() == text,
+              "Floats through %s came back as:\n%s" % (via, file(back).read()))
+
+
+record("floats: subnormals and the largest float read back", testFloatRoundTrip)
+shutil.rmtree(tmpdir)
+
+#
+# --rewrite sets single values, and must refuse a block rather than crash
+#
+tmpdir = tempfile.mkdtemp()
+
+
+def testRewriteValue():
+    pod = os.path.join(tmpdir, "rewrite.pod")
+    out = os.path.join(tmpdir, "rewritten.pod")
+    writePod(pod, 'key = { shadows = 1; name = "x"; };\n')
+    returncode, output = run(["--rewrite", pod, out, "key.shadows", "2.5"])
+    check(returncode == 0, output)
+    check(file(out).read() == 'key = { shadows = 2.5; name = "x"; };\n',
+          "Rewriting key.shadows gave: " + file(out).read())
+    returncode, output = run(["--rewrite", pod, out, "key.shadows", "{ x = 1; }"])
+    check(returncode == 1 and "to a block" in output,
+          "Setting a block value gave status %d: %s" % (returncode, output))
+
+
+record("rewrite: setting a value, and refusing a block", testRewriteValue)
+
+
+def testRewriteUnknownToken():
+    # Scanning stops at the unknown '/', and the rest must still be copied
+    pod = os.path.join(tmpdir, "tail.pod")
+    out = os.path.join(tmpdir, "tail.rewritten.pod")
+    writePod(pod, "a = 1;\n// tail")
+    returncode, output = run(["--rewrite", pod, out])
+    check(returncode == 0, output)
+    check(file(out).read() == file(pod).read(),
+          "Rewriting gave: %r" % file(out).read())
+
+
+record("rewrite: a last line comment without a newline", testRewriteUnknownToken)
+
+
+#
+# Reordering, inserting and deleting nodes must keep the formatting of the
+# rest, and give a pod that reads back, comments after a node and all
+#
+editText = """a = { x = 1;   // keep
+  y = "s"; };
+b = 2; # end
+"""
+
+
+def editPod(args, text=editText, syncRoot=False):
+    pod = os.path.join(tmpdir, "edit.pod")
+    out = os.path.join(tmpdir, "edited.pod")
+    writePod(pod, text)
+    returncode, output = run(["edit"] + (syncRoot and ["--sync-root"] or []) + [pod, out] + args,
+                             PODTEST)
+    check(returncode == 0, output)
+    changes = output
+    returncode, output = run([out])
+    check(returncode == 0 and "Unknown token" not in output,
+          "The edited pod doesn't read back: " + output)
+    return file(out).read(), changes
+
+
+def testEdit(args, expected, text=editText, syncRoot=False):
+    def test():
+        edited, changes = editPod(args, text, syncRoot)
+        check(edited == expected, "Editing gave:\n" + edited)
+    return test
+
+
+record("keep format: reordering after a line comment",
+       testEdit(["reverse", "a"], """a = {  y = "s"; x = 1;   // keep
+ };
+b = 2; # end
+"""))
+record("keep format: reordering the top level",
+       testEdit(["reverse", ""], """
+b = 2; # end
+a = { x = 1;   // keep
+  y = "s"; };"""))
+record("keep format: inserting after a line comment",
+       testEdit(["insert", "a", "1", "z = 3;"], """a = { x = 1;   // keep
+    z = 3;  y = "s"; };
+b = 2; # end
+"""))
+record("keep format: inserting first",
+       testEdit(["insert", "a", "0", "z = 3;"], """a = {
+    z = 3; x = 1;   // keep
+  y = "s"; };
+b = 2; # end
+"""))
+record("keep format: inserting last",
+       testEdit(["insert", "a", "2", "z = 3;"], """a = { x = 1;   // keep
+  y = "s";
+    z = 3; };
+b = 2; # end
+"""))
+record("keep format: deleting a node with a line comment",
+       testEdit(["delete", "a.x"], """a = {  y = "s"; };
+b = 2; # end
+"""))
+record("keep format: deleting the last node",
+       testEdit(["delete", "b"], """a = { x = 1;   // keep
+  y = "s"; };"""))
+
+nestedText = """a = { b = { x = 1; w = 0; }; };
+c = 1;
+"""
+record("keep format: a nested insert, synced from the top",
+       testEdit(["insert", "a.b", "1", "y = 2;"], """a = { b = { x = 1;
+        y = 2; w = 0; }; };
+c = 1;
+""", nestedText, True))
+record("keep format: a nested reorder, synced from the top",
+       testEdit(["reverse", "a.b"], """a = { b = { w = 0; x = 1; }; };
+c = 1;
+""", nestedText, True))
+record("keep format: a nested delete, synced from the top",
+       testEdit(["delete", "a.b.w"], """a = { b = { x = 1; }; };
+c = 1;
+""", nestedText, True))
+
+
+# podtest edit also checks that every node's writtenText() is up to date,
+# kept from before the edit as it was; a block kept while it had no parent
+# was written without its braces
+record("written text: inserting a block kept without a parent",
+       testEdit(["insert", "a", "0", "{ v = 1; };"], """a = {
+    {
+        v = 1;
+    }; b = { x = 1; w = 0; }; };
+c = 1;
+""", nestedText, True))
+
+
+#
+# Syncing from the top must let diff() see an edit made further down, though
+# the hashes of the nodes above it were kept from before
+#
+def testEditDiff(args, expected, syncRoot):
+    def test():
+        edited, changes = editPod(args, nestedText, syncRoot)
+        check(changes == expected, "Diffing after the edit gave:\n" + changes)
+    return test
+
+
+for syncRoot in (False, True):
+    synced = syncRoot and "synced from the top" or "synced where it was made"
+    record("diff: a nested insert, " + synced,
+           testEditDiff(["insert", "a.b", "1", "y = 2;"], "+ a.b.y\n", syncRoot))
+    record("diff: a nested delete, " + synced,
+           testEditDiff(["delete", "a.b.w"], "- a.b.w\n", syncRoot))
+
+#
+# A PodNodeIndex must list what a walk of the tree finds, in document order
+# to begin with, and still after each of many random changes to the tree
+#
+def testIndex(pod):
+    def test():
+        returncode, output = run(["index", pod, "2000"], PODTEST)
+        check(returncode == 0, output)
+    return test
+
+
+indexPod = os.path.join(tmpdir, "index.pod")
+writePod(indexPod, """Light key = { intensity = 1.5; Shader shader = "plastic"; };
+Light fill = { intensity = 0.5; lights = { Light a = 1; Light b = 2; }; };
+Camera main = { fov = 35; };
+{ 1; 2; key = 3; };
+""")
+for f in [indexPod] + [os.path.join("./testpods", f) for f in os.listdir("./testpods")
+                       if f.endswith(".pod")]:
+    record("index: following changes to %s" % f, testIndex(f))
+shutil.rmtree(tmpdir)
+
+#
+# --diff must match children by name, and unnamed or same-named ones by
+# content and then in order, so a rename is a removal and an addition and
+# inserting into a list adds one entry rather than changing what follows
+#
+tmpdir = tempfile.mkdtemp()
+
+
+def diffPods(before, after):
+    beforePod = os.path.join(tmpdir, "before.pod")
+    afterPod = os.path.join(tmpdir, "after.pod")
+    writePod(beforePod, before)
+    writePod(afterPod, after)
+    returncode, output = run(["--diff", beforePod, afterPod])
+    check(returncode == 0, output)
+    return output
+
+
+def testDiffNamed():
+    output = diffPods("""Light key = { intensity = 1.5; };
+fill = 0.5;
+old = 1;
+""", """Light key = { intensity = 2.0; };
+rim = 0.5;
+new = "x";
+""")
+    expected = """- fill
+- old
+~ key.intensity: 1.5 -> 2.0
++ rim = 0.5
++ new = "x"
+"""
+    check(output == expected, "Diff gave:\n" + output)
+
+
+def testDiffUnnamed():
+    output = diffPods("""list = { 1; 1; 2; };
+{ a = 1; };
+{ a = 1; };
+""", """list = { 1; 5; 1; 2; };
+{ a = 1; };
+{ a = 1; };
+{ a = 1; };
+""")
+    expected = """+ list[1] = 5
++ [3] = { 1 node }
+"""
+    check(output == expected, "Diff gave:\n" + output)
+
+
+def testDiffSame(pod):
+    def test():
+        returncode, output = run(["--diff", pod, pod])
+        changes = [l for l in output.splitlines() if not l.startswith("WARNING")]
+        check(returncode == 0 and not changes,
+              "Diffing a pod with itself gave:\n" + output)
+    return test
+
+
+record("diff: renamed, added, removed and changed nodes", testDiffNamed)
+record("diff: inserting among duplicate unnamed nodes", testDiffUnnamed)
+for f in [os.path.join("./testpods", f) for f in os.listdir("./testpods")
+          if f.endswith(".pod")]:
+    record("diff: %s against itself" % f, testDiffSame(f))
+shutil.rmtree(tmpdir)
+
+#
+# --merge must take theirs' changes into ours where only one side changed
+# a node, and where both did differently keep ours, report the conflict
+# and exit 1
+#
+tmpdir = tempfile.mkdtemp()
+mergeBase = """Light key = { intensity = 1.5; color = 1; };
+fill = 0.5;
+old = 1;
+"""
+mergeOurs = """Light key = { intensity = 2.0; color = 1; };
+fill = 0.5;
+old = 1;
+"""
+
+
+def mergePods(theirs):
+    paths = [os.path.join(tmpdir, name) for name in ["base.pod", "ours.pod", "theirs.pod"]]
+    for path, text in zip(paths, [mergeBase, mergeOurs, theirs]):
+        writePod(path, text)
+    return run(["--merge"] + paths)
+
+
+def testMergeClean():
+    returncode, output = mergePods("""Light key = { intensity = 1.5; color = 2; };
+fill = 0.5;
+rim = 3;
+""")
+    expected = """Light key = {
+    intensity = 2.0;
+    color = 2;
+};
+fill = 0.5;
+rim = 3;
+"""
+    check(returncode == 0, "Merging gave status %d: %s" % (returncode, output))
+    check(output == expected, "Merging gave:\n" + output)
+
+
+def testMergeConflict():
+    returncode, output = mergePods("""Light key = { intensity = 3.0; color = 1; };
+fill = 0.5;
+old = 1;
+""")
+    check(returncode == 1, "Merging gave status %d: %s" % (returncode, output))
+    check("CONFLICT key.intensity: 1.5, ours 2.0, theirs 3.0\n" in output,
+          "Merging didn't report the conflict:\n" + output)
+    check("intensity = 2.0;" in output and "3.0" not in output.split("\n", 1)[1],
+          "Merging didn't keep ours:\n" + output)
+
+
+record("merge: changes on both sides to different nodes", testMergeClean)
+record("merge: a conflicting change, exiting 1", testMergeConflict)
+shutil.rmtree(tmpdir)
+
+#
+# PodWriter writing a pod a node at a time must give the same text as
+# write() does for the parsed pod: types, names, scopes, escapes and all
+#
+tmpdir = tempfile.mkdtemp()
+
+
+def testWriter(pod):
+    def test():
+        returncode, output = run(["writer", pod], PODTEST)
+        check(returncode == 0, output)
+    return test
+
+
+writerPod = os.path.join(tmpdir, "writer.pod")
+writePod(writerPod, """Shot shot = { frames = 240; camera = "cam \\"main\\"\\n"; };
+frames = Range { start = 1; end = 100; };
+{ 1; 2.5; true; };
+Light key = { intensity = 0.1; on = false; shader = plastic; };
+script = <python>print 1</python>;
+Camera;
+cameras = { Cam::main = { fov = 35; }; };
+""")
+for f in [writerPod] + [os.path.join("./testpods", f) for f in os.listdir("./testpods")
+                        if f.endswith(".pod")]:
+    record("writer: the same as write() for %s" % f, testWriter(f))
+shutil.rmtree(tmpdir)
+
+#
+# A PodPath must find the node each form of step names, or nothing where a
+# step is missing, the same in a tree and a snapshot (which podtest find
+# checks); a malformed one must be refused with the column that's wrong
+#
+tmpdir = tempfile.mkdtemp()
+pathPod = os.path.join(tmpdir, "path.pod")
+writePod(pathPod, """render = { shadows = { resolution = 1024; }; fps = 24; };
+lights = { Light key = { intensity = 1; }; Light fill = { intensity = 0.5; }; Light key = 3; };
+cameras = { Cam::main = { fov = 35; }; Camera side = { fov = 20; }; };
+a.b = 1;
+x = { c = 2; };
+list = { { 1; 2; }; { 3; 4; }; };
+value = 5;
+""")
+
+
+def testFind(path, expected):
+    def test():
+        returncode, output = run(["find", pathPod, path], PODTEST)
+        check(returncode == 0, output)
+        check(output == "%s: %s\n" % (path, expected), "Finding %s gave:\n%s" % (path, output))
+    return test
+
+
+def testBadPath(path, column):
+    def test():
+        returncode, output = run(["find", pathPod, path], PODTEST)
+        check(returncode == 1 and "Bad pod path '%s', column %d:" % (path, column) in output,
+              "Finding %s gave status %d: %s" % (path, returncode, output))
+    return test
+
+
+record("path: names", testFind("render.shadows.resolution", "render.shadows.resolution"))
+record("path: the first of several with a name", testFind("lights.key", "lights.key"))
+record("path: an index", testFind("lights[1]", "lights.fill"))
+record("path: a negative index", testFind("lights[-1]", "lights[2]"))
+record("path: an index alone", testFind("[0]", "render"))
+record("path: a negative index alone", testFind("[-1]", "value"))
+record("path: indexes in a row", testFind("list[1][0]", "list[1][0]"))
+record("path: a negative index in a row", testFind("list[0][-1]", "list[0][1]"))
+record("path: a scoped name", testFind("cameras.Cam::main.fov", "cameras.Cam::main.fov"))
+record("path: a type and name", testFind("cameras.Camera::side", "cameras.side"))
+record("path: a type and name, the type wrong", testFind("cameras.Light::side", "not found"))
+record("path: a dotted name", testFind("a.b", "a.b"))
+record("path: nothing under a dotted name", testFind("a.b.c", "not found"))
+record("path: empty, the root", testFind("", "(root)"))
+record("path: a missing name", testFind("missing", "not found"))
+record("path: a name under a value", testFind("value.x", "not found"))
+record("path: an index into a value", testFind("value[0]", "not found"))
+record("path: an index past the end", testFind("lights[3]", "not found"))
+record("path: a negative index past the start", testFind("lights[-4]", "not found"))
+record("path: refusing an empty step", testBadPath("a..b", 3))
+record("path: refusing a leading '.'", testBadPath(".a", 1))
+record("path: refusing a trailing '.'", testBadPath("a.", 3))
+record("path: refusing an index that isn't a number", testBadPath("[x]", 2))
+record("path: refusing an empty index", testBadPath("[]", 2))
+record("path: refusing an unterminated index", testBadPath("a[", 3))
+record("path: refusing a name right after an index", testBadPath("a[1]b", 5))
+record("path: refusing a scope without a name", testBadPath("a::", 2))
+record("path: refusing a name without a scope", testBadPath("::a", 1))
+shutil.rmtree(tmpdir)
+
+#
+# A PodResolver must find what identifiers name, looking out through the
+# blocks around them, and must forget what it found once the tree is
+# edited (podtest resolve checks each answer against a new resolver's)
+#
+tmpdir = tempfile.mkdtemp()
+resolvePod = os.path.join(tmpdir, "resolve.pod")
+writePod(resolvePod, """fps = 24;
+rate = fps;
+cameras = { Cam::main = { fov = 35; }; side = 2; };
+shot = { fps = 48; frameRate = fps; outer = rate; fps2 = { fps = fps; }; camera = cameras.side; };
+loopA = loopB;
+loopB = loopA;
+lost = nowhere;
+""")
+
+
+def testResolve(items, expected):
+    def test():
+        returncode, output = run(["resolve", resolvePod] + items, PODTEST)
+        check(returncode == 0, output)
+        check(output == expected, "Resolving gave:\n" + output)
+    return test
+
+
+def testResolveCycle():
+    returncode, output = run(["resolve", resolvePod, "loopA"], PODTEST)
+    check(returncode == 0 and "cycle of references 'loopA' -> 'loopB' -> 'loopA'" in output,
+          "Resolving a cycle gave status %d: %s" % (returncode, output))
+
+
+record("resolve: identifiers in and around a block",
+       testResolve(["fps", "rate", "shot.frameRate", "shot.outer", "shot.fps2.fps",
+                    "shot.camera", "lost"],
+                   """fps -> fps
+rate -> fps
+shot.frameRate -> shot.fps
+shot.outer -> fps
+shot.fps2.fps -> shot.fps
+shot.camera -> cameras.side
+lost -> not found
+"""))
+record("resolve: a cycle of references", testResolveCycle)
+record("resolve: forgetting after a node is deleted",
+       testResolve(["shot.frameRate", "delete", "shot.fps", "shot.frameRate"],
+                   """shot.frameRate -> shot.fps
+shot.frameRate -> fps
+"""))
+record("resolve: forgetting after a node is renamed",
+       testResolve(["rate", "lost", "rename", "fps", "nowhere", "rate", "lost"],
+                   """rate -> fps
+lost -> not found
+rate -> not found
+lost -> nowhere
+"""))
+record("resolve: forgetting after a value is set",
+       testResolve(["rate", "shot.outer", "set", "rate", "cameras.side", "rate", "shot.outer"],
+                   """rate -> fps
+shot.outer -> fps
+rate -> cameras.side
+shot.outer -> cameras.side
+"""))
+record("resolve: breaking a cycle",
+       testResolve(["set", "loopB", "fps", "loopA"], "loopA -> fps\n"))
+shutil.rmtree(tmpdir)
+
+#
+# A selector must match the nodes it describes, in the order a walk finds
+# them, and the same in a snapshot and with an index (which podtest select
+# checks); a malformed one must be refused with the column that's wrong
+#
+tmpdir = tempfile.mkdtemp()
+selectPod = os.path.join(tmpdir, "select.pod")
+writePod(selectPod, """lights = {
+    Light key = { intensity = 2.5; color = "warm"; };
+    Light fill = { intensity = 1; };
+    Light key = { intensity = 4; };
+    Spot rim = { intensity = 3; on = true; };
+};
+frames = Range { start = 1; end = 10; };
+cameras = { Cam::main = { fov = 40; }; };
+node_1 = 1;
+node_2 = "two";
+node_10 = 10;
+""")
+
+
+def testSelect(selector, expected):
+    def test():
+        returncode, output = run(["select", selectPod, selector], PODTEST)
+        check(returncode == 0, output)
+        check(output == "".join(path + "\n" for path in expected),
+              "Selecting %s gave:\n%s" % (selector, output))
+    return test
+
+
+def testBadSelector(selector, column):
+    def test():
+        returncode, output = run(["select", selectPod, selector], PODTEST)
+        check(returncode == 1 and "Bad pod selector '%s', column %d:" % (selector, column) in output,
+              "Selecting %s gave status %d: %s" % (selector, returncode, output))
+    return test
+
+
+record("select: every node, parent first",
+       testSelect("**", ["lights", "lights.key", "lights.key.intensity", "lights.key.color",
+                         "lights.fill", "lights.fill.intensity", "lights[2]",
+                         "lights[2].intensity", "lights.rim", "lights.rim.intensity",
+                         "lights.rim.on", "frames", "frames.start", "frames.end", "cameras",
+                         "cameras.Cam::main", "cameras.Cam::main.fov", "node_1", "node_2",
+                         "node_10"]))
+record("select: the top level",
+       testSelect("*", ["lights", "frames", "cameras", "node_1", "node_2", "node_10"]))
+record("select: by name at any depth",
+       testSelect("**/#intensity", ["lights.key.intensity", "lights.fill.intensity",
+                                    "lights[2].intensity", "lights.rim.intensity"]))
+record("select: by type under a name",
+       testSelect("#lights/Light", ["lights.key", "lights.fill", "lights[2]"]))
+record("select: by type and name, names repeated",
+       testSelect("**/Light#key", ["lights.key", "lights[2]"]))
+record("select: by scope type", testSelect("**/@Range", ["frames"]))
+record("select: type and name patterns",
+       testSelect("#lights/*#?i*", ["lights.fill", "lights.rim"]))
+record("select: a type pattern", testSelect("**/Spot*", ["lights.rim"]))
+record("select: '?' matching one character", testSelect("#node_?", ["node_1", "node_2"]))
+record("select: a node at a path", testSelect("**/[start]", ["frames"]))
+record("select: a path into an indexed child", testSelect("*[[3].on]", ["lights"]))
+record("select: comparing a child's number",
+       testSelect("**/[intensity>2]", ["lights.key", "lights[2]", "lights.rim"]))
+record("select: comparing the node's own number",
+       testSelect("**/#intensity[>=3]", ["lights[2].intensity", "lights.rim.intensity"]))
+record("select: comparing a dotted path",
+       testSelect("*[key.intensity<3]", ["lights"]))
+record("select: comparing a string",
+       testSelect('#lights/*[color=="warm"]', ["lights.key"]))
+record("select: comparing a bool", testSelect("**/[on==true]", ["lights.rim"]))
+record("select: != false for a different kind of value",
+       testSelect("#node_*[!=1]", ["node_10"]))
+record("select: several '**', each node once",
+       testSelect("**/**/#on", ["lights.rim.on"]))
+record("select: nothing matching", testSelect("**/Camera", []))
+record("select: refusing an empty selector", testBadSelector("", 1))
+record("select: refusing an empty step", testBadSelector("/", 1))
+record("select: refusing '#' without a name", testBadSelector("Light#", 7))
+record("select: refusing '@' without a scope type", testBadSelector("@", 2))
+record("select: refusing an unterminated '['",
+       testBadSelector("**/Light[intensity>2", 21))
+record("select: refusing an unterminated string",
+       testBadSelector('**/[color == "warm]', 14))
+record("select: refusing an unknown comparison", testBadSelector("**/[a ~ 1]", 7))
+record("select: refusing a comparison without a value", testBadSelector("**/[a > ]", 9))
+record("select: refusing text after a step",
+       testBadSelector("**/Light[intensity>2]]", 22))
+record("select: refusing a malformed path", testBadSelector("**/[[x]", 5))
+shutil.rmtree(tmpdir)
+
+#
+# A PodOverlay must give the top layer's node at a path, whatever form the
+# path takes, fall back to the layers below for what the top one lacks,
+# merge blocks, and let a value hide a block below it; flattening it must
+# give the same (which podtest overlay checks)
+#
+tmpdir = tempfile.mkdtemp()
+overlayBase = os.path.join(tmpdir, "base.pod")
+overlayShot = os.path.join(tmpdir, "shot.pod")
+writePod(overlayBase, """render = { fps = 24; gamma = 2.2; shadows = { on = true; resolution = 1024; }; };
+lights = { Light key = { intensity = 1; }; Light fill = { intensity = 0.5; }; };
+cameras = { Cam::main = { fov = 35; near = 0.1; }; };
+frames = Range { start = 1; end = 100; };
+""")
+writePod(overlayShot, """render = { fps = 48; shadows = { resolution = 2048; }; };
+lights = { Light key = { intensity = 3; }; Light rim = { intensity = 2; }; };
+cameras = { Cam::main = { fov = 50; }; };
+frames = 12;
+""")
+
+
+def testOverlay(path, expected, layers=[overlayBase, overlayShot]):
+    def test():
+        returncode, output = run(["overlay", path] + layers, PODTEST)
+        check(returncode == 0, output)
+        check(output == expected, "Looking up %s gave:\n%s" % (path, output))
+    return test
+
+
+record("overlay: a value from the top layer",
+       testOverlay("render.fps", "layer 1: fps = 48;\n"))
+record("overlay: falling back to the base",
+       testOverlay("render.gamma", "layer 0: gamma = 2.2;\n"))
+record("overlay: falling back in a nested block",
+       testOverlay("render.shadows.on", "layer 0: on = true;\n"))
+record("overlay: overriding in a nested block",
+       testOverlay("render.shadows.resolution", "layer 1: resolution = 2048;\n"))
+record("overlay: merging a block",
+       testOverlay("render.shadows", """layer 1: shadows = {
+    resolution = 2048;
+    on = true;
+};
+"""))
+record("overlay: an index counting the merged block",
+       testOverlay("lights[2]", """layer 0: Light fill = {
+    intensity = 0.5;
+};
+"""))
+record("overlay: a negative index",
+       testOverlay("lights[-1]", """layer 0: Light fill = {
+    intensity = 0.5;
+};
+"""))
+record("overlay: a path through an index",
+       testOverlay("lights[0].intensity", "layer 1: intensity = 3;\n"))
+record("overlay: a scoped name",
+       testOverlay("cameras.Cam::main.fov", "layer 1: fov = 50;\n"))
+record("overlay: a scoped name falling back to the base",
+       testOverlay("cameras.Cam::main.near", "layer 0: near = 0.1;\n"))
+record("overlay: a type and name",
+       testOverlay("lights.Light::key.intensity", "layer 1: intensity = 3;\n"))
+record("overlay: a type and name from the base",
+       testOverlay("lights.Light::fill", """layer 0: Light fill = {
+    intensity = 0.5;
+};
+"""))
+record("overlay: a value hiding a block",
+       testOverlay("frames", "layer 1: frames = 12;\n"))
+record("overlay: nothing under a value hiding a block",
+       testOverlay("frames.start", "frames.start: not found\n"))
+record("overlay: an index past the end",
+       testOverlay("lights[5]", "lights[5]: not found\n"))
+record("overlay: one layer", testOverlay("render.fps", "layer 0: fps = 24;\n", [overlayBase]))
+shutil.rmtree(tmpdir)
+
+#
+# podqueryd must answer podquery's requests, reply with an error to one
+# that asks for more paths than it has, and hang up on a frame cut short
+# or too short for its header, without stopping serving anyone else
+#
+tmpdir = tempfile.mkdtemp()
+querySocket = os.path.join(tmpdir, "podqueryd.sock")
+queryPod = os.path.join(tmpdir, "query.pod")
+writePod(queryPod, """render = { shadows = true; gamma = 1.2345679; name = "beauty"; };
+frames = 100;
+""")
+
+
+def sendFrame(body, length=None):
+    """Send a request frame to podqueryd, and return all it replied"""
+    if length is None:
+        length = len(body)
+    try:
+        connection = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        connection.connect(querySocket)
+        connection.sendall(struct.pack("=I", length) + body)
+        connection.shutdown(socket.SHUT_WR)
+        reply = ""
+        while True:
+            data = connection.recv(4096)
+            if not data:
+                break
+            reply += data
+        connection.close()
+    except socket.error, e:
+        raise TestFailure("Talking to podqueryd: " + str(e))
+    return reply
+
+
+def testQuery():
+    returncode, output = run(["-s", querySocket, queryPod, "render.gamma", "frames",
+                              "render.shadows", "render.name", "missing"], "./podquery")
+    expected = """render.gamma = 1.2345679
+frames = 100
+render.shadows = true
+render.name = beauty
+missing: not found
+"""
+    check(returncode == 1, "podquery gave status %d: %s" % (returncode, output))
+    check(output == expected, "podquery gave:\n" + output)
+
+
+def testQueryTooFewPaths():
+    body = struct.pack("=IHH", 7, len(queryPod), 2) + queryPod
+    reply = sendFrame(body)
+    check(len(reply) > 9, "No reply to a request missing its paths: %r" % reply)
+    length, replyId, status = struct.unpack("=IIB", reply[:9])
+    check(length == len(reply) - 4 and replyId == 7 and status == 1,
+          "Expected an error reply to request 7, got %r" % reply)
+
+
+def testQueryCutShort():
+    body = struct.pack("=IHH", 8, len(queryPod), 1) + queryPod
+    reply = sendFrame(body, len(body) + 100)
+    check(reply == "", "Replied to a frame cut short: %r" % reply)
+    reply = sendFrame(struct.pack("=I", 9))
+    check(reply == "", "Replied to a frame too short for its header: %r" % reply)
+
+
+daemon = subprocess.Popen(["./podqueryd", "-s", querySocket],
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+for i in range(100):
+    if os.path.exists(querySocket):
+        break
+    time.sleep(0.05)
+record("query: looking up paths through podqueryd", testQuery)
+record("query: a request without the paths it counts", testQueryTooFewPaths)
+record("query: frames cut short", testQueryCutShort)
+record("query: still serving after bad frames", testQuery)
+daemon.terminate()
+daemonOutput = daemon.communicate()[0]
+record("query: podqueryd stopping cleanly",
+       lambda: check(daemon.returncode == 0 and ", 1 errors;" in daemonOutput,
+                     "podqueryd gave status %d: %s" % (daemon.returncode, daemonOutput)))
+shutil.rmtree(tmpdir)
+
 print
 print "     %d tests passed" % (len([r for r in results if r[0] == 0]))
 print "     %d tests failed" % (len([r for r in results if r[0] != 0]))